@@ -1,84 +1,28 @@
 //=====[Libraries]=============================================================
 #include <stdio.h>
-#include <string.h>
 
 #include "esp_log.h"
-#include "esp_wifi.h"
 #include "esp_event.h"
+#include "esp_netif.h"
 #include "nvs_flash.h"
-#include "wifi_provisioning/manager.h"
-#include "wifi_provisioning/scheme_ble.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/event_groups.h"
 
-#include "qrcode.h"
+#include "provisioning.h"
 
 //=====[Declaration of private defines]========================================
 
-// Los siguientes 2 defines estan hardcodeados pero no deberian estarlo para produccion
-#define EXAMPLE_PROV_SEC2_USERNAME "wifiprov"
-#define EXAMPLE_PROV_SEC2_PWD "abcd1234"
-
-#define PROV_QR_VERSION "v1"
-#define PROV_TRANSPORT_BLE "ble"
-#define QRCODE_BASE_URL "https://espressif.github.io/esp-jumpstart/qrcode.html"
-
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of private global constants]============
 
 static const char *TAG = "wifi-provisioning-ble";
 
-// Las siguientes constantes estan hardcodeados pero no deberian estarlo para produccion
-static const char sec2_salt[] = {
-    0x03, 0x6e, 0xe0, 0xc7, 0xbc, 0xb9, 0xed, 0xa8, 0x4c, 0x9e, 0xac, 0x97, 0xd9, 0x3d, 0xec, 0xf4};
-
-static const char sec2_verifier[] = {
-    0x7c, 0x7c, 0x85, 0x47, 0x65, 0x08, 0x94, 0x6d, 0xd6, 0x36, 0xaf, 0x37, 0xd7, 0xe8, 0x91, 0x43,
-    0x78, 0xcf, 0xfd, 0x61, 0x6c, 0x59, 0xd2, 0xf8, 0x39, 0x08, 0x12, 0x72, 0x38, 0xde, 0x9e, 0x24,
-    0xa4, 0x70, 0x26, 0x1c, 0xdf, 0xa9, 0x03, 0xc2, 0xb2, 0x70, 0xe7, 0xb1, 0x32, 0x24, 0xda, 0x11,
-    0x1d, 0x97, 0x18, 0xdc, 0x60, 0x72, 0x08, 0xcc, 0x9a, 0xc9, 0x0c, 0x48, 0x27, 0xe2, 0xae, 0x89,
-    0xaa, 0x16, 0x25, 0xb8, 0x04, 0xd2, 0x1a, 0x9b, 0x3a, 0x8f, 0x37, 0xf6, 0xe4, 0x3a, 0x71, 0x2e,
-    0xe1, 0x27, 0x86, 0x6e, 0xad, 0xce, 0x28, 0xff, 0x54, 0x46, 0x60, 0x1f, 0xb9, 0x96, 0x87, 0xdc,
-    0x57, 0x40, 0xa7, 0xd4, 0x6c, 0xc9, 0x77, 0x54, 0xdc, 0x16, 0x82, 0xf0, 0xed, 0x35, 0x6a, 0xc4,
-    0x70, 0xad, 0x3d, 0x90, 0xb5, 0x81, 0x94, 0x70, 0xd7, 0xbc, 0x65, 0xb2, 0xd5, 0x18, 0xe0, 0x2e,
-    0xc3, 0xa5, 0xf9, 0x68, 0xdd, 0x64, 0x7b, 0xb8, 0xb7, 0x3c, 0x9c, 0xfc, 0x00, 0xd8, 0x71, 0x7e,
-    0xb7, 0x9a, 0x7c, 0xb1, 0xb7, 0xc2, 0xc3, 0x18, 0x34, 0x29, 0x32, 0x43, 0x3e, 0x00, 0x99, 0xe9,
-    0x82, 0x94, 0xe3, 0xd8, 0x2a, 0xb0, 0x96, 0x29, 0xb7, 0xdf, 0x0e, 0x5f, 0x08, 0x33, 0x40, 0x76,
-    0x52, 0x91, 0x32, 0x00, 0x9f, 0x97, 0x2c, 0x89, 0x6c, 0x39, 0x1e, 0xc8, 0x28, 0x05, 0x44, 0x17,
-    0x3f, 0x68, 0x02, 0x8a, 0x9f, 0x44, 0x61, 0xd1, 0xf5, 0xa1, 0x7e, 0x5a, 0x70, 0xd2, 0xc7, 0x23,
-    0x81, 0xcb, 0x38, 0x68, 0xe4, 0x2c, 0x20, 0xbc, 0x40, 0x57, 0x76, 0x17, 0xbd, 0x08, 0xb8, 0x96,
-    0xbc, 0x26, 0xeb, 0x32, 0x46, 0x69, 0x35, 0x05, 0x8c, 0x15, 0x70, 0xd9, 0x1b, 0xe9, 0xbe, 0xcc,
-    0xa9, 0x38, 0xa6, 0x67, 0xf0, 0xad, 0x50, 0x13, 0x19, 0x72, 0x64, 0xbf, 0x52, 0xc2, 0x34, 0xe2,
-    0x1b, 0x11, 0x79, 0x74, 0x72, 0xbd, 0x34, 0x5b, 0xb1, 0xe2, 0xfd, 0x66, 0x73, 0xfe, 0x71, 0x64,
-    0x74, 0xd0, 0x4e, 0xbc, 0x51, 0x24, 0x19, 0x40, 0x87, 0x0e, 0x92, 0x40, 0xe6, 0x21, 0xe7, 0x2d,
-    0x4e, 0x37, 0x76, 0x2f, 0x2e, 0xe2, 0x68, 0xc7, 0x89, 0xe8, 0x32, 0x13, 0x42, 0x06, 0x84, 0x84,
-    0x53, 0x4a, 0xb3, 0x0c, 0x1b, 0x4c, 0x8d, 0x1c, 0x51, 0x97, 0x19, 0xab, 0xae, 0x77, 0xff, 0xdb,
-    0xec, 0xf0, 0x10, 0x95, 0x34, 0x33, 0x6b, 0xcb, 0x3e, 0x84, 0x0f, 0xb9, 0xd8, 0x5f, 0xb8, 0xa0,
-    0xb8, 0x55, 0x53, 0x3e, 0x70, 0xf7, 0x18, 0xf5, 0xce, 0x7b, 0x4e, 0xbf, 0x27, 0xce, 0xce, 0xa8,
-    0xb3, 0xbe, 0x40, 0xc5, 0xc5, 0x32, 0x29, 0x3e, 0x71, 0x64, 0x9e, 0xde, 0x8c, 0xf6, 0x75, 0xa1,
-    0xe6, 0xf6, 0x53, 0xc8, 0x31, 0xa8, 0x78, 0xde, 0x50, 0x40, 0xf7, 0x62, 0xde, 0x36, 0xb2, 0xba};
-
-static const EventBits_t WIFI_CONNECTED_EVENT = BIT0;
-
 //=====[Declaration and initialization of private global variables]============
 
-static EventGroupHandle_t wifi_event_group;
-
 //=====[Declarations (prototypes) of private functions]========================
 
-static esp_err_t example_get_sec2_salt(const char **salt, uint16_t *salt_len);
-
-static esp_err_t example_get_sec2_verifier(const char **verifier, uint16_t *verifier_len);
-
-static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
-
-static void get_device_service_name(char *service_name, size_t max);
-
-static void wifi_prov_print_qr(const char *name, const char *username, const char *pop);
-
 //=====[Implementations of public functions]===================================
 
 void app_main(void)
@@ -97,95 +41,13 @@ void app_main(void)
 
     // Inicializa el loop de eventos del sistema
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    wifi_event_group = xEventGroupCreate();
-    configASSERT(wifi_event_group != NULL);
-    ESP_ERROR_CHECK(esp_event_handler_register(
-        WIFI_PROV_EVENT,
-        ESP_EVENT_ANY_ID,
-        &event_handler,
-        NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(
-        PROTOCOMM_TRANSPORT_BLE_EVENT,
-        ESP_EVENT_ANY_ID,
-        &event_handler,
-        NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(
-        PROTOCOMM_SECURITY_SESSION_EVENT,
-        ESP_EVENT_ANY_ID,
-        &event_handler,
-        NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(
-        WIFI_EVENT,
-        ESP_EVENT_ANY_ID,
-        &event_handler,
-        NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(
-        IP_EVENT,
-        IP_EVENT_STA_GOT_IP,
-        &event_handler,
-        NULL));
-
-    // Inicializa la interfaz Wi-Fi con la configuracion por defecto
-    esp_netif_create_default_wifi_sta();
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    // Configura el provisioning manager
-    wifi_prov_mgr_config_t config = {
-        .scheme = wifi_prov_scheme_ble,
-        .scheme_event_handler = WIFI_PROV_SCHEME_BLE_EVENT_HANDLER_FREE_BTDM,
-    };
-
-    // Inicializa el provisioning manager con la configuracion anterior
-    ESP_ERROR_CHECK(wifi_prov_mgr_init(config));
-    bool provisioned = false;
-
-    // Verifica si al dispositivo ya se le habia hecho el provisioning
-    ESP_ERROR_CHECK(wifi_prov_mgr_is_provisioned(&provisioned));
 
-    if (!provisioned)
-    {
-        ESP_LOGI(TAG, "Starting provisioning");
-
-        // Obtiene el device name para BLE
-        char service_name[12];
-        get_device_service_name(service_name, sizeof(service_name));
-
-        // Configura el nivel de seguridad (0, 1, o 2) para la sesion que se establece con el dispositivo que hara el provisioning
-        wifi_prov_security_t security = WIFI_PROV_SECURITY_2;
-
-        // username y pop para generar el QR junto al service_name
-        const char *username = EXAMPLE_PROV_SEC2_USERNAME;
-        const char *pop = EXAMPLE_PROV_SEC2_PWD;
-
-        // Configura los parametros que se utilizan durante la sesion con el nivel de seguridad 2
-        wifi_prov_security2_params_t sec2_params = {};
-        ESP_ERROR_CHECK(example_get_sec2_salt(&sec2_params.salt, &sec2_params.salt_len));
-        ESP_ERROR_CHECK(example_get_sec2_verifier(&sec2_params.verifier, &sec2_params.verifier_len));
-        wifi_prov_security2_params_t *sec_params = &sec2_params;
-
-        // Configura el UUID que proveera las caracteristicas en la capa GATT para el provisioning y que se incluira en los paquetes publicitarios BLE del dispositivo
-        uint8_t custom_service_uuid[] = {
-            0xb4, 0xdf, 0x5a, 0x1c, 0x3f, 0x6b, 0xf4, 0xbf, 0xea, 0x4a, 0x82, 0x03, 0x04, 0x90, 0x1a, 0x02};
-        ESP_ERROR_CHECK(wifi_prov_scheme_ble_set_service_uuid(custom_service_uuid));
-
-        // Arranca el provisioning manager
-        ESP_ERROR_CHECK(wifi_prov_mgr_start_provisioning(security, (const void *)sec_params, service_name, NULL));
-
-        // Muestra el QR
-        wifi_prov_print_qr(service_name, username, pop);
-    }
-    else
-    {
-        // Arranca la interfaz Wi-Fi en modo station
-        ESP_LOGI(TAG, "Already provisioned, starting Wi-Fi STA");
-        wifi_prov_mgr_deinit();
-        ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-        ESP_ERROR_CHECK(esp_wifi_start());
-    }
+    // Arranca el provisioning, o la conexion al AP si ya se habia hecho
+    // El nivel de seguridad, el origen de las credenciales y el transporte se eligen en el menuconfig
+    ESP_ERROR_CHECK(provisioning_start());
 
     // Espera a que se finalice la conexion Wi-Fi
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_EVENT, pdTRUE, pdTRUE, portMAX_DELAY);
+    provisioning_wait_connected(portMAX_DELAY);
 
     // Loop infinito
     while (1)
@@ -195,165 +57,4 @@ void app_main(void)
     }
 }
 
-//=====[Implementations of private functions]==================================
-
-static esp_err_t example_get_sec2_salt(const char **salt, uint16_t *salt_len)
-{
-    ESP_LOGI(TAG, "Development mode: using hard coded salt");
-    *salt = sec2_salt;
-    *salt_len = sizeof(sec2_salt);
-    return ESP_OK;
-}
-
-static esp_err_t example_get_sec2_verifier(const char **verifier, uint16_t *verifier_len)
-{
-    ESP_LOGI(TAG, "Development mode: using hard coded verifier");
-    *verifier = sec2_verifier;
-    *verifier_len = sizeof(sec2_verifier);
-    return ESP_OK;
-}
-
-static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
-{
-    // Eventos del provisioning manger
-    static int retries;
-    if (event_base == WIFI_PROV_EVENT)
-    {
-        switch (event_id)
-        {
-        case WIFI_PROV_START:
-            ESP_LOGI(TAG, "Provisioning started");
-            break;
-        case WIFI_PROV_CRED_RECV:
-        {
-            wifi_sta_config_t *wifi_sta_cfg = (wifi_sta_config_t *)event_data;
-            ESP_LOGI(TAG, "Received Wi-Fi credentials"
-                          "\n\tSSID     : %s\n\tPassword : %s",
-                     (const char *)wifi_sta_cfg->ssid,
-                     (const char *)wifi_sta_cfg->password);
-            break;
-        }
-        case WIFI_PROV_CRED_FAIL:
-        {
-            wifi_prov_sta_fail_reason_t *reason = (wifi_prov_sta_fail_reason_t *)event_data;
-            ESP_LOGE(TAG, "Provisioning failed!\n\tReason : %s"
-                          "\n\tPlease reset to factory and retry provisioning",
-                     (*reason == WIFI_PROV_STA_AUTH_ERROR) ? "Wi-Fi station authentication failed" : "Wi-Fi access-point not found");
-            retries++;
-            if (retries >= 5)
-            {
-                ESP_LOGI(TAG, "Failed to connect with provisioned AP, reseting provisioned credentials");
-                ESP_ERROR_CHECK(wifi_prov_mgr_reset_sm_state_on_failure());
-                retries = 0;
-            }
-            break;
-        }
-        case WIFI_PROV_CRED_SUCCESS:
-            ESP_LOGI(TAG, "Provisioning successful");
-            retries = 0;
-            break;
-        case WIFI_PROV_END:
-            wifi_prov_mgr_deinit();
-            break;
-        default:
-            break;
-        }
-    }
-
-    // Eventos del Wi-Fi
-    else if (event_base == WIFI_EVENT)
-    {
-        switch (event_id)
-        {
-        case WIFI_EVENT_STA_START:
-            // No usar la macro ESP_ERROR_CHECK porque reinicia el dispositivo en caso de que aun no se haya hecho el provisioning
-            esp_wifi_connect();
-            break;
-        case WIFI_EVENT_STA_DISCONNECTED:
-            ESP_LOGI(TAG, "Disconnected. Connecting to the AP again...");
-            esp_wifi_connect();
-            break;
-        default:
-            break;
-        }
-    }
-
-    // Evento al obtener direccion IP
-    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
-    {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "Connected with IP Address:" IPSTR, IP2STR(&event->ip_info.ip));
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_EVENT);
-    }
-
-    // Eventos BLE
-    else if (event_base == PROTOCOMM_TRANSPORT_BLE_EVENT)
-    {
-        switch (event_id)
-        {
-        case PROTOCOMM_TRANSPORT_BLE_CONNECTED:
-            ESP_LOGI(TAG, "BLE transport: Connected!");
-            break;
-        case PROTOCOMM_TRANSPORT_BLE_DISCONNECTED:
-            ESP_LOGI(TAG, "BLE transport: Disconnected!");
-            break;
-        default:
-            break;
-        }
-    }
-
-    // Eventos de la sesion con el dispositivo que hara el provisioning
-    else if (event_base == PROTOCOMM_SECURITY_SESSION_EVENT)
-    {
-        switch (event_id)
-        {
-        case PROTOCOMM_SECURITY_SESSION_SETUP_OK:
-            ESP_LOGI(TAG, "Secured session established!");
-            break;
-        case PROTOCOMM_SECURITY_SESSION_INVALID_SECURITY_PARAMS:
-            ESP_LOGE(TAG, "Received invalid security parameters for establishing secure session!");
-            break;
-        case PROTOCOMM_SECURITY_SESSION_CREDENTIALS_MISMATCH:
-            ESP_LOGE(TAG, "Received incorrect username and/or PoP for establishing secure session!");
-            break;
-        default:
-            break;
-        }
-    }
-}
-
-static void get_device_service_name(char *service_name, size_t max)
-{
-    // Genera un device name distinto para cada dispositivo porque el resultado depende de la MAC
-    uint8_t eth_mac[6];
-    const char *ssid_prefix = "PROV_";
-    ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, eth_mac));
-    snprintf(service_name, max, "%s%02X%02X%02X",
-             ssid_prefix, eth_mac[3], eth_mac[4], eth_mac[5]);
-}
-
-static void wifi_prov_print_qr(const char *name, const char *username, const char *pop)
-{
-    if (!name)
-    {
-        ESP_LOGW(TAG, "Cannot generate QR code payload. Data missing.");
-        return;
-    }
-    char payload[150] = {0};
-    if (pop)
-    {
-        snprintf(payload, sizeof(payload), "{\"ver\":\"%s\",\"name\":\"%s\""
-                                           ",\"username\":\"%s\",\"pop\":\"%s\",\"transport\":\"%s\"}",
-                 PROV_QR_VERSION, name, username, pop, PROV_TRANSPORT_BLE);
-    }
-    else
-    {
-        snprintf(payload, sizeof(payload), "{\"ver\":\"%s\",\"name\":\"%s\""
-                                           ",\"transport\":\"%s\"}",
-                 PROV_QR_VERSION, name, PROV_TRANSPORT_BLE);
-    }
-    ESP_LOGI(TAG, "Scan this QR code from the provisioning application for Provisioning.");
-    esp_qrcode_config_t cfg = ESP_QRCODE_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_qrcode_generate(&cfg, payload));
-    ESP_LOGI(TAG, "If QR code is not visible, copy paste the below URL in a browser.\n%s?data=%s", QRCODE_BASE_URL, payload);
-}
\ No newline at end of file
+//=====[Implementations of private functions]==================================
\ No newline at end of file
@@ -0,0 +1,734 @@
+//=====[Libraries]=============================================================
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "nvs_flash.h"
+#include "wifi_provisioning/manager.h"
+#include "driver/gpio.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "provisioning.h"
+#include "sampling.h"
+#include "actuator_cmd.h"
+#include "metrics.h"
+#include "roaming.h"
+#include "time_sync.h"
+#include "ota.h"
+#include "duty_cycle.h"
+#include "phy_cal.h"
+#include "app_events.h"
+#include "cloud_conn.h"
+#include "event_recorder.h"
+#include "mem_pool.h"
+#include "ts_codec.h"
+#include "analytics.h"
+#if CONFIG_PROV_RESUME
+#include "prov_resume.h"
+#endif
+
+//=====[Declaration of private defines]========================================
+
+// LED de la placa, se usa como actuador
+#define ACTUATOR_GPIO GPIO_NUM_2
+
+// Tiempo maximo para obtener el primer bloque de muestras al despertar
+#define DUTY_CYCLE_SAMPLE_TIMEOUT_MS 100
+
+// Canales de la conexion con el servidor
+#define CLOUD_CHANNEL_SAMPLES 0
+#define CLOUD_CHANNEL_RULES 1
+#define CLOUD_CHANNEL_ACTUATOR 2
+#define CLOUD_CHANNEL_DUTY_CYCLE 3
+
+// Cada evento o resumen del analisis lleva el tipo, la muestra, el EWMA, el promedio, el desvio y el minimo y maximo de la ventana
+#define SAMPLES_CHANNELS 7
+
+// Lo que ocuparia enviar cada muestra decimada con su timestamp, sin analizar ni comprimir
+#define SAMPLES_RAW_RECORD_LEN (sizeof(int64_t) + sizeof(int32_t))
+
+// Periodo de las muestras decimadas que recibe el analisis
+#define SAMPLING_PERIOD_US (1000000ULL * CONFIG_SAMPLING_CIC_RATIO * CONFIG_SAMPLING_FIR_RATIO / CONFIG_SAMPLING_RATE_HZ)
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "sensor-node";
+
+//=====[Declaration and initialization of private global variables]============
+
+// Metricas de operacion del dispositivo
+static metrics_counter_t wifi_reconnects;
+static metrics_counter_t prov_failures;
+static metrics_histogram_t time_to_ip_ms = METRICS_HISTOGRAM_INIT(500, 1000, 2000, 4000, 8000, 16000, 32000);
+static metrics_histogram_t srp_handshake_ms = METRICS_HISTOGRAM_INIT(250, 500, 1000, 2000, 4000, 8000);
+static metrics_counter_t samples_raw_bytes;
+static metrics_counter_t samples_encoded_bytes;
+
+// Las salidas del analisis se comprimen en un bloque del tamano de un envio
+static ts_codec_encoder_t samples_encoder;
+static uint8_t samples_block[CLOUD_CONN_UPLINK_MAX];
+_Static_assert(CLOUD_CONN_UPLINK_MAX >= TS_CODEC_HEADER_LEN + TS_CODEC_RECORD_MAX(SAMPLES_CHANNELS), "An uplink must fit one analytics output");
+
+// Apaga el actuador al vencer la duracion de un comando SET
+static esp_timer_handle_t actuator_timer = NULL;
+
+static int64_t connect_start_us = 0;
+static int64_t ble_connected_us = 0;
+
+#if CONFIG_DUTY_CYCLE_ENABLE
+static TaskHandle_t duty_cycle_task = NULL;
+#endif
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void events_init(void);
+
+static void recorder_init(void);
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static void on_sampling_block(const sampling_block_t *block, void *ctx);
+
+static void uplink_output(const analytics_output_t *output);
+
+static void flush_samples(void);
+
+static void on_actuator_cmd(const actuator_cmd_t *cmd, void *ctx);
+
+static void on_actuator_timeout(void *arg);
+
+static void on_cloud_command(uint8_t channel, const uint8_t *data, size_t len, void *ctx);
+
+static void on_cloud_tx(bool ok, void *ctx);
+
+static void metrics_init(void);
+
+static void app_collector(metrics_writer_t *writer, void *ctx);
+
+#if CONFIG_DUTY_CYCLE_ENABLE
+static void run_duty_cycle(void) __attribute__((noreturn));
+
+static esp_err_t sample_once(duty_cycle_record_t *record);
+
+static void on_duty_cycle_block(const sampling_block_t *block, void *ctx);
+
+#if CONFIG_DUTY_CYCLE_CLOUD_CONN
+static esp_err_t send_duty_cycle_packet(const uint8_t *packet, size_t len, void *ctx);
+#endif
+#endif
+
+//=====[Implementations of public functions]===================================
+
+void app_main(void)
+{
+#if CONFIG_DUTY_CYCLE_ENABLE
+    duty_cycle_mark(DUTY_CYCLE_PHASE_BOOT);
+#endif
+
+    // Inicializa el Non-Volatile-Storage
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+
+    // Recupera la hora mantenida por el RTC si el dispositivo viene de un deep sleep
+    time_sync_init();
+
+    // Inicializa el stack TCP/IP
+    ESP_ERROR_CHECK(esp_netif_init());
+
+    // Registra las metricas antes de que lleguen los primeros eventos
+    metrics_init();
+
+    // Inicializa el loop de eventos del sistema y el de la aplicacion
+    // En el loop por defecto solo quedan los handlers del Wi-Fi, los de la aplicacion van a su propio loop
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    recorder_init();
+    events_init();
+
+    // Si la imagen es nueva, arranca el plazo para confirmarla al obtener la direccion IP
+    ESP_ERROR_CHECK(ota_init());
+
+    // Calibra el RF antes de arrancar el Wi-Fi, con los datos guardados si siguen siendo validos
+    ESP_ERROR_CHECK(phy_cal_init());
+
+#if CONFIG_DUTY_CYCLE_ENABLE
+    // En modo duty cycle el dispositivo muestrea, envia y vuelve al deep sleep
+    run_duty_cycle();
+#endif
+
+    // Arranca el provisioning, o la conexion al AP si ya se habia hecho
+    ESP_ERROR_CHECK(provisioning_start());
+
+    // Espera a que se finalice la conexion Wi-Fi
+    provisioning_wait_connected(portMAX_DELAY);
+
+    // Sincroniza la hora apenas se obtiene la direccion IP para que los bloques tengan timestamps validos
+    ESP_ERROR_CHECK(time_sync_start());
+    if (time_sync_wait(pdMS_TO_TICKS(CONFIG_TIME_SYNC_WAIT_MS)) != ESP_OK && !time_sync_is_valid())
+    {
+        ESP_LOGW(TAG, "No valid time yet, samples keep the time since boot until SNTP answers");
+    }
+
+    // Arranca la tarea del actuador y abre el endpoint UDP de comandos
+    // Va antes de la conexion con el servidor, que tambien le pasa comandos a la tarea del actuador
+    gpio_reset_pin(ACTUATOR_GPIO);
+    gpio_set_direction(ACTUATOR_GPIO, GPIO_MODE_OUTPUT);
+    const esp_timer_create_args_t actuator_timer_args = {
+        .callback = on_actuator_timeout,
+        .name = "actuator",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&actuator_timer_args, &actuator_timer));
+    actuator_cmd_config_t actuator_cfg = {
+        .handler = on_actuator_cmd,
+        .ctx = NULL,
+    };
+    // Sin la clave del dispositivo en el NVS el nodo sigue funcionando y el actuador solo responde a la nube
+    err = actuator_cmd_start(&actuator_cfg);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting the command endpoint, running without it", esp_err_to_name(err));
+    }
+
+    // Abre la conexion con el servidor, retomando la sesion TLS guardada si la hay
+    // Se abre despues del SNTP porque la validez del certificado depende de la hora
+    cloud_conn_config_t cloud_cfg = {
+        .on_command = on_cloud_command,
+        .on_tx = on_cloud_tx,
+        .ctx = NULL,
+    };
+    // Sin CA ni PSK, o sin memoria, el nodo sigue funcionando sin la conexion: los datos salientes se descartan
+    // y el actuador se sigue manejando por el endpoint UDP
+    err = cloud_conn_start(&cloud_cfg);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting the cloud connection, running without it", esp_err_to_name(err));
+    }
+
+    // Arranca el analisis con las reglas guardadas en el NVS y el muestreo continuo del ADC
+    ESP_ERROR_CHECK(analytics_start());
+    ts_codec_config_t codec_cfg = {
+        .channels = SAMPLES_CHANNELS,
+        .mode = TS_CODEC_DELTA,
+        .dictionary = true,
+    };
+    ts_codec_encoder_init(&samples_encoder, &codec_cfg, samples_block, sizeof(samples_block));
+    sampling_config_t sampling_cfg = {
+        .on_block = on_sampling_block,
+        .ctx = NULL,
+    };
+    ESP_ERROR_CHECK(sampling_start(&sampling_cfg));
+
+    // Arranca el monitor de calidad del enlace para hacer roaming antes de perder la conexion
+    ESP_ERROR_CHECK(roaming_start());
+
+    // Publica las metricas en formato Prometheus
+    ESP_ERROR_CHECK(metrics_server_start());
+
+    // Consulta periodicamente si hay un parche para la imagen en ejecucion. Sin la CA del servidor de
+    // actualizaciones el nodo sigue funcionando sin OTA
+    err = ota_start();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting OTA updates, running without them", esp_err_to_name(err));
+    }
+
+    // Envia las salidas del analisis: los eventos apenas ocurren y los resumenes cuando se llena un bloque
+    while (1)
+    {
+        analytics_output_t output;
+        if (analytics_receive(&output, portMAX_DELAY) == ESP_OK)
+        {
+            uplink_output(&output);
+        }
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+static void events_init(void)
+{
+    ESP_ERROR_CHECK(app_events_init());
+
+    // Eventos del sistema que se reenvian al loop de la aplicacion
+    ESP_ERROR_CHECK(app_events_forward(WIFI_PROV_EVENT, WIFI_PROV_START, 0));
+    ESP_ERROR_CHECK(app_events_forward(WIFI_PROV_EVENT, WIFI_PROV_CRED_RECV, sizeof(wifi_sta_config_t)));
+    ESP_ERROR_CHECK(app_events_forward(WIFI_PROV_EVENT, WIFI_PROV_CRED_FAIL, sizeof(wifi_prov_sta_fail_reason_t)));
+    ESP_ERROR_CHECK(app_events_forward(WIFI_PROV_EVENT, WIFI_PROV_CRED_SUCCESS, 0));
+    ESP_ERROR_CHECK(app_events_forward(PROTOCOMM_TRANSPORT_BLE_EVENT, ESP_EVENT_ANY_ID, 0));
+    ESP_ERROR_CHECK(app_events_forward(PROTOCOMM_SECURITY_SESSION_EVENT, ESP_EVENT_ANY_ID, 0));
+    ESP_ERROR_CHECK(app_events_forward(WIFI_EVENT, WIFI_EVENT_STA_START, 0));
+    ESP_ERROR_CHECK(app_events_forward(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, 0));
+    ESP_ERROR_CHECK(app_events_forward(IP_EVENT, IP_EVENT_STA_GOT_IP, sizeof(ip_event_got_ip_t)));
+
+    // Los logs del provisioning y las metricas se atienden en el loop de la aplicacion
+    ESP_ERROR_CHECK(app_events_register(ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, provisioning_log_event_handler, NULL, "provisioning_log"));
+    ESP_ERROR_CHECK(app_events_register(ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, event_handler, NULL, "app_metrics"));
+}
+
+static void recorder_init(void)
+{
+    // Graba los eventos del loop por defecto para reproducirlos en la PC con tools/event-replay
+    ESP_ERROR_CHECK(event_recorder_start());
+
+    // Se guardan los payloads que usa el replay, nunca el de WIFI_PROV_CRED_RECV porque tiene la contrasena
+    ESP_ERROR_CHECK(event_recorder_set_payload_size(WIFI_PROV_EVENT, WIFI_PROV_CRED_FAIL, sizeof(wifi_prov_sta_fail_reason_t)));
+    ESP_ERROR_CHECK(event_recorder_set_payload_size(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, sizeof(wifi_event_sta_disconnected_t)));
+    ESP_ERROR_CHECK(event_recorder_set_payload_size(IP_EVENT, IP_EVENT_STA_GOT_IP, sizeof(ip_event_got_ip_t)));
+}
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // Fallas del provisioning, la grabacion se guarda para analizar la secuencia que llevo a la falla
+    if (event_base == WIFI_PROV_EVENT && event_id == WIFI_PROV_CRED_FAIL)
+    {
+        metrics_counter_inc(&prov_failures);
+        event_recorder_save();
+    }
+
+    // Eventos del Wi-Fi
+    else if (event_base == WIFI_EVENT)
+    {
+        switch (event_id)
+        {
+        case WIFI_EVENT_STA_START:
+            connect_start_us = esp_timer_get_time();
+            break;
+        case WIFI_EVENT_STA_DISCONNECTED:
+            metrics_counter_inc(&wifi_reconnects);
+            // El tiempo hasta obtener la IP se mide desde la primera desconexion de la serie
+            if (connect_start_us == 0)
+            {
+                connect_start_us = esp_timer_get_time();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Evento al obtener direccion IP
+    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
+    {
+        if (connect_start_us != 0)
+        {
+            metrics_histogram_observe(&time_to_ip_ms, (uint32_t)((esp_timer_get_time() - connect_start_us) / 1000));
+            connect_start_us = 0;
+        }
+    }
+
+    // El handshake SRP6a empieza apenas se conecta el cliente BLE
+    else if (event_base == PROTOCOMM_TRANSPORT_BLE_EVENT && event_id == PROTOCOMM_TRANSPORT_BLE_CONNECTED)
+    {
+        ble_connected_us = esp_timer_get_time();
+    }
+    else if (event_base == PROTOCOMM_SECURITY_SESSION_EVENT && event_id == PROTOCOMM_SECURITY_SESSION_SETUP_OK)
+    {
+        if (ble_connected_us != 0)
+        {
+            metrics_histogram_observe(&srp_handshake_ms, (uint32_t)((esp_timer_get_time() - ble_connected_us) / 1000));
+            ble_connected_us = 0;
+        }
+    }
+}
+
+static void on_sampling_block(const sampling_block_t *block, void *ctx)
+{
+    // Se ejecuta en la tarea de muestreo: el analisis no bloquea y solo se loguea uno de cada 64 bloques
+    int64_t unix_us = time_sync_to_unix_us(block->timestamp_us);
+    analytics_process(unix_us, block->samples, block->count, SAMPLING_PERIOD_US);
+    metrics_counter_add(&samples_raw_bytes, block->count * SAMPLES_RAW_RECORD_LEN);
+    if ((block->sequence & 0x3F) == 0)
+    {
+        ESP_LOGI(TAG, "Block %" PRIu32 " at %lld ms: n=%u min=%" PRId32 " max=%" PRId32 " mean=%" PRId32,
+                 block->sequence, (long long)(unix_us / 1000), (unsigned)block->count, block->stats.min,
+                 block->stats.max, block_stats_mean(&block->stats));
+    }
+}
+
+static void uplink_output(const analytics_output_t *output)
+{
+    int32_t values[SAMPLES_CHANNELS] = {
+        (int32_t)output->kind,
+        output->value,
+        output->ewma,
+        output->mean,
+        (int32_t)output->stddev,
+        output->window_min,
+        output->window_max,
+    };
+    if (ts_codec_encoder_append(&samples_encoder, output->timestamp_ms, values) == TS_CODEC_ERR_FULL)
+    {
+        // El bloque lleno se envia y la salida empieza el siguiente
+        flush_samples();
+        ts_codec_encoder_append(&samples_encoder, output->timestamp_ms, values);
+    }
+
+    // Los resumenes esperan a llenar el bloque para comprimirse mejor, los eventos salen con los que estaban
+    if (output->kind != ANALYTICS_OUTPUT_SUMMARY)
+    {
+        flush_samples();
+    }
+}
+
+static void flush_samples(void)
+{
+    cloud_conn_send(CLOUD_CHANNEL_SAMPLES, samples_block, samples_encoder.len);
+    metrics_counter_add(&samples_encoded_bytes, samples_encoder.len);
+    ts_codec_encoder_reset(&samples_encoder);
+}
+
+static void on_actuator_cmd(const actuator_cmd_t *cmd, void *ctx)
+{
+    // Solo hay un actuador, el resto de los ids se ignoran
+    if (cmd->actuator != 0)
+    {
+        return;
+    }
+    // Cada comando reemplaza al anterior, incluida su duracion
+    esp_timer_stop(actuator_timer);
+    switch (cmd->op)
+    {
+    case ACTUATOR_OP_SET:
+        gpio_set_level(ACTUATOR_GPIO, cmd->value ? 1 : 0);
+        if (cmd->value && cmd->duration_ms > 0)
+        {
+            esp_timer_start_once(actuator_timer, (uint64_t)cmd->duration_ms * 1000);
+        }
+        break;
+    case ACTUATOR_OP_STOP:
+        gpio_set_level(ACTUATOR_GPIO, 0);
+        break;
+    default:
+        break;
+    }
+}
+
+static void on_actuator_timeout(void *arg)
+{
+    gpio_set_level(ACTUATOR_GPIO, 0);
+}
+
+static void on_cloud_command(uint8_t channel, const uint8_t *data, size_t len, void *ctx)
+{
+    // El comando llega por TLS, no necesita la autenticacion del endpoint UDP
+    if (channel == CLOUD_CHANNEL_RULES)
+    {
+        // Las reglas llegan como texto "clave=valor", las claves que no se mencionan no cambian
+        analytics_rules_t rules;
+        analytics_get_rules(&rules);
+        if (analytics_rules_parse(&rules, (const char *)data, len) != 0 || analytics_set_rules(&rules) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Invalid analytics rules: %.*s", (int)len, (const char *)data);
+        }
+        return;
+    }
+    if (channel != CLOUD_CHANNEL_ACTUATOR || len < 1)
+    {
+        return;
+    }
+
+    // Se ejecuta en la tarea del actuador, igual que los comandos del endpoint UDP, asi no se pisan
+    actuator_cmd_t cmd = {
+        .actuator = 0,
+        .op = ACTUATOR_OP_SET,
+        .value = data[0] ? 1 : 0,
+        .duration_ms = 0,
+    };
+    esp_err_t err = actuator_cmd_post(&cmd);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Error (%s) posting the actuator command", esp_err_to_name(err));
+    }
+}
+
+static void on_cloud_tx(bool ok, void *ctx)
+{
+    // Una escritura que no se completa en el timeout del socket cuenta como falla de TX para el roaming
+    roaming_report_tx(ok);
+}
+
+static void metrics_init(void)
+{
+    ESP_ERROR_CHECK(metrics_register_counter(&wifi_reconnects, "wifi_reconnects_total", "Disconnections from the AP followed by a reconnect attempt"));
+    ESP_ERROR_CHECK(metrics_register_counter(&prov_failures, "provisioning_failures_total", "Provisioning attempts that failed to connect to the AP"));
+    ESP_ERROR_CHECK(metrics_register_histogram(&time_to_ip_ms, "wifi_time_to_ip_ms", "Time from station start or disconnection to IP acquisition"));
+    ESP_ERROR_CHECK(metrics_register_histogram(&srp_handshake_ms, "provisioning_srp_handshake_ms", "Time from BLE connection to secured session established"));
+    ESP_ERROR_CHECK(metrics_register_counter(&samples_raw_bytes, "samples_raw_bytes_total", "Bytes of the decimated samples with their timestamps, before analytics and compression"));
+    ESP_ERROR_CHECK(metrics_register_counter(&samples_encoded_bytes, "samples_encoded_bytes_total", "Compressed analytics output bytes queued for uplink"));
+    ESP_ERROR_CHECK(metrics_register_collector(app_collector, NULL));
+}
+
+static void app_collector(metrics_writer_t *writer, void *ctx)
+{
+    sampling_stats_t sampling;
+    sampling_get_stats(&sampling);
+    metrics_printf(writer, "# TYPE sampling_overruns_total counter\nsampling_overruns_total %" PRIu32 "\n", sampling.overruns);
+    metrics_printf(writer, "# TYPE sampling_max_process_us gauge\nsampling_max_process_us %" PRIu32 "\n", sampling.max_process_us);
+
+    analytics_stats_t analytics;
+    analytics_get_stats(&analytics);
+    metrics_printf(writer, "# TYPE analytics_samples_total counter\nanalytics_samples_total %" PRIu32 "\n", analytics.samples);
+    metrics_printf(writer, "# TYPE analytics_outputs_total counter\n");
+    for (int i = 0; i < ANALYTICS_OUTPUT_COUNT; i++)
+    {
+        metrics_printf(writer, "analytics_outputs_total{kind=\"%s\"} %" PRIu32 "\n", analytics_output_to_name(i), analytics.outputs[i]);
+    }
+    metrics_printf(writer, "# TYPE analytics_dropped_total counter\nanalytics_dropped_total %" PRIu32 "\n", analytics.dropped);
+    metrics_printf(writer, "# TYPE analytics_rule_updates_total counter\nanalytics_rule_updates_total %" PRIu32 "\n", analytics.rule_updates);
+
+    actuator_cmd_stats_t actuator;
+    actuator_cmd_get_stats(&actuator);
+    metrics_printf(writer, "# TYPE actuator_commands_total counter\nactuator_commands_total %" PRIu32 "\n", actuator.executed);
+    metrics_printf(writer, "# TYPE actuator_rejected_total counter\nactuator_rejected_total %" PRIu32 "\n", actuator.rejected);
+    metrics_printf(writer, "# TYPE actuator_max_latency_us gauge\nactuator_max_latency_us %" PRIu32 "\n", actuator.max_latency_us);
+    metrics_printf(writer, "# TYPE actuator_seq_store_failures_total counter\nactuator_seq_store_failures_total %" PRIu32 "\n", actuator.seq_store_failures);
+
+    roaming_stats_t roaming;
+    roaming_get_stats(&roaming);
+    metrics_printf(writer, "# TYPE wifi_rssi_smoothed_dbm gauge\nwifi_rssi_smoothed_dbm %d\n", roaming.rssi);
+    metrics_printf(writer, "# TYPE wifi_tx_fail_permille gauge\nwifi_tx_fail_permille %u\n", roaming.tx_fail_permille);
+    metrics_printf(writer, "# TYPE wifi_roam_requests_total counter\nwifi_roam_requests_total %" PRIu32 "\n", roaming.transition_requests);
+
+    time_sync_stats_t time_stats;
+    time_sync_get_stats(&time_stats);
+    metrics_printf(writer, "# TYPE time_first_sync_ms gauge\ntime_first_sync_ms %" PRIu32 "\n", time_stats.first_sync_ms);
+    metrics_printf(writer, "# TYPE time_syncs_total counter\ntime_syncs_total %" PRIu32 "\n", time_stats.syncs);
+
+    ota_stats_t ota;
+    ota_get_stats(&ota);
+    metrics_printf(writer, "# TYPE ota_checks_total counter\nota_checks_total %" PRIu32 "\n", ota.checks);
+    metrics_printf(writer, "# TYPE ota_failures_total counter\nota_failures_total %" PRIu32 "\n", ota.failures);
+
+    phy_cal_stats_t phy;
+    phy_cal_get_stats(&phy);
+    metrics_printf(writer, "# TYPE phy_calibration_us gauge\nphy_calibration_us{reason=\"%s\"} %" PRIu32 "\n",
+                   phy_cal_reason_to_name(phy.reason), phy.calibration_us);
+
+    app_events_stats_t events;
+    app_events_get_stats(&events);
+    metrics_printf(writer, "# TYPE app_events_max_queue_depth gauge\napp_events_max_queue_depth %" PRIu32 "\n", events.max_depth);
+    metrics_printf(writer, "# TYPE app_events_dropped_total counter\napp_events_dropped_total %" PRIu32 "\n", events.dropped);
+
+    cloud_conn_stats_t cloud;
+    cloud_conn_get_stats(&cloud);
+    metrics_printf(writer, "# TYPE cloud_connected gauge\ncloud_connected %d\n", cloud.connected ? 1 : 0);
+    metrics_printf(writer, "# TYPE cloud_last_handshake_ms gauge\ncloud_last_handshake_ms{kind=\"%s\"} %" PRIu32 "\n",
+                   cloud_link_handshake_to_name(cloud.last_handshake), cloud.last_handshake_ms);
+    metrics_printf(writer, "# TYPE cloud_handshakes_total counter\n");
+    for (int i = 0; i < CLOUD_LINK_HANDSHAKE_COUNT; i++)
+    {
+        metrics_printf(writer, "cloud_handshakes_total{kind=\"%s\"} %" PRIu32 "\n", cloud_link_handshake_to_name(i), cloud.handshakes[i]);
+    }
+    metrics_printf(writer, "# TYPE cloud_handshake_ms_total counter\n");
+    for (int i = 0; i < CLOUD_LINK_HANDSHAKE_COUNT; i++)
+    {
+        metrics_printf(writer, "cloud_handshake_ms_total{kind=\"%s\"} %" PRIu32 "\n", cloud_link_handshake_to_name(i), cloud.handshake_ms_total[i]);
+    }
+    metrics_printf(writer, "# TYPE cloud_connect_failures_total counter\ncloud_connect_failures_total %" PRIu32 "\n", cloud.failures);
+    metrics_printf(writer, "# TYPE cloud_uplink_dropped_total counter\ncloud_uplink_dropped_total %" PRIu32 "\n", cloud.dropped);
+
+    // Tiempos del provisioning por transporte, se agregan entre dispositivos para comparar el BLE con el SoftAP
+    provisioning_stats_t prov;
+    provisioning_get_stats(&prov);
+    if (prov.valid)
+    {
+        const char *transport = provisioning_transport_to_name(prov.transport);
+        metrics_printf(writer, "# TYPE provisioning_time_to_credentials_ms gauge\nprovisioning_time_to_credentials_ms{transport=\"%s\"} %" PRIu32 "\n",
+                       transport, prov.credentials_ms);
+        metrics_printf(writer, "# TYPE provisioning_time_to_ip_ms gauge\nprovisioning_time_to_ip_ms{transport=\"%s\"} %" PRIu32 "\n",
+                       transport, prov.connected_ms);
+        metrics_printf(writer, "# TYPE provisioning_first_contact_ms gauge\n");
+        for (int i = 0; i < PROVISIONING_TRANSPORT_COUNT; i++)
+        {
+            if (prov.first_contact_ms[i] != 0)
+            {
+                metrics_printf(writer, "provisioning_first_contact_ms{transport=\"%s\"} %" PRIu32 "\n",
+                               provisioning_transport_to_name(i), prov.first_contact_ms[i]);
+            }
+        }
+    }
+
+#if CONFIG_PROV_RESUME
+    // La tasa de reanudacion es hits / attempts, saved_ms contra handshake_ms muestra cuanto handshake se evito
+    prov_resume_stats_t resume;
+    prov_resume_get_stats(&resume);
+    metrics_printf(writer, "# TYPE provisioning_resume_attempts_total counter\nprovisioning_resume_attempts_total %" PRIu32 "\n", resume.attempts);
+    metrics_printf(writer, "# TYPE provisioning_resume_hits_total counter\nprovisioning_resume_hits_total %" PRIu32 "\n", resume.hits);
+    metrics_printf(writer, "# TYPE provisioning_resume_rejected_total counter\nprovisioning_resume_rejected_total %" PRIu32 "\n", resume.rejected);
+    metrics_printf(writer, "# TYPE provisioning_resume_expired_total counter\nprovisioning_resume_expired_total %" PRIu32 "\n", resume.expired);
+    metrics_printf(writer, "# TYPE provisioning_resume_evicted_total counter\nprovisioning_resume_evicted_total %" PRIu32 "\n", resume.evicted);
+    metrics_printf(writer, "# TYPE provisioning_resume_saved_ms_total counter\nprovisioning_resume_saved_ms_total %" PRIu32 "\n", resume.saved_ms_total);
+    metrics_printf(writer, "# TYPE provisioning_session_handshakes_total counter\nprovisioning_session_handshakes_total %" PRIu32 "\n", resume.handshakes);
+    metrics_printf(writer, "# TYPE provisioning_session_handshake_ms_total counter\nprovisioning_session_handshake_ms_total %" PRIu32 "\n", resume.handshake_ms_total);
+#endif
+
+    event_recorder_stats_t recorder;
+    event_recorder_get_stats(&recorder);
+    metrics_printf(writer, "# TYPE event_recorder_records_total counter\nevent_recorder_records_total %" PRIu32 "\n", recorder.records);
+    metrics_printf(writer, "# TYPE event_recorder_max_record_ns gauge\nevent_recorder_max_record_ns %" PRIu32 "\n", recorder.max_record_ns);
+    metrics_printf(writer, "# TYPE event_recorder_mean_record_ns gauge\nevent_recorder_mean_record_ns %" PRIu32 "\n", recorder.mean_record_ns);
+
+    app_events_handler_stats_t handlers[CONFIG_APP_EVENTS_MAX_HANDLERS];
+    size_t handler_count = app_events_get_handler_stats(handlers, CONFIG_APP_EVENTS_MAX_HANDLERS);
+    metrics_printf(writer, "# TYPE app_event_handler_max_us gauge\n");
+    for (size_t i = 0; i < handler_count; i++)
+    {
+        metrics_printf(writer, "app_event_handler_max_us{handler=\"%s\"} %" PRIu32 "\n", handlers[i].name, handlers[i].max_us);
+    }
+    metrics_printf(writer, "# TYPE app_event_handler_us_total counter\n");
+    for (size_t i = 0; i < handler_count; i++)
+    {
+        metrics_printf(writer, "app_event_handler_us_total{handler=\"%s\"} %" PRIu32 "\n", handlers[i].name, handlers[i].total_us);
+    }
+
+    // Si el maximo en uso se acerca a la cantidad de bloques hay que agrandar el pool o la cola que lo usa
+    mem_pool_stats_t pools[CONFIG_MEM_POOL_MAX_POOLS];
+    size_t pool_count = mem_pool_get_all_stats(pools, CONFIG_MEM_POOL_MAX_POOLS);
+    metrics_printf(writer, "# TYPE mem_pool_blocks gauge\n");
+    for (size_t i = 0; i < pool_count; i++)
+    {
+        metrics_printf(writer, "mem_pool_blocks{pool=\"%s\",region=\"%s\"} %" PRIu32 "\n", pools[i].name,
+                       mem_pool_region_to_name(pools[i].region), pools[i].block_count);
+    }
+    metrics_printf(writer, "# TYPE mem_pool_in_use_blocks gauge\n");
+    for (size_t i = 0; i < pool_count; i++)
+    {
+        metrics_printf(writer, "mem_pool_in_use_blocks{pool=\"%s\"} %" PRIu32 "\n", pools[i].name, pools[i].in_use);
+    }
+    metrics_printf(writer, "# TYPE mem_pool_high_water_blocks gauge\n");
+    for (size_t i = 0; i < pool_count; i++)
+    {
+        metrics_printf(writer, "mem_pool_high_water_blocks{pool=\"%s\"} %" PRIu32 "\n", pools[i].name, pools[i].high_water);
+    }
+    metrics_printf(writer, "# TYPE mem_pool_failures_total counter\n");
+    for (size_t i = 0; i < pool_count; i++)
+    {
+        metrics_printf(writer, "mem_pool_failures_total{pool=\"%s\"} %" PRIu32 "\n", pools[i].name, pools[i].failures);
+    }
+}
+
+#if CONFIG_DUTY_CYCLE_ENABLE
+static void run_duty_cycle(void)
+{
+    duty_cycle_mark(DUTY_CYCLE_PHASE_INIT);
+
+    // Se muestrea con la radio apagada, asi el registro queda guardado aunque falle la conexion
+    duty_cycle_record_t record = {0};
+    if (sample_once(&record) == ESP_OK)
+    {
+        duty_cycle_push(&record);
+    }
+    duty_cycle_mark(DUTY_CYCLE_PHASE_SAMPLE);
+
+    // Al despertar con la conexion guardada no se pasa por el provisioning ni se lee el NVS
+    bool connected = duty_cycle_has_connection() &&
+                     duty_cycle_connect(pdMS_TO_TICKS(CONFIG_DUTY_CYCLE_CONNECT_TIMEOUT_MS)) == ESP_OK;
+    if (!connected)
+    {
+        // Si el AP o la red cambiaron se intenta el camino completo en este mismo despertar, la conexion guardada
+        // se reemplaza solo cuando se obtiene una nueva
+        ESP_ERROR_CHECK(provisioning_start());
+        wifi_config_t sta_config = {0};
+        esp_wifi_get_config(WIFI_IF_STA, &sta_config);
+        TickType_t timeout = (sta_config.sta.ssid[0] != '\0') ? pdMS_TO_TICKS(CONFIG_DUTY_CYCLE_FULL_CONNECT_TIMEOUT_MS)
+                                                              : portMAX_DELAY;
+        if (provisioning_wait_connected(timeout) != ESP_OK)
+        {
+            // Con el AP caido no se espera con el Wi-Fi encendido, las muestras quedan en el RTC para el proximo
+            // despertar y el deep sleep se alarga con cada falla
+            duty_cycle_connect_failed();
+            duty_cycle_mark(DUTY_CYCLE_PHASE_CONNECT);
+            duty_cycle_sleep();
+        }
+        duty_cycle_save_connection();
+    }
+
+    // La hora se mantiene en el RTC durante el deep sleep, el SNTP solo hace falta si no es valida
+    if (!time_sync_is_valid())
+    {
+        ESP_ERROR_CHECK(time_sync_start());
+        time_sync_wait(pdMS_TO_TICKS(CONFIG_TIME_SYNC_WAIT_MS));
+    }
+    duty_cycle_mark(DUTY_CYCLE_PHASE_CONNECT);
+
+#if CONFIG_DUTY_CYCLE_CLOUD_CONN
+    duty_cycle_send_with(send_duty_cycle_packet, NULL);
+#else
+    duty_cycle_send();
+#endif
+
+#if CONFIG_DUTY_CYCLE_OTA_WAKES > 0
+    // El loop principal no corre en este modo, las actualizaciones se consultan cada N despertares. Si hay un
+    // parche se aplica y el dispositivo se reinicia, si no la consulta cuenta dentro de la etapa de envio
+    if (duty_cycle_wake() % CONFIG_DUTY_CYCLE_OTA_WAKES == 0)
+    {
+        esp_err_t err = ota_check_now();
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Error (%s) checking for updates", esp_err_to_name(err));
+        }
+    }
+#endif
+    duty_cycle_mark(DUTY_CYCLE_PHASE_SEND);
+
+    duty_cycle_sleep();
+}
+
+static esp_err_t sample_once(duty_cycle_record_t *record)
+{
+    sampling_config_t sampling_cfg = {
+        .on_block = on_duty_cycle_block,
+        .ctx = record,
+    };
+    duty_cycle_task = xTaskGetCurrentTaskHandle();
+    ESP_ERROR_CHECK(sampling_start(&sampling_cfg));
+    uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DUTY_CYCLE_SAMPLE_TIMEOUT_MS));
+    duty_cycle_task = NULL;
+    sampling_stop();
+    return notified ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void on_duty_cycle_block(const sampling_block_t *block, void *ctx)
+{
+    // Solo se usa el primer bloque de cada despertar
+    TaskHandle_t task = duty_cycle_task;
+    if (task == NULL)
+    {
+        return;
+    }
+    duty_cycle_task = NULL;
+
+    duty_cycle_record_t *record = (duty_cycle_record_t *)ctx;
+    record->unix_ms = time_sync_to_unix_us(block->timestamp_us) / 1000;
+    record->min = (int16_t)block->stats.min;
+    record->max = (int16_t)block->stats.max;
+    record->mean = (int16_t)block_stats_mean(&block->stats);
+    record->flags = time_sync_is_valid() ? DUTY_CYCLE_RECORD_TIME_VALID : 0;
+    xTaskNotifyGive(task);
+}
+
+#if CONFIG_DUTY_CYCLE_CLOUD_CONN
+static esp_err_t send_duty_cycle_packet(const uint8_t *packet, size_t len, void *ctx)
+{
+    // La sesion TLS queda en la memoria RTC, cada despertar hace el handshake abreviado con el ticket guardado
+    esp_err_t err = cloud_conn_send_now(CLOUD_CHANNEL_DUTY_CYCLE, packet, len);
+    if (err == ESP_ERR_NOT_FOUND || err == ESP_ERR_INVALID_STATE)
+    {
+        // Sin CA ni PSK no hay conexion TLS posible, el paquete va por UDP como sin la opcion
+        return duty_cycle_send_udp(packet, len, NULL);
+    }
+    return err;
+}
+#endif
+#endif
\ No newline at end of file
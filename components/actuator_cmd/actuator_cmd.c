@@ -0,0 +1,266 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "lwip/sockets.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "actuator_cmd.h"
+#include "actuator_rx.h"
+#include "spsc_queue.h"
+
+//=====[Declaration of private defines]========================================
+
+#define ACTUATOR_CMD_NAMESPACE "cmd_auth"
+#define ACTUATOR_CMD_SEQ_KEY "seq_floor"
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "actuator-cmd";
+
+//=====[Declaration and initialization of private global variables]============
+
+static actuator_cmd_config_t cmd_config;
+static actuator_cmd_stats_t cmd_stats;
+
+static uint8_t auth_key[ACTUATOR_CMD_KEY_LEN];
+static actuator_rx_t rx_state;
+static nvs_handle_t seq_handle;
+static int sock = -1;
+
+static TaskHandle_t rx_task_handle = NULL;
+static TaskHandle_t actuator_task_handle = NULL;
+
+// Los buffers y la cola se reservan una sola vez, el camino de un comando no usa el heap
+static uint8_t rx_packet[ACTUATOR_CMD_PACKET_LEN + 1];
+static actuator_cmd_t queue_storage[CONFIG_ACTUATOR_CMD_QUEUE_LEN];
+static spsc_queue_t cmd_queue;
+
+// Cola de los comandos que llegan por otro medio, con actuator_cmd_post, cada cola tiene un solo productor
+static actuator_cmd_t post_storage[CONFIG_ACTUATOR_CMD_QUEUE_LEN];
+static spsc_queue_t post_queue;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void rx_task(void *arg);
+
+static void actuator_task(void *arg);
+
+static void execute(const actuator_cmd_t *cmd);
+
+static int store_seq(uint32_t reserved, void *ctx);
+
+static esp_err_t open_socket(void);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t actuator_cmd_start(const actuator_cmd_config_t *config)
+{
+    if (actuator_task_handle != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config == NULL || config->handler == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cmd_config = *config;
+    memset(&cmd_stats, 0, sizeof(cmd_stats));
+
+    // El Kconfig solo ofrece potencias de 2
+    spsc_queue_init(&cmd_queue, queue_storage, sizeof(actuator_cmd_t), CONFIG_ACTUATOR_CMD_QUEUE_LEN);
+    spsc_queue_init(&post_queue, post_storage, sizeof(actuator_cmd_t), CONFIG_ACTUATOR_CMD_QUEUE_LEN);
+
+    // La tarea del actuador arranca primero y queda corriendo aunque el endpoint UDP no se pueda abrir,
+    // asi los comandos de actuator_cmd_post se siguen ejecutando
+    // Tiene mas prioridad que la de recepcion para ejecutar el comando apenas se encola
+    if (xTaskCreate(actuator_task, "actuator", CONFIG_ACTUATOR_CMD_TASK_STACK_SIZE, NULL,
+                    CONFIG_ACTUATOR_CMD_ACTUATOR_PRIORITY, &actuator_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Unable to create the actuator task");
+        actuator_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Recupera la clave compartida del NVS, el handle queda abierto para guardar los numeros de secuencia
+    esp_err_t err = nvs_open(ACTUATOR_CMD_NAMESPACE, NVS_READWRITE, &seq_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
+        return err;
+    }
+    size_t key_len = sizeof(auth_key);
+    err = nvs_get_blob(seq_handle, "key", auth_key, &key_len);
+    if (err != ESP_OK || key_len != sizeof(auth_key))
+    {
+        ESP_LOGE(TAG, "Missing or invalid command key in NVS");
+        nvs_close(seq_handle);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Los numeros hasta el reservado se pudieron usar antes del reinicio, asi un paquete capturado no se puede repetir
+    uint32_t seq_reserved = 0;
+    err = nvs_get_u32(seq_handle, ACTUATOR_CMD_SEQ_KEY, &seq_reserved);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGE(TAG, "Error (%s) reading the sequence floor", esp_err_to_name(err));
+        nvs_close(seq_handle);
+        return err;
+    }
+    ESP_LOGI(TAG, "Accepting sequence numbers above %" PRIu32, seq_reserved);
+
+    rx_state = (actuator_rx_t){
+        .key = auth_key,
+        .queue = &cmd_queue,
+        .seq_reserve = CONFIG_ACTUATOR_CMD_SEQ_RESERVE,
+        .store_seq = store_seq,
+        .store_ctx = NULL,
+        .last_seq = seq_reserved,
+        .seq_reserved = seq_reserved,
+    };
+
+    err = open_socket();
+    if (err != ESP_OK)
+    {
+        nvs_close(seq_handle);
+        return err;
+    }
+
+    if (xTaskCreate(rx_task, "actuator_rx", CONFIG_ACTUATOR_CMD_TASK_STACK_SIZE, NULL,
+                    CONFIG_ACTUATOR_CMD_RX_PRIORITY, &rx_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Unable to create the receive task");
+        close(sock);
+        sock = -1;
+        nvs_close(seq_handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Command endpoint listening on UDP port %d", CONFIG_ACTUATOR_CMD_PORT);
+    return ESP_OK;
+}
+
+esp_err_t actuator_cmd_post(const actuator_cmd_t *cmd)
+{
+    if (actuator_task_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    actuator_cmd_t item = *cmd;
+    item.received_us = esp_timer_get_time();
+    if (!spsc_queue_push(&post_queue, &item))
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    xTaskNotifyGive(actuator_task_handle);
+    return ESP_OK;
+}
+
+void actuator_cmd_get_stats(actuator_cmd_stats_t *stats)
+{
+    *stats = cmd_stats;
+    stats->received = rx_state.received;
+    stats->rejected = rx_state.rejected;
+    stats->queue_full = rx_state.queue_full;
+    stats->seq_store_failures = rx_state.seq_store_failures;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void rx_task(void *arg)
+{
+    struct sockaddr_storage source_addr;
+    uint8_t ack[ACTUATOR_CMD_ACK_LEN];
+    while (1)
+    {
+        socklen_t addr_len = sizeof(source_addr);
+        int len = recvfrom(sock, rx_packet, sizeof(rx_packet), 0, (struct sockaddr *)&source_addr, &addr_len);
+        if (len < 0)
+        {
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            continue;
+        }
+
+        if (actuator_rx_handle(&rx_state, rx_packet, (size_t)len, esp_timer_get_time(), ack) == ACTUATOR_STATUS_OK)
+        {
+            xTaskNotifyGive(actuator_task_handle);
+        }
+
+        // El ACK se envia despues de encolar para no sumar latencia al comando
+        sendto(sock, ack, sizeof(ack), 0, (const struct sockaddr *)&source_addr, addr_len);
+    }
+}
+
+static void actuator_task(void *arg)
+{
+    actuator_cmd_t cmd;
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (spsc_queue_pop(&cmd_queue, &cmd))
+        {
+            execute(&cmd);
+        }
+        while (spsc_queue_pop(&post_queue, &cmd))
+        {
+            execute(&cmd);
+        }
+    }
+}
+
+static void execute(const actuator_cmd_t *cmd)
+{
+    cmd_config.handler(cmd, cmd_config.ctx);
+
+    uint32_t latency = (uint32_t)(esp_timer_get_time() - cmd->received_us);
+    cmd_stats.last_latency_us = latency;
+    if (latency > cmd_stats.max_latency_us)
+    {
+        cmd_stats.max_latency_us = latency;
+    }
+    cmd_stats.executed++;
+}
+
+static int store_seq(uint32_t reserved, void *ctx)
+{
+    esp_err_t err = nvs_set_u32(seq_handle, ACTUATOR_CMD_SEQ_KEY, reserved);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(seq_handle);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) storing the sequence floor", esp_err_to_name(err));
+        return -1;
+    }
+    return 0;
+}
+
+static esp_err_t open_socket(void)
+{
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    struct sockaddr_in bind_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_ACTUATOR_CMD_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) < 0)
+    {
+        ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
+        close(sock);
+        sock = -1;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
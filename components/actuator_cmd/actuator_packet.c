@@ -0,0 +1,113 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbedtls/md.h"
+
+#include "actuator_packet.h"
+
+//=====[Declaration of private defines]========================================
+
+#define ACTUATOR_PACKET_SIGNED_LEN 16
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int compute_tag(const uint8_t *key, const uint8_t *packet, uint8_t tag[32]);
+
+static uint32_t read_u32(const uint8_t *p);
+
+static void write_u32(uint8_t *p, uint32_t value);
+
+//=====[Implementations of public functions]===================================
+
+actuator_status_t actuator_packet_parse(const uint8_t *key, const uint8_t *packet, size_t len, uint32_t last_seq,
+                                        actuator_cmd_t *cmd)
+{
+    if (len != ACTUATOR_CMD_PACKET_LEN || packet[0] != ACTUATOR_CMD_MAGIC || packet[1] != ACTUATOR_CMD_VERSION)
+    {
+        return ACTUATOR_STATUS_BAD_FORMAT;
+    }
+
+    // Verifica el HMAC en tiempo constante
+    uint8_t tag[32];
+    if (compute_tag(key, packet, tag) != 0)
+    {
+        return ACTUATOR_STATUS_BAD_TAG;
+    }
+    uint8_t diff = 0;
+    for (int i = 0; i < ACTUATOR_CMD_TAG_LEN; i++)
+    {
+        diff |= tag[i] ^ packet[ACTUATOR_PACKET_SIGNED_LEN + i];
+    }
+    if (diff != 0)
+    {
+        return ACTUATOR_STATUS_BAD_TAG;
+    }
+
+    // El numero de secuencia debe crecer para descartar paquetes repetidos
+    cmd->seq = read_u32(&packet[4]);
+    if (cmd->seq <= last_seq)
+    {
+        return ACTUATOR_STATUS_REPLAYED;
+    }
+
+    cmd->actuator = packet[2];
+    cmd->op = packet[3];
+    cmd->value = (int32_t)read_u32(&packet[8]);
+    cmd->duration_ms = read_u32(&packet[12]);
+    return ACTUATOR_STATUS_OK;
+}
+
+int actuator_packet_encode(const uint8_t *key, const actuator_cmd_t *cmd, uint8_t packet[ACTUATOR_CMD_PACKET_LEN])
+{
+    packet[0] = ACTUATOR_CMD_MAGIC;
+    packet[1] = ACTUATOR_CMD_VERSION;
+    packet[2] = cmd->actuator;
+    packet[3] = cmd->op;
+    write_u32(&packet[4], cmd->seq);
+    write_u32(&packet[8], (uint32_t)cmd->value);
+    write_u32(&packet[12], cmd->duration_ms);
+
+    uint8_t tag[32];
+    int ret = compute_tag(key, packet, tag);
+    if (ret == 0)
+    {
+        memcpy(&packet[ACTUATOR_PACKET_SIGNED_LEN], tag, ACTUATOR_CMD_TAG_LEN);
+    }
+    return ret;
+}
+
+void actuator_packet_ack(uint32_t seq, actuator_status_t status, uint8_t ack[ACTUATOR_CMD_ACK_LEN])
+{
+    ack[0] = ACTUATOR_CMD_MAGIC;
+    ack[1] = ACTUATOR_CMD_VERSION | 0x80;
+    ack[2] = (uint8_t)status;
+    ack[3] = 0;
+    write_u32(&ack[4], seq);
+}
+
+uint32_t actuator_packet_seq(const uint8_t *packet, size_t len)
+{
+    return (len >= 8) ? read_u32(&packet[4]) : 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int compute_tag(const uint8_t *key, const uint8_t *packet, uint8_t tag[32])
+{
+    return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key, ACTUATOR_CMD_KEY_LEN,
+                           packet, ACTUATOR_PACKET_SIGNED_LEN, tag);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
@@ -0,0 +1,60 @@
+//=====[Libraries]=============================================================
+
+#include "actuator_rx.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int reserve_seq(actuator_rx_t *rx, uint32_t seq);
+
+//=====[Implementations of public functions]===================================
+
+actuator_status_t actuator_rx_handle(actuator_rx_t *rx, const uint8_t *packet, size_t len, int64_t received_us,
+                                     uint8_t ack[ACTUATOR_CMD_ACK_LEN])
+{
+    actuator_cmd_t cmd;
+    cmd.received_us = received_us;
+    rx->received++;
+
+    actuator_status_t status = actuator_packet_parse(rx->key, packet, len, rx->last_seq, &cmd);
+    if (status == ACTUATOR_STATUS_OK && cmd.seq > rx->seq_reserved && reserve_seq(rx, cmd.seq) != 0)
+    {
+        // Sin el numero guardado el comando se podria repetir despues de un reinicio
+        rx->seq_store_failures++;
+        status = ACTUATOR_STATUS_BUSY;
+    }
+    else if (status == ACTUATOR_STATUS_OK)
+    {
+        if (spsc_queue_push(rx->queue, &cmd))
+        {
+            rx->last_seq = cmd.seq;
+        }
+        else
+        {
+            rx->queue_full++;
+            status = ACTUATOR_STATUS_BUSY;
+        }
+    }
+    else
+    {
+        rx->rejected++;
+    }
+
+    // Un paquete repetido o de un emisor atrasado, por ejemplo despues de un reinicio, recibe el ultimo numero aceptado
+    uint32_t ack_seq = actuator_packet_seq(packet, len);
+    actuator_packet_ack((status == ACTUATOR_STATUS_REPLAYED) ? rx->last_seq : ack_seq, status, ack);
+    return status;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int reserve_seq(actuator_rx_t *rx, uint32_t seq)
+{
+    // Cada escritura reserva un bloque de numeros, el piso se guarda una vez cada seq_reserve comandos
+    uint32_t reserved = (seq > UINT32_MAX - rx->seq_reserve) ? UINT32_MAX : seq + rx->seq_reserve;
+    if (rx->store_seq(reserved, rx->store_ctx) != 0)
+    {
+        return -1;
+    }
+    rx->seq_reserved = reserved;
+    return 0;
+}
@@ -0,0 +1,50 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ACTUATOR_CMD_H_
+#define _ACTUATOR_CMD_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "actuator_packet.h"
+
+//=====[Declaration of public data types]======================================
+
+// Se ejecuta en la tarea del actuador, que tiene prioridad alta
+typedef void (*actuator_cmd_handler_t)(const actuator_cmd_t *cmd, void *ctx);
+
+typedef struct
+{
+    actuator_cmd_handler_t handler;
+    void *ctx;
+} actuator_cmd_config_t;
+
+typedef struct
+{
+    uint32_t received;
+    uint32_t executed;
+    uint32_t rejected;
+    uint32_t queue_full;
+    uint32_t seq_store_failures;
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+} actuator_cmd_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Arranca la tarea del actuador, lee la clave del NVS y abre el socket UDP, llamar una vez obtenida la direccion IP
+// Si devuelve un error por la clave o el socket la tarea del actuador sigue corriendo para actuator_cmd_post
+esp_err_t actuator_cmd_start(const actuator_cmd_config_t *config);
+
+// Encola un comando que ya fue autenticado por otro medio, por ejemplo la conexion TLS con el servidor
+// No bloquea y descarta si la cola esta llena, la puede llamar una sola tarea
+esp_err_t actuator_cmd_post(const actuator_cmd_t *cmd);
+
+void actuator_cmd_get_stats(actuator_cmd_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ACTUATOR_CMD_H_
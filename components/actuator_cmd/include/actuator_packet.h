@@ -0,0 +1,67 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ACTUATOR_PACKET_H_
+#define _ACTUATOR_PACKET_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define ACTUATOR_CMD_MAGIC 0xAC
+#define ACTUATOR_CMD_VERSION 1
+#define ACTUATOR_CMD_TAG_LEN 16
+#define ACTUATOR_CMD_PACKET_LEN (16 + ACTUATOR_CMD_TAG_LEN)
+#define ACTUATOR_CMD_KEY_LEN 32
+#define ACTUATOR_CMD_ACK_LEN 8
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    ACTUATOR_OP_SET = 1,
+    ACTUATOR_OP_STOP = 2,
+} actuator_op_t;
+
+typedef enum
+{
+    ACTUATOR_STATUS_OK = 0,
+    ACTUATOR_STATUS_BAD_FORMAT = 1,
+    ACTUATOR_STATUS_BAD_TAG = 2,
+    ACTUATOR_STATUS_REPLAYED = 3,
+    ACTUATOR_STATUS_BUSY = 4,
+} actuator_status_t;
+
+// Formato del paquete (little endian, 32 bytes):
+// [0] magic, [1] version, [2] actuator, [3] op, [4..7] seq, [8..11] value, [12..15] duration_ms (0 sin limite),
+// [16..31] HMAC-SHA256 de los bytes 0..15 truncado a 16 bytes
+typedef struct
+{
+    uint8_t actuator;
+    uint8_t op;
+    uint32_t seq;
+    int32_t value;
+    uint32_t duration_ms;
+    int64_t received_us;
+} actuator_cmd_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Sin dependencias del ESP-IDF, el mismo codigo se usa en el dispositivo y en el benchmark de la PC
+// Verifica el formato, el HMAC y que seq sea mayor que last_seq. No completa received_us
+actuator_status_t actuator_packet_parse(const uint8_t *key, const uint8_t *packet, size_t len, uint32_t last_seq,
+                                        actuator_cmd_t *cmd);
+
+// Arma el paquete firmado, lo usa quien envia los comandos
+int actuator_packet_encode(const uint8_t *key, const actuator_cmd_t *cmd, uint8_t packet[ACTUATOR_CMD_PACKET_LEN]);
+
+void actuator_packet_ack(uint32_t seq, actuator_status_t status, uint8_t ack[ACTUATOR_CMD_ACK_LEN]);
+
+// Numero de secuencia del paquete sin verificarlo, 0 si es demasiado corto
+uint32_t actuator_packet_seq(const uint8_t *packet, size_t len);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ACTUATOR_PACKET_H_
@@ -0,0 +1,45 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ACTUATOR_RX_H_
+#define _ACTUATOR_RX_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "actuator_packet.h"
+#include "spsc_queue.h"
+
+//=====[Declaration of public data types]======================================
+
+// Guarda el piso de los numeros de secuencia, devuelve 0 si se pudo guardar
+typedef int (*actuator_rx_store_seq_t)(uint32_t reserved, void *ctx);
+
+// Estado de la recepcion, solo lo toca la tarea que recibe los paquetes
+typedef struct
+{
+    const uint8_t *key;
+    spsc_queue_t *queue;
+    uint32_t seq_reserve;
+    actuator_rx_store_seq_t store_seq;
+    void *store_ctx;
+    uint32_t last_seq;
+    uint32_t seq_reserved;
+    uint32_t received;
+    uint32_t rejected;
+    uint32_t queue_full;
+    uint32_t seq_store_failures;
+} actuator_rx_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Sin dependencias del ESP-IDF, la usan la tarea de recepcion del dispositivo y el benchmark de la PC
+// Valida el paquete, reserva el numero de secuencia si hace falta, encola el comando y arma el ACK
+// Con ACTUATOR_STATUS_OK el comando quedo en la cola y hay que despertar a quien la consume
+actuator_status_t actuator_rx_handle(actuator_rx_t *rx, const uint8_t *packet, size_t len, int64_t received_us,
+                                     uint8_t ack[ACTUATOR_CMD_ACK_LEN]);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ACTUATOR_RX_H_
@@ -0,0 +1,39 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public data types]======================================
+
+// Cola sin locks de un solo productor y un solo consumidor
+// El almacenamiento lo provee quien la usa y la capacidad debe ser potencia de 2
+typedef struct
+{
+    uint8_t *storage;
+    size_t item_size;
+    uint32_t mask;
+    atomic_uint_fast32_t head;
+    atomic_uint_fast32_t tail;
+} spsc_queue_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Devuelve 0 si la capacidad es potencia de 2
+int spsc_queue_init(spsc_queue_t *queue, void *storage, size_t item_size, uint32_t capacity);
+
+// Solo la llama el productor, devuelve false si la cola esta llena
+bool spsc_queue_push(spsc_queue_t *queue, const void *item);
+
+// Solo la llama el consumidor, devuelve false si la cola esta vacia
+bool spsc_queue_pop(spsc_queue_t *queue, void *item);
+
+//=====[#include guards - end]=================================================
+
+#endif // _SPSC_QUEUE_H_
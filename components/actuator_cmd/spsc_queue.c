@@ -0,0 +1,48 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "spsc_queue.h"
+
+//=====[Implementations of public functions]===================================
+
+int spsc_queue_init(spsc_queue_t *queue, void *storage, size_t item_size, uint32_t capacity)
+{
+    if (storage == NULL || item_size == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        return -1;
+    }
+    queue->storage = (uint8_t *)storage;
+    queue->item_size = item_size;
+    queue->mask = capacity - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 0;
+}
+
+bool spsc_queue_push(spsc_queue_t *queue, const void *item)
+{
+    // El productor es el unico que escribe head, el consumidor el unico que escribe tail
+    uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail > queue->mask)
+    {
+        return false;
+    }
+    memcpy(&queue->storage[(head & queue->mask) * queue->item_size], item, queue->item_size);
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool spsc_queue_pop(spsc_queue_t *queue, void *item)
+{
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    memcpy(item, &queue->storage[(tail & queue->mask) * queue->item_size], queue->item_size);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
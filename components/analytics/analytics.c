@@ -0,0 +1,211 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "nvs.h"
+
+#include "analytics.h"
+
+//=====[Declaration of private defines]========================================
+
+#define ANALYTICS_NAMESPACE "analytics"
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "analytics";
+
+//=====[Declaration and initialization of private global variables]============
+
+static analytics_engine_t engine;
+static analytics_rules_t current_rules;
+static analytics_rules_t pending_rules;
+static volatile bool rules_pending = false;
+static QueueHandle_t output_queue = NULL;
+static analytics_stats_t analytics_stats;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void load_rules(analytics_rules_t *rules);
+
+static esp_err_t save_rules(const analytics_rules_t *rules);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t analytics_start(void)
+{
+    analytics_rules_t rules;
+    load_rules(&rules);
+    if (analytics_rules_validate(&rules) != 0)
+    {
+        ESP_LOGW(TAG, "Invalid rules in NVS, using defaults");
+        analytics_rules_default(&rules);
+    }
+
+    output_queue = xQueueCreate(CONFIG_ANALYTICS_QUEUE_LEN, sizeof(analytics_output_t));
+    if (output_queue == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    current_rules = rules;
+    analytics_engine_init(&engine, &rules);
+    ESP_LOGI(TAG, "Summary every %" PRIu32 " ms, EWMA shift %u, window %u, thresholds [%" PRId32 ", %" PRId32 "]",
+             rules.summary_ms, rules.ewma_shift, rules.window, rules.low, rules.high);
+    return ESP_OK;
+}
+
+void analytics_process(int64_t unix_us, const int32_t *samples, size_t count, uint32_t sample_period_us)
+{
+    // Las reglas nuevas se aplican entre bloques, asi el motor solo lo toca la tarea de muestreo
+    if (rules_pending)
+    {
+        portENTER_CRITICAL(&lock);
+        current_rules = pending_rules;
+        rules_pending = false;
+        portEXIT_CRITICAL(&lock);
+        analytics_engine_init(&engine, &current_rules);
+    }
+
+    uint32_t outputs[ANALYTICS_OUTPUT_COUNT] = {0};
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        analytics_output_t out[ANALYTICS_MAX_OUTPUTS];
+        int64_t timestamp_ms = (unix_us + (int64_t)i * sample_period_us) / 1000;
+        size_t n = analytics_engine_update(&engine, timestamp_ms, samples[i], out);
+        for (size_t j = 0; j < n; j++)
+        {
+            outputs[out[j].kind]++;
+            if (xQueueSend(output_queue, &out[j], 0) != pdTRUE)
+            {
+                dropped++;
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&lock);
+    analytics_stats.samples += count;
+    for (int i = 0; i < ANALYTICS_OUTPUT_COUNT; i++)
+    {
+        analytics_stats.outputs[i] += outputs[i];
+    }
+    analytics_stats.dropped += dropped;
+    portEXIT_CRITICAL(&lock);
+}
+
+esp_err_t analytics_receive(analytics_output_t *output, TickType_t timeout)
+{
+    return (xQueueReceive(output_queue, output, timeout) == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t analytics_set_rules(const analytics_rules_t *rules)
+{
+    if (analytics_rules_validate(rules) != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = save_rules(rules);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Error (%s) saving rules, applying them until the next boot", esp_err_to_name(err));
+    }
+
+    portENTER_CRITICAL(&lock);
+    pending_rules = *rules;
+    rules_pending = true;
+    analytics_stats.rule_updates++;
+    portEXIT_CRITICAL(&lock);
+    ESP_LOGI(TAG, "New rules: summary every %" PRIu32 " ms, thresholds [%" PRId32 ", %" PRId32 "], deadband %" PRIu32,
+             rules->summary_ms, rules->low, rules->high, rules->deadband);
+    return ESP_OK;
+}
+
+void analytics_get_rules(analytics_rules_t *rules)
+{
+    portENTER_CRITICAL(&lock);
+    *rules = rules_pending ? pending_rules : current_rules;
+    portEXIT_CRITICAL(&lock);
+}
+
+void analytics_get_stats(analytics_stats_t *stats)
+{
+    portENTER_CRITICAL(&lock);
+    *stats = analytics_stats;
+    portEXIT_CRITICAL(&lock);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void load_rules(analytics_rules_t *rules)
+{
+    analytics_rules_default(rules);
+    nvs_handle_t my_handle;
+    if (nvs_open(ANALYTICS_NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK)
+    {
+        return;
+    }
+
+    // Cada regla es una clave aparte, las que no estan conservan el valor por defecto
+    for (size_t i = 0; i < analytics_rule_field_count; i++)
+    {
+        const analytics_rule_field_t *field = &analytics_rule_fields[i];
+        void *value = (uint8_t *)rules + field->offset;
+        switch (field->type)
+        {
+        case ANALYTICS_RULE_U8:
+            nvs_get_u8(my_handle, field->key, value);
+            break;
+        case ANALYTICS_RULE_U16:
+            nvs_get_u16(my_handle, field->key, value);
+            break;
+        case ANALYTICS_RULE_U32:
+            nvs_get_u32(my_handle, field->key, value);
+            break;
+        case ANALYTICS_RULE_I32:
+            nvs_get_i32(my_handle, field->key, value);
+            break;
+        }
+    }
+    nvs_close(my_handle);
+}
+
+static esp_err_t save_rules(const analytics_rules_t *rules)
+{
+    nvs_handle_t my_handle;
+    esp_err_t err = nvs_open(ANALYTICS_NAMESPACE, NVS_READWRITE, &my_handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    for (size_t i = 0; i < analytics_rule_field_count && err == ESP_OK; i++)
+    {
+        const analytics_rule_field_t *field = &analytics_rule_fields[i];
+        const void *value = (const uint8_t *)rules + field->offset;
+        switch (field->type)
+        {
+        case ANALYTICS_RULE_U8:
+            err = nvs_set_u8(my_handle, field->key, *(const uint8_t *)value);
+            break;
+        case ANALYTICS_RULE_U16:
+            err = nvs_set_u16(my_handle, field->key, *(const uint16_t *)value);
+            break;
+        case ANALYTICS_RULE_U32:
+            err = nvs_set_u32(my_handle, field->key, *(const uint32_t *)value);
+            break;
+        case ANALYTICS_RULE_I32:
+            err = nvs_set_i32(my_handle, field->key, *(const int32_t *)value);
+            break;
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(my_handle);
+    }
+    nvs_close(my_handle);
+    return err;
+}
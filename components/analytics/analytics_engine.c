@@ -0,0 +1,291 @@
+//=====[Libraries]=============================================================
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analytics_engine.h"
+
+//=====[Declaration of private defines]========================================
+
+#define RULE_TOKEN_MAX 32
+#define EWMA_SHIFT_MAX 16
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void window_push(analytics_window_t *window, int32_t value, uint32_t index, uint16_t size, bool keep_max);
+
+static analytics_level_t next_level(const analytics_engine_t *engine, int32_t ewma);
+
+static void fill_output(const analytics_engine_t *engine, analytics_output_kind_t kind, int64_t timestamp_ms,
+                        int32_t sample, analytics_output_t *out);
+
+static int set_rule(analytics_rules_t *rules, const char *token);
+
+//=====[Declaration and initialization of public global variables]=============
+
+// Las claves del NVS tienen como mucho 15 caracteres
+const analytics_rule_field_t analytics_rule_fields[] = {
+    {"summary_ms", ANALYTICS_RULE_U32, offsetof(analytics_rules_t, summary_ms)},
+    {"ewma_shift", ANALYTICS_RULE_U8, offsetof(analytics_rules_t, ewma_shift)},
+    {"window", ANALYTICS_RULE_U16, offsetof(analytics_rules_t, window)},
+    {"high", ANALYTICS_RULE_I32, offsetof(analytics_rules_t, high)},
+    {"low", ANALYTICS_RULE_I32, offsetof(analytics_rules_t, low)},
+    {"hysteresis", ANALYTICS_RULE_U32, offsetof(analytics_rules_t, hysteresis)},
+    {"deadband", ANALYTICS_RULE_U32, offsetof(analytics_rules_t, deadband)},
+    {"holdoff_ms", ANALYTICS_RULE_U32, offsetof(analytics_rules_t, holdoff_ms)},
+};
+
+const size_t analytics_rule_field_count = sizeof(analytics_rule_fields) / sizeof(analytics_rule_fields[0]);
+
+//=====[Implementations of public functions]===================================
+
+void analytics_rules_default(analytics_rules_t *rules)
+{
+    rules->summary_ms = 60000;
+    rules->ewma_shift = 4;
+    rules->window = (ANALYTICS_WINDOW_MAX < 64) ? ANALYTICS_WINDOW_MAX : 64;
+    rules->high = INT32_MAX;
+    rules->low = INT32_MIN;
+    rules->hysteresis = 0;
+    rules->deadband = 0;
+    rules->holdoff_ms = 0;
+}
+
+int analytics_rules_validate(const analytics_rules_t *rules)
+{
+    if (rules->window == 0 || rules->window > ANALYTICS_WINDOW_MAX || rules->ewma_shift > EWMA_SHIFT_MAX ||
+        rules->low > rules->high)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int analytics_rules_parse(analytics_rules_t *rules, const char *text, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len)
+    {
+        if (isspace((unsigned char)text[pos]) || text[pos] == ',')
+        {
+            pos++;
+            continue;
+        }
+        size_t start = pos;
+        while (pos < len && !isspace((unsigned char)text[pos]) && text[pos] != ',')
+        {
+            pos++;
+        }
+        char token[RULE_TOKEN_MAX];
+        if (pos - start >= sizeof(token))
+        {
+            return -1;
+        }
+        memcpy(token, &text[start], pos - start);
+        token[pos - start] = '\0';
+        if (set_rule(rules, token) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void analytics_engine_init(analytics_engine_t *engine, const analytics_rules_t *rules)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->rules = *rules;
+    engine->level = ANALYTICS_LEVEL_NORMAL;
+}
+
+size_t analytics_engine_update(analytics_engine_t *engine, int64_t timestamp_ms, int32_t sample,
+                               analytics_output_t out[ANALYTICS_MAX_OUTPUTS])
+{
+    const analytics_rules_t *rules = &engine->rules;
+    if (!engine->started)
+    {
+        engine->started = true;
+        engine->period_start_ms = timestamp_ms;
+        engine->ewma_q8 = (int64_t)sample * 256;
+        engine->last_reported = sample;
+        engine->last_change_ms = timestamp_ms - rules->holdoff_ms;
+    }
+    else
+    {
+        engine->ewma_q8 += ((int64_t)sample * 256 - engine->ewma_q8) >> rules->ewma_shift;
+    }
+
+    // Welford evita la cancelacion de restar dos sumas grandes en float
+    engine->count++;
+    float delta = (float)sample - engine->mean;
+    engine->mean += delta / (float)engine->count;
+    engine->m2 += delta * ((float)sample - engine->mean);
+
+    window_push(&engine->window_max, sample, engine->index, rules->window, true);
+    window_push(&engine->window_min, sample, engine->index, rules->window, false);
+    engine->index++;
+
+    size_t count = 0;
+    int32_t ewma = (int32_t)(engine->ewma_q8 / 256);
+    analytics_level_t level = next_level(engine, ewma);
+    if (level != engine->level)
+    {
+        static const analytics_output_kind_t level_outputs[] = {
+            [ANALYTICS_LEVEL_NORMAL] = ANALYTICS_OUTPUT_NORMAL,
+            [ANALYTICS_LEVEL_HIGH] = ANALYTICS_OUTPUT_HIGH,
+            [ANALYTICS_LEVEL_LOW] = ANALYTICS_OUTPUT_LOW,
+        };
+        engine->level = level;
+        engine->last_reported = ewma;
+        engine->last_change_ms = timestamp_ms;
+        fill_output(engine, level_outputs[level], timestamp_ms, sample, &out[count++]);
+    }
+    else if (rules->deadband > 0 && llabs((int64_t)ewma - engine->last_reported) >= rules->deadband &&
+             timestamp_ms - engine->last_change_ms >= rules->holdoff_ms)
+    {
+        // Solo se informa un cambio cuando el EWMA se alejo del ultimo valor informado mas que la banda muerta
+        engine->last_reported = ewma;
+        engine->last_change_ms = timestamp_ms;
+        fill_output(engine, ANALYTICS_OUTPUT_CHANGE, timestamp_ms, sample, &out[count++]);
+    }
+
+    if (rules->summary_ms > 0 && timestamp_ms - engine->period_start_ms >= rules->summary_ms)
+    {
+        fill_output(engine, ANALYTICS_OUTPUT_SUMMARY, timestamp_ms, sample, &out[count++]);
+        engine->period_start_ms = timestamp_ms;
+        engine->count = 0;
+        engine->mean = 0;
+        engine->m2 = 0;
+    }
+    return count;
+}
+
+const char *analytics_output_to_name(analytics_output_kind_t kind)
+{
+    static const char *names[] = {"summary", "high", "low", "normal", "change"};
+    return ((unsigned)kind < sizeof(names) / sizeof(names[0])) ? names[kind] : "unknown";
+}
+
+//=====[Implementations of private functions]==================================
+
+static void window_push(analytics_window_t *window, int32_t value, uint32_t index, uint16_t size, bool keep_max)
+{
+    // Como los indices son consecutivos, en cada muestra sale de la ventana como mucho una entrada
+    if (window->count > 0 && index - window->entries[window->head].index >= size)
+    {
+        window->head = (uint16_t)((window->head + 1) % size);
+        window->count--;
+    }
+
+    // Las entradas del final que no superan a la nueva ya no pueden ser el extremo
+    while (window->count > 0)
+    {
+        const analytics_window_entry_t *back = &window->entries[(window->head + window->count - 1) % size];
+        if (keep_max ? (back->value > value) : (back->value < value))
+        {
+            break;
+        }
+        window->count--;
+    }
+    analytics_window_entry_t *entry = &window->entries[(window->head + window->count) % size];
+    entry->value = value;
+    entry->index = index;
+    window->count++;
+}
+
+static analytics_level_t next_level(const analytics_engine_t *engine, int32_t ewma)
+{
+    // Para volver a NORMAL el EWMA tiene que entrar en la banda de histeresis
+    const analytics_rules_t *rules = &engine->rules;
+    if (ewma > rules->high)
+    {
+        return ANALYTICS_LEVEL_HIGH;
+    }
+    if (ewma < rules->low)
+    {
+        return ANALYTICS_LEVEL_LOW;
+    }
+    if (engine->level == ANALYTICS_LEVEL_HIGH && (int64_t)ewma > (int64_t)rules->high - rules->hysteresis)
+    {
+        return ANALYTICS_LEVEL_HIGH;
+    }
+    if (engine->level == ANALYTICS_LEVEL_LOW && (int64_t)ewma < (int64_t)rules->low + rules->hysteresis)
+    {
+        return ANALYTICS_LEVEL_LOW;
+    }
+    return ANALYTICS_LEVEL_NORMAL;
+}
+
+static void fill_output(const analytics_engine_t *engine, analytics_output_kind_t kind, int64_t timestamp_ms,
+                        int32_t sample, analytics_output_t *out)
+{
+    out->kind = kind;
+    out->timestamp_ms = timestamp_ms;
+    out->value = sample;
+    out->ewma = (int32_t)(engine->ewma_q8 / 256);
+    out->mean = (int32_t)lroundf(engine->mean);
+    out->stddev = (engine->count > 0) ? (uint32_t)lroundf(sqrtf(engine->m2 / (float)engine->count)) : 0;
+    out->window_min = engine->window_min.entries[engine->window_min.head].value;
+    out->window_max = engine->window_max.entries[engine->window_max.head].value;
+    out->count = engine->count;
+}
+
+static int set_rule(analytics_rules_t *rules, const char *token)
+{
+    const char *equal = strchr(token, '=');
+    if (equal == NULL)
+    {
+        return -1;
+    }
+    size_t key_len = (size_t)(equal - token);
+    for (size_t i = 0; i < analytics_rule_field_count; i++)
+    {
+        const analytics_rule_field_t *field = &analytics_rule_fields[i];
+        if (strlen(field->key) != key_len || strncmp(field->key, token, key_len) != 0)
+        {
+            continue;
+        }
+        char *end;
+        long long value = strtoll(equal + 1, &end, 0);
+        if (end == equal + 1 || *end != '\0')
+        {
+            return -1;
+        }
+        uint8_t *base = (uint8_t *)rules + field->offset;
+        switch (field->type)
+        {
+        case ANALYTICS_RULE_U8:
+            if (value < 0 || value > UINT8_MAX)
+            {
+                return -1;
+            }
+            *base = (uint8_t)value;
+            break;
+        case ANALYTICS_RULE_U16:
+            if (value < 0 || value > UINT16_MAX)
+            {
+                return -1;
+            }
+            *(uint16_t *)base = (uint16_t)value;
+            break;
+        case ANALYTICS_RULE_U32:
+            if (value < 0 || value > UINT32_MAX)
+            {
+                return -1;
+            }
+            *(uint32_t *)base = (uint32_t)value;
+            break;
+        case ANALYTICS_RULE_I32:
+            if (value < INT32_MIN || value > INT32_MAX)
+            {
+                return -1;
+            }
+            *(int32_t *)base = (int32_t)value;
+            break;
+        }
+        return 0;
+    }
+    return -1;
+}
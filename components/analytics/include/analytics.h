@@ -0,0 +1,47 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ANALYTICS_H_
+#define _ANALYTICS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#include "analytics_engine.h"
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t outputs[ANALYTICS_OUTPUT_COUNT];
+    uint32_t dropped;
+    uint32_t rule_updates;
+} analytics_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Lee las reglas del namespace "analytics" del NVS, las que faltan toman el valor por defecto
+esp_err_t analytics_start(void);
+
+// Procesa un bloque de muestras equiespaciadas, unix_us es la hora de la primera
+// Se llama desde la tarea de muestreo, no bloquea: si la cola de salidas esta llena se descartan y se cuentan
+void analytics_process(int64_t unix_us, const int32_t *samples, size_t count, uint32_t sample_period_us);
+
+// Espera el proximo evento o resumen
+esp_err_t analytics_receive(analytics_output_t *output, TickType_t timeout);
+
+// Valida las reglas y las guarda en el NVS, se aplican desde el proximo bloque y reinician el analisis
+esp_err_t analytics_set_rules(const analytics_rules_t *rules);
+
+void analytics_get_rules(analytics_rules_t *rules);
+
+void analytics_get_stats(analytics_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ANALYTICS_H_
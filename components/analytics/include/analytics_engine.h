@@ -0,0 +1,153 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ANALYTICS_ENGINE_H_
+#define _ANALYTICS_ENGINE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// En la PC CONFIG_ANALYTICS_WINDOW_MAX lo define el CMakeLists.txt de la herramienta
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+//=====[Declaration of public defines]=========================================
+
+#define ANALYTICS_WINDOW_MAX CONFIG_ANALYTICS_WINDOW_MAX
+
+// Cada muestra puede generar como mucho un evento y un resumen
+#define ANALYTICS_MAX_OUTPUTS 2
+
+//=====[Declaration of public data types]======================================
+
+// Los umbrales y la banda muerta se comparan contra el EWMA, no contra cada muestra
+typedef struct
+{
+    uint32_t summary_ms;
+    uint8_t ewma_shift;
+    uint16_t window;
+    int32_t high;
+    int32_t low;
+    uint32_t hysteresis;
+    uint32_t deadband;
+    uint32_t holdoff_ms;
+} analytics_rules_t;
+
+// Descripcion de cada regla para leerla del NVS o de un texto sin repetir la lista de campos
+typedef enum
+{
+    ANALYTICS_RULE_U8,
+    ANALYTICS_RULE_U16,
+    ANALYTICS_RULE_U32,
+    ANALYTICS_RULE_I32,
+} analytics_rule_type_t;
+
+typedef struct
+{
+    const char *key;
+    analytics_rule_type_t type;
+    size_t offset;
+} analytics_rule_field_t;
+
+typedef enum
+{
+    ANALYTICS_OUTPUT_SUMMARY,
+    ANALYTICS_OUTPUT_HIGH,
+    ANALYTICS_OUTPUT_LOW,
+    ANALYTICS_OUTPUT_NORMAL,
+    ANALYTICS_OUTPUT_CHANGE,
+    ANALYTICS_OUTPUT_COUNT,
+} analytics_output_kind_t;
+
+// En los eventos mean, stddev y count son los del periodo en curso
+typedef struct
+{
+    analytics_output_kind_t kind;
+    int64_t timestamp_ms;
+    int32_t value;
+    int32_t ewma;
+    int32_t mean;
+    uint32_t stddev;
+    int32_t window_min;
+    int32_t window_max;
+    uint32_t count;
+} analytics_output_t;
+
+typedef struct
+{
+    int32_t value;
+    uint32_t index;
+} analytics_window_entry_t;
+
+// Cola monotona de la ventana, el frente siempre es el extremo
+typedef struct
+{
+    analytics_window_entry_t entries[ANALYTICS_WINDOW_MAX];
+    uint16_t head;
+    uint16_t count;
+} analytics_window_t;
+
+typedef enum
+{
+    ANALYTICS_LEVEL_NORMAL,
+    ANALYTICS_LEVEL_HIGH,
+    ANALYTICS_LEVEL_LOW,
+} analytics_level_t;
+
+// Estado del analisis, no depende del ESP-IDF para poder reproducir trazas grabadas en la PC
+typedef struct
+{
+    analytics_rules_t rules;
+    uint32_t index;
+    bool started;
+
+    // Media y varianza del periodo por el metodo de Welford
+    int64_t period_start_ms;
+    uint32_t count;
+    float mean;
+    float m2;
+
+    // EWMA en Q8, alpha = 1 / 2^ewma_shift
+    int64_t ewma_q8;
+
+    analytics_window_t window_min;
+    analytics_window_t window_max;
+
+    analytics_level_t level;
+    int32_t last_reported;
+    int64_t last_change_ms;
+} analytics_engine_t;
+
+//=====[Declaration of public global variables]================================
+
+extern const analytics_rule_field_t analytics_rule_fields[];
+
+extern const size_t analytics_rule_field_count;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Reglas por defecto: sin umbrales ni banda muerta, solo resumenes
+void analytics_rules_default(analytics_rules_t *rules);
+
+// Devuelve 0 si las reglas son validas
+int analytics_rules_validate(const analytics_rules_t *rules);
+
+// Actualiza las reglas con pares "clave=valor" separados por espacios, comas o saltos de linea
+// Las claves son las mismas del NVS. Devuelve 0 o -1 si una clave o un valor no son validos
+int analytics_rules_parse(analytics_rules_t *rules, const char *text, size_t len);
+
+// Las reglas tienen que estar validadas
+void analytics_engine_init(analytics_engine_t *engine, const analytics_rules_t *rules);
+
+// O(1) amortizado y memoria fija, devuelve cuantas salidas escribio en out
+size_t analytics_engine_update(analytics_engine_t *engine, int64_t timestamp_ms, int32_t sample,
+                               analytics_output_t out[ANALYTICS_MAX_OUTPUTS]);
+
+const char *analytics_output_to_name(analytics_output_kind_t kind);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ANALYTICS_ENGINE_H_
@@ -0,0 +1,207 @@
+//=====[Libraries]=============================================================
+
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "app_events.h"
+
+//=====[Declaration of private defines]========================================
+
+#if CONFIG_APP_EVENTS_TASK_CORE < 0
+#define APP_EVENTS_TASK_CORE tskNO_AFFINITY
+#else
+#define APP_EVENTS_TASK_CORE CONFIG_APP_EVENTS_TASK_CORE
+#endif
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    esp_event_handler_t handler;
+    void *arg;
+    // Solo los escribe la tarea del loop, una lectura de 32 bits no se corta
+    app_events_handler_stats_t stats;
+} handler_entry_t;
+
+typedef struct
+{
+    size_t data_size;
+} forward_entry_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "app-events";
+
+//=====[Declaration and initialization of private global variables]============
+
+static esp_event_loop_handle_t app_loop = NULL;
+
+static handler_entry_t handler_entries[CONFIG_APP_EVENTS_MAX_HANDLERS];
+static size_t handler_count = 0;
+
+static forward_entry_t forward_entries[CONFIG_APP_EVENTS_MAX_FORWARDS];
+static size_t forward_count = 0;
+
+// Se publica desde varias tareas, la profundidad se calcula como publicados menos atendidos
+static atomic_uint posted = 0;
+static atomic_uint dropped = 0;
+static atomic_uint depth = 0;
+static atomic_uint max_depth = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void on_dequeue(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static void dispatch(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static void forward(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t app_events_init(void)
+{
+    if (app_loop != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_event_loop_args_t loop_args = {
+        .queue_size = CONFIG_APP_EVENTS_QUEUE_SIZE,
+        .task_name = "app_events",
+        .task_priority = CONFIG_APP_EVENTS_TASK_PRIORITY,
+        .task_stack_size = CONFIG_APP_EVENTS_TASK_STACK_SIZE,
+        .task_core_id = APP_EVENTS_TASK_CORE,
+    };
+    esp_err_t err = esp_event_loop_create(&loop_args, &app_loop);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) creating event loop", esp_err_to_name(err));
+        return err;
+    }
+
+    // Los handlers de nivel loop se ejecutan antes que el resto, marca el evento como retirado de la cola
+    return esp_event_handler_register_with(app_loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, on_dequeue, NULL);
+}
+
+esp_err_t app_events_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg, const char *name)
+{
+    if (app_loop == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (handler_count >= CONFIG_APP_EVENTS_MAX_HANDLERS)
+    {
+        ESP_LOGE(TAG, "No room for handler %s", name);
+        return ESP_ERR_NO_MEM;
+    }
+    handler_entry_t *entry = &handler_entries[handler_count];
+    entry->handler = handler;
+    entry->arg = arg;
+    entry->stats.name = name;
+    esp_err_t err = esp_event_handler_register_with(app_loop, base, id, dispatch, entry);
+    if (err == ESP_OK)
+    {
+        handler_count++;
+    }
+    return err;
+}
+
+esp_err_t app_events_post(esp_event_base_t base, int32_t id, const void *data, size_t data_size, TickType_t ticks)
+{
+    if (app_loop == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Se cuenta antes de publicar porque el loop puede atender el evento antes de que vuelva la llamada
+    unsigned current = atomic_fetch_add_explicit(&depth, 1, memory_order_relaxed) + 1;
+    esp_err_t err = esp_event_post_to(app_loop, base, id, data, data_size, ticks);
+    if (err != ESP_OK)
+    {
+        atomic_fetch_sub_explicit(&depth, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return err;
+    }
+    atomic_fetch_add_explicit(&posted, 1, memory_order_relaxed);
+
+    unsigned max = atomic_load_explicit(&max_depth, memory_order_relaxed);
+    while (current > max && !atomic_compare_exchange_weak_explicit(&max_depth, &max, current,
+                                                                    memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+    return ESP_OK;
+}
+
+esp_err_t app_events_forward(esp_event_base_t base, int32_t id, size_t data_size)
+{
+    if (forward_count >= CONFIG_APP_EVENTS_MAX_FORWARDS)
+    {
+        ESP_LOGE(TAG, "No room for more forwarded events");
+        return ESP_ERR_NO_MEM;
+    }
+    forward_entry_t *entry = &forward_entries[forward_count];
+    entry->data_size = data_size;
+    esp_err_t err = esp_event_handler_register(base, id, forward, entry);
+    if (err == ESP_OK)
+    {
+        forward_count++;
+    }
+    return err;
+}
+
+void app_events_get_stats(app_events_stats_t *stats)
+{
+    stats->posted = atomic_load_explicit(&posted, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&dropped, memory_order_relaxed);
+    stats->depth = atomic_load_explicit(&depth, memory_order_relaxed);
+    stats->max_depth = atomic_load_explicit(&max_depth, memory_order_relaxed);
+}
+
+size_t app_events_get_handler_stats(app_events_handler_stats_t *stats, size_t max)
+{
+    size_t count = (handler_count < max) ? handler_count : max;
+    for (size_t i = 0; i < count; i++)
+    {
+        stats[i] = handler_entries[i].stats;
+    }
+    return count;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void on_dequeue(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    atomic_fetch_sub_explicit(&depth, 1, memory_order_relaxed);
+}
+
+static void dispatch(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    handler_entry_t *entry = (handler_entry_t *)arg;
+    int64_t start_us = esp_timer_get_time();
+    entry->handler(entry->arg, event_base, event_id, event_data);
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    entry->stats.calls++;
+    entry->stats.total_us += elapsed_us;
+    if (elapsed_us > entry->stats.max_us)
+    {
+        entry->stats.max_us = elapsed_us;
+    }
+}
+
+static void forward(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // Se ejecuta en el loop por defecto, compartido con el Wi-Fi, por eso no espera si la cola esta llena
+    // Los eventos sin datos se publican con NULL, el loop no reserva memoria para una copia vacia
+    const forward_entry_t *entry = (const forward_entry_t *)arg;
+    if (event_data == NULL || entry->data_size == 0)
+    {
+        app_events_post(event_base, event_id, NULL, 0, 0);
+        return;
+    }
+    app_events_post(event_base, event_id, event_data, entry->data_size, 0);
+}
@@ -0,0 +1,54 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _APP_EVENTS_H_
+#define _APP_EVENTS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    uint32_t posted;
+    uint32_t dropped;
+    uint32_t depth;
+    uint32_t max_depth;
+} app_events_stats_t;
+
+typedef struct
+{
+    const char *name;
+    uint32_t calls;
+    uint32_t total_us;
+    uint32_t max_us;
+} app_events_handler_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Crea el loop de eventos de la aplicacion, con su propia tarea y cola
+esp_err_t app_events_init(void);
+
+// Registra un handler en el loop de la aplicacion, el nombre identifica su tiempo de ejecucion en las estadisticas
+esp_err_t app_events_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg, const char *name);
+
+// Publica un evento en el loop de la aplicacion, si la cola esta llena se descarta y se cuenta
+esp_err_t app_events_post(esp_event_base_t base, int32_t id, const void *data, size_t data_size, TickType_t ticks);
+
+// Reenvia un evento del loop por defecto al de la aplicacion, copiando data_size bytes de sus datos
+// El handler del loop por defecto solo encola, nunca espera
+esp_err_t app_events_forward(esp_event_base_t base, int32_t id, size_t data_size);
+
+void app_events_get_stats(app_events_stats_t *stats);
+
+// Copia las estadisticas de hasta max handlers y devuelve cuantas copio
+size_t app_events_get_handler_stats(app_events_handler_stats_t *stats, size_t max);
+
+//=====[#include guards - end]=================================================
+
+#endif // _APP_EVENTS_H_
@@ -0,0 +1,527 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "mem_pool.h"
+
+#include "cloud_frame.h"
+#include "cloud_conn.h"
+
+//=====[Declaration of private defines]========================================
+
+#define CLOUD_CONN_RTC_MAGIC 0x434C4F55
+#define CLOUD_CONN_NAMESPACE "cloud"
+
+#define CLOUD_CONN_PSK_MAX 32
+#define CLOUD_CONN_PSK_IDENTITY_MAX 64
+
+#define CLOUD_CONN_BACKOFF_MIN_MS 1000
+#define CLOUD_CONN_BACKOFF_MAX_MS 60000
+
+#define CLOUD_CONN_RX_LEN 256
+#define CLOUD_CONN_KEEPALIVE_US (CONFIG_CLOUD_CONN_KEEPALIVE_S * 1000000LL)
+
+// Los de la cola, el que esta enviando la tarea y los que pueden quedar en la cache de cada nucleo
+#define CLOUD_CONN_UPLINK_BLOCKS (CONFIG_CLOUD_CONN_QUEUE_LEN + 1 + portNUM_PROCESSORS * CONFIG_MEM_POOL_CACHE_SIZE)
+
+#if CONFIG_CLOUD_CONN_UPLINK_PSRAM
+#define CLOUD_CONN_UPLINK_REGION MEM_POOL_PSRAM
+#else
+#define CLOUD_CONN_UPLINK_REGION MEM_POOL_INTERNAL
+#endif
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    uint8_t channel;
+    uint8_t len;
+    uint8_t data[CLOUD_CONN_UPLINK_MAX];
+} uplink_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint8_t psk_len;
+    uint8_t psk[CLOUD_CONN_PSK_MAX];
+    char psk_identity[CLOUD_CONN_PSK_IDENTITY_MAX];
+    uint16_t session_len;
+    uint8_t session[CONFIG_CLOUD_CONN_SESSION_MAX];
+    uint32_t crc;
+} cloud_conn_rtc_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "cloud-conn";
+
+#ifdef CLOUD_CONN_HAS_CA
+extern const char cloud_ca_pem_start[] asm("_binary_cloud_ca_pem_start");
+#endif
+
+//=====[Declaration and initialization of private global variables]============
+
+// RTC_NOINIT_ATTR para que la sesion sobreviva al deep sleep y a los reinicios por software,
+// el CRC descarta el contenido despues de un power-on y entonces se recupera del NVS
+static RTC_NOINIT_ATTR cloud_conn_rtc_t rtc_state;
+
+static cloud_link_t tls_link;
+static cloud_frame_parser_t parser;
+static cloud_conn_config_t conn_config;
+static cloud_conn_stats_t conn_stats;
+
+// Lo incrementan la tarea que llama a cloud_conn_send y la tarea de la conexion
+static atomic_uint_fast32_t dropped;
+
+static mem_pool_t *uplink_pool = NULL;
+static QueueHandle_t uplink_queue = NULL;
+static TaskHandle_t conn_task = NULL;
+static esp_event_handler_instance_t got_ip_instance;
+
+// Solo los usa la tarea de la conexion
+static uplink_t *tx_item;
+static uint8_t tx_buf[CLOUD_FRAME_HEADER_LEN + CLOUD_FRAME_MAX_PAYLOAD];
+static uint8_t rx_buf[CLOUD_CONN_RX_LEN];
+static bool link_error = false;
+static bool uplink_acked = false;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void cloud_conn_task(void *arg);
+
+static esp_err_t link_init(void);
+
+static esp_err_t link_connect(void);
+
+static void link_run(void);
+
+static esp_err_t write_frame(uint8_t type, uint8_t channel, const uint8_t *payload, size_t len);
+
+static void on_frame(const cloud_frame_t *frame, void *ctx);
+
+static void store_session(cloud_link_handshake_t handshake);
+
+static void rtc_load(void);
+
+static void rtc_commit(void);
+
+static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t cloud_conn_start(const cloud_conn_config_t *config)
+{
+    if (conn_task != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    conn_config = *config;
+    esp_err_t err = link_init();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // La cola solo lleva punteros, los datos van en bloques del pool que se reservan de una vez
+    mem_pool_config_t pool_config = {
+        .name = "cloud_uplink",
+        .block_size = sizeof(uplink_t),
+        .block_count = CLOUD_CONN_UPLINK_BLOCKS,
+        .region = CLOUD_CONN_UPLINK_REGION,
+    };
+    uplink_pool = mem_pool_create(&pool_config);
+    uplink_queue = xQueueCreate(CONFIG_CLOUD_CONN_QUEUE_LEN, sizeof(uplink_t *));
+    if (uplink_pool == NULL || uplink_queue == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(cloud_conn_task, "cloud_conn", CONFIG_CLOUD_CONN_TASK_STACK_SIZE, NULL,
+                    CONFIG_CLOUD_CONN_TASK_PRIORITY, &conn_task) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Al recuperar la IP se reintenta enseguida en lugar de esperar el backoff
+    return esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL, &got_ip_instance);
+}
+
+esp_err_t cloud_conn_send(uint8_t channel, const void *data, size_t len)
+{
+    if (uplink_queue == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > CLOUD_CONN_UPLINK_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uplink_t *item = mem_pool_alloc(uplink_pool);
+    if (item == NULL)
+    {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+    item->channel = channel;
+    item->len = (uint8_t)len;
+    memcpy(item->data, data, len);
+    if (xQueueSend(uplink_queue, &item, 0) != pdTRUE)
+    {
+        mem_pool_free(uplink_pool, item);
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t cloud_conn_send_now(uint8_t channel, const void *data, size_t len)
+{
+    if (conn_task != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > CLOUD_FRAME_MAX_PAYLOAD)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(&conn_config, 0, sizeof(conn_config));
+    esp_err_t err = link_init();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // link_connect ofrece la sesion de la memoria RTC, al despertar de un deep sleep el handshake es abreviado
+    err = link_connect();
+    if (err == ESP_OK)
+    {
+        link_error = false;
+        uplink_acked = false;
+        err = write_frame(CLOUD_FRAME_UPLINK, channel, data, len);
+
+        // Los datos se dan por recibidos con el ACK del servidor, sin el quedan para el proximo envio
+        int64_t deadline_us = esp_timer_get_time() + (int64_t)CONFIG_CLOUD_CONN_IO_TIMEOUT_MS * 1000;
+        while (err == ESP_OK && !uplink_acked)
+        {
+            int64_t left_ms = (deadline_us - esp_timer_get_time()) / 1000;
+            if (left_ms <= 0)
+            {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            int rx_len = cloud_link_read(&tls_link, rx_buf, sizeof(rx_buf), (uint32_t)left_ms);
+            if (rx_len < 0 || (rx_len > 0 && cloud_frame_parser_feed(&parser, rx_buf, (size_t)rx_len) != 0) || link_error)
+            {
+                err = ESP_FAIL;
+            }
+        }
+        cloud_link_close(&tls_link);
+        conn_stats.connected = false;
+    }
+    cloud_link_free(&tls_link);
+    return err;
+}
+
+bool cloud_conn_is_connected(void)
+{
+    return conn_stats.connected;
+}
+
+void cloud_conn_get_stats(cloud_conn_stats_t *stats)
+{
+    *stats = conn_stats;
+    stats->dropped = (uint32_t)atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void cloud_conn_task(void *arg)
+{
+    uint32_t backoff_ms = CLOUD_CONN_BACKOFF_MIN_MS;
+    while (1)
+    {
+        if (link_connect() == ESP_OK)
+        {
+            link_run();
+            cloud_link_close(&tls_link);
+            conn_stats.connected = false;
+            backoff_ms = CLOUD_CONN_BACKOFF_MIN_MS;
+        }
+
+        // Espera antes de reintentar, al obtener la IP se reintenta enseguida
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(backoff_ms));
+        backoff_ms = (backoff_ms * 2 > CLOUD_CONN_BACKOFF_MAX_MS) ? CLOUD_CONN_BACKOFF_MAX_MS : backoff_ms * 2;
+    }
+}
+
+static esp_err_t link_init(void)
+{
+    rtc_load();
+
+    cloud_link_config_t link_config = {
+        .host = CONFIG_CLOUD_CONN_HOST,
+        .port = CONFIG_CLOUD_CONN_PORT,
+        .timeout_ms = CONFIG_CLOUD_CONN_IO_TIMEOUT_MS,
+    };
+#ifdef CLOUD_CONN_HAS_CA
+    link_config.ca_pem = cloud_ca_pem_start;
+#endif
+#if CONFIG_CLOUD_CONN_USE_PSK
+    if (rtc_state.psk_len == 0)
+    {
+        ESP_LOGE(TAG, "No PSK stored in NVS namespace %s", CLOUD_CONN_NAMESPACE);
+        return ESP_ERR_NOT_FOUND;
+    }
+    link_config.psk = rtc_state.psk;
+    link_config.psk_len = rtc_state.psk_len;
+    link_config.psk_identity = rtc_state.psk_identity;
+#endif
+    if (link_config.ca_pem == NULL && link_config.psk == NULL)
+    {
+        ESP_LOGE(TAG, "Neither a server CA nor a PSK is configured");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int ret = cloud_link_init(&tls_link, &link_config);
+    if (ret != 0)
+    {
+        ESP_LOGE(TAG, "Error -0x%04x initializing TLS", -ret);
+        cloud_link_free(&tls_link);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t link_connect(void)
+{
+    const uint8_t *session = (rtc_state.session_len > 0) ? rtc_state.session : NULL;
+    cloud_link_handshake_t handshake;
+    int64_t start_us = esp_timer_get_time();
+    int ret = cloud_link_connect(&tls_link, session, rtc_state.session_len, &handshake);
+    if (ret != 0)
+    {
+        conn_stats.failures++;
+        ESP_LOGW(TAG, "Error -0x%04x connecting to %s:%s", -ret, CONFIG_CLOUD_CONN_HOST, CONFIG_CLOUD_CONN_PORT);
+
+        // Si el servidor rechazo la sesion guardada el proximo intento hace el handshake completo
+        // Un timeout o un error de red no dicen nada de la sesion, se conserva
+        if (session != NULL && ret != MBEDTLS_ERR_NET_CONNECT_FAILED && ret != MBEDTLS_ERR_NET_UNKNOWN_HOST &&
+            ret != MBEDTLS_ERR_NET_SOCKET_FAILED && ret != MBEDTLS_ERR_SSL_TIMEOUT)
+        {
+            rtc_state.session_len = 0;
+            rtc_commit();
+        }
+        return ESP_FAIL;
+    }
+
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    conn_stats.last_handshake = handshake;
+    conn_stats.last_handshake_ms = elapsed_ms;
+    conn_stats.handshakes[handshake]++;
+    conn_stats.handshake_ms_total[handshake] += elapsed_ms;
+    ESP_LOGI(TAG, "Connected to %s:%s, %s handshake in %" PRIu32 " ms", CONFIG_CLOUD_CONN_HOST, CONFIG_CLOUD_CONN_PORT,
+             cloud_link_handshake_to_name(handshake), elapsed_ms);
+
+    store_session(handshake);
+    cloud_frame_parser_init(&parser, on_frame, NULL);
+    conn_stats.connected = true;
+    return ESP_OK;
+}
+
+static void link_run(void)
+{
+    int64_t last_rx_us = esp_timer_get_time();
+    bool ping_sent = false;
+    link_error = false;
+
+    while (!link_error)
+    {
+        // Los datos salientes se envian por la misma conexion que los comandos
+        while (xQueueReceive(uplink_queue, &tx_item, 0) == pdTRUE)
+        {
+            if (write_frame(CLOUD_FRAME_UPLINK, tx_item->channel, tx_item->data, tx_item->len) != ESP_OK)
+            {
+                // Vuelve a la cola para enviarse por la proxima conexion
+                if (xQueueSendToFront(uplink_queue, &tx_item, 0) != pdTRUE)
+                {
+                    mem_pool_free(uplink_pool, tx_item);
+                    atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+                }
+                return;
+            }
+            mem_pool_free(uplink_pool, tx_item);
+        }
+
+        int len = cloud_link_read(&tls_link, rx_buf, sizeof(rx_buf), CONFIG_CLOUD_CONN_POLL_MS);
+        if (len < 0)
+        {
+            ESP_LOGW(TAG, "Connection lost (-0x%04x)", -len);
+            return;
+        }
+        int64_t now_us = esp_timer_get_time();
+        if (len > 0)
+        {
+            last_rx_us = now_us;
+            ping_sent = false;
+            if (cloud_frame_parser_feed(&parser, rx_buf, (size_t)len) != 0)
+            {
+                ESP_LOGW(TAG, "Invalid frame length, closing connection");
+                return;
+            }
+            continue;
+        }
+
+        // Sin trafico se manda un PING, si tampoco responde la conexion se da por muerta
+        int64_t idle_us = now_us - last_rx_us;
+        if (idle_us > 2 * CLOUD_CONN_KEEPALIVE_US)
+        {
+            ESP_LOGW(TAG, "Server not responding, closing connection");
+            return;
+        }
+        if (!ping_sent && idle_us > CLOUD_CONN_KEEPALIVE_US)
+        {
+            if (write_frame(CLOUD_FRAME_PING, 0, NULL, 0) != ESP_OK)
+            {
+                return;
+            }
+            ping_sent = true;
+        }
+    }
+}
+
+static esp_err_t write_frame(uint8_t type, uint8_t channel, const uint8_t *payload, size_t len)
+{
+    size_t frame_len = cloud_frame_encode(type, channel, payload, len, tx_buf, sizeof(tx_buf));
+    int ret = cloud_link_write(&tls_link, tx_buf, frame_len);
+    if (conn_config.on_tx != NULL)
+    {
+        conn_config.on_tx(ret == 0, conn_config.ctx);
+    }
+    if (ret != 0)
+    {
+        ESP_LOGW(TAG, "Error -0x%04x writing frame", -ret);
+        return ESP_FAIL;
+    }
+    conn_stats.frames_sent++;
+    return ESP_OK;
+}
+
+static void on_frame(const cloud_frame_t *frame, void *ctx)
+{
+    conn_stats.frames_received++;
+    switch (frame->type)
+    {
+    case CLOUD_FRAME_COMMAND:
+        if (conn_config.on_command != NULL)
+        {
+            conn_config.on_command(frame->channel, frame->payload, frame->len, conn_config.ctx);
+        }
+        if (write_frame(CLOUD_FRAME_ACK, frame->channel, NULL, 0) != ESP_OK)
+        {
+            link_error = true;
+        }
+        break;
+    case CLOUD_FRAME_PING:
+        if (write_frame(CLOUD_FRAME_PONG, frame->channel, NULL, 0) != ESP_OK)
+        {
+            link_error = true;
+        }
+        break;
+    case CLOUD_FRAME_ACK:
+        // Solo cloud_conn_send_now espera el ACK, en la conexion permanente solo la mantiene viva
+        uplink_acked = true;
+        break;
+    default:
+        // PONG solo mantiene viva la conexion
+        break;
+    }
+}
+
+static void store_session(cloud_link_handshake_t handshake)
+{
+    size_t len = 0;
+    if (cloud_link_save_session(&tls_link, rtc_state.session, sizeof(rtc_state.session), &len) != 0)
+    {
+        ESP_LOGW(TAG, "TLS session does not fit in %d bytes", CONFIG_CLOUD_CONN_SESSION_MAX);
+        len = 0;
+    }
+    rtc_state.session_len = (uint16_t)len;
+    rtc_commit();
+
+    // El NVS solo se escribe con una sesion nueva, los handshakes abreviados no gastan la flash
+    if (handshake == CLOUD_LINK_HANDSHAKE_RESUMED || len == 0)
+    {
+        return;
+    }
+    nvs_handle_t my_handle;
+    if (nvs_open(CLOUD_CONN_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK)
+    {
+        if (nvs_set_blob(my_handle, "session", rtc_state.session, len) == ESP_OK)
+        {
+            nvs_commit(my_handle);
+        }
+        nvs_close(my_handle);
+    }
+}
+
+static void rtc_load(void)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&rtc_state, offsetof(cloud_conn_rtc_t, crc));
+    if (rtc_state.magic == CLOUD_CONN_RTC_MAGIC && rtc_state.crc == crc)
+    {
+        ESP_LOGI(TAG, "Using TLS session from RTC memory (%u bytes)", (unsigned)rtc_state.session_len);
+        return;
+    }
+
+    // Despues de un power-on la sesion y la PSK se recuperan del NVS
+    memset(&rtc_state, 0, sizeof(rtc_state));
+    rtc_state.magic = CLOUD_CONN_RTC_MAGIC;
+    nvs_handle_t my_handle;
+    if (nvs_open(CLOUD_CONN_NAMESPACE, NVS_READONLY, &my_handle) == ESP_OK)
+    {
+        size_t len = sizeof(rtc_state.session);
+        if (nvs_get_blob(my_handle, "session", rtc_state.session, &len) == ESP_OK)
+        {
+            rtc_state.session_len = (uint16_t)len;
+            ESP_LOGI(TAG, "Using TLS session from NVS (%u bytes)", (unsigned)len);
+        }
+#if CONFIG_CLOUD_CONN_USE_PSK
+        len = sizeof(rtc_state.psk);
+        if (nvs_get_blob(my_handle, "psk", rtc_state.psk, &len) == ESP_OK)
+        {
+            rtc_state.psk_len = (uint8_t)len;
+        }
+        len = sizeof(rtc_state.psk_identity);
+        if (nvs_get_str(my_handle, "psk_id", rtc_state.psk_identity, &len) != ESP_OK)
+        {
+            rtc_state.psk_len = 0;
+        }
+#endif
+        nvs_close(my_handle);
+    }
+    rtc_commit();
+}
+
+static void rtc_commit(void)
+{
+    rtc_state.crc = esp_rom_crc32_le(0, (const uint8_t *)&rtc_state, offsetof(cloud_conn_rtc_t, crc));
+}
+
+static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    xTaskNotifyGive(conn_task);
+}
@@ -0,0 +1,72 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "cloud_frame.h"
+
+//=====[Implementations of public functions]===================================
+
+size_t cloud_frame_encode(uint8_t type, uint8_t channel, const uint8_t *payload, size_t len, uint8_t *out, size_t max)
+{
+    if (len > CLOUD_FRAME_MAX_PAYLOAD || CLOUD_FRAME_HEADER_LEN + len > max)
+    {
+        return 0;
+    }
+    out[0] = type;
+    out[1] = channel;
+    out[2] = (uint8_t)len;
+    out[3] = (uint8_t)(len >> 8);
+    if (len > 0)
+    {
+        memcpy(&out[CLOUD_FRAME_HEADER_LEN], payload, len);
+    }
+    return CLOUD_FRAME_HEADER_LEN + len;
+}
+
+void cloud_frame_parser_init(cloud_frame_parser_t *parser, cloud_frame_cb_t on_frame, void *ctx)
+{
+    parser->fill = 0;
+    parser->on_frame = on_frame;
+    parser->ctx = ctx;
+}
+
+int cloud_frame_parser_feed(cloud_frame_parser_t *parser, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        // Primero completa la cabecera y despues el payload que declara
+        size_t need = CLOUD_FRAME_HEADER_LEN;
+        if (parser->fill >= CLOUD_FRAME_HEADER_LEN)
+        {
+            need += (size_t)parser->buf[2] | ((size_t)parser->buf[3] << 8);
+        }
+        size_t chunk = (need - parser->fill < len) ? need - parser->fill : len;
+        memcpy(&parser->buf[parser->fill], data, chunk);
+        parser->fill += chunk;
+        data += chunk;
+        len -= chunk;
+        if (parser->fill < CLOUD_FRAME_HEADER_LEN)
+        {
+            continue;
+        }
+
+        size_t payload_len = (size_t)parser->buf[2] | ((size_t)parser->buf[3] << 8);
+        if (payload_len > CLOUD_FRAME_MAX_PAYLOAD)
+        {
+            parser->fill = 0;
+            return -1;
+        }
+        if (parser->fill == CLOUD_FRAME_HEADER_LEN + payload_len)
+        {
+            cloud_frame_t frame = {
+                .type = parser->buf[0],
+                .channel = parser->buf[1],
+                .len = (uint16_t)payload_len,
+                .payload = &parser->buf[CLOUD_FRAME_HEADER_LEN],
+            };
+            parser->fill = 0;
+            parser->on_frame(&frame, parser->ctx);
+        }
+    }
+    return 0;
+}
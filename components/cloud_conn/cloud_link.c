@@ -0,0 +1,415 @@
+//=====[Libraries]=============================================================
+
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "mbedtls/version.h"
+#include "mbedtls/error.h"
+#include "mbedtls/sha256.h"
+
+#include "cloud_link.h"
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+#include "psa/crypto.h"
+#endif
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *PERSONALIZATION = "cloud_link";
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int net_connect(cloud_link_t *link);
+
+static int wait_connected(int fd, uint32_t timeout_ms);
+
+static int verify_cb(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags);
+
+static void store_secret_tag(cloud_link_t *link, const unsigned char *secret, size_t len);
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+static void export_keys_cb(void *ctx, mbedtls_ssl_key_export_type type, const unsigned char *secret, size_t secret_len,
+                           const unsigned char client_random[32], const unsigned char server_random[32],
+                           mbedtls_tls_prf_types tls_prf_type);
+#elif defined(MBEDTLS_SSL_EXPORT_KEYS)
+static int export_keys_cb(void *ctx, const unsigned char *ms, const unsigned char *kb, size_t maclen, size_t keylen,
+                          size_t ivlen);
+#endif
+
+//=====[Implementations of public functions]===================================
+
+int cloud_link_init(cloud_link_t *link, const cloud_link_config_t *config)
+{
+    mbedtls_net_init(&link->net);
+    mbedtls_ssl_init(&link->ssl);
+    mbedtls_ssl_config_init(&link->conf);
+    mbedtls_entropy_init(&link->entropy);
+    mbedtls_ctr_drbg_init(&link->ctr_drbg);
+    mbedtls_x509_crt_init(&link->ca);
+    link->host = config->host;
+    link->port = config->port;
+    link->timeout_ms = config->timeout_ms;
+    link->verify_calls = 0;
+    link->has_ca = 0;
+    link->offered = 0;
+    link->secret_seen = 0;
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    if (psa_crypto_init() != PSA_SUCCESS)
+    {
+        return MBEDTLS_ERR_ERROR_GENERIC_ERROR;
+    }
+#endif
+
+    int ret = mbedtls_ctr_drbg_seed(&link->ctr_drbg, mbedtls_entropy_func, &link->entropy,
+                                    (const unsigned char *)PERSONALIZATION, strlen(PERSONALIZATION));
+    if (ret != 0)
+    {
+        return ret;
+    }
+    ret = mbedtls_ssl_config_defaults(&link->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    // Con TLS 1.2 el ticket se guarda junto con la sesion y el handshake abreviado no hace calculos de ECC/RSA
+#if MBEDTLS_VERSION_MAJOR >= 3
+    mbedtls_ssl_conf_max_tls_version(&link->conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#else
+    mbedtls_ssl_conf_max_version(&link->conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+#endif
+    mbedtls_ssl_conf_rng(&link->conf, mbedtls_ctr_drbg_random, &link->ctr_drbg);
+    // Con un AP que se cae o un servidor que no responde, mbedtls_ssl_handshake y mbedtls_ssl_read vuelven con
+    // MBEDTLS_ERR_SSL_TIMEOUT en lugar de bloquear la tarea para siempre
+    mbedtls_ssl_conf_read_timeout(&link->conf, config->timeout_ms);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&link->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    if (config->ca_pem != NULL)
+    {
+        ret = mbedtls_x509_crt_parse(&link->ca, (const unsigned char *)config->ca_pem, strlen(config->ca_pem) + 1);
+        if (ret != 0)
+        {
+            return ret;
+        }
+        mbedtls_ssl_conf_ca_chain(&link->conf, &link->ca, NULL);
+        mbedtls_ssl_conf_authmode(&link->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        // El callback solo se llama cuando el servidor manda su certificado, es decir en un handshake completo
+        mbedtls_ssl_conf_verify(&link->conf, verify_cb, link);
+        link->has_ca = 1;
+    }
+    else
+    {
+        mbedtls_ssl_conf_authmode(&link->conf, MBEDTLS_SSL_VERIFY_NONE);
+    }
+
+    if (config->psk != NULL)
+    {
+#if defined(MBEDTLS_KEY_EXCHANGE_SOME_PSK_ENABLED) || defined(MBEDTLS_SSL_HANDSHAKE_WITH_PSK_ENABLED)
+        ret = mbedtls_ssl_conf_psk(&link->conf, config->psk, config->psk_len,
+                                   (const unsigned char *)config->psk_identity, strlen(config->psk_identity));
+        if (ret != 0)
+        {
+            return ret;
+        }
+#else
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif
+    }
+
+#if MBEDTLS_VERSION_MAJOR < 3 && defined(MBEDTLS_SSL_EXPORT_KEYS)
+    mbedtls_ssl_conf_export_keys_cb(&link->conf, export_keys_cb, link);
+#endif
+    return mbedtls_ssl_setup(&link->ssl, &link->conf);
+}
+
+int cloud_link_connect(cloud_link_t *link, const uint8_t *session, size_t session_len, cloud_link_handshake_t *handshake)
+{
+    int ret = mbedtls_ssl_session_reset(&link->ssl);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    if (link->has_ca)
+    {
+        ret = mbedtls_ssl_set_hostname(&link->ssl, link->host);
+        if (ret != 0)
+        {
+            return ret;
+        }
+    }
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+    mbedtls_ssl_set_export_keys_cb(&link->ssl, export_keys_cb, link);
+#endif
+    link->offered = 0;
+    link->secret_seen = 0;
+
+    // Una sesion que no se puede cargar, por ejemplo de otra version de mbedTLS, se descarta
+    if (session != NULL && session_len > CLOUD_LINK_SECRET_TAG_LEN)
+    {
+        mbedtls_ssl_session saved;
+        mbedtls_ssl_session_init(&saved);
+        if (mbedtls_ssl_session_load(&saved, session + CLOUD_LINK_SECRET_TAG_LEN, session_len - CLOUD_LINK_SECRET_TAG_LEN) == 0 &&
+            mbedtls_ssl_set_session(&link->ssl, &saved) == 0)
+        {
+            memcpy(link->offered_tag, session, CLOUD_LINK_SECRET_TAG_LEN);
+            link->offered = 1;
+        }
+        mbedtls_ssl_session_free(&saved);
+    }
+
+    ret = net_connect(link);
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    // El socket es bloqueante, sin este timeout un envio con la ventana TCP llena no vuelve nunca
+    struct timeval tv = {
+        .tv_sec = link->timeout_ms / 1000,
+        .tv_usec = (link->timeout_ms % 1000) * 1000,
+    };
+    if (setsockopt(link->net.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0)
+    {
+        mbedtls_net_free(&link->net);
+        return MBEDTLS_ERR_NET_SOCKET_FAILED;
+    }
+    mbedtls_ssl_set_bio(&link->ssl, &link->net, mbedtls_net_send, NULL, mbedtls_net_recv_timeout);
+
+    link->verify_calls = 0;
+    while ((ret = mbedtls_ssl_handshake(&link->ssl)) != 0)
+    {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+        {
+            mbedtls_net_free(&link->net);
+            return ret;
+        }
+    }
+
+    // Al retomar la sesion el master secret es el de la sesion guardada, un handshake completo deriva uno nuevo
+    // Con CA y PSK configuradas un handshake completo con PSK tampoco manda certificado, por eso no alcanza con verify_cb
+    if (link->offered && link->secret_seen && memcmp(link->offered_tag, link->secret_tag, CLOUD_LINK_SECRET_TAG_LEN) == 0)
+    {
+        *handshake = CLOUD_LINK_HANDSHAKE_RESUMED;
+    }
+    else
+    {
+        *handshake = (link->verify_calls > 0) ? CLOUD_LINK_HANDSHAKE_FULL : CLOUD_LINK_HANDSHAKE_PSK;
+    }
+    return 0;
+}
+
+int cloud_link_save_session(cloud_link_t *link, uint8_t *buf, size_t max, size_t *len)
+{
+    // Sin el resumen del master secret no se podria distinguir una sesion retomada de una nueva
+    if (!link->secret_seen)
+    {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+    if (max <= CLOUD_LINK_SECRET_TAG_LEN)
+    {
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    }
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    int ret = mbedtls_ssl_get_session(&link->ssl, &session);
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_session_save(&session, buf + CLOUD_LINK_SECRET_TAG_LEN, max - CLOUD_LINK_SECRET_TAG_LEN, len);
+    }
+    mbedtls_ssl_session_free(&session);
+    if (ret == 0)
+    {
+        memcpy(buf, link->secret_tag, CLOUD_LINK_SECRET_TAG_LEN);
+        *len += CLOUD_LINK_SECRET_TAG_LEN;
+    }
+    return ret;
+}
+
+int cloud_link_write(cloud_link_t *link, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        int ret = mbedtls_ssl_write(&link->ssl, data, len);
+        if (ret > 0)
+        {
+            data += ret;
+            len -= (size_t)ret;
+        }
+        else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+        {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int cloud_link_read(cloud_link_t *link, uint8_t *buf, size_t max, uint32_t timeout_ms)
+{
+    // Si mbedTLS ya tiene un registro descifrado no hace falta esperar al socket
+    if (mbedtls_ssl_get_bytes_avail(&link->ssl) == 0)
+    {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(link->net.fd, &read_fds);
+        struct timeval tv = {
+            .tv_sec = timeout_ms / 1000,
+            .tv_usec = (timeout_ms % 1000) * 1000,
+        };
+        int ready = select(link->net.fd + 1, &read_fds, NULL, NULL, &tv);
+        if (ready < 0)
+        {
+            return MBEDTLS_ERR_NET_POLL_FAILED;
+        }
+        if (ready == 0)
+        {
+            return 0;
+        }
+    }
+
+    int ret = mbedtls_ssl_read(&link->ssl, buf, max);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+        return 0;
+    }
+    if (ret == 0)
+    {
+        return MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY;
+    }
+    return ret;
+}
+
+void cloud_link_close(cloud_link_t *link)
+{
+    mbedtls_ssl_close_notify(&link->ssl);
+    mbedtls_net_free(&link->net);
+}
+
+void cloud_link_free(cloud_link_t *link)
+{
+    mbedtls_net_free(&link->net);
+    mbedtls_ssl_free(&link->ssl);
+    mbedtls_ssl_config_free(&link->conf);
+    mbedtls_ctr_drbg_free(&link->ctr_drbg);
+    mbedtls_entropy_free(&link->entropy);
+    mbedtls_x509_crt_free(&link->ca);
+}
+
+const char *cloud_link_handshake_to_name(cloud_link_handshake_t handshake)
+{
+    static const char *names[] = {"full", "resumed", "psk"};
+    return (handshake < CLOUD_LINK_HANDSHAKE_COUNT) ? names[handshake] : "unknown";
+}
+
+//=====[Implementations of private functions]==================================
+
+static int net_connect(cloud_link_t *link)
+{
+    // Igual que mbedtls_net_connect pero con timeout: con el servidor inalcanzable el connect bloqueante
+    // esperaria todos los reintentos de SYN de lwIP
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_protocol = IPPROTO_TCP,
+    };
+    struct addrinfo *addr_list;
+    if (getaddrinfo(link->host, link->port, &hints, &addr_list) != 0 || addr_list == NULL)
+    {
+        return MBEDTLS_ERR_NET_UNKNOWN_HOST;
+    }
+
+    int ret = MBEDTLS_ERR_NET_UNKNOWN_HOST;
+    for (struct addrinfo *cur = addr_list; cur != NULL; cur = cur->ai_next)
+    {
+        link->net.fd = socket(cur->ai_family, cur->ai_socktype, cur->ai_protocol);
+        if (link->net.fd < 0)
+        {
+            ret = MBEDTLS_ERR_NET_SOCKET_FAILED;
+            continue;
+        }
+        mbedtls_net_set_nonblock(&link->net);
+        if (connect(link->net.fd, cur->ai_addr, cur->ai_addrlen) == 0 ||
+            (errno == EINPROGRESS && wait_connected(link->net.fd, link->timeout_ms) == 0))
+        {
+            mbedtls_net_set_block(&link->net);
+            ret = 0;
+            break;
+        }
+        mbedtls_net_free(&link->net);
+        ret = MBEDTLS_ERR_NET_CONNECT_FAILED;
+    }
+    freeaddrinfo(addr_list);
+    return ret;
+}
+
+static int wait_connected(int fd, uint32_t timeout_ms)
+{
+    // El socket queda listo para escribir cuando el connect termina, bien o mal, SO_ERROR dice cual de los dos
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+    FD_SET(fd, &write_fds);
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    if (select(fd + 1, NULL, &write_fds, NULL, &tv) <= 0)
+    {
+        return -1;
+    }
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int verify_cb(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags)
+{
+    // La verificacion la sigue haciendo mbedTLS, aca solo se cuenta el certificado del servidor
+    cloud_link_t *link = (cloud_link_t *)ctx;
+    if (depth == 0)
+    {
+        link->verify_calls++;
+    }
+    return 0;
+}
+
+static void store_secret_tag(cloud_link_t *link, const unsigned char *secret, size_t len)
+{
+    // Se guarda un resumen y no el secreto, alcanza para comparar
+    unsigned char digest[32];
+    if (mbedtls_sha256(secret, len, digest, 0) == 0)
+    {
+        memcpy(link->secret_tag, digest, CLOUD_LINK_SECRET_TAG_LEN);
+        link->secret_seen = 1;
+    }
+}
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+static void export_keys_cb(void *ctx, mbedtls_ssl_key_export_type type, const unsigned char *secret, size_t secret_len,
+                           const unsigned char client_random[32], const unsigned char server_random[32],
+                           mbedtls_tls_prf_types tls_prf_type)
+{
+    // mbedTLS lo llama en cada handshake, completo o abreviado, al derivar las claves
+    if (type == MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET)
+    {
+        store_secret_tag((cloud_link_t *)ctx, secret, secret_len);
+    }
+}
+#elif defined(MBEDTLS_SSL_EXPORT_KEYS)
+static int export_keys_cb(void *ctx, const unsigned char *ms, const unsigned char *kb, size_t maclen, size_t keylen,
+                          size_t ivlen)
+{
+    store_secret_tag((cloud_link_t *)ctx, ms, 48);
+    return 0;
+}
+#endif
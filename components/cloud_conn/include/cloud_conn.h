@@ -0,0 +1,68 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _CLOUD_CONN_H_
+#define _CLOUD_CONN_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "cloud_link.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Los datos salientes son telemetria corta, los comandos pueden llegar hasta CLOUD_FRAME_MAX_PAYLOAD
+#define CLOUD_CONN_UPLINK_MAX 64
+
+//=====[Declaration of public data types]======================================
+
+// Se ejecuta en la tarea de la conexion, no tiene que bloquearse
+typedef void (*cloud_conn_command_cb_t)(uint8_t channel, const uint8_t *data, size_t len, void *ctx);
+
+// Se ejecuta en la tarea de la conexion con el resultado de cada escritura en el socket
+typedef void (*cloud_conn_tx_cb_t)(bool ok, void *ctx);
+
+typedef struct
+{
+    cloud_conn_command_cb_t on_command;
+    cloud_conn_tx_cb_t on_tx;
+    void *ctx;
+} cloud_conn_config_t;
+
+typedef struct
+{
+    bool connected;
+    cloud_link_handshake_t last_handshake;
+    uint32_t last_handshake_ms;
+    uint32_t handshakes[CLOUD_LINK_HANDSHAKE_COUNT];
+    uint32_t handshake_ms_total[CLOUD_LINK_HANDSHAKE_COUNT];
+    uint32_t failures;
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t dropped;
+} cloud_conn_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Recupera la sesion TLS guardada y arranca la tarea de la conexion, llamar una vez obtenida la direccion IP
+esp_err_t cloud_conn_start(const cloud_conn_config_t *config);
+
+// Encola un payload para enviarlo por la conexion, no bloquea y descarta si la cola esta llena
+esp_err_t cloud_conn_send(uint8_t channel, const void *data, size_t len);
+
+// Sin la tarea de la conexion: conecta retomando la sesion guardada, envia una trama UPLINK, espera el ACK y
+// cierra. Es para el modo duty cycle, no se puede usar despues de cloud_conn_start. Bloquea hasta que recibe
+// el ACK o vencen los timeouts de CONFIG_CLOUD_CONN_IO_TIMEOUT_MS, el payload puede llegar a CLOUD_FRAME_MAX_PAYLOAD
+esp_err_t cloud_conn_send_now(uint8_t channel, const void *data, size_t len);
+
+bool cloud_conn_is_connected(void);
+
+void cloud_conn_get_stats(cloud_conn_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _CLOUD_CONN_H_
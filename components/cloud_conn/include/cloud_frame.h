@@ -0,0 +1,59 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _CLOUD_FRAME_H_
+#define _CLOUD_FRAME_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define CLOUD_FRAME_HEADER_LEN 4
+#define CLOUD_FRAME_MAX_PAYLOAD 512
+
+//=====[Declaration of public data types]======================================
+
+// Sobre la conexion TLS viajan tramas: [0] tipo, [1] canal, [2..3] largo del payload (little endian), payload
+typedef enum
+{
+    CLOUD_FRAME_UPLINK = 1,
+    CLOUD_FRAME_COMMAND = 2,
+    CLOUD_FRAME_ACK = 3,
+    CLOUD_FRAME_PING = 4,
+    CLOUD_FRAME_PONG = 5,
+} cloud_frame_type_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t channel;
+    uint16_t len;
+    const uint8_t *payload;
+} cloud_frame_t;
+
+typedef void (*cloud_frame_cb_t)(const cloud_frame_t *frame, void *ctx);
+
+// Arma las tramas a partir de un flujo de bytes que puede llegar fragmentado
+typedef struct
+{
+    uint8_t buf[CLOUD_FRAME_HEADER_LEN + CLOUD_FRAME_MAX_PAYLOAD];
+    size_t fill;
+    cloud_frame_cb_t on_frame;
+    void *ctx;
+} cloud_frame_parser_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Codifica una trama en out, devuelve el largo o 0 si el payload es demasiado grande
+size_t cloud_frame_encode(uint8_t type, uint8_t channel, const uint8_t *payload, size_t len, uint8_t *out, size_t max);
+
+void cloud_frame_parser_init(cloud_frame_parser_t *parser, cloud_frame_cb_t on_frame, void *ctx);
+
+// Devuelve 0, o -1 si una trama declara un largo mayor al maximo y hay que cerrar la conexion
+int cloud_frame_parser_feed(cloud_frame_parser_t *parser, const uint8_t *data, size_t len);
+
+//=====[#include guards - end]=================================================
+
+#endif // _CLOUD_FRAME_H_
@@ -0,0 +1,91 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _CLOUD_LINK_H_
+#define _CLOUD_LINK_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+
+//=====[Declaration of public defines]=========================================
+
+// La sesion guardada empieza con un resumen del master secret, que permite saber si el servidor la retomo
+#define CLOUD_LINK_SECRET_TAG_LEN 8
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    CLOUD_LINK_HANDSHAKE_FULL,
+    CLOUD_LINK_HANDSHAKE_RESUMED,
+    CLOUD_LINK_HANDSHAKE_PSK,
+    CLOUD_LINK_HANDSHAKE_COUNT,
+} cloud_link_handshake_t;
+
+typedef struct
+{
+    const char *host;
+    const char *port;
+    // CA del servidor en PEM terminado en '\0', NULL si solo se usa PSK
+    const char *ca_pem;
+    const uint8_t *psk;
+    size_t psk_len;
+    const char *psk_identity;
+    // Tiempo maximo que se espera al socket en el connect y en cada lectura y escritura, tambien durante el handshake
+    uint32_t timeout_ms;
+} cloud_link_config_t;
+
+// Cliente TLS 1.2 sobre mbedTLS, sin dependencias del ESP-IDF para poder probarlo en una PC
+typedef struct
+{
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_x509_crt ca;
+    const char *host;
+    const char *port;
+    uint32_t timeout_ms;
+    unsigned verify_calls;
+    int has_ca;
+    uint8_t offered_tag[CLOUD_LINK_SECRET_TAG_LEN];
+    uint8_t secret_tag[CLOUD_LINK_SECRET_TAG_LEN];
+    int offered;
+    int secret_seen;
+} cloud_link_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Prepara la configuracion TLS, se hace una sola vez y se reutiliza en cada conexion
+int cloud_link_init(cloud_link_t *link, const cloud_link_config_t *config);
+
+// Abre la conexion y hace el handshake, retomando la sesion guardada si session no es NULL
+int cloud_link_connect(cloud_link_t *link, const uint8_t *session, size_t session_len, cloud_link_handshake_t *handshake);
+
+// Serializa la sesion actual (ticket incluido) para retomarla en la proxima conexion
+// Los primeros CLOUD_LINK_SECRET_TAG_LEN bytes son el resumen del master secret, el resto es de mbedTLS
+int cloud_link_save_session(cloud_link_t *link, uint8_t *buf, size_t max, size_t *len);
+
+// Escribe todos los bytes, devuelve 0 o un error de mbedTLS, por ejemplo si el socket no acepta datos en timeout_ms
+int cloud_link_write(cloud_link_t *link, const uint8_t *data, size_t len);
+
+// Espera datos hasta timeout_ms, devuelve la cantidad leida, 0 si no llego nada o un error de mbedTLS
+int cloud_link_read(cloud_link_t *link, uint8_t *buf, size_t max, uint32_t timeout_ms);
+
+void cloud_link_close(cloud_link_t *link);
+
+void cloud_link_free(cloud_link_t *link);
+
+const char *cloud_link_handshake_to_name(cloud_link_handshake_t handshake);
+
+//=====[#include guards - end]=================================================
+
+#endif // _CLOUD_LINK_H_
@@ -0,0 +1,452 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_rom_crc.h"
+#include "lwip/sockets.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "duty_cycle.h"
+
+//=====[Declaration of private defines]========================================
+
+#define DUTY_CYCLE_RTC_MAGIC 0x44555459
+
+#define CONNECTED_BIT BIT0
+#define FAILED_BIT BIT1
+
+#define DUTY_CYCLE_PACKET_LEN (DUTY_CYCLE_HEADER_LEN + CONFIG_DUTY_CYCLE_PENDING_RECORDS * DUTY_CYCLE_RECORD_LEN)
+
+// El periodo se duplica con cada falla hasta este limite, despues solo lo acota CONFIG_DUTY_CYCLE_MAX_BACKOFF_S
+#define DUTY_CYCLE_MAX_BACKOFF_SHIFT 12
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t wake;
+
+    // Conexion con el AP
+    bool connection_valid;
+    uint8_t ssid[32];
+    uint8_t password[64];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gw;
+    uint32_t dns;
+    uint32_t lease_age_ms;
+
+    // Despertares seguidos sin conexion, alargan el deep sleep siguiente
+    uint8_t connect_failures;
+
+    // Telemetria pendiente de enviar, en un buffer circular
+    duty_cycle_record_t records[CONFIG_DUTY_CYCLE_PENDING_RECORDS];
+    uint8_t record_head;
+    uint8_t record_count;
+
+    duty_cycle_report_t last_report;
+    uint32_t sleep_ms;
+
+    uint32_t crc;
+} duty_cycle_rtc_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "duty-cycle";
+
+static const char *phase_names[DUTY_CYCLE_PHASE_COUNT] = {"boot", "init", "sample", "connect", "send"};
+
+//=====[Declaration and initialization of private global variables]============
+
+// RTC_NOINIT_ATTR para que la telemetria pendiente sobreviva tambien al reinicio por software
+// despues de una conexion rapida fallida, el CRC descarta el contenido despues de un power-on
+static RTC_NOINIT_ATTR duty_cycle_rtc_t rtc_state;
+static bool rtc_checked = false;
+
+static int64_t phase_start_us = 0;
+static uint16_t phase_ms[DUTY_CYCLE_PHASE_COUNT];
+static bool fast_path = false;
+
+static EventGroupHandle_t connect_events = NULL;
+
+static uint8_t packet[DUTY_CYCLE_PACKET_LEN];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void rtc_check(void);
+
+static void rtc_commit(void);
+
+static void connect_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static void save_ip_info(esp_netif_t *netif);
+
+static void write_u16(uint8_t *p, uint16_t value);
+
+static void write_u32(uint8_t *p, uint32_t value);
+
+//=====[Implementations of public functions]===================================
+
+bool duty_cycle_has_connection(void)
+{
+    rtc_check();
+    return rtc_state.connection_valid;
+}
+
+esp_err_t duty_cycle_connect(TickType_t timeout)
+{
+    rtc_check();
+    if (!rtc_state.connection_valid)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    connect_events = xEventGroupCreate();
+
+    // Reutiliza la IP mientras el lease siga vigente, asi no hay que esperar al DHCP
+    esp_netif_t *netif = esp_netif_create_default_wifi_sta();
+    bool reuse_ip = rtc_state.ip != 0 && rtc_state.lease_age_ms < (uint32_t)CONFIG_DUTY_CYCLE_LEASE_REUSE_S * 1000;
+    if (reuse_ip)
+    {
+        ESP_ERROR_CHECK(esp_netif_dhcpc_stop(netif));
+        esp_netif_ip_info_t ip_info = {
+            .ip.addr = rtc_state.ip,
+            .netmask.addr = rtc_state.netmask,
+            .gw.addr = rtc_state.gw,
+        };
+        ESP_ERROR_CHECK(esp_netif_set_ip_info(netif, &ip_info));
+        esp_netif_dns_info_t dns_info = {
+            .ip.u_addr.ip4.addr = rtc_state.dns,
+            .ip.type = ESP_IPADDR_TYPE_V4,
+        };
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info);
+    }
+
+    esp_event_handler_instance_t wifi_instance;
+    esp_event_handler_instance_t ip_instance;
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, connect_event_handler, NULL, &wifi_instance));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, connect_event_handler, NULL, &ip_instance));
+
+    // La configuracion de Wi-Fi se mantiene solo en RAM, no se lee ni se escribe el NVS
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    cfg.nvs_enable = 0;
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+
+    // Con el BSSID y el canal fijos el driver no recorre los demas canales
+    wifi_config_t wifi_config = {0};
+    memcpy(wifi_config.sta.ssid, rtc_state.ssid, sizeof(wifi_config.sta.ssid));
+    memcpy(wifi_config.sta.password, rtc_state.password, sizeof(wifi_config.sta.password));
+    memcpy(wifi_config.sta.bssid, rtc_state.bssid, sizeof(wifi_config.sta.bssid));
+    wifi_config.sta.bssid_set = true;
+    wifi_config.sta.channel = rtc_state.channel;
+    wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+#if CONFIG_ESP_WIFI_11KV_SUPPORT
+    // 802.11k/v se negocian en la asociacion, igual que en el provisioning
+    wifi_config.sta.rm_enabled = 1;
+    wifi_config.sta.btm_enabled = 1;
+#endif
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    EventBits_t bits = xEventGroupWaitBits(connect_events, CONNECTED_BIT | FAILED_BIT, pdFALSE, pdFALSE, timeout);
+    esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_instance);
+    esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, ip_instance);
+    vEventGroupDelete(connect_events);
+    connect_events = NULL;
+
+    if (!(bits & CONNECTED_BIT))
+    {
+        // Deja el Wi-Fi como antes de la llamada para poder conectar por el camino completo sin reiniciar
+        ESP_LOGW(TAG, "Fast connect to channel %u failed", rtc_state.channel);
+        esp_wifi_stop();
+        esp_wifi_deinit();
+        esp_netif_destroy_default_wifi(netif);
+        return (bits & FAILED_BIT) ? ESP_FAIL : ESP_ERR_TIMEOUT;
+    }
+    if (!reuse_ip)
+    {
+        save_ip_info(netif);
+    }
+    rtc_state.connect_failures = 0;
+    rtc_commit();
+    fast_path = true;
+    return ESP_OK;
+}
+
+void duty_cycle_save_connection(void)
+{
+    rtc_check();
+    wifi_config_t wifi_config;
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) != ESP_OK || esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK)
+    {
+        return;
+    }
+    memcpy(rtc_state.ssid, wifi_config.sta.ssid, sizeof(rtc_state.ssid));
+    memcpy(rtc_state.password, wifi_config.sta.password, sizeof(rtc_state.password));
+    memcpy(rtc_state.bssid, ap_info.bssid, sizeof(rtc_state.bssid));
+    rtc_state.channel = ap_info.primary;
+    save_ip_info(esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"));
+    rtc_state.connection_valid = true;
+    rtc_state.connect_failures = 0;
+    rtc_commit();
+    ESP_LOGI(TAG, "Saved connection to " MACSTR " on channel %u", MAC2STR(rtc_state.bssid), rtc_state.channel);
+}
+
+void duty_cycle_forget_connection(void)
+{
+    rtc_check();
+    rtc_state.connection_valid = false;
+    rtc_commit();
+}
+
+void duty_cycle_connect_failed(void)
+{
+    rtc_check();
+    if (rtc_state.connect_failures < UINT8_MAX)
+    {
+        rtc_state.connect_failures++;
+    }
+    rtc_commit();
+    ESP_LOGW(TAG, "No connection in this wake (%u in a row), the samples stay pending", rtc_state.connect_failures);
+}
+
+void duty_cycle_mark(duty_cycle_phase_t phase)
+{
+    // El camino completo puede esperar al provisioning, el tiempo de cada etapa se satura en 65535 ms
+    int64_t now = esp_timer_get_time();
+    uint32_t elapsed_ms = phase_ms[phase] + (uint32_t)((now - phase_start_us) / 1000);
+    phase_ms[phase] = (elapsed_ms > UINT16_MAX) ? UINT16_MAX : (uint16_t)elapsed_ms;
+    phase_start_us = now;
+}
+
+uint32_t duty_cycle_wake(void)
+{
+    rtc_check();
+    return rtc_state.wake;
+}
+
+void duty_cycle_push(const duty_cycle_record_t *record)
+{
+    rtc_check();
+    uint8_t index = (rtc_state.record_head + rtc_state.record_count) % CONFIG_DUTY_CYCLE_PENDING_RECORDS;
+    rtc_state.records[index] = *record;
+    if (rtc_state.record_count < CONFIG_DUTY_CYCLE_PENDING_RECORDS)
+    {
+        rtc_state.record_count++;
+    }
+    else
+    {
+        rtc_state.record_head = (rtc_state.record_head + 1) % CONFIG_DUTY_CYCLE_PENDING_RECORDS;
+    }
+    rtc_commit();
+}
+
+esp_err_t duty_cycle_send(void)
+{
+    return duty_cycle_send_with(duty_cycle_send_udp, NULL);
+}
+
+esp_err_t duty_cycle_send_with(duty_cycle_transport_t transport, void *ctx)
+{
+    rtc_check();
+
+    // Cabecera con el reporte del despertar anterior, el del actual recien se conoce al dormir
+    const duty_cycle_report_t *report = &rtc_state.last_report;
+    memset(packet, 0, DUTY_CYCLE_HEADER_LEN);
+    packet[0] = DUTY_CYCLE_MAGIC;
+    packet[1] = DUTY_CYCLE_VERSION;
+    packet[2] = rtc_state.record_count;
+    packet[3] = report->fast_path ? 1 : 0;
+    write_u32(&packet[4], report->wake);
+    for (int i = 0; i < DUTY_CYCLE_PHASE_COUNT; i++)
+    {
+        write_u16(&packet[8 + 2 * i], report->phase_ms[i]);
+    }
+    write_u32(&packet[18], report->energy_uj);
+
+    // Registros pendientes, del mas viejo al mas nuevo
+    size_t len = DUTY_CYCLE_HEADER_LEN;
+    for (uint8_t i = 0; i < rtc_state.record_count; i++)
+    {
+        const duty_cycle_record_t *record = &rtc_state.records[(rtc_state.record_head + i) % CONFIG_DUTY_CYCLE_PENDING_RECORDS];
+        write_u32(&packet[len], (uint32_t)record->unix_ms);
+        write_u32(&packet[len + 4], (uint32_t)(record->unix_ms >> 32));
+        write_u16(&packet[len + 8], (uint16_t)record->min);
+        write_u16(&packet[len + 10], (uint16_t)record->max);
+        write_u16(&packet[len + 12], (uint16_t)record->mean);
+        write_u16(&packet[len + 14], record->flags);
+        len += DUTY_CYCLE_RECORD_LEN;
+    }
+
+    esp_err_t err = transport(packet, len, ctx);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) sending telemetry, the records stay pending", esp_err_to_name(err));
+        return err;
+    }
+
+    rtc_state.record_head = 0;
+    rtc_state.record_count = 0;
+    rtc_commit();
+    return ESP_OK;
+}
+
+esp_err_t duty_cycle_send_udp(const uint8_t *data, size_t len, void *ctx)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    struct sockaddr_in dest_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_DUTY_CYCLE_SERVER_PORT),
+        .sin_addr.s_addr = inet_addr(CONFIG_DUTY_CYCLE_SERVER_IP),
+    };
+    int sent = sendto(sock, data, len, 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    close(sock);
+    if (sent != (int)len)
+    {
+        ESP_LOGE(TAG, "sendto failed: errno %d", errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void duty_cycle_sleep(void)
+{
+    rtc_check();
+
+    // El tiempo despierto se cuenta desde que arranca la aplicacion, no incluye el ROM ni el bootloader
+    uint32_t awake_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t cpu_ms = phase_ms[DUTY_CYCLE_PHASE_BOOT] + phase_ms[DUTY_CYCLE_PHASE_INIT] + phase_ms[DUTY_CYCLE_PHASE_SAMPLE];
+    uint32_t radio_ms = phase_ms[DUTY_CYCLE_PHASE_CONNECT] + phase_ms[DUTY_CYCLE_PHASE_SEND];
+
+    // mV * mA * ms = nJ, mV * uA * ms = pJ
+    uint64_t awake_uj = (uint64_t)CONFIG_DUTY_CYCLE_SUPPLY_MV *
+                        ((uint64_t)CONFIG_DUTY_CYCLE_CPU_MA * cpu_ms + (uint64_t)CONFIG_DUTY_CYCLE_RADIO_MA * radio_ms) / 1000;
+    uint64_t sleep_uj = (uint64_t)CONFIG_DUTY_CYCLE_SUPPLY_MV * CONFIG_DUTY_CYCLE_SLEEP_UA * rtc_state.sleep_ms / 1000000;
+
+    duty_cycle_report_t *report = &rtc_state.last_report;
+    report->wake = rtc_state.wake;
+    report->fast_path = fast_path;
+    memcpy(report->phase_ms, phase_ms, sizeof(report->phase_ms));
+    report->awake_ms = awake_ms;
+    report->sleep_ms = rtc_state.sleep_ms;
+    report->energy_uj = (uint32_t)(awake_uj + sleep_uj);
+
+    ESP_LOGI(TAG, "Wake %" PRIu32 " (%s): awake %" PRIu32 " ms, %" PRIu32 " uJ (%" PRIu32 " uJ awake, %" PRIu32 " uJ asleep)",
+             report->wake, fast_path ? "fast" : "full", awake_ms, report->energy_uj, (uint32_t)awake_uj, (uint32_t)sleep_uj);
+    for (int i = 0; i < DUTY_CYCLE_PHASE_COUNT; i++)
+    {
+        ESP_LOGI(TAG, "  %-8s %5u ms", phase_names[i], phase_ms[i]);
+    }
+
+    // Sin conexion el periodo se duplica en cada despertar, para no gastar la bateria esperando a un AP caido
+    uint64_t period_ms = (uint64_t)CONFIG_DUTY_CYCLE_PERIOD_S * 1000;
+    if (rtc_state.connect_failures > 0)
+    {
+        uint8_t shift = (rtc_state.connect_failures < DUTY_CYCLE_MAX_BACKOFF_SHIFT) ? rtc_state.connect_failures : DUTY_CYCLE_MAX_BACKOFF_SHIFT;
+        period_ms <<= shift;
+        uint64_t max_ms = (uint64_t)CONFIG_DUTY_CYCLE_MAX_BACKOFF_S * 1000;
+        if (period_ms > max_ms)
+        {
+            period_ms = (max_ms > (uint64_t)CONFIG_DUTY_CYCLE_PERIOD_S * 1000) ? max_ms : (uint64_t)CONFIG_DUTY_CYCLE_PERIOD_S * 1000;
+        }
+    }
+    uint32_t sleep_ms = (awake_ms < period_ms) ? (uint32_t)(period_ms - awake_ms) : 1000;
+    rtc_state.sleep_ms = sleep_ms;
+    rtc_state.lease_age_ms += awake_ms + sleep_ms;
+    rtc_state.wake++;
+    rtc_commit();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_ms * 1000);
+    esp_deep_sleep_start();
+}
+
+//=====[Implementations of private functions]==================================
+
+static void rtc_check(void)
+{
+    if (rtc_checked)
+    {
+        return;
+    }
+    rtc_checked = true;
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&rtc_state, offsetof(duty_cycle_rtc_t, crc));
+    if (rtc_state.magic != DUTY_CYCLE_RTC_MAGIC || rtc_state.crc != crc)
+    {
+        memset(&rtc_state, 0, sizeof(rtc_state));
+        rtc_state.magic = DUTY_CYCLE_RTC_MAGIC;
+        rtc_commit();
+    }
+}
+
+static void rtc_commit(void)
+{
+    rtc_state.crc = esp_rom_crc32_le(0, (const uint8_t *)&rtc_state, offsetof(duty_cycle_rtc_t, crc));
+}
+
+static void connect_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
+    {
+        esp_wifi_connect();
+    }
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
+    {
+        // Sin reintentos, si el AP guardado no responde se vuelve al camino completo
+        xEventGroupSetBits(connect_events, FAILED_BIT);
+    }
+    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
+    {
+        xEventGroupSetBits(connect_events, CONNECTED_BIT);
+    }
+}
+
+static void save_ip_info(esp_netif_t *netif)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns_info;
+    if (netif == NULL || esp_netif_get_ip_info(netif, &ip_info) != ESP_OK)
+    {
+        return;
+    }
+    rtc_state.ip = ip_info.ip.addr;
+    rtc_state.netmask = ip_info.netmask.addr;
+    rtc_state.gw = ip_info.gw.addr;
+    rtc_state.dns = (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns_info) == ESP_OK) ? dns_info.ip.u_addr.ip4.addr : 0;
+    rtc_state.lease_age_ms = 0;
+}
+
+static void write_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void write_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
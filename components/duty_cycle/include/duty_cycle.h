@@ -0,0 +1,102 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _DUTY_CYCLE_H_
+#define _DUTY_CYCLE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define DUTY_CYCLE_MAGIC 0xD5
+#define DUTY_CYCLE_VERSION 1
+#define DUTY_CYCLE_HEADER_LEN 24
+#define DUTY_CYCLE_RECORD_LEN 16
+
+// El registro tiene un timestamp valido
+#define DUTY_CYCLE_RECORD_TIME_VALID 0x0001
+
+//=====[Declaration of public data types]======================================
+
+// Etapas de cada despertar, en el orden en que ocurren
+typedef enum
+{
+    DUTY_CYCLE_PHASE_BOOT,
+    DUTY_CYCLE_PHASE_INIT,
+    DUTY_CYCLE_PHASE_SAMPLE,
+    DUTY_CYCLE_PHASE_CONNECT,
+    DUTY_CYCLE_PHASE_SEND,
+    DUTY_CYCLE_PHASE_COUNT,
+} duty_cycle_phase_t;
+
+typedef struct
+{
+    int64_t unix_ms;
+    int16_t min;
+    int16_t max;
+    int16_t mean;
+    uint16_t flags;
+} duty_cycle_record_t;
+
+typedef struct
+{
+    uint32_t wake;
+    bool fast_path;
+    uint16_t phase_ms[DUTY_CYCLE_PHASE_COUNT];
+    uint32_t awake_ms;
+    uint32_t sleep_ms;
+    uint32_t energy_uj;
+} duty_cycle_report_t;
+
+// Envia el paquete armado, devuelve ESP_OK solo si el paquete salio, si no los registros quedan pendientes
+typedef esp_err_t (*duty_cycle_transport_t)(const uint8_t *packet, size_t len, void *ctx);
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Indica si se desperto de un deep sleep con una conexion guardada
+bool duty_cycle_has_connection(void);
+
+// Conecta con el AP, el canal, el BSSID y la IP guardados, sin provisioning ni lecturas del NVS
+// Antes hay que inicializar el stack TCP/IP y el loop de eventos por defecto
+// Si falla deja el Wi-Fi sin inicializar y la conexion guardada, para seguir por el camino completo
+esp_err_t duty_cycle_connect(TickType_t timeout);
+
+// Guarda la conexion actual en memoria RTC, llamar despues de obtener la IP por el camino completo
+void duty_cycle_save_connection(void);
+
+// Descarta la conexion guardada, el siguiente arranque hace la conexion completa
+void duty_cycle_forget_connection(void);
+
+// Registra un despertar sin conexion, el deep sleep siguiente se alarga hasta CONFIG_DUTY_CYCLE_MAX_BACKOFF_S
+void duty_cycle_connect_failed(void);
+
+// Cierra la etapa en curso
+void duty_cycle_mark(duty_cycle_phase_t phase);
+
+// Numero del despertar actual, cuenta desde el power-on
+uint32_t duty_cycle_wake(void);
+
+// Guarda un registro en memoria RTC hasta que se envie, si no hay lugar se descarta el mas viejo
+void duty_cycle_push(const duty_cycle_record_t *record);
+
+// Envia por UDP los registros pendientes y el reporte del despertar anterior
+esp_err_t duty_cycle_send(void);
+
+// Igual que duty_cycle_send pero el paquete lo envia transport, por ejemplo por una conexion TLS
+esp_err_t duty_cycle_send_with(duty_cycle_transport_t transport, void *ctx);
+
+// Transporte de duty_cycle_send, envia el paquete al servidor UDP configurado
+esp_err_t duty_cycle_send_udp(const uint8_t *packet, size_t len, void *ctx);
+
+// Calcula el reporte del despertar actual y entra en deep sleep hasta el proximo periodo
+void duty_cycle_sleep(void) __attribute__((noreturn));
+
+//=====[#include guards - end]=================================================
+
+#endif // _DUTY_CYCLE_H_
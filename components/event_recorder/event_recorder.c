@@ -0,0 +1,347 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_partition.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "event_recorder.h"
+
+//=====[Declaration of private defines]========================================
+
+#define EVREC_PARTITION_LABEL "evrec"
+
+#define EVREC_SINK_BUFFER_LEN 256
+#define EVREC_UART_LINE_BYTES 32
+
+#define EVREC_MAX_DUMP_LEN                                              \
+    (sizeof(evrec_header_t) + EVREC_MAX_BASES * EVREC_BASE_NAME_LEN + \
+     CONFIG_EVREC_CAPACITY * (sizeof(evrec_record_t) + CONFIG_EVREC_MAX_PAYLOAD))
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    evrec_record_t record;
+    uint8_t payload[CONFIG_EVREC_MAX_PAYLOAD];
+} slot_t;
+
+typedef struct
+{
+    esp_event_base_t event_base;
+    int32_t event_id;
+    uint8_t size;
+} payload_rule_t;
+
+// Destino del volcado, los bytes se juntan en el buffer y se escriben de a bloques
+typedef struct dump_sink dump_sink_t;
+struct dump_sink
+{
+    esp_err_t (*flush)(dump_sink_t *sink);
+    uint8_t buf[EVREC_SINK_BUFFER_LEN];
+    size_t fill;
+    size_t offset;
+};
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "event-recorder";
+
+//=====[Declaration and initialization of private global variables]============
+
+static slot_t slots[CONFIG_EVREC_CAPACITY];
+static uint32_t head = 0;
+static uint32_t count = 0;
+
+static esp_event_base_t bases[EVREC_MAX_BASES];
+static uint8_t base_count = 0;
+
+static payload_rule_t rules[CONFIG_EVREC_MAX_PAYLOAD_RULES];
+static size_t rule_count = 0;
+
+static bool dumping = false;
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+static event_recorder_stats_t rec_stats;
+static uint64_t total_cycles = 0;
+static uint32_t max_cycles = 0;
+
+static const esp_partition_t *partition = NULL;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void record_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static uint8_t find_base(esp_event_base_t event_base);
+
+static uint8_t find_payload_size(esp_event_base_t event_base, int32_t event_id);
+
+static esp_err_t dump(dump_sink_t *sink);
+
+static esp_err_t sink_write(dump_sink_t *sink, const void *data, size_t len);
+
+static esp_err_t uart_flush(dump_sink_t *sink);
+
+static esp_err_t flash_flush(dump_sink_t *sink);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t event_recorder_start(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, EVREC_PARTITION_LABEL);
+    if (partition == NULL)
+    {
+        ESP_LOGW(TAG, "No %s partition, recordings can only be dumped to the console", EVREC_PARTITION_LABEL);
+    }
+    else
+    {
+        // Avisa si quedo una grabacion de un arranque anterior
+        evrec_header_t header;
+        if (esp_partition_read(partition, 0, &header, sizeof(header)) == ESP_OK && header.magic == EVREC_MAGIC)
+        {
+            ESP_LOGI(TAG, "Partition %s holds a recording of %u events", EVREC_PARTITION_LABEL, (unsigned)header.record_count);
+        }
+    }
+
+    // Se registra antes que el resto de los handlers, asi graba cada evento antes de que se atienda
+    return esp_event_handler_register(ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, record_handler, NULL);
+}
+
+esp_err_t event_recorder_set_payload_size(esp_event_base_t event_base, int32_t event_id, size_t size)
+{
+    if (rule_count >= CONFIG_EVREC_MAX_PAYLOAD_RULES)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    rules[rule_count].event_base = event_base;
+    rules[rule_count].event_id = event_id;
+    rules[rule_count].size = (size > CONFIG_EVREC_MAX_PAYLOAD) ? CONFIG_EVREC_MAX_PAYLOAD : (uint8_t)size;
+    rule_count++;
+    return ESP_OK;
+}
+
+void event_recorder_dump_uart(void)
+{
+    dump_sink_t sink = {
+        .flush = uart_flush,
+    };
+    printf("%sBEGIN\n", EVREC_UART_PREFIX);
+    dump(&sink);
+    printf("%sEND\n", EVREC_UART_PREFIX);
+}
+
+esp_err_t event_recorder_save(void)
+{
+    if (partition == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Solo se borran los sectores que puede ocupar una grabacion
+    size_t erase_len = (EVREC_MAX_DUMP_LEN + partition->erase_size - 1) / partition->erase_size * partition->erase_size;
+    if (erase_len > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = esp_partition_erase_range(partition, 0, erase_len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    dump_sink_t sink = {
+        .flush = flash_flush,
+    };
+    err = dump(&sink);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) saving recording", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Recording saved to partition %s (%u bytes)", EVREC_PARTITION_LABEL, (unsigned)sink.offset);
+
+#if CONFIG_EVREC_DUMP_UART_ON_SAVE
+    event_recorder_dump_uart();
+#endif
+    return ESP_OK;
+}
+
+void event_recorder_get_stats(event_recorder_stats_t *stats)
+{
+    *stats = rec_stats;
+    stats->max_record_ns = (uint32_t)(max_cycles * 1000ULL / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    stats->mean_record_ns = stats->records ? (uint32_t)(total_cycles * 1000ULL / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / stats->records) : 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void record_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // Se ejecuta en el loop por defecto para cada evento, no puede bloquear ni reservar memoria
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint8_t len = (event_data != NULL) ? find_payload_size(event_base, event_id) : 0;
+
+    portENTER_CRITICAL(&lock);
+    if (dumping)
+    {
+        rec_stats.missed++;
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    slot_t *slot = &slots[head];
+    slot->record.time_us = (uint32_t)esp_timer_get_time();
+    slot->record.event_id = (uint16_t)event_id;
+    slot->record.base = find_base(event_base);
+    slot->record.len = len;
+    if (len > 0)
+    {
+        memcpy(slot->payload, event_data, len);
+    }
+    head = (head + 1) % CONFIG_EVREC_CAPACITY;
+    if (count < CONFIG_EVREC_CAPACITY)
+    {
+        count++;
+    }
+    else
+    {
+        rec_stats.overwritten++;
+    }
+    rec_stats.records++;
+    portEXIT_CRITICAL(&lock);
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    total_cycles += cycles;
+    if (cycles > max_cycles)
+    {
+        max_cycles = cycles;
+    }
+}
+
+static uint8_t find_base(esp_event_base_t event_base)
+{
+    // Las bases son punteros a cadenas constantes, alcanza con comparar el puntero
+    for (uint8_t i = 0; i < base_count; i++)
+    {
+        if (bases[i] == event_base)
+        {
+            return i;
+        }
+    }
+    if (base_count >= EVREC_MAX_BASES)
+    {
+        return EVREC_BASE_UNKNOWN;
+    }
+    bases[base_count] = event_base;
+    return base_count++;
+}
+
+static uint8_t find_payload_size(esp_event_base_t event_base, int32_t event_id)
+{
+    for (size_t i = 0; i < rule_count; i++)
+    {
+        if (rules[i].event_base == event_base && (rules[i].event_id == event_id || rules[i].event_id == ESP_EVENT_ANY_ID))
+        {
+            return rules[i].size;
+        }
+    }
+    return 0;
+}
+
+static esp_err_t dump(dump_sink_t *sink)
+{
+    // Mientras se vuelca no se graba, los eventos que llegan se cuentan como perdidos
+    portENTER_CRITICAL(&lock);
+    dumping = true;
+    portEXIT_CRITICAL(&lock);
+
+    evrec_header_t header = {
+        .magic = EVREC_MAGIC,
+        .version = EVREC_VERSION,
+        .base_count = base_count,
+        .record_count = count,
+        .lost = rec_stats.overwritten + rec_stats.missed,
+    };
+    esp_err_t err = sink_write(sink, &header, sizeof(header));
+    for (uint8_t i = 0; i < base_count && err == ESP_OK; i++)
+    {
+        char name[EVREC_BASE_NAME_LEN] = {0};
+        strncpy(name, bases[i], sizeof(name) - 1);
+        err = sink_write(sink, name, sizeof(name));
+    }
+    uint32_t first = (head + CONFIG_EVREC_CAPACITY - count) % CONFIG_EVREC_CAPACITY;
+    for (uint32_t i = 0; i < count && err == ESP_OK; i++)
+    {
+        const slot_t *slot = &slots[(first + i) % CONFIG_EVREC_CAPACITY];
+        err = sink_write(sink, &slot->record, sizeof(slot->record));
+        if (err == ESP_OK)
+        {
+            err = sink_write(sink, slot->payload, slot->record.len);
+        }
+    }
+    if (err == ESP_OK && sink->fill > 0)
+    {
+        err = sink->flush(sink);
+    }
+
+    portENTER_CRITICAL(&lock);
+    dumping = false;
+    portEXIT_CRITICAL(&lock);
+    return err;
+}
+
+static esp_err_t sink_write(dump_sink_t *sink, const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    while (len > 0)
+    {
+        size_t chunk = sizeof(sink->buf) - sink->fill;
+        if (chunk > len)
+        {
+            chunk = len;
+        }
+        memcpy(sink->buf + sink->fill, bytes, chunk);
+        sink->fill += chunk;
+        bytes += chunk;
+        len -= chunk;
+        if (sink->fill == sizeof(sink->buf))
+        {
+            esp_err_t err = sink->flush(sink);
+            if (err != ESP_OK)
+            {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t uart_flush(dump_sink_t *sink)
+{
+    for (size_t i = 0; i < sink->fill; i += EVREC_UART_LINE_BYTES)
+    {
+        char line[2 * EVREC_UART_LINE_BYTES + 1];
+        size_t n = (sink->fill - i < EVREC_UART_LINE_BYTES) ? sink->fill - i : EVREC_UART_LINE_BYTES;
+        for (size_t j = 0; j < n; j++)
+        {
+            snprintf(&line[2 * j], 3, "%02x", sink->buf[i + j]);
+        }
+        printf("%s%s\n", EVREC_UART_PREFIX, line);
+    }
+    sink->offset += sink->fill;
+    sink->fill = 0;
+    return ESP_OK;
+}
+
+static esp_err_t flash_flush(dump_sink_t *sink)
+{
+    esp_err_t err = esp_partition_write(partition, sink->offset, sink->buf, sink->fill);
+    sink->offset += sink->fill;
+    sink->fill = 0;
+    return err;
+}
@@ -0,0 +1,47 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _EVENT_RECORDER_H_
+#define _EVENT_RECORDER_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+#include "evrec_format.h"
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    uint32_t records;
+    uint32_t overwritten;
+    // Eventos que llegaron mientras se volcaba la grabacion
+    uint32_t missed;
+    uint32_t max_record_ns;
+    uint32_t mean_record_ns;
+} event_recorder_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Registra el grabador en el loop por defecto, llamar antes de provisioning_start para no perder eventos
+esp_err_t event_recorder_start(void);
+
+// Cantidad de bytes del payload que se guardan para un evento, por defecto no se guarda ninguno
+// El loop de eventos no informa el tamano de los datos, por eso hay que declararlo
+esp_err_t event_recorder_set_payload_size(esp_event_base_t event_base, int32_t event_id, size_t size);
+
+// Escribe la grabacion por la consola, en lineas EVREC_UART_PREFIX seguidas de hexadecimal
+void event_recorder_dump_uart(void);
+
+// Guarda la grabacion en la particion "evrec", pisando la anterior
+esp_err_t event_recorder_save(void);
+
+void event_recorder_get_stats(event_recorder_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _EVENT_RECORDER_H_
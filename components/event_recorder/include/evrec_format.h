@@ -0,0 +1,51 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _EVREC_FORMAT_H_
+#define _EVREC_FORMAT_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Formato de las grabaciones, compartido con tools/event-replay, todo en little endian:
+// encabezado, tabla de nombres de las bases de eventos y los registros del mas viejo al mas nuevo
+#define EVREC_MAGIC 0x31525645
+#define EVREC_VERSION 1
+
+#define EVREC_BASE_NAME_LEN 24
+#define EVREC_MAX_BASES 16
+
+// Indice de base para eventos que no entraron en la tabla
+#define EVREC_BASE_UNKNOWN 0xFF
+
+// En la salida por UART cada linea empieza asi y sigue con los bytes en hexadecimal
+#define EVREC_UART_PREFIX "EVREC:"
+
+//=====[Declaration of public data types]======================================
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint16_t version;
+    uint8_t base_count;
+    uint8_t reserved;
+    uint32_t record_count;
+    // Registros pisados o perdidos antes de la grabacion
+    uint32_t lost;
+} evrec_header_t;
+
+// A cada registro le siguen len bytes del payload del evento, sin relleno
+typedef struct __attribute__((packed))
+{
+    // Parte baja de esp_timer_get_time(), la diferencia entre registros es valida hasta 71 minutos
+    uint32_t time_us;
+    uint16_t event_id;
+    uint8_t base;
+    uint8_t len;
+} evrec_record_t;
+
+//=====[#include guards - end]=================================================
+
+#endif // _EVREC_FORMAT_H_
@@ -0,0 +1,69 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MEM_POOL_H_
+#define _MEM_POOL_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Los indices de los bloques son de 16 bits y el 0 marca la lista vacia
+#define MEM_POOL_MAX_BLOCKS 65535
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    MEM_POOL_INTERNAL,
+    MEM_POOL_PSRAM,
+} mem_pool_region_t;
+
+typedef struct
+{
+    const char *name;
+    size_t block_size;
+    uint32_t block_count;
+    mem_pool_region_t region;
+} mem_pool_config_t;
+
+typedef struct mem_pool mem_pool_t;
+
+typedef struct
+{
+    const char *name;
+    size_t block_size;
+    uint32_t block_count;
+    mem_pool_region_t region;
+    uint32_t in_use;
+    uint32_t high_water;
+    uint32_t failures;
+} mem_pool_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Reserva todos los bloques de una vez, llamar al inicio antes de que el heap se fragmente
+// Sin PSRAM habilitada los bloques de MEM_POOL_PSRAM quedan en RAM interna
+mem_pool_t *mem_pool_create(const mem_pool_config_t *config);
+
+// O(1) y sin locks, se puede llamar desde cualquier tarea o interrupcion
+// Devuelve NULL si no quedan bloques libres y lo cuenta como falla
+void *mem_pool_alloc(mem_pool_t *pool);
+
+void mem_pool_free(mem_pool_t *pool, void *block);
+
+// Devuelve a la lista compartida los bloques guardados en la cache del nucleo actual
+void mem_pool_flush_cache(mem_pool_t *pool);
+
+void mem_pool_get_stats(const mem_pool_t *pool, mem_pool_stats_t *stats);
+
+// Copia las estadisticas de hasta max pools y devuelve cuantas copio
+size_t mem_pool_get_all_stats(mem_pool_stats_t *stats, size_t max);
+
+const char *mem_pool_region_to_name(mem_pool_region_t region);
+
+//=====[#include guards - end]=================================================
+
+#endif // _MEM_POOL_H_
@@ -0,0 +1,357 @@
+//=====[Libraries]=============================================================
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem_pool.h"
+
+// Fuera del ESP-IDF se compila para el benchmark de la PC
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#endif
+
+//=====[Declaration of private defines]========================================
+
+#define MEM_POOL_ALIGN 8
+
+#define MEM_POOL_INDEX_MASK 0x0000FFFFu
+#define MEM_POOL_TAG_STEP 0x00010000u
+
+#ifdef ESP_PLATFORM
+#define MEM_POOL_SLOTS portNUM_PROCESSORS
+#else
+// En la PC cada hilo usa su propia cache, los que no entran van directo a la lista compartida
+#define MEM_POOL_SLOTS 8
+#endif
+
+//=====[Declaration of private data types]=====================================
+
+// Indices base 1 de bloques libres, solo la toca el nucleo dueno con las interrupciones enmascaradas
+typedef struct
+{
+    uint16_t count;
+    uint16_t items[CONFIG_MEM_POOL_CACHE_SIZE];
+} pool_cache_t;
+
+struct mem_pool
+{
+    const char *name;
+    uint8_t *blocks;
+    size_t block_size;
+    uint32_t block_count;
+    mem_pool_region_t region;
+
+    // Pila de Treiber, los 16 bits altos son un contador que evita el problema ABA
+    _Atomic uint32_t head;
+    _Atomic uint16_t *next;
+
+    pool_cache_t caches[MEM_POOL_SLOTS];
+
+    atomic_uint in_use;
+    atomic_uint high_water;
+    atomic_uint failures;
+};
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *REGION_NAMES[] = {
+    [MEM_POOL_INTERNAL] = "internal",
+    [MEM_POOL_PSRAM] = "psram",
+};
+
+//=====[Declaration and initialization of private global variables]============
+
+static mem_pool_t *pools[CONFIG_MEM_POOL_MAX_POOLS];
+static atomic_uint pool_count;
+
+#ifndef ESP_PLATFORM
+static _Thread_local unsigned thread_slot = UINT32_MAX;
+static atomic_uint thread_slot_next;
+#endif
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static unsigned cache_enter(unsigned *slot);
+
+static void cache_exit(unsigned state);
+
+static uint16_t pop_shared(mem_pool_t *pool);
+
+static void push_shared(mem_pool_t *pool, const uint16_t *items, size_t count);
+
+static void *alloc_region(size_t size, mem_pool_region_t *region);
+
+//=====[Implementations of public functions]===================================
+
+mem_pool_t *mem_pool_create(const mem_pool_config_t *config)
+{
+    if (config->block_size == 0 || config->block_count == 0 || config->block_count > MEM_POOL_MAX_BLOCKS)
+    {
+        return NULL;
+    }
+    unsigned index = atomic_fetch_add(&pool_count, 1);
+    if (index >= CONFIG_MEM_POOL_MAX_POOLS)
+    {
+        atomic_fetch_sub(&pool_count, 1);
+        return NULL;
+    }
+
+    // El control y la lista siempre van en RAM interna, las operaciones atomicas no funcionan sobre la PSRAM
+    mem_pool_region_t internal = MEM_POOL_INTERNAL;
+    mem_pool_t *pool = alloc_region(sizeof(mem_pool_t), &internal);
+    _Atomic uint16_t *next = alloc_region(config->block_count * sizeof(uint16_t), &internal);
+    size_t block_size = (config->block_size + MEM_POOL_ALIGN - 1) & ~(size_t)(MEM_POOL_ALIGN - 1);
+    mem_pool_region_t region = config->region;
+    uint8_t *blocks = alloc_region(block_size * config->block_count, &region);
+    if (pool == NULL || next == NULL || blocks == NULL)
+    {
+        free(pool);
+        free(next);
+        free(blocks);
+        atomic_fetch_sub(&pool_count, 1);
+        return NULL;
+    }
+
+    memset(pool, 0, sizeof(mem_pool_t));
+    pool->name = config->name;
+    pool->blocks = blocks;
+    pool->block_size = block_size;
+    pool->block_count = config->block_count;
+    pool->region = region;
+    pool->next = next;
+
+    // Al principio todos los bloques estan en la lista compartida, en orden
+    for (uint32_t i = 0; i < config->block_count; i++)
+    {
+        atomic_init(&next[i], (uint16_t)((i + 1 < config->block_count) ? i + 2 : 0));
+    }
+    atomic_init(&pool->head, 1);
+
+    pools[index] = pool;
+    return pool;
+}
+
+void *mem_pool_alloc(mem_pool_t *pool)
+{
+    uint16_t index = 0;
+    unsigned slot;
+    unsigned state = cache_enter(&slot);
+    if (slot < MEM_POOL_SLOTS && pool->caches[slot].count > 0)
+    {
+        pool_cache_t *cache = &pool->caches[slot];
+        index = cache->items[--cache->count];
+    }
+    cache_exit(state);
+
+    if (index == 0)
+    {
+        index = pop_shared(pool);
+        if (index == 0)
+        {
+            atomic_fetch_add_explicit(&pool->failures, 1, memory_order_relaxed);
+            return NULL;
+        }
+    }
+
+    unsigned in_use = atomic_fetch_add_explicit(&pool->in_use, 1, memory_order_relaxed) + 1;
+    unsigned high_water = atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    while (in_use > high_water &&
+           !atomic_compare_exchange_weak_explicit(&pool->high_water, &high_water, in_use, memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+    }
+    return pool->blocks + (size_t)(index - 1) * pool->block_size;
+}
+
+void mem_pool_free(mem_pool_t *pool, void *block)
+{
+    if (block == NULL)
+    {
+        return;
+    }
+    size_t offset = (size_t)((uint8_t *)block - pool->blocks);
+    assert(offset < pool->block_size * pool->block_count && offset % pool->block_size == 0);
+    uint16_t index = (uint16_t)(offset / pool->block_size + 1);
+    atomic_fetch_sub_explicit(&pool->in_use, 1, memory_order_relaxed);
+
+    // Con la cache llena se pasa la mitad mas vieja a la lista compartida, fuera de la seccion enmascarada
+    uint16_t spill[CONFIG_MEM_POOL_CACHE_SIZE / 2];
+    size_t spill_count = 0;
+    unsigned slot;
+    unsigned state = cache_enter(&slot);
+    if (slot < MEM_POOL_SLOTS)
+    {
+        pool_cache_t *cache = &pool->caches[slot];
+        if (cache->count == CONFIG_MEM_POOL_CACHE_SIZE)
+        {
+            spill_count = CONFIG_MEM_POOL_CACHE_SIZE / 2;
+            memcpy(spill, cache->items, sizeof(spill));
+            memmove(cache->items, &cache->items[spill_count], (cache->count - spill_count) * sizeof(uint16_t));
+            cache->count -= spill_count;
+        }
+        cache->items[cache->count++] = index;
+        index = 0;
+    }
+    cache_exit(state);
+
+    if (spill_count > 0)
+    {
+        push_shared(pool, spill, spill_count);
+    }
+    if (index != 0)
+    {
+        push_shared(pool, &index, 1);
+    }
+}
+
+void mem_pool_flush_cache(mem_pool_t *pool)
+{
+    uint16_t items[CONFIG_MEM_POOL_CACHE_SIZE];
+    size_t count = 0;
+    unsigned slot;
+    unsigned state = cache_enter(&slot);
+    if (slot < MEM_POOL_SLOTS)
+    {
+        pool_cache_t *cache = &pool->caches[slot];
+        count = cache->count;
+        memcpy(items, cache->items, count * sizeof(uint16_t));
+        cache->count = 0;
+    }
+    cache_exit(state);
+
+    if (count > 0)
+    {
+        push_shared(pool, items, count);
+    }
+}
+
+void mem_pool_get_stats(const mem_pool_t *pool, mem_pool_stats_t *stats)
+{
+    stats->name = pool->name;
+    stats->block_size = pool->block_size;
+    stats->block_count = pool->block_count;
+    stats->region = pool->region;
+    stats->in_use = atomic_load_explicit(&pool->in_use, memory_order_relaxed);
+    stats->high_water = atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    stats->failures = atomic_load_explicit(&pool->failures, memory_order_relaxed);
+}
+
+size_t mem_pool_get_all_stats(mem_pool_stats_t *stats, size_t max)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < CONFIG_MEM_POOL_MAX_POOLS && count < max; i++)
+    {
+        if (pools[i] != NULL)
+        {
+            mem_pool_get_stats(pools[i], &stats[count++]);
+        }
+    }
+    return count;
+}
+
+const char *mem_pool_region_to_name(mem_pool_region_t region)
+{
+    if (region > MEM_POOL_PSRAM)
+    {
+        return "unknown";
+    }
+    return REGION_NAMES[region];
+}
+
+//=====[Implementations of private functions]==================================
+
+#ifdef ESP_PLATFORM
+
+// Con las interrupciones enmascaradas la tarea no puede ser desalojada ni migrar de nucleo,
+// asi que la cache del nucleo actual se usa sin spinlock
+static unsigned cache_enter(unsigned *slot)
+{
+    unsigned state = portSET_INTERRUPT_MASK_FROM_ISR();
+    *slot = (unsigned)esp_cpu_get_core_id();
+    return state;
+}
+
+static void cache_exit(unsigned state)
+{
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+static void *alloc_region(size_t size, mem_pool_region_t *region)
+{
+#if CONFIG_SPIRAM
+    if (*region == MEM_POOL_PSRAM)
+    {
+        return heap_caps_aligned_alloc(MEM_POOL_ALIGN, size, MALLOC_CAP_SPIRAM);
+    }
+#endif
+    *region = MEM_POOL_INTERNAL;
+    return heap_caps_aligned_alloc(MEM_POOL_ALIGN, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+#else
+
+static unsigned cache_enter(unsigned *slot)
+{
+    if (thread_slot == UINT32_MAX)
+    {
+        thread_slot = atomic_fetch_add(&thread_slot_next, 1);
+    }
+    *slot = thread_slot;
+    return 0;
+}
+
+static void cache_exit(unsigned state)
+{
+    (void)state;
+}
+
+static void *alloc_region(size_t size, mem_pool_region_t *region)
+{
+    *region = MEM_POOL_INTERNAL;
+    return aligned_alloc(MEM_POOL_ALIGN, (size + MEM_POOL_ALIGN - 1) & ~(size_t)(MEM_POOL_ALIGN - 1));
+}
+
+#endif
+
+static uint16_t pop_shared(mem_pool_t *pool)
+{
+    uint32_t head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    while (1)
+    {
+        uint16_t index = (uint16_t)(head & MEM_POOL_INDEX_MASK);
+        if (index == 0)
+        {
+            return 0;
+        }
+        // Si otro nucleo saco este bloque mientras tanto el contador cambio y el CAS falla
+        uint16_t next = atomic_load_explicit(&pool->next[index - 1], memory_order_relaxed);
+        uint32_t new_head = ((head & ~MEM_POOL_INDEX_MASK) + MEM_POOL_TAG_STEP) | next;
+        if (atomic_compare_exchange_weak_explicit(&pool->head, &head, new_head, memory_order_acquire,
+                                                  memory_order_acquire))
+        {
+            return index;
+        }
+    }
+}
+
+static void push_shared(mem_pool_t *pool, const uint16_t *items, size_t count)
+{
+    // Los bloques todavia son nuestros, se encadenan antes de publicarlos con un solo CAS
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        atomic_store_explicit(&pool->next[items[i] - 1], items[i + 1], memory_order_relaxed);
+    }
+    uint16_t last = items[count - 1];
+    uint32_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    uint32_t new_head;
+    do
+    {
+        atomic_store_explicit(&pool->next[last - 1], (uint16_t)(head & MEM_POOL_INDEX_MASK), memory_order_relaxed);
+        new_head = ((head & ~MEM_POOL_INDEX_MASK) + MEM_POOL_TAG_STEP) | items[0];
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, new_head, memory_order_release,
+                                                    memory_order_relaxed));
+}
@@ -0,0 +1,98 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define METRICS_HISTOGRAM_MAX_BUCKETS 8
+
+// Inicializadores para declarar las metricas como variables estaticas
+#define METRICS_HISTOGRAM_INIT(...)                                                     \
+    {                                                                                   \
+        .bounds = (const uint32_t[]){__VA_ARGS__},                                      \
+        .bucket_count = sizeof((const uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t),     \
+    }
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    atomic_uint_fast32_t value;
+} metrics_counter_t;
+
+typedef struct
+{
+    atomic_int_fast32_t value;
+} metrics_gauge_t;
+
+// Los limites superiores de los buckets son fijos y estan ordenados de menor a mayor
+typedef struct
+{
+    const uint32_t *bounds;
+    uint8_t bucket_count;
+    atomic_uint_fast32_t counts[METRICS_HISTOGRAM_MAX_BUCKETS + 1];
+    atomic_uint_fast32_t sum;
+} metrics_histogram_t;
+
+typedef struct metrics_writer metrics_writer_t;
+
+// Se llama en cada consulta al endpoint, antes de escribir las metricas registradas
+typedef void (*metrics_collector_t)(metrics_writer_t *writer, void *ctx);
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// El registro se hace durante la inicializacion, las metricas deben tener vida estatica
+esp_err_t metrics_register_counter(metrics_counter_t *counter, const char *name, const char *help);
+
+esp_err_t metrics_register_gauge(metrics_gauge_t *gauge, const char *name, const char *help);
+
+esp_err_t metrics_register_histogram(metrics_histogram_t *histogram, const char *name, const char *help);
+
+esp_err_t metrics_register_collector(metrics_collector_t collector, void *ctx);
+
+// Escribe una linea en formato de texto de Prometheus, solo se usa desde un collector
+// Despues de un error al enviar no escribe nada mas y la consulta termina con ese error
+void metrics_printf(metrics_writer_t *writer, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Arranca el servidor HTTP que publica /metrics
+esp_err_t metrics_server_start(void);
+
+// Las funciones de registro de valores son inline y solo hacen una operacion atomica para usarlas en caminos criticos
+
+static inline void metrics_counter_inc(metrics_counter_t *counter)
+{
+    atomic_fetch_add_explicit(&counter->value, 1, memory_order_relaxed);
+}
+
+static inline void metrics_counter_add(metrics_counter_t *counter, uint32_t value)
+{
+    atomic_fetch_add_explicit(&counter->value, value, memory_order_relaxed);
+}
+
+static inline void metrics_gauge_set(metrics_gauge_t *gauge, int32_t value)
+{
+    atomic_store_explicit(&gauge->value, value, memory_order_relaxed);
+}
+
+static inline void metrics_histogram_observe(metrics_histogram_t *histogram, uint32_t value)
+{
+    uint8_t i = 0;
+    while (i < histogram->bucket_count && value > histogram->bounds[i])
+    {
+        i++;
+    }
+    atomic_fetch_add_explicit(&histogram->counts[i], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _METRICS_H_
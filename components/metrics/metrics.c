@@ -0,0 +1,300 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "metrics.h"
+
+//=====[Declaration of private defines]========================================
+
+#define METRICS_LINE_MAX 160
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum
+{
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+} metric_type_t;
+
+typedef struct
+{
+    metric_type_t type;
+    const char *name;
+    const char *help;
+    void *metric;
+} metric_entry_t;
+
+typedef struct
+{
+    metrics_collector_t collector;
+    void *ctx;
+} collector_entry_t;
+
+struct metrics_writer
+{
+    httpd_req_t *req;
+    // Primer error al enviar, despues no se escribe nada mas en el socket
+    esp_err_t err;
+    char line[METRICS_LINE_MAX];
+};
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "metrics";
+
+//=====[Declaration and initialization of private global variables]============
+
+static metric_entry_t metric_entries[CONFIG_METRICS_MAX_METRICS];
+static size_t metric_count = 0;
+
+static collector_entry_t collector_entries[CONFIG_METRICS_MAX_COLLECTORS];
+static size_t collector_count = 0;
+
+static httpd_handle_t server = NULL;
+
+// Lineas que no entraron en el buffer y no se pudieron escribir, solo las toca la tarea del servidor HTTP
+static uint32_t dropped_lines = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static esp_err_t register_metric(metric_type_t type, void *metric, const char *name, const char *help);
+
+static esp_err_t metrics_get_handler(httpd_req_t *req);
+
+static void write_metric(metrics_writer_t *writer, const metric_entry_t *entry);
+
+static void system_collector(metrics_writer_t *writer, void *ctx);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t metrics_register_counter(metrics_counter_t *counter, const char *name, const char *help)
+{
+    return register_metric(METRIC_COUNTER, counter, name, help);
+}
+
+esp_err_t metrics_register_gauge(metrics_gauge_t *gauge, const char *name, const char *help)
+{
+    return register_metric(METRIC_GAUGE, gauge, name, help);
+}
+
+esp_err_t metrics_register_histogram(metrics_histogram_t *histogram, const char *name, const char *help)
+{
+    if (histogram->bucket_count > METRICS_HISTOGRAM_MAX_BUCKETS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return register_metric(METRIC_HISTOGRAM, histogram, name, help);
+}
+
+esp_err_t metrics_register_collector(metrics_collector_t collector, void *ctx)
+{
+    if (collector_count >= CONFIG_METRICS_MAX_COLLECTORS)
+    {
+        ESP_LOGE(TAG, "No room for more collectors");
+        return ESP_ERR_NO_MEM;
+    }
+    collector_entries[collector_count].collector = collector;
+    collector_entries[collector_count].ctx = ctx;
+    collector_count++;
+    return ESP_OK;
+}
+
+void metrics_printf(metrics_writer_t *writer, const char *fmt, ...)
+{
+    if (writer->err != ESP_OK)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    va_list retry;
+    va_copy(retry, args);
+    int len = vsnprintf(writer->line, sizeof(writer->line), fmt, args);
+    va_end(args);
+    if (len < (int)sizeof(writer->line))
+    {
+        if (len > 0)
+        {
+            writer->err = httpd_resp_send_chunk(writer->req, writer->line, len);
+        }
+        va_end(retry);
+        return;
+    }
+
+    // Una linea cortada rompe el formato, las que no entran en el buffer se escriben desde el heap o no se escriben
+    char *line = malloc((size_t)len + 1);
+    if (line == NULL)
+    {
+        dropped_lines++;
+        va_end(retry);
+        return;
+    }
+    vsnprintf(line, (size_t)len + 1, fmt, retry);
+    va_end(retry);
+    writer->err = httpd_resp_send_chunk(writer->req, line, len);
+    free(line);
+}
+
+esp_err_t metrics_server_start(void)
+{
+    if (server != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Usa otro puerto de control para convivir con otros servidores HTTP del dispositivo
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = CONFIG_METRICS_HTTP_PORT;
+    config.ctrl_port = ESP_HTTPD_DEF_CTRL_PORT + 1;
+    config.max_open_sockets = 2;
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting metrics server", esp_err_to_name(err));
+        return err;
+    }
+
+    httpd_uri_t metrics_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = metrics_get_handler,
+        .user_ctx = NULL,
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &metrics_uri));
+    ESP_LOGI(TAG, "Serving metrics on port %d", CONFIG_METRICS_HTTP_PORT);
+    return ESP_OK;
+}
+
+//=====[Implementations of private functions]==================================
+
+static esp_err_t register_metric(metric_type_t type, void *metric, const char *name, const char *help)
+{
+    if (metric_count >= CONFIG_METRICS_MAX_METRICS)
+    {
+        ESP_LOGE(TAG, "No room for metric %s", name);
+        return ESP_ERR_NO_MEM;
+    }
+    metric_entries[metric_count].type = type;
+    metric_entries[metric_count].name = name;
+    metric_entries[metric_count].help = help;
+    metric_entries[metric_count].metric = metric;
+    metric_count++;
+    return ESP_OK;
+}
+
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    // El writer se reserva por consulta, nunca en el camino donde se registran los valores
+    metrics_writer_t *writer = malloc(sizeof(metrics_writer_t));
+    if (writer == NULL)
+    {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    writer->req = req;
+    writer->err = ESP_OK;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+    // Si el cliente cerro la conexion se deja de recorrer el registro en vez de escribir en un socket muerto
+    system_collector(writer, NULL);
+    for (size_t i = 0; i < collector_count && writer->err == ESP_OK; i++)
+    {
+        collector_entries[i].collector(writer, collector_entries[i].ctx);
+    }
+    for (size_t i = 0; i < metric_count && writer->err == ESP_OK; i++)
+    {
+        write_metric(writer, &metric_entries[i]);
+    }
+
+    esp_err_t err = writer->err;
+    free(writer);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Error (%s) sending metrics, closing the connection", esp_err_to_name(err));
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static void write_metric(metrics_writer_t *writer, const metric_entry_t *entry)
+{
+    static const char *type_names[] = {"counter", "gauge", "histogram"};
+    metrics_printf(writer, "# HELP %s %s\n", entry->name, entry->help);
+    metrics_printf(writer, "# TYPE %s %s\n", entry->name, type_names[entry->type]);
+
+    switch (entry->type)
+    {
+    case METRIC_COUNTER:
+    {
+        metrics_counter_t *counter = (metrics_counter_t *)entry->metric;
+        metrics_printf(writer, "%s %u\n", entry->name, (unsigned)atomic_load_explicit(&counter->value, memory_order_relaxed));
+        break;
+    }
+    case METRIC_GAUGE:
+    {
+        metrics_gauge_t *gauge = (metrics_gauge_t *)entry->metric;
+        metrics_printf(writer, "%s %d\n", entry->name, (int)atomic_load_explicit(&gauge->value, memory_order_relaxed));
+        break;
+    }
+    case METRIC_HISTOGRAM:
+    {
+        // Los buckets se guardan sin acumular, Prometheus los espera acumulados
+        metrics_histogram_t *histogram = (metrics_histogram_t *)entry->metric;
+        unsigned cumulative = 0;
+        for (uint8_t i = 0; i < histogram->bucket_count; i++)
+        {
+            cumulative += atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+            metrics_printf(writer, "%s_bucket{le=\"%u\"} %u\n", entry->name, (unsigned)histogram->bounds[i], cumulative);
+        }
+        cumulative += atomic_load_explicit(&histogram->counts[histogram->bucket_count], memory_order_relaxed);
+        metrics_printf(writer, "%s_bucket{le=\"+Inf\"} %u\n", entry->name, cumulative);
+        metrics_printf(writer, "%s_sum %u\n", entry->name, (unsigned)atomic_load_explicit(&histogram->sum, memory_order_relaxed));
+        metrics_printf(writer, "%s_count %u\n", entry->name, cumulative);
+        break;
+    }
+    }
+}
+
+static void system_collector(metrics_writer_t *writer, void *ctx)
+{
+    // Memoria del heap interno, sin la PSRAM que esconderia que se agota la DRAM
+    metrics_printf(writer, "# TYPE heap_free_bytes gauge\nheap_free_bytes %u\n",
+                   (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    metrics_printf(writer, "# TYPE heap_min_free_bytes gauge\nheap_min_free_bytes %u\n",
+                   (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    metrics_printf(writer, "# TYPE heap_largest_free_block_bytes gauge\nheap_largest_free_block_bytes %u\n",
+                   (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+
+    // Lineas descartadas en las consultas anteriores porque no habia memoria para escribirlas
+    metrics_printf(writer, "# TYPE metrics_dropped_lines_total counter\nmetrics_dropped_lines_total %u\n",
+                   (unsigned)dropped_lines);
+
+#if CONFIG_METRICS_TASK_STACKS
+    // Marca de agua del stack de cada tarea, en el ESP-IDF se expresa en bytes
+    UBaseType_t task_count = uxTaskGetNumberOfTasks();
+    TaskStatus_t *tasks = malloc(task_count * sizeof(TaskStatus_t));
+    if (tasks == NULL)
+    {
+        return;
+    }
+    task_count = uxTaskGetSystemState(tasks, task_count, NULL);
+    metrics_printf(writer, "# TYPE task_stack_high_water_mark_bytes gauge\n");
+    for (UBaseType_t i = 0; i < task_count; i++)
+    {
+        metrics_printf(writer, "task_stack_high_water_mark_bytes{task=\"%s\"} %u\n",
+                       tasks[i].pcTaskName, (unsigned)tasks[i].usStackHighWaterMark);
+    }
+    free(tasks);
+#endif
+}
@@ -0,0 +1,50 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _OTA_H_
+#define _OTA_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define OTA_PATCH_MAGIC 0x4154444F
+#define OTA_PATCH_HEADER_LEN 64
+
+//=====[Declaration of public data types]======================================
+
+// Cabecera del parche (little endian, 64 bytes):
+// [0..3] magic, [4..35] SHA-256 de la imagen base, [36..39] tamano de la imagen nueva, [40..63] reservado
+// Le sigue el parche de detools comprimido con heatshrink
+
+typedef struct
+{
+    uint32_t checks;
+    uint32_t updates;
+    uint32_t failures;
+    uint32_t patch_bytes;
+    uint32_t image_bytes;
+    uint32_t last_duration_ms;
+} ota_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Si la imagen en ejecucion es nueva arranca el plazo para obtener la IP, llamar al inicio despues del NVS
+esp_err_t ota_init(void);
+
+// Arranca la tarea que consulta periodicamente al servidor, llamar una vez obtenida la direccion IP
+// Devuelve ESP_ERR_NOT_SUPPORTED si no hay una CA embebida o la URL no es HTTPS
+esp_err_t ota_start(void);
+
+// Consulta al servidor y aplica el parche si lo hay, reinicia el dispositivo si la actualizacion es correcta
+// Devuelve ESP_ERR_NOT_SUPPORTED si no hay una CA embebida o la URL no es HTTPS
+esp_err_t ota_check_now(void);
+
+void ota_get_stats(ota_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _OTA_H_
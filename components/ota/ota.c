@@ -0,0 +1,420 @@
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_http_client.h"
+#include "esp_delta_ota.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "ota.h"
+
+//=====[Declaration of private defines]========================================
+
+#define OTA_DIGEST_LEN 32
+#define OTA_URL_MAX 192
+#define OTA_HTTP_TIMEOUT_MS 10000
+#define OTA_TASK_STACK_SIZE 6144
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    esp_ota_handle_t handle;
+    uint32_t written;
+} ota_write_ctx_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "ota";
+
+#ifdef OTA_HAS_CA
+extern const char ota_ca_pem_start[] asm("_binary_ota_ca_pem_start");
+#endif
+
+//=====[Declaration and initialization of private global variables]============
+
+static const esp_partition_t *running_partition = NULL;
+
+static SemaphoreHandle_t check_mutex = NULL;
+static TaskHandle_t ota_task_handle = NULL;
+
+static esp_timer_handle_t rollback_timer = NULL;
+static esp_event_handler_instance_t got_ip_instance = NULL;
+
+static ota_stats_t ota_stats;
+
+// Unico buffer de descarga, el parche nunca se guarda completo en RAM
+static uint8_t download_buf[CONFIG_OTA_BUFFER_SIZE];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void ota_task(void *arg);
+
+static bool server_is_pinned(void);
+
+static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static void on_rollback_timeout(void *arg);
+
+static esp_err_t apply_patch(esp_http_client_handle_t client, const uint8_t *running_digest);
+
+static esp_err_t read_cb(uint8_t *buf_p, size_t size, int src_offset);
+
+static esp_err_t write_cb(const uint8_t *buf_p, size_t size, void *user_data);
+
+static int read_full(esp_http_client_handle_t client, uint8_t *buf, int len);
+
+static uint32_t read_u32(const uint8_t *p);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t ota_init(void)
+{
+    if (check_mutex != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    check_mutex = xSemaphoreCreateMutex();
+    if (check_mutex == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    running_partition = esp_ota_get_running_partition();
+
+    // Una imagen recien actualizada arranca pendiente de verificacion
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(running_partition, &state) != ESP_OK || state != ESP_OTA_IMG_PENDING_VERIFY)
+    {
+        return ESP_OK;
+    }
+
+    // Si no obtiene la IP en el plazo, el bootloader vuelve a la imagen anterior
+    const esp_timer_create_args_t timer_args = {
+        .callback = on_rollback_timeout,
+        .name = "ota_rollback",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &rollback_timer));
+    ESP_ERROR_CHECK(esp_timer_start_once(rollback_timer, (uint64_t)CONFIG_OTA_ROLLBACK_TIMEOUT_MS * 1000));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL, &got_ip_instance));
+
+    ESP_LOGW(TAG, "New image in %s pending verification, %d ms to get an IP address",
+             running_partition->label, CONFIG_OTA_ROLLBACK_TIMEOUT_MS);
+    return ESP_OK;
+}
+
+esp_err_t ota_start(void)
+{
+    if (check_mutex == NULL || ota_task_handle != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!server_is_pinned())
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (xTaskCreate(ota_task, "ota", OTA_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &ota_task_handle) != pdPASS)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_check_now(void)
+{
+    if (check_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!server_is_pinned())
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    xSemaphoreTake(check_mutex, portMAX_DELAY);
+    ota_stats.checks++;
+
+    // El servidor elige el parche a partir del SHA-256 de la imagen en ejecucion
+    uint8_t running_digest[OTA_DIGEST_LEN];
+    esp_err_t err = esp_partition_get_sha256(running_partition, running_digest);
+    if (err != ESP_OK)
+    {
+        xSemaphoreGive(check_mutex);
+        return err;
+    }
+    char url[OTA_URL_MAX];
+    int pos = snprintf(url, sizeof(url), "%s/patch?base=", CONFIG_OTA_SERVER_URL);
+    for (int i = 0; i < OTA_DIGEST_LEN && pos < (int)sizeof(url) - 2; i++)
+    {
+        pos += snprintf(&url[pos], sizeof(url) - pos, "%02x", running_digest[i]);
+    }
+
+    // Solo se acepta un servidor con un certificado firmado por la CA del proyecto
+    esp_http_client_config_t config = {
+        .url = url,
+        .timeout_ms = OTA_HTTP_TIMEOUT_MS,
+        .buffer_size = 512,
+        .buffer_size_tx = 512,
+    };
+#ifdef OTA_HAS_CA
+    config.cert_pem = ota_ca_pem_start;
+#endif
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL)
+    {
+        xSemaphoreGive(check_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    err = esp_http_client_open(client, 0);
+    if (err == ESP_OK)
+    {
+        // Un largo negativo es un error leyendo los headers, salvo en una respuesta chunked que no trae el largo
+        int64_t content_length = esp_http_client_fetch_headers(client);
+        int status = esp_http_client_get_status_code(client);
+        if (content_length < 0 && !esp_http_client_is_chunked_response(client))
+        {
+            ESP_LOGE(TAG, "Error (%lld) reading the response headers", (long long)content_length);
+            err = ESP_FAIL;
+        }
+        else if (status == 200)
+        {
+            err = apply_patch(client, running_digest);
+        }
+        else if (status == 204 || status == 404)
+        {
+            // No hay actualizacion para esta imagen
+            ESP_LOGI(TAG, "Firmware is up to date");
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Unexpected HTTP status %d", status);
+            err = ESP_FAIL;
+        }
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Error (%s) connecting to update server", esp_err_to_name(err));
+    }
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+
+    if (err != ESP_OK)
+    {
+        ota_stats.failures++;
+    }
+    xSemaphoreGive(check_mutex);
+    return err;
+}
+
+void ota_get_stats(ota_stats_t *stats)
+{
+    *stats = ota_stats;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void ota_task(void *arg)
+{
+    while (1)
+    {
+        ota_check_now();
+        vTaskDelay(pdMS_TO_TICKS((uint32_t)CONFIG_OTA_CHECK_INTERVAL_S * 1000));
+    }
+}
+
+static bool server_is_pinned(void)
+{
+    // esp_ota_end solo verifica la integridad de la imagen, la autenticidad la da el servidor
+#ifdef OTA_HAS_CA
+    if (strncmp(CONFIG_OTA_SERVER_URL, "https://", 8) == 0)
+    {
+        return true;
+    }
+    ESP_LOGE(TAG, "Update server URL %s is not HTTPS, updates are disabled", CONFIG_OTA_SERVER_URL);
+#else
+    ESP_LOGE(TAG, "No update server CA embedded, updates are disabled");
+#endif
+    return false;
+}
+
+static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // La imagen nueva llego a la red, se cancela el rollback
+    esp_timer_stop(rollback_timer);
+    esp_err_t err = esp_ota_mark_app_valid_cancel_rollback();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) marking image as valid", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "Image in %s marked as valid", running_partition->label);
+    esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, got_ip_instance);
+}
+
+static void on_rollback_timeout(void *arg)
+{
+    ESP_LOGE(TAG, "New image did not get an IP address, rolling back");
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+}
+
+static esp_err_t apply_patch(esp_http_client_handle_t client, const uint8_t *running_digest)
+{
+    int64_t start_us = esp_timer_get_time();
+
+    // Verifica que el parche sea para la imagen en ejecucion
+    if (read_full(client, download_buf, OTA_PATCH_HEADER_LEN) != OTA_PATCH_HEADER_LEN ||
+        read_u32(&download_buf[0]) != OTA_PATCH_MAGIC ||
+        memcmp(&download_buf[4], running_digest, OTA_DIGEST_LEN) != 0)
+    {
+        ESP_LOGE(TAG, "Patch does not match the running image");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    uint32_t image_size = read_u32(&download_buf[36]);
+
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL || image_size > update_partition->size)
+    {
+        ESP_LOGE(TAG, "No OTA partition for a %" PRIu32 " bytes image", image_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Con escrituras secuenciales la particion se borra a medida que se escribe
+    ota_write_ctx_t write_ctx = {0};
+    esp_err_t err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &write_ctx.handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting OTA", esp_err_to_name(err));
+        return err;
+    }
+    esp_delta_ota_cfg_t delta_cfg = {
+        .user_data = &write_ctx,
+        .read_cb = read_cb,
+        .write_cb = write_cb,
+    };
+    esp_delta_ota_handle_t delta = esp_delta_ota_init(&delta_cfg);
+    if (delta == NULL)
+    {
+        esp_ota_abort(write_ctx.handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Descomprime y aplica el parche a medida que llega, contra la imagen en ejecucion
+    uint32_t patch_bytes = OTA_PATCH_HEADER_LEN;
+    ESP_LOGI(TAG, "Applying patch to %s, new image %" PRIu32 " bytes", update_partition->label, image_size);
+    while (1)
+    {
+        int len = esp_http_client_read(client, (char *)download_buf, sizeof(download_buf));
+        if (len < 0)
+        {
+            ESP_LOGE(TAG, "Error reading patch");
+            err = ESP_FAIL;
+            break;
+        }
+        if (len == 0)
+        {
+            if (!esp_http_client_is_complete_data_received(client))
+            {
+                ESP_LOGE(TAG, "Connection closed before the end of the patch");
+                err = ESP_FAIL;
+            }
+            break;
+        }
+        patch_bytes += len;
+        err = esp_delta_ota_feed_patch(delta, download_buf, len);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Error (%s) applying patch", esp_err_to_name(err));
+            break;
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_delta_ota_finalize(delta);
+    }
+    esp_delta_ota_deinit(delta);
+
+    if (err == ESP_OK && write_ctx.written != image_size)
+    {
+        ESP_LOGE(TAG, "Patched image is %" PRIu32 " bytes, expected %" PRIu32, write_ctx.written, image_size);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err != ESP_OK)
+    {
+        esp_ota_abort(write_ctx.handle);
+        return err;
+    }
+
+    // esp_ota_end verifica la integridad de la imagen completa antes de aceptarla
+    err = esp_ota_end(write_ctx.handle);
+    if (err == ESP_OK)
+    {
+        err = esp_ota_set_boot_partition(update_partition);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) validating new image", esp_err_to_name(err));
+        return err;
+    }
+
+    ota_stats.updates++;
+    ota_stats.patch_bytes = patch_bytes;
+    ota_stats.image_bytes = image_size;
+    ota_stats.last_duration_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    ESP_LOGI(TAG, "Update done: %" PRIu32 " patch bytes for a %" PRIu32 " bytes image in %" PRIu32 " ms, restarting",
+             patch_bytes, image_size, ota_stats.last_duration_ms);
+    esp_restart();
+    return ESP_OK;
+}
+
+static esp_err_t read_cb(uint8_t *buf_p, size_t size, int src_offset)
+{
+    // La imagen base es la que esta en ejecucion
+    if (size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_partition_read(running_partition, src_offset, buf_p, size);
+}
+
+static esp_err_t write_cb(const uint8_t *buf_p, size_t size, void *user_data)
+{
+    ota_write_ctx_t *ctx = (ota_write_ctx_t *)user_data;
+    if (size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ctx->written += size;
+    return esp_ota_write(ctx->handle, buf_p, size);
+}
+
+static int read_full(esp_http_client_handle_t client, uint8_t *buf, int len)
+{
+    int total = 0;
+    while (total < len)
+    {
+        int n = esp_http_client_read(client, (char *)&buf[total], len - total);
+        if (n <= 0)
+        {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,49 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PHY_CAL_H_
+#define _PHY_CAL_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Valor de temperatura cuando el chip no tiene sensor interno
+#define PHY_CAL_NO_TEMPERATURE INT16_MIN
+
+//=====[Declaration of public data types]======================================
+
+// Motivo por el que se hizo, o no, una calibracion completa en este arranque
+typedef enum
+{
+    PHY_CAL_STORED,
+    PHY_CAL_DEEP_SLEEP,
+    PHY_CAL_NO_DATA,
+    PHY_CAL_VERSION_CHANGED,
+    PHY_CAL_TEMPERATURE_DRIFT,
+    PHY_CAL_VOLTAGE_DRIFT,
+} phy_cal_reason_t;
+
+typedef struct
+{
+    phy_cal_reason_t reason;
+    uint32_t calibration_us;
+    int16_t temperature_c;
+    uint16_t vdd_mv;
+} phy_cal_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Verifica la calibracion guardada y calibra el RF, llamar despues del NVS y del loop de eventos y antes del Wi-Fi
+esp_err_t phy_cal_init(void);
+
+const char *phy_cal_reason_to_name(phy_cal_reason_t reason);
+
+void phy_cal_get_stats(phy_cal_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PHY_CAL_H_
@@ -0,0 +1,278 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_phy_init.h"
+#include "esp_attr.h"
+#include "nvs.h"
+#include "soc/soc_caps.h"
+
+#if SOC_TEMP_SENSOR_SUPPORTED
+#include "driver/temperature_sensor.h"
+#endif
+
+#if CONFIG_PHY_CAL_VDD_ADC_CHANNEL >= 0
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#endif
+
+#include "phy_cal.h"
+
+//=====[Declaration of private defines]========================================
+
+#define PHY_CAL_NAMESPACE "phy_cal"
+#define PHY_CAL_VERSION_LEN 32
+#define PHY_CAL_RTC_MAGIC 0x50484343
+
+//=====[Declaration of private data types]=====================================
+
+// Condiciones en las que se hizo la calibracion que se guardo
+typedef struct
+{
+    char phy_version[PHY_CAL_VERSION_LEN];
+    int16_t temperature_c;
+    uint16_t vdd_mv;
+} phy_cal_context_t;
+
+// Copia en el RTC de las condiciones guardadas, asi al despertar de un deep sleep no se lee el NVS
+typedef struct
+{
+    uint32_t magic;
+    phy_cal_context_t context;
+} phy_cal_rtc_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "phy-cal";
+
+//=====[Declaration and initialization of private global variables]============
+
+static phy_cal_stats_t cal_stats;
+static phy_cal_context_t current_context;
+static esp_event_handler_instance_t got_ip_instance = NULL;
+RTC_DATA_ATTR static phy_cal_rtc_t rtc_context;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static phy_cal_reason_t check_stored_context(void);
+
+static phy_cal_reason_t compare_context(const phy_cal_context_t *stored);
+
+static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static int16_t read_temperature(void);
+
+static uint16_t read_vdd(void);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t phy_cal_init(void)
+{
+    memset(&current_context, 0, sizeof(current_context));
+    snprintf(current_context.phy_version, sizeof(current_context.phy_version), "%s", get_phy_version_str());
+    current_context.temperature_c = read_temperature();
+    current_context.vdd_mv = read_vdd();
+    cal_stats.temperature_c = current_context.temperature_c;
+    cal_stats.vdd_mv = current_context.vdd_mv;
+
+    // Al despertar de un deep sleep el ESP-IDF no calibra y usa los datos guardados en el NVS, por eso la deriva se
+    // verifica tambien ahi: un nodo en duty cycle puede pasar meses sin otro tipo de arranque
+    cal_stats.reason = check_stored_context();
+    if (cal_stats.reason == PHY_CAL_STORED && esp_reset_reason() == ESP_RST_DEEPSLEEP)
+    {
+        cal_stats.reason = PHY_CAL_DEEP_SLEEP;
+    }
+
+    // Sin datos validos se borran los del NVS para forzar una calibracion completa, tambien al despertar de un deep sleep
+    if (cal_stats.reason != PHY_CAL_STORED && cal_stats.reason != PHY_CAL_DEEP_SLEEP)
+    {
+        esp_phy_erase_cal_data_in_nvs();
+    }
+
+    // La calibracion se hace una sola vez por arranque, al habilitar el PHY por primera vez
+    // Se habilita aca para medirla, el Wi-Fi despues solo hace la inicializacion rapida
+    int64_t start_us = esp_timer_get_time();
+    esp_phy_enable(PHY_MODEM_WIFI);
+    cal_stats.calibration_us = (uint32_t)(esp_timer_get_time() - start_us);
+    esp_phy_disable(PHY_MODEM_WIFI);
+
+    ESP_LOGI(TAG, "RF calibration took %" PRIu32 " ms (%s)", cal_stats.calibration_us / 1000,
+             phy_cal_reason_to_name(cal_stats.reason));
+
+    // La calibracion nueva se da por buena recien con la primera conexion
+    if (cal_stats.reason != PHY_CAL_STORED && cal_stats.reason != PHY_CAL_DEEP_SLEEP)
+    {
+        return esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL, &got_ip_instance);
+    }
+    return ESP_OK;
+}
+
+const char *phy_cal_reason_to_name(phy_cal_reason_t reason)
+{
+    static const char *names[] = {"stored data", "deep-sleep wake", "no stored data", "PHY version changed",
+                                  "temperature drift", "voltage drift"};
+    return ((unsigned)reason < sizeof(names) / sizeof(names[0])) ? names[reason] : "unknown";
+}
+
+void phy_cal_get_stats(phy_cal_stats_t *stats)
+{
+    *stats = cal_stats;
+}
+
+//=====[Implementations of private functions]==================================
+
+static phy_cal_reason_t check_stored_context(void)
+{
+    // La copia del RTC solo sobrevive al deep sleep, en cualquier otro arranque se vuelve a leer el NVS
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP && rtc_context.magic == PHY_CAL_RTC_MAGIC)
+    {
+        return compare_context(&rtc_context.context);
+    }
+    rtc_context.magic = 0;
+
+    nvs_handle_t my_handle;
+    phy_cal_context_t stored;
+    size_t len = sizeof(stored);
+    if (nvs_open(PHY_CAL_NAMESPACE, NVS_READONLY, &my_handle) != ESP_OK)
+    {
+        return PHY_CAL_NO_DATA;
+    }
+    esp_err_t err = nvs_get_blob(my_handle, "context", &stored, &len);
+    nvs_close(my_handle);
+    if (err != ESP_OK || len != sizeof(stored))
+    {
+        return PHY_CAL_NO_DATA;
+    }
+    rtc_context.context = stored;
+    rtc_context.magic = PHY_CAL_RTC_MAGIC;
+    return compare_context(&stored);
+}
+
+static phy_cal_reason_t compare_context(const phy_cal_context_t *stored)
+{
+    if (strncmp(stored->phy_version, current_context.phy_version, PHY_CAL_VERSION_LEN) != 0)
+    {
+        return PHY_CAL_VERSION_CHANGED;
+    }
+    if (stored->temperature_c != PHY_CAL_NO_TEMPERATURE && current_context.temperature_c != PHY_CAL_NO_TEMPERATURE &&
+        abs(stored->temperature_c - current_context.temperature_c) > CONFIG_PHY_CAL_MAX_TEMP_DRIFT)
+    {
+        return PHY_CAL_TEMPERATURE_DRIFT;
+    }
+#if CONFIG_PHY_CAL_VDD_ADC_CHANNEL >= 0
+    if (stored->vdd_mv != 0 && current_context.vdd_mv != 0 &&
+        abs((int)stored->vdd_mv - (int)current_context.vdd_mv) > CONFIG_PHY_CAL_MAX_VDD_DRIFT_MV)
+    {
+        return PHY_CAL_VOLTAGE_DRIFT;
+    }
+#endif
+    return PHY_CAL_STORED;
+}
+
+static void on_got_ip(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // El ESP-IDF ya guardo los datos de calibracion en el NVS, aca se guardan las condiciones
+    nvs_handle_t my_handle;
+    if (nvs_open(PHY_CAL_NAMESPACE, NVS_READWRITE, &my_handle) == ESP_OK)
+    {
+        if (nvs_set_blob(my_handle, "context", &current_context, sizeof(current_context)) == ESP_OK)
+        {
+            nvs_commit(my_handle);
+            rtc_context.context = current_context;
+            rtc_context.magic = PHY_CAL_RTC_MAGIC;
+            ESP_LOGI(TAG, "Calibration data kept for next boots (PHY %s)", current_context.phy_version);
+        }
+        nvs_close(my_handle);
+    }
+    esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, got_ip_instance);
+}
+
+static int16_t read_temperature(void)
+{
+#if SOC_TEMP_SENSOR_SUPPORTED
+    temperature_sensor_handle_t sensor = NULL;
+    temperature_sensor_config_t config = TEMPERATURE_SENSOR_CONFIG_DEFAULT(-10, 80);
+    float celsius;
+    if (temperature_sensor_install(&config, &sensor) != ESP_OK)
+    {
+        return PHY_CAL_NO_TEMPERATURE;
+    }
+    temperature_sensor_enable(sensor);
+    esp_err_t err = temperature_sensor_get_celsius(sensor, &celsius);
+    temperature_sensor_disable(sensor);
+    temperature_sensor_uninstall(sensor);
+    return (err == ESP_OK) ? (int16_t)celsius : PHY_CAL_NO_TEMPERATURE;
+#else
+    // El ESP32 no tiene sensor de temperatura interno
+    return PHY_CAL_NO_TEMPERATURE;
+#endif
+}
+
+static uint16_t read_vdd(void)
+{
+#if CONFIG_PHY_CAL_VDD_ADC_CHANNEL >= 0
+    // Lectura unica antes de que arranque el muestreo continuo, que usa el mismo ADC
+    adc_oneshot_unit_handle_t adc_handle;
+    adc_oneshot_unit_init_cfg_t unit_config = {
+        .unit_id = ADC_UNIT_1,
+    };
+    if (adc_oneshot_new_unit(&unit_config, &adc_handle) != ESP_OK)
+    {
+        return 0;
+    }
+    adc_oneshot_chan_cfg_t chan_config = {
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    adc_oneshot_config_channel(adc_handle, CONFIG_PHY_CAL_VDD_ADC_CHANNEL, &chan_config);
+
+    adc_cali_handle_t cali_handle = NULL;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .chan = CONFIG_PHY_CAL_VDD_ADC_CHANNEL,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    adc_cali_create_scheme_curve_fitting(&cali_config, &cali_handle);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = ADC_UNIT_1,
+        .atten = ADC_ATTEN_DB_12,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    adc_cali_create_scheme_line_fitting(&cali_config, &cali_handle);
+#endif
+
+    int raw = 0;
+    int mv = 0;
+    if (adc_oneshot_read(adc_handle, CONFIG_PHY_CAL_VDD_ADC_CHANNEL, &raw) == ESP_OK && cali_handle != NULL)
+    {
+        adc_cali_raw_to_voltage(cali_handle, raw, &mv);
+    }
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    if (cali_handle != NULL)
+    {
+        adc_cali_delete_scheme_curve_fitting(cali_handle);
+    }
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    if (cali_handle != NULL)
+    {
+        adc_cali_delete_scheme_line_fitting(cali_handle);
+    }
+#endif
+    adc_oneshot_del_unit(adc_handle);
+    return (uint16_t)(mv * CONFIG_PHY_CAL_VDD_DIVIDER);
+#else
+    return 0;
+#endif
+}
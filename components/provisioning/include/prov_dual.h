@@ -0,0 +1,38 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROV_DUAL_H_
+#define _PROV_DUAL_H_
+
+//=====[Libraries]=============================================================
+
+#include "wifi_provisioning/manager.h"
+
+#include "provisioning.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Libera la memoria del Bluetooth al terminar el provisioning, salvo que ya se haya liberado al cerrar el BLE
+#define PROV_DUAL_EVENT_HANDLER                   \
+    {                                             \
+        .event_cb = prov_dual_scheme_event_cb,    \
+        .user_data = NULL,                        \
+    }
+
+//=====[Declaration of public global variables]================================
+
+// Esquema del provisioning manager que arranca el BLE y el SoftAP sobre la misma instancia de protocomm
+// Sin CONFIG_PROV_RESUME la seguridad 2 de protocomm atiende una sola sesion a la vez: si un cliente abre la
+// sesion por el otro transporte se cierra la del primero, que tiene que repetir el handshake
+extern const wifi_prov_scheme_t prov_dual_scheme;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void prov_dual_scheme_event_cb(void *user_data, wifi_prov_cb_event_t event, void *event_data);
+
+// Cierra el transporte que no entrego las credenciales, llamar al recibir WIFI_PROV_CRED_RECV en el loop por defecto
+// El que gano se conoce por la tarea que ejecuto apply-config, no por la actividad del otro transporte
+provisioning_transport_t prov_dual_resolve(void);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROV_DUAL_H_
@@ -0,0 +1,44 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROV_DUAL_SEL_H_
+#define _PROV_DUAL_SEL_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Mismos valores que provisioning_transport_t, prov_dual.c verifica que coincidan
+#define PROV_DUAL_SEL_BLE 0
+#define PROV_DUAL_SEL_SOFTAP 1
+
+//=====[Declaration of public data types]======================================
+
+// Eleccion del transporte que gano sin dependencias del ESP-IDF, asi la prueba de la PC la ejecuta con sesiones
+// concurrentes en los dos transportes. Cada tarea se identifica con un puntero opaco: el servidor HTTP atiende
+// todos los pedidos del SoftAP en su tarea y el stack BLE los suyos en otra
+typedef struct
+{
+    const void *volatile http_task;
+    volatile int carrier;
+} prov_dual_sel_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void prov_dual_sel_init(prov_dual_sel_t *sel);
+
+// Llamar con cada pedido HTTP, desde la tarea del servidor
+void prov_dual_sel_http_request(prov_dual_sel_t *sel, const void *task);
+
+// Llamar con WIFI_PROV_CRED_RECV desde el callback del esquema. El manager lo ejecuta en la tarea del transporte
+// que trajo apply-config, antes de publicar el evento en el loop por defecto
+void prov_dual_sel_credentials(prov_dual_sel_t *sel, const void *task);
+
+// Devuelve el transporte que gano, o -1 si todavia no llegaron credenciales
+// Si uno de los dos ya se cerro gana el que queda, asi los reintentos no cambian la eleccion
+int prov_dual_sel_winner(const prov_dual_sel_t *sel, bool ble_running, bool softap_running);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROV_DUAL_SEL_H_
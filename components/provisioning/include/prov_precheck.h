@@ -0,0 +1,60 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROV_PRECHECK_H_
+#define _PROV_PRECHECK_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define PROV_PRECHECK_ENDPOINT "prov-precheck"
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    PROV_PRECHECK_OK,
+    PROV_PRECHECK_INVALID_REQUEST,
+    PROV_PRECHECK_SSID_NOT_FOUND,
+    PROV_PRECHECK_SSID_CASE_MISMATCH,
+    PROV_PRECHECK_PASSWORD_REQUIRED,
+    PROV_PRECHECK_PASSWORD_LENGTH,
+    PROV_PRECHECK_AUTH_UNSUPPORTED,
+    PROV_PRECHECK_SCAN_BUSY,
+    PROV_PRECHECK_REASON_COUNT,
+} prov_precheck_reason_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Arranca la tarea del pre-check y el escaneo que llena la cache, llamar despues de wifi_prov_mgr_start_provisioning
+esp_err_t prov_precheck_start(void);
+
+// Termina la tarea del pre-check, llamar al terminar el provisioning
+void prov_precheck_stop(void);
+
+// Guarda los resultados si el escaneo es el de la cache, llamar con WIFI_EVENT_SCAN_DONE
+void prov_precheck_on_scan_done(void);
+
+// Verifica las credenciales recibidas en la tarea del pre-check, llamar con WIFI_PROV_CRED_RECV
+void prov_precheck_on_credentials(const uint8_t *ssid, const uint8_t *password);
+
+// true si el pre-check de las ultimas credenciales recibidas encontro una falla que no se resuelve reintentando
+bool prov_precheck_rejected(void);
+
+// Handler del endpoint, registrarlo con wifi_prov_mgr_endpoint_register. No bloquea la tarea del transporte:
+// el pedido (largo del SSID, SSID, largo de la contrasena) responde pending y el resultado se consulta con un
+// pedido vacio o con el largo del SSID en 0. Respuesta: JSON
+esp_err_t prov_precheck_handler(uint32_t session_id, const uint8_t *inbuf, ssize_t inlen,
+                                uint8_t **outbuf, ssize_t *outlen, void *priv_data);
+
+const char *prov_precheck_reason_to_name(prov_precheck_reason_t reason);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROV_PRECHECK_H_
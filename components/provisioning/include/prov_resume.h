@@ -0,0 +1,77 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROV_RESUME_H_
+#define _PROV_RESUME_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "esp_err.h"
+#include "wifi_provisioning/manager.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define PROV_RESUME_ENDPOINT "prov-resume"
+
+#define PROV_RESUME_CLIENT_ID_MAX 32
+#define PROV_RESUME_TOKEN_LEN 16
+
+//=====[Declaration of public data types]======================================
+
+// Primer byte del pedido al endpoint
+typedef enum
+{
+    PROV_RESUME_OP_ISSUE = 1,
+    PROV_RESUME_OP_RESUME = 2,
+} prov_resume_op_t;
+
+// Ultimo paso del provisioning que hizo el dispositivo, se informa al cliente que retoma la sesion
+typedef enum
+{
+    PROV_RESUME_PROGRESS_SESSION,
+    PROV_RESUME_PROGRESS_CREDENTIALS_RECEIVED,
+    PROV_RESUME_PROGRESS_CREDENTIALS_FAILED,
+    PROV_RESUME_PROGRESS_CONNECTED,
+    PROV_RESUME_PROGRESS_COUNT,
+} prov_resume_progress_t;
+
+typedef struct
+{
+    uint32_t handshakes;
+    uint32_t handshake_ms_total;
+    uint32_t attempts;
+    uint32_t hits;
+    uint32_t rejected;
+    uint32_t expired;
+    uint32_t evicted;
+    uint32_t saved_ms_total;
+} prov_resume_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Envuelve el prov_start del esquema para conocer la instancia de protocomm, llamar antes de wifi_prov_mgr_init
+void prov_resume_wrap_scheme(wifi_prov_scheme_t *scheme);
+
+// Reemplaza la seguridad 2 de prov-session por la que permite retomar sesiones
+// Llamar despues de wifi_prov_mgr_start_provisioning con los mismos parametros de seguridad
+esp_err_t prov_resume_install(const void *sec_params);
+
+// Actualiza el progreso que se informa al retomar, llamar con cada evento de WIFI_PROV_EVENT
+void prov_resume_on_prov_event(int32_t event_id);
+
+// Handler del endpoint, registrarlo con wifi_prov_mgr_endpoint_register
+// ISSUE: op, largo del id del cliente (1 byte), id. RESUME: lo mismo seguido del token. Respuesta: JSON
+esp_err_t prov_resume_handler(uint32_t session_id, const uint8_t *inbuf, ssize_t inlen,
+                              uint8_t **outbuf, ssize_t *outlen, void *priv_data);
+
+// handshake_ms_total se mide desde SessionCmd0 hasta el ultimo paso del handshake
+// saved_ms_total suma el handshake de cada sesion retomada, el que el cliente no tuvo que repetir
+void prov_resume_get_stats(prov_resume_stats_t *stats);
+
+const char *prov_resume_progress_to_name(prov_resume_progress_t progress);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROV_RESUME_H_
@@ -0,0 +1,74 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROV_SM_H_
+#define _PROV_SM_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Reintentos con credenciales invalidas antes de volver a pedirlas
+#define PROV_SM_MAX_RETRIES 5
+
+// Ids de los eventos del ESP-IDF que atiende la maquina de estados, provisioning.c verifica que coincidan
+#define PROV_SM_ID_WIFI_PROV_CRED_FAIL 3
+#define PROV_SM_ID_WIFI_PROV_CRED_SUCCESS 4
+#define PROV_SM_ID_WIFI_PROV_END 5
+#define PROV_SM_ID_WIFI_STA_START 2
+#define PROV_SM_ID_WIFI_STA_DISCONNECTED 5
+#define PROV_SM_ID_IP_STA_GOT_IP 0
+
+// Acciones que tiene que ejecutar el que llama, se pueden combinar
+#define PROV_SM_ACTION_CONNECT 0x01
+#define PROV_SM_ACTION_RESET_CREDENTIALS 0x02
+#define PROV_SM_ACTION_DEINIT 0x04
+#define PROV_SM_ACTION_SIGNAL_CONNECTED 0x08
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    PROV_SM_BASE_OTHER,
+    PROV_SM_BASE_WIFI_PROV,
+    PROV_SM_BASE_WIFI,
+    PROV_SM_BASE_IP,
+} prov_sm_base_t;
+
+typedef enum
+{
+    PROV_SM_EVENT_NONE,
+    PROV_SM_EVENT_CRED_FAIL,
+    PROV_SM_EVENT_CRED_SUCCESS,
+    PROV_SM_EVENT_PROV_END,
+    PROV_SM_EVENT_STA_START,
+    PROV_SM_EVENT_STA_DISCONNECTED,
+    PROV_SM_EVENT_GOT_IP,
+} prov_sm_event_t;
+
+// Logica del handler de eventos del provisioning sin dependencias del ESP-IDF,
+// asi la herramienta de replay la ejecuta en la PC con las mismas secuencias del dispositivo
+typedef struct
+{
+    int retries;
+    uint32_t connect_attempts;
+    uint32_t credential_resets;
+    uint32_t connections;
+} prov_sm_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void prov_sm_init(prov_sm_t *sm);
+
+prov_sm_event_t prov_sm_classify(prov_sm_base_t base, int32_t event_id);
+
+// Actualiza el estado y devuelve las acciones PROV_SM_ACTION_* para el evento
+uint32_t prov_sm_handle(prov_sm_t *sm, prov_sm_event_t event);
+
+// Descarta las credenciales sin esperar los reintentos, cuando ya se sabe que no sirven
+uint32_t prov_sm_reject_credentials(prov_sm_t *sm);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROV_SM_H_
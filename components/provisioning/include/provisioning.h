@@ -0,0 +1,57 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROVISIONING_H_
+#define _PROVISIONING_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+#include "freertos/FreeRTOS.h"
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    PROVISIONING_TRANSPORT_BLE,
+    PROVISIONING_TRANSPORT_SOFTAP,
+    PROVISIONING_TRANSPORT_COUNT,
+} provisioning_transport_t;
+
+// Tiempos del ultimo provisioning, se guardan en el NVS y se recuperan en los arranques siguientes
+typedef struct
+{
+    bool valid;
+    provisioning_transport_t transport;
+    uint32_t first_contact_ms[PROVISIONING_TRANSPORT_COUNT];
+    uint32_t credentials_ms;
+    uint32_t connected_ms;
+} provisioning_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Inicializa la interfaz Wi-Fi y arranca el provisioning, o la estacion si el dispositivo ya tiene credenciales
+// Antes hay que inicializar el NVS, el stack TCP/IP y el loop de eventos por defecto
+esp_err_t provisioning_start(void);
+
+// Espera a que la estacion obtenga la direccion IP
+esp_err_t provisioning_wait_connected(TickType_t timeout);
+
+// Loguea los eventos del provisioning, del Wi-Fi y de la sesion segura
+// Con CONFIG_PROV_LOG_EVENTS se registra en el loop por defecto, sino la aplicacion lo registra donde quiera
+void provisioning_log_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+// first_contact_ms se mide desde el arranque del provisioning hasta el primer cliente de cada transporte, 0 si no hubo
+// credentials_ms va desde el primer contacto del transporte que gano hasta recibir las credenciales
+// connected_ms va desde el arranque del provisioning hasta obtener la direccion IP
+void provisioning_get_stats(provisioning_stats_t *stats);
+
+const char *provisioning_transport_to_name(provisioning_transport_t transport);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROVISIONING_H_
@@ -0,0 +1,277 @@
+//=====[Libraries]=============================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "wifi_provisioning/scheme_ble.h"
+#include "wifi_provisioning/scheme_softap.h"
+
+#include "prov_dual.h"
+#include "prov_dual_sel.h"
+
+//=====[Declaration of private defines]========================================
+
+// Endpoints del provisioning manager mas los propios de la aplicacion
+#define PROV_DUAL_HTTP_MAX_URIS 12
+
+_Static_assert(PROV_DUAL_SEL_BLE == PROVISIONING_TRANSPORT_BLE, "PROVISIONING_TRANSPORT_BLE changed");
+_Static_assert(PROV_DUAL_SEL_SOFTAP == PROVISIONING_TRANSPORT_SOFTAP, "PROVISIONING_TRANSPORT_SOFTAP changed");
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    void *ble;
+    void *softap;
+} dual_config_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "prov-dual";
+
+//=====[Declaration and initialization of private global variables]============
+
+static protocomm_t *dual_pc = NULL;
+static httpd_handle_t http_server = NULL;
+
+static bool ble_running = false;
+static bool softap_running = false;
+static bool ble_released = false;
+
+// Lo escriben la tarea del servidor HTTP y la del transporte que trae las credenciales
+static prov_dual_sel_t selection;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static esp_err_t dual_prov_start(protocomm_t *pc, void *config);
+
+static esp_err_t dual_prov_stop(protocomm_t *pc);
+
+static void *dual_new_config(void);
+
+static void dual_delete_config(void *config);
+
+static esp_err_t dual_set_config_service(void *config, const char *service_name, const char *service_key);
+
+static esp_err_t dual_set_config_endpoint(void *config, const char *endpoint_name, uint16_t uuid);
+
+static void stop_ble(void);
+
+static void stop_softap(void);
+
+static bool match_uri(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+//=====[Declaration and initialization of public global variables]=============
+
+const wifi_prov_scheme_t prov_dual_scheme = {
+    .prov_start = dual_prov_start,
+    .prov_stop = dual_prov_stop,
+    .new_config = dual_new_config,
+    .delete_config = dual_delete_config,
+    .set_config_service = dual_set_config_service,
+    .set_config_endpoint = dual_set_config_endpoint,
+    .wifi_mode = WIFI_MODE_APSTA,
+};
+
+//=====[Implementations of public functions]===================================
+
+void prov_dual_scheme_event_cb(void *user_data, wifi_prov_cb_event_t event, void *event_data)
+{
+    if (event == WIFI_PROV_CRED_RECV)
+    {
+        // Corre en la tarea del transporte que entrego apply-config, no en el loop por defecto
+        prov_dual_sel_credentials(&selection, xTaskGetCurrentTaskHandle());
+    }
+    if (event == WIFI_PROV_DEINIT && ble_released)
+    {
+        return;
+    }
+    wifi_prov_scheme_ble_event_cb_free_btdm(user_data, event, event_data);
+}
+
+provisioning_transport_t prov_dual_resolve(void)
+{
+    // Si las credenciales fallaron y llegan de nuevo, solo queda el transporte que gano la primera vez
+    int winner = prov_dual_sel_winner(&selection, ble_running, softap_running);
+    if (winner < 0)
+    {
+        ESP_LOGW(TAG, "Credentials received over an unknown transport, keeping both");
+        return PROVISIONING_TRANSPORT_BLE;
+    }
+    if (winner == PROV_DUAL_SEL_SOFTAP)
+    {
+        if (ble_running)
+        {
+            ESP_LOGI(TAG, "Credentials received over SoftAP, stopping BLE");
+            stop_ble();
+        }
+        return PROVISIONING_TRANSPORT_SOFTAP;
+    }
+
+    // El AP sigue activo hasta que el manager termina, asi no se interrumpe la conexion de la estacion
+    if (softap_running)
+    {
+        ESP_LOGI(TAG, "Credentials received over BLE, stopping HTTP server");
+        stop_softap();
+    }
+    return PROVISIONING_TRANSPORT_BLE;
+}
+
+//=====[Implementations of private functions]==================================
+
+static esp_err_t dual_prov_start(protocomm_t *pc, void *config)
+{
+    dual_config_t *dual_config = (dual_config_t *)config;
+    dual_pc = pc;
+    prov_dual_sel_init(&selection);
+    ble_released = false;
+
+    esp_err_t err = wifi_prov_scheme_ble.prov_start(pc, dual_config->ble);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting BLE transport", esp_err_to_name(err));
+        return err;
+    }
+    ble_running = true;
+
+    // El servidor HTTP es propio para conocer su tarea y asi el transporte que entrega las credenciales
+    httpd_config_t http_config = HTTPD_DEFAULT_CONFIG();
+    http_config.max_uri_handlers = PROV_DUAL_HTTP_MAX_URIS;
+    http_config.lru_purge_enable = true;
+    http_config.uri_match_fn = match_uri;
+    err = httpd_start(&http_server, &http_config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting HTTP server", esp_err_to_name(err));
+        stop_ble();
+        return err;
+    }
+
+    // El SoftAP arranca despues del BLE porque protocomm registra los endpoints en el ultimo transporte
+    // El BLE ya los tiene en su tabla de UUIDs desde set_config_endpoint
+    wifi_prov_scheme_softap_set_httpd_handle(&http_server);
+    err = wifi_prov_scheme_softap.prov_start(pc, dual_config->softap);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting SoftAP transport", esp_err_to_name(err));
+        httpd_stop(http_server);
+        http_server = NULL;
+        stop_ble();
+        return err;
+    }
+    softap_running = true;
+    ESP_LOGI(TAG, "BLE and SoftAP transports started");
+    return ESP_OK;
+}
+
+static esp_err_t dual_prov_stop(protocomm_t *pc)
+{
+    stop_softap();
+    stop_ble();
+    dual_pc = NULL;
+    return ESP_OK;
+}
+
+static void *dual_new_config(void)
+{
+    dual_config_t *config = calloc(1, sizeof(dual_config_t));
+    if (config == NULL)
+    {
+        return NULL;
+    }
+    config->ble = wifi_prov_scheme_ble.new_config();
+    config->softap = wifi_prov_scheme_softap.new_config();
+    if (config->ble == NULL || config->softap == NULL)
+    {
+        dual_delete_config(config);
+        return NULL;
+    }
+    return config;
+}
+
+static void dual_delete_config(void *config)
+{
+    dual_config_t *dual_config = (dual_config_t *)config;
+    if (dual_config == NULL)
+    {
+        return;
+    }
+    if (dual_config->ble != NULL)
+    {
+        wifi_prov_scheme_ble.delete_config(dual_config->ble);
+    }
+    if (dual_config->softap != NULL)
+    {
+        wifi_prov_scheme_softap.delete_config(dual_config->softap);
+    }
+    free(dual_config);
+}
+
+static esp_err_t dual_set_config_service(void *config, const char *service_name, const char *service_key)
+{
+    // El nombre del dispositivo BLE y el SSID del AP son el mismo
+    dual_config_t *dual_config = (dual_config_t *)config;
+    esp_err_t err = wifi_prov_scheme_ble.set_config_service(dual_config->ble, service_name, service_key);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    return wifi_prov_scheme_softap.set_config_service(dual_config->softap, service_name, service_key);
+}
+
+static esp_err_t dual_set_config_endpoint(void *config, const char *endpoint_name, uint16_t uuid)
+{
+    dual_config_t *dual_config = (dual_config_t *)config;
+    esp_err_t err = wifi_prov_scheme_ble.set_config_endpoint(dual_config->ble, endpoint_name, uuid);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    return wifi_prov_scheme_softap.set_config_endpoint(dual_config->softap, endpoint_name, uuid);
+}
+
+static void stop_ble(void)
+{
+    if (!ble_running)
+    {
+        return;
+    }
+    ble_running = false;
+    wifi_prov_scheme_ble.prov_stop(dual_pc);
+
+    // Libera la memoria del controlador y del stack en el momento, no cuando termina el manager
+    if (softap_running)
+    {
+        wifi_prov_scheme_ble_event_cb_free_btdm(NULL, WIFI_PROV_DEINIT, NULL);
+        ble_released = true;
+    }
+}
+
+static void stop_softap(void)
+{
+    if (!softap_running)
+    {
+        return;
+    }
+    softap_running = false;
+
+    // protocomm no detiene un servidor HTTP que no arranco el
+    wifi_prov_scheme_softap.prov_stop(dual_pc);
+    httpd_stop(http_server);
+    http_server = NULL;
+}
+
+static bool match_uri(const char *reference_uri, const char *uri_to_match, size_t match_upto)
+{
+    // Misma comparacion exacta que usa el servidor cuando no se configura uri_match_fn
+    if (strlen(reference_uri) != match_upto || strncmp(reference_uri, uri_to_match, match_upto) != 0)
+    {
+        return false;
+    }
+    prov_dual_sel_http_request(&selection, xTaskGetCurrentTaskHandle());
+    return true;
+}
@@ -0,0 +1,37 @@
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+
+#include "prov_dual_sel.h"
+
+//=====[Implementations of public functions]===================================
+
+void prov_dual_sel_init(prov_dual_sel_t *sel)
+{
+    sel->http_task = NULL;
+    sel->carrier = -1;
+}
+
+void prov_dual_sel_http_request(prov_dual_sel_t *sel, const void *task)
+{
+    sel->http_task = task;
+}
+
+void prov_dual_sel_credentials(prov_dual_sel_t *sel, const void *task)
+{
+    // El SoftAP siempre pasa por el servidor HTTP antes de llegar a protocomm, cualquier otra tarea es la del BLE
+    sel->carrier = (task != NULL && task == sel->http_task) ? PROV_DUAL_SEL_SOFTAP : PROV_DUAL_SEL_BLE;
+}
+
+int prov_dual_sel_winner(const prov_dual_sel_t *sel, bool ble_running, bool softap_running)
+{
+    if (!softap_running)
+    {
+        return PROV_DUAL_SEL_BLE;
+    }
+    if (!ble_running)
+    {
+        return PROV_DUAL_SEL_SOFTAP;
+    }
+    return sel->carrier;
+}
@@ -0,0 +1,538 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "prov_precheck.h"
+
+//=====[Declaration of private defines]========================================
+
+#define PROV_PRECHECK_SSID_MAX 32
+#define PROV_PRECHECK_PASSWORD_MAX 64
+#define PROV_PRECHECK_RESPONSE_MAX 160
+
+#define PROV_PRECHECK_TASK_STACK_SIZE 3072
+
+// Puede haber varios AP con el mismo SSID, se queda con el de mejor RSSI
+#define PROV_PRECHECK_PROBE_RECORDS 4
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    prov_precheck_reason_t reason;
+    bool found;
+    wifi_ap_record_t ap;
+} precheck_result_t;
+
+// Pedido a la tarea del pre-check, del endpoint o de las credenciales recibidas
+typedef struct
+{
+    bool stop;
+    bool credentials;
+    char ssid[PROV_PRECHECK_SSID_MAX + 1];
+    uint8_t ssid_len;
+    uint8_t password_len;
+    int64_t queued_us;
+} precheck_job_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "prov-precheck";
+
+static const char *reason_names[] = {
+    "ok",
+    "invalid_request",
+    "ssid_not_found",
+    "ssid_case_mismatch",
+    "password_required",
+    "password_length",
+    "auth_unsupported",
+    "scan_busy",
+};
+
+//=====[Declaration and initialization of private global variables]============
+
+// Protege la cache y el ultimo resultado, que se escriben en la tarea del pre-check y en el loop por defecto
+static SemaphoreHandle_t cache_mutex = NULL;
+static wifi_ap_record_t cache[CONFIG_PROV_PRECHECK_CACHE_SIZE];
+static uint16_t cache_count = 0;
+static bool cache_valid = false;
+
+static QueueHandle_t job_queue = NULL;
+static TaskHandle_t precheck_task_handle = NULL;
+
+static bool result_pending = false;
+static bool result_valid = false;
+static bool result_credentials = false;
+static precheck_result_t last_result;
+static uint32_t last_ms = 0;
+
+// Resultado del pre-check de las ultimas credenciales recibidas, PROV_PRECHECK_REASON_COUNT mientras no termino
+static prov_precheck_reason_t credentials_reason = PROV_PRECHECK_REASON_COUNT;
+
+// El manager ignora los SCAN_DONE de escaneos que no pidio, este flag marca el de la cache
+static volatile bool cache_scan_pending = false;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void precheck_task(void *arg);
+
+static esp_err_t queue_job(const precheck_job_t *job);
+
+static int format_result(char *response, size_t max);
+
+static void run_precheck(const uint8_t *ssid, size_t ssid_len, size_t password_len, bool probe_allowed,
+                         precheck_result_t *result);
+
+static bool cache_find(const uint8_t *ssid, size_t ssid_len, wifi_ap_record_t *ap, bool *case_mismatch);
+
+static esp_err_t probe(const uint8_t *ssid, uint8_t channel, wifi_ap_record_t *ap, bool *found);
+
+static prov_precheck_reason_t check_auth(wifi_auth_mode_t authmode, size_t password_len);
+
+static const char *auth_to_name(wifi_auth_mode_t authmode);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t prov_precheck_start(void)
+{
+    if (cache_mutex == NULL)
+    {
+        cache_mutex = xSemaphoreCreateMutex();
+        if (cache_mutex == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (job_queue == NULL)
+    {
+        // Un solo pedido pendiente, uno nuevo reemplaza al que todavia no empezo
+        job_queue = xQueueCreate(1, sizeof(precheck_job_t));
+        if (job_queue == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (precheck_task_handle == NULL &&
+        xTaskCreate(precheck_task, "prov_precheck", PROV_PRECHECK_TASK_STACK_SIZE, NULL, tskIDLE_PRIORITY + 2,
+                    &precheck_task_handle) != pdPASS)
+    {
+        precheck_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    result_pending = false;
+    result_valid = false;
+    credentials_reason = PROV_PRECHECK_REASON_COUNT;
+
+    // Escanea todos los canales mientras el telefono todavia se esta conectando
+    cache_scan_pending = true;
+    esp_err_t err = esp_wifi_scan_start(NULL, false);
+    if (err != ESP_OK)
+    {
+        cache_scan_pending = false;
+        ESP_LOGW(TAG, "Error (%s) starting cache scan, pre-checks will probe all channels", esp_err_to_name(err));
+    }
+    return ESP_OK;
+}
+
+void prov_precheck_on_scan_done(void)
+{
+    if (!cache_scan_pending)
+    {
+        return;
+    }
+    cache_scan_pending = false;
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    cache_count = CONFIG_PROV_PRECHECK_CACHE_SIZE;
+    cache_valid = (esp_wifi_scan_get_ap_records(&cache_count, cache) == ESP_OK);
+    if (!cache_valid)
+    {
+        cache_count = 0;
+    }
+    xSemaphoreGive(cache_mutex);
+    ESP_LOGI(TAG, "Cached %u access points", (unsigned)cache_count);
+}
+
+void prov_precheck_stop(void)
+{
+    if (precheck_task_handle == NULL)
+    {
+        return;
+    }
+    precheck_job_t job = {.stop = true};
+    xQueueOverwrite(job_queue, &job);
+}
+
+void prov_precheck_on_credentials(const uint8_t *ssid, const uint8_t *password)
+{
+    precheck_job_t job = {.credentials = true, .queued_us = esp_timer_get_time()};
+    job.ssid_len = (uint8_t)strnlen((const char *)ssid, PROV_PRECHECK_SSID_MAX);
+    job.password_len = (uint8_t)strnlen((const char *)password, PROV_PRECHECK_PASSWORD_MAX);
+    memcpy(job.ssid, ssid, job.ssid_len);
+    if (queue_job(&job) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Pre-check task not running, credentials not checked");
+    }
+}
+
+bool prov_precheck_rejected(void)
+{
+    if (cache_mutex == NULL)
+    {
+        return false;
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    prov_precheck_reason_t reason = credentials_reason;
+    xSemaphoreGive(cache_mutex);
+
+    // Sin probe no se puede decidir, y con OK el intento de asociacion sigue su curso normal
+    return reason != PROV_PRECHECK_OK && reason != PROV_PRECHECK_SCAN_BUSY && reason != PROV_PRECHECK_INVALID_REQUEST &&
+           reason != PROV_PRECHECK_REASON_COUNT;
+}
+
+esp_err_t prov_precheck_handler(uint32_t session_id, const uint8_t *inbuf, ssize_t inlen,
+                                uint8_t **outbuf, ssize_t *outlen, void *priv_data)
+{
+    char *response = malloc(PROV_PRECHECK_RESPONSE_MAX);
+    if (response == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Los escaneos corren en la tarea del pre-check, la del transporte solo encola el pedido y responde pending
+    // Un pedido vacio o con el largo del SSID en 0 consulta el ultimo resultado
+    size_t ssid_len = (inbuf != NULL && inlen > 0) ? inbuf[0] : 0;
+    int len;
+    if (ssid_len == 0 && inlen <= 1)
+    {
+        len = format_result(response, PROV_PRECHECK_RESPONSE_MAX);
+    }
+    else if (ssid_len >= 1 && ssid_len <= PROV_PRECHECK_SSID_MAX && (size_t)inlen == ssid_len + 2 &&
+             inbuf[1 + ssid_len] <= PROV_PRECHECK_PASSWORD_MAX)
+    {
+        // El pedido trae solo el largo de la contrasena, la contrasena viaja una sola vez con las credenciales
+        precheck_job_t job = {.queued_us = esp_timer_get_time()};
+        memcpy(job.ssid, &inbuf[1], ssid_len);
+        job.ssid_len = (uint8_t)ssid_len;
+        job.password_len = inbuf[1 + ssid_len];
+        if (queue_job(&job) == ESP_OK)
+        {
+            len = snprintf(response, PROV_PRECHECK_RESPONSE_MAX, "{\"status\":\"pending\"}");
+        }
+        else
+        {
+            len = snprintf(response, PROV_PRECHECK_RESPONSE_MAX, "{\"status\":\"fail\",\"reason\":\"%s\"}",
+                           prov_precheck_reason_to_name(PROV_PRECHECK_SCAN_BUSY));
+        }
+    }
+    else
+    {
+        len = snprintf(response, PROV_PRECHECK_RESPONSE_MAX, "{\"status\":\"fail\",\"reason\":\"%s\"}",
+                       prov_precheck_reason_to_name(PROV_PRECHECK_INVALID_REQUEST));
+    }
+
+    *outbuf = (uint8_t *)response;
+    *outlen = len;
+    return ESP_OK;
+}
+
+const char *prov_precheck_reason_to_name(prov_precheck_reason_t reason)
+{
+    return (reason < PROV_PRECHECK_REASON_COUNT) ? reason_names[reason] : "unknown";
+}
+
+//=====[Implementations of private functions]==================================
+
+static void precheck_task(void *arg)
+{
+    precheck_job_t job;
+    while (true)
+    {
+        xQueueReceive(job_queue, &job, portMAX_DELAY);
+        if (job.stop)
+        {
+            break;
+        }
+
+        // Con las credenciales recibidas la estacion ya se esta asociando y no se puede escanear:
+        // el veredicto sale de la cache y el primer intento de asociacion hace de probe
+        precheck_result_t result = {.reason = PROV_PRECHECK_INVALID_REQUEST};
+        if (job.ssid_len >= 1)
+        {
+            run_precheck((const uint8_t *)job.ssid, job.ssid_len, job.password_len, !job.credentials, &result);
+        }
+        uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - job.queued_us) / 1000);
+
+        xSemaphoreTake(cache_mutex, portMAX_DELAY);
+        last_result = result;
+        last_ms = elapsed_ms;
+        result_credentials = job.credentials;
+        result_valid = true;
+        result_pending = (uxQueueMessagesWaiting(job_queue) > 0);
+        if (job.credentials)
+        {
+            credentials_reason = result.reason;
+        }
+        xSemaphoreGive(cache_mutex);
+        ESP_LOGI(TAG, "Pre-check for \"%s\"%s: %s in %u ms", job.ssid, job.credentials ? " (received credentials)" : "",
+                 prov_precheck_reason_to_name(result.reason), (unsigned)elapsed_ms);
+    }
+
+    vQueueDelete(job_queue);
+    job_queue = NULL;
+    precheck_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+static esp_err_t queue_job(const precheck_job_t *job)
+{
+    if (precheck_task_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    result_pending = true;
+    if (job->credentials)
+    {
+        credentials_reason = PROV_PRECHECK_REASON_COUNT;
+    }
+    xSemaphoreGive(cache_mutex);
+
+    // Si un pedido del endpoint reemplaza al de las credenciales, estas siguen el camino normal de los reintentos
+    xQueueOverwrite(job_queue, job);
+    return ESP_OK;
+}
+
+static int format_result(char *response, size_t max)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    bool pending = result_pending;
+    bool valid = result_valid;
+    precheck_result_t result = last_result;
+    uint32_t elapsed_ms = last_ms;
+    const char *stage = result_credentials ? "credentials" : "request";
+    xSemaphoreGive(cache_mutex);
+
+    if (pending || !valid)
+    {
+        return snprintf(response, max, "{\"status\":\"%s\"}", pending ? "pending" : "none");
+    }
+    if (result.found)
+    {
+        return snprintf(response, max,
+                        "{\"status\":\"%s\",\"reason\":\"%s\",\"stage\":\"%s\",\"channel\":%u,\"rssi\":%d,\"auth\":\"%s\",\"ms\":%u}",
+                        (result.reason == PROV_PRECHECK_OK) ? "ok" : "fail", prov_precheck_reason_to_name(result.reason),
+                        stage, (unsigned)result.ap.primary, (int)result.ap.rssi, auth_to_name(result.ap.authmode),
+                        (unsigned)elapsed_ms);
+    }
+    return snprintf(response, max, "{\"status\":\"fail\",\"reason\":\"%s\",\"stage\":\"%s\",\"ms\":%u}",
+                    prov_precheck_reason_to_name(result.reason), stage, (unsigned)elapsed_ms);
+}
+
+static void run_precheck(const uint8_t *ssid, size_t ssid_len, size_t password_len, bool probe_allowed,
+                         precheck_result_t *result)
+{
+    wifi_ap_record_t cached;
+    bool case_mismatch = false;
+    bool in_cache = cache_find(ssid, ssid_len, &cached, &case_mismatch);
+
+    // Si el AP esta en la cache se prueba solo su canal, sino todos los canales con el SSID como filtro
+    esp_err_t err = ESP_ERR_WIFI_STATE;
+    if (probe_allowed)
+    {
+        err = probe(ssid, in_cache ? cached.primary : 0, &result->ap, &result->found);
+        if (err == ESP_OK && !result->found && in_cache)
+        {
+            // El AP puede haber cambiado de canal desde el escaneo de la cache
+            err = probe(ssid, 0, &result->ap, &result->found);
+        }
+    }
+    if (err != ESP_OK)
+    {
+        // Mientras el manager escanea o la estacion se conecta no se puede hacer el probe, queda la cache
+        // Para las credenciales recibidas alcanza con la cache completa, el intento de asociacion lo confirma
+        if (!in_cache && (probe_allowed || !cache_valid))
+        {
+            result->reason = PROV_PRECHECK_SCAN_BUSY;
+            return;
+        }
+        if (!in_cache)
+        {
+            result->reason = case_mismatch ? PROV_PRECHECK_SSID_CASE_MISMATCH : PROV_PRECHECK_SSID_NOT_FOUND;
+            return;
+        }
+        result->ap = cached;
+        result->found = true;
+    }
+
+    if (!result->found)
+    {
+        result->reason = case_mismatch ? PROV_PRECHECK_SSID_CASE_MISMATCH : PROV_PRECHECK_SSID_NOT_FOUND;
+        return;
+    }
+    result->reason = check_auth(result->ap.authmode, password_len);
+}
+
+static bool cache_find(const uint8_t *ssid, size_t ssid_len, wifi_ap_record_t *ap, bool *case_mismatch)
+{
+    bool found = false;
+    *case_mismatch = false;
+    if (cache_mutex == NULL)
+    {
+        return false;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (uint16_t i = 0; i < cache_count && !found; i++)
+    {
+        const char *cached_ssid = (const char *)cache[i].ssid;
+        if (strlen(cached_ssid) != ssid_len)
+        {
+            continue;
+        }
+        if (memcmp(cached_ssid, ssid, ssid_len) == 0)
+        {
+            *ap = cache[i];
+            found = true;
+        }
+        else if (strncasecmp(cached_ssid, (const char *)ssid, ssid_len) == 0)
+        {
+            *case_mismatch = true;
+        }
+    }
+    xSemaphoreGive(cache_mutex);
+    return found;
+}
+
+static esp_err_t probe(const uint8_t *ssid, uint8_t channel, wifi_ap_record_t *ap, bool *found)
+{
+    // En APSTA el AP comparte la radio y cambiar de canal deja sin servicio al telefono conectado al SoftAP,
+    // solo se prueba el canal del AP. Si el AP buscado esta en otro canal queda el resultado de la cache
+    wifi_mode_t mode;
+    uint8_t home_channel;
+    wifi_second_chan_t second;
+    if (esp_wifi_get_mode(&mode) == ESP_OK && mode == WIFI_MODE_APSTA &&
+        esp_wifi_get_channel(&home_channel, &second) == ESP_OK)
+    {
+        if (channel != 0 && channel != home_channel)
+        {
+            *found = false;
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        channel = home_channel;
+    }
+
+    // Escaneo activo con el SSID en el probe request, asi tambien responden los AP ocultos
+    wifi_scan_config_t config = {
+        .ssid = (uint8_t *)ssid,
+        .channel = channel,
+        .show_hidden = true,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active.min = 0,
+        .scan_time.active.max = CONFIG_PROV_PRECHECK_PROBE_MS,
+    };
+    *found = false;
+    esp_err_t err = esp_wifi_scan_start(&config, true);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    wifi_ap_record_t records[PROV_PRECHECK_PROBE_RECORDS];
+    uint16_t count = PROV_PRECHECK_PROBE_RECORDS;
+    err = esp_wifi_scan_get_ap_records(&count, records);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (!*found || records[i].rssi > ap->rssi)
+        {
+            *ap = records[i];
+            *found = true;
+        }
+    }
+    return ESP_OK;
+}
+
+static prov_precheck_reason_t check_auth(wifi_auth_mode_t authmode, size_t password_len)
+{
+    switch (authmode)
+    {
+    case WIFI_AUTH_OPEN:
+        return PROV_PRECHECK_OK;
+    case WIFI_AUTH_WEP:
+        // Claves de 40 o 104 bits en ASCII o en hexadecimal
+        if (password_len == 0)
+        {
+            return PROV_PRECHECK_PASSWORD_REQUIRED;
+        }
+        return (password_len == 5 || password_len == 13 || password_len == 10 || password_len == 26) ? PROV_PRECHECK_OK : PROV_PRECHECK_PASSWORD_LENGTH;
+    case WIFI_AUTH_WPA_PSK:
+    case WIFI_AUTH_WPA2_PSK:
+    case WIFI_AUTH_WPA_WPA2_PSK:
+    case WIFI_AUTH_WPA2_WPA3_PSK:
+        // Passphrase de 8 a 63 caracteres o PSK de 64 digitos hexadecimales
+        if (password_len == 0)
+        {
+            return PROV_PRECHECK_PASSWORD_REQUIRED;
+        }
+        return (password_len >= 8 && password_len <= 64) ? PROV_PRECHECK_OK : PROV_PRECHECK_PASSWORD_LENGTH;
+    case WIFI_AUTH_WPA3_PSK:
+#if CONFIG_ESP_WIFI_ENABLE_WPA3_SAE
+        return (password_len == 0) ? PROV_PRECHECK_PASSWORD_REQUIRED : PROV_PRECHECK_OK;
+#else
+        return PROV_PRECHECK_AUTH_UNSUPPORTED;
+#endif
+    case WIFI_AUTH_OWE:
+#if CONFIG_ESP_WIFI_ENABLE_WPA3_OWE_STA
+        return PROV_PRECHECK_OK;
+#else
+        return PROV_PRECHECK_AUTH_UNSUPPORTED;
+#endif
+    default:
+        // Enterprise y WAPI necesitan mas que una contrasena
+        return PROV_PRECHECK_AUTH_UNSUPPORTED;
+    }
+}
+
+static const char *auth_to_name(wifi_auth_mode_t authmode)
+{
+    switch (authmode)
+    {
+    case WIFI_AUTH_OPEN:
+        return "open";
+    case WIFI_AUTH_WEP:
+        return "wep";
+    case WIFI_AUTH_WPA_PSK:
+        return "wpa_psk";
+    case WIFI_AUTH_WPA2_PSK:
+        return "wpa2_psk";
+    case WIFI_AUTH_WPA_WPA2_PSK:
+        return "wpa_wpa2_psk";
+    case WIFI_AUTH_WPA2_WPA3_PSK:
+        return "wpa2_wpa3_psk";
+    case WIFI_AUTH_WPA3_PSK:
+        return "wpa3_psk";
+    case WIFI_AUTH_OWE:
+        return "owe";
+    case WIFI_AUTH_WPA2_ENTERPRISE:
+        return "wpa2_enterprise";
+    default:
+        return "other";
+    }
+}
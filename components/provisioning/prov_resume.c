@@ -0,0 +1,563 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "protocomm.h"
+#include "protocomm_security.h"
+#include "protocomm_security2.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "prov_resume.h"
+
+//=====[Declaration of private defines]========================================
+
+#define PROV_RESUME_SESSION_ENDPOINT "prov-session"
+#define PROV_RESUME_RESPONSE_MAX 128
+#define PROV_RESUME_WINDOW_US (CONFIG_PROV_RESUME_WINDOW_S * 1000000LL)
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum
+{
+    SLOT_FREE,
+    SLOT_HANDSHAKE,
+    SLOT_ACTIVE,
+    SLOT_RESUMING,
+    SLOT_PARKED,
+} slot_state_t;
+
+// Cada sesion tiene su propia instancia de protocomm_security2, que solo maneja una sesion a la vez
+typedef struct
+{
+    slot_state_t state;
+    protocomm_security_handle_t inner;
+    uint32_t inner_id;
+    uint32_t session_id;
+    bool token_issued;
+    uint8_t client_id[PROV_RESUME_CLIENT_ID_MAX];
+    uint8_t client_id_len;
+    uint8_t token[PROV_RESUME_TOKEN_LEN];
+    int64_t handshake_start_us;
+    int64_t handshake_end_us;
+    uint32_t handshake_ms;
+    int64_t last_used_us;
+} slot_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "prov-resume";
+
+static const char *progress_names[] = {
+    "session",
+    "credentials_received",
+    "credentials_failed",
+    "connected",
+};
+
+//=====[Declaration and initialization of private global variables]============
+
+// Protege las sesiones y las estadisticas, los transportes llaman desde la tarea del BLE y la del servidor HTTP
+static SemaphoreHandle_t slots_mutex = NULL;
+static slot_t slots[CONFIG_PROV_RESUME_CACHE_SIZE];
+static prov_resume_stats_t resume_stats;
+static volatile prov_resume_progress_t progress = PROV_RESUME_PROGRESS_SESSION;
+
+static protocomm_t *resume_pc = NULL;
+static esp_err_t (*inner_prov_start)(protocomm_t *pc, void *config) = NULL;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static esp_err_t resume_prov_start(protocomm_t *pc, void *config);
+
+static esp_err_t resume_init(protocomm_security_handle_t *handle);
+
+static esp_err_t resume_cleanup(protocomm_security_handle_t handle);
+
+static esp_err_t resume_new_session(protocomm_security_handle_t handle, uint32_t session_id);
+
+static esp_err_t resume_close_session(protocomm_security_handle_t handle, uint32_t session_id);
+
+static esp_err_t resume_req_handler(protocomm_security_handle_t handle, const void *sec_params, uint32_t session_id,
+                                    const uint8_t *inbuf, ssize_t inlen, uint8_t **outbuf, ssize_t *outlen,
+                                    void *priv_data);
+
+static esp_err_t resume_encrypt(protocomm_security_handle_t handle, uint32_t session_id, const uint8_t *inbuf,
+                                ssize_t inlen, uint8_t **outbuf, ssize_t *outlen);
+
+static esp_err_t resume_decrypt(protocomm_security_handle_t handle, uint32_t session_id, const uint8_t *inbuf,
+                                ssize_t inlen, uint8_t **outbuf, ssize_t *outlen);
+
+static esp_err_t try_resume(uint32_t session_id, const uint8_t *inbuf, ssize_t inlen, uint8_t **outbuf, ssize_t *outlen);
+
+static bool is_resume_request(const uint8_t *data, ssize_t len);
+
+static slot_t *find_bound(uint32_t session_id);
+
+static slot_t *alloc_slot(void);
+
+static void close_slot(slot_t *slot);
+
+static void expire_parked(void);
+
+static void issue_token(slot_t *slot);
+
+static bool equal_ct(const uint8_t *a, const uint8_t *b, size_t len);
+
+//=====[Declaration and initialization of public global variables]=============
+
+// Delega todo en protocomm_security2, el handshake SRP6a y el cifrado no cambian
+static const protocomm_security_t resume_security = {
+    .ver = 2,
+    .init = resume_init,
+    .cleanup = resume_cleanup,
+    .new_transport_session = resume_new_session,
+    .close_transport_session = resume_close_session,
+    .security_req_handler = resume_req_handler,
+    .encrypt = resume_encrypt,
+    .decrypt = resume_decrypt,
+};
+
+//=====[Implementations of public functions]===================================
+
+void prov_resume_wrap_scheme(wifi_prov_scheme_t *scheme)
+{
+    inner_prov_start = scheme->prov_start;
+    scheme->prov_start = resume_prov_start;
+}
+
+esp_err_t prov_resume_install(const void *sec_params)
+{
+    if (resume_pc == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (slots_mutex == NULL)
+    {
+        slots_mutex = xSemaphoreCreateMutex();
+        if (slots_mutex == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    progress = PROV_RESUME_PROGRESS_SESSION;
+
+    // El manager ya registro protocomm_security2 en prov-session, se reemplaza con los mismos parametros
+    // Si un cliente se conecto en el medio, su sesion se crea al llegar el primer paso del handshake
+    esp_err_t err = protocomm_unset_security(resume_pc, PROV_RESUME_SESSION_ENDPOINT);
+    if (err == ESP_OK)
+    {
+        err = protocomm_set_security(resume_pc, PROV_RESUME_SESSION_ENDPOINT, &resume_security, sec_params);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) installing session resumption", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Sessions can be resumed up to %d s after a disconnect (%d slots)", CONFIG_PROV_RESUME_WINDOW_S,
+             CONFIG_PROV_RESUME_CACHE_SIZE);
+    return ESP_OK;
+}
+
+void prov_resume_on_prov_event(int32_t event_id)
+{
+    switch (event_id)
+    {
+    case WIFI_PROV_CRED_RECV:
+        progress = PROV_RESUME_PROGRESS_CREDENTIALS_RECEIVED;
+        break;
+    case WIFI_PROV_CRED_FAIL:
+        progress = PROV_RESUME_PROGRESS_CREDENTIALS_FAILED;
+        break;
+    case WIFI_PROV_CRED_SUCCESS:
+        progress = PROV_RESUME_PROGRESS_CONNECTED;
+        break;
+    default:
+        break;
+    }
+}
+
+esp_err_t prov_resume_handler(uint32_t session_id, const uint8_t *inbuf, ssize_t inlen,
+                              uint8_t **outbuf, ssize_t *outlen, void *priv_data)
+{
+    const char *status = "invalid_request";
+    uint8_t token[PROV_RESUME_TOKEN_LEN];
+
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    slot_t *slot = find_bound(session_id);
+    size_t id_len = (inbuf != NULL && inlen >= 2) ? inbuf[1] : 0;
+    bool valid = (slot != NULL && id_len >= 1 && id_len <= PROV_RESUME_CLIENT_ID_MAX);
+
+    if (valid && inbuf[0] == PROV_RESUME_OP_ISSUE && slot->state == SLOT_ACTIVE && (size_t)inlen == 2 + id_len)
+    {
+        // Cada pedido cambia el token, el cliente se queda con el ultimo
+        memcpy(slot->client_id, &inbuf[2], id_len);
+        slot->client_id_len = (uint8_t)id_len;
+        issue_token(slot);
+        memcpy(token, slot->token, sizeof(token));
+        status = "ok";
+    }
+    else if (slot != NULL && slot->state == SLOT_RESUMING)
+    {
+        // decrypt ya verifico que el cliente tiene la clave de la sesion, aca se compara el id y el token
+        bool match = (valid && inbuf[0] == PROV_RESUME_OP_RESUME && (size_t)inlen == 2 + id_len + PROV_RESUME_TOKEN_LEN &&
+                      id_len == slot->client_id_len && equal_ct(&inbuf[2], slot->client_id, id_len) &&
+                      equal_ct(&inbuf[2 + id_len], slot->token, PROV_RESUME_TOKEN_LEN));
+        if (!match)
+        {
+            // El token es de un solo uso, un pedido repetido o de otro cliente no se responde
+            slot->state = SLOT_PARKED;
+            resume_stats.rejected++;
+            xSemaphoreGive(slots_mutex);
+            ESP_LOGW(TAG, "Rejected resume request on session %" PRIu32, session_id);
+            return ESP_FAIL;
+        }
+        slot->state = SLOT_ACTIVE;
+        issue_token(slot);
+        memcpy(token, slot->token, sizeof(token));
+        resume_stats.hits++;
+        resume_stats.saved_ms_total += slot->handshake_ms;
+        status = "ok";
+        ESP_LOGI(TAG, "Session %" PRIu32 " resumed, %" PRIu32 " ms of handshake saved", session_id, slot->handshake_ms);
+    }
+    xSemaphoreGive(slots_mutex);
+
+    char *response = malloc(PROV_RESUME_RESPONSE_MAX);
+    if (response == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    int len;
+    if (strcmp(status, "ok") == 0)
+    {
+        char token_hex[2 * PROV_RESUME_TOKEN_LEN + 1];
+        for (int i = 0; i < PROV_RESUME_TOKEN_LEN; i++)
+        {
+            snprintf(&token_hex[2 * i], 3, "%02x", token[i]);
+        }
+        len = snprintf(response, PROV_RESUME_RESPONSE_MAX, "{\"status\":\"ok\",\"token\":\"%s\",\"window_s\":%d,\"progress\":\"%s\"}",
+                       token_hex, CONFIG_PROV_RESUME_WINDOW_S, prov_resume_progress_to_name(progress));
+    }
+    else
+    {
+        len = snprintf(response, PROV_RESUME_RESPONSE_MAX, "{\"status\":\"%s\"}", status);
+    }
+    *outbuf = (uint8_t *)response;
+    *outlen = len;
+    return ESP_OK;
+}
+
+void prov_resume_get_stats(prov_resume_stats_t *stats)
+{
+    // Si el dispositivo ya tenia credenciales el provisioning no arranco y no hay nada que contar
+    if (slots_mutex == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    *stats = resume_stats;
+    xSemaphoreGive(slots_mutex);
+}
+
+const char *prov_resume_progress_to_name(prov_resume_progress_t progress)
+{
+    return (progress < PROV_RESUME_PROGRESS_COUNT) ? progress_names[progress] : "unknown";
+}
+
+//=====[Implementations of private functions]==================================
+
+static esp_err_t resume_prov_start(protocomm_t *pc, void *config)
+{
+    resume_pc = pc;
+    return inner_prov_start(pc, config);
+}
+
+static esp_err_t resume_init(protocomm_security_handle_t *handle)
+{
+    // Las instancias de protocomm_security2 se crean a medida que se usan los slots
+    memset(slots, 0, sizeof(slots));
+    *handle = slots;
+    return ESP_OK;
+}
+
+static esp_err_t resume_cleanup(protocomm_security_handle_t handle)
+{
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_PROV_RESUME_CACHE_SIZE; i++)
+    {
+        close_slot(&slots[i]);
+        if (slots[i].inner != NULL)
+        {
+            protocomm_security2.cleanup(slots[i].inner);
+            slots[i].inner = NULL;
+        }
+    }
+    resume_pc = NULL;
+    xSemaphoreGive(slots_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t resume_new_session(protocomm_security_handle_t handle, uint32_t session_id)
+{
+    // La sesion interna se crea con el primer paso del handshake, asi una reconexion no desaloja a la que va a retomar
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    slot_t *slot = find_bound(session_id);
+    if (slot != NULL)
+    {
+        close_slot(slot);
+    }
+    xSemaphoreGive(slots_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t resume_close_session(protocomm_security_handle_t handle, uint32_t session_id)
+{
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    slot_t *slot = find_bound(session_id);
+    if (slot != NULL && slot->state == SLOT_ACTIVE && slot->token_issued)
+    {
+        // La sesion interna sigue abierta con su clave, sin transporte hasta que el cliente la retome
+        slot->state = SLOT_PARKED;
+        slot->last_used_us = esp_timer_get_time();
+        ESP_LOGI(TAG, "Session %" PRIu32 " parked for %d s", session_id, CONFIG_PROV_RESUME_WINDOW_S);
+    }
+    else if (slot != NULL)
+    {
+        close_slot(slot);
+    }
+    xSemaphoreGive(slots_mutex);
+    return ESP_OK;
+}
+
+static esp_err_t resume_req_handler(protocomm_security_handle_t handle, const void *sec_params, uint32_t session_id,
+                                    const uint8_t *inbuf, ssize_t inlen, uint8_t **outbuf, ssize_t *outlen,
+                                    void *priv_data)
+{
+    // El mutex solo reserva y publica el slot, el calculo del SRP6a se hace sin el para no frenar el cifrado de la
+    // sesion del otro transporte. Un slot en HANDSHAKE o ACTIVE no se desaloja y solo lo usa la tarea de su transporte
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    expire_parked();
+    slot_t *slot = find_bound(session_id);
+    bool created = (slot == NULL);
+    if (created)
+    {
+        slot = alloc_slot();
+        if (slot == NULL)
+        {
+            xSemaphoreGive(slots_mutex);
+            ESP_LOGW(TAG, "No free slot for session %" PRIu32 ", all sessions are in use", session_id);
+            return ESP_ERR_NO_MEM;
+        }
+        slot->state = SLOT_HANDSHAKE;
+        slot->inner_id = session_id;
+        slot->session_id = session_id;
+        slot->handshake_start_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(slots_mutex);
+
+    esp_err_t err = ESP_OK;
+    if (created && slot->inner == NULL)
+    {
+        err = protocomm_security2.init(&slot->inner);
+    }
+    if (created && err == ESP_OK)
+    {
+        err = protocomm_security2.new_transport_session(slot->inner, session_id);
+    }
+    bool ready = (err == ESP_OK);
+    if (ready)
+    {
+        err = protocomm_security2.security_req_handler(slot->inner, sec_params, slot->inner_id, inbuf, inlen,
+                                                       outbuf, outlen, priv_data);
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    if (ready)
+    {
+        slot->handshake_end_us = now_us;
+        slot->last_used_us = now_us;
+    }
+    else
+    {
+        // Sin sesion interna no hay nada que cerrar, la instancia queda para el proximo uso del slot
+        slot->state = SLOT_FREE;
+    }
+    xSemaphoreGive(slots_mutex);
+    return err;
+}
+
+static esp_err_t resume_encrypt(protocomm_security_handle_t handle, uint32_t session_id, const uint8_t *inbuf,
+                                ssize_t inlen, uint8_t **outbuf, ssize_t *outlen)
+{
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    slot_t *slot = find_bound(session_id);
+    if (slot != NULL && slot->state != SLOT_RESUMING)
+    {
+        err = protocomm_security2.encrypt(slot->inner, slot->inner_id, inbuf, inlen, outbuf, outlen);
+        slot->last_used_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(slots_mutex);
+    return err;
+}
+
+static esp_err_t resume_decrypt(protocomm_security_handle_t handle, uint32_t session_id, const uint8_t *inbuf,
+                                ssize_t inlen, uint8_t **outbuf, ssize_t *outlen)
+{
+    xSemaphoreTake(slots_mutex, portMAX_DELAY);
+    expire_parked();
+    slot_t *slot = find_bound(session_id);
+    if (slot == NULL)
+    {
+        esp_err_t err = try_resume(session_id, inbuf, inlen, outbuf, outlen);
+        xSemaphoreGive(slots_mutex);
+        return err;
+    }
+    if (slot->state == SLOT_RESUMING)
+    {
+        // Una sesion que se esta retomando solo puede llamar a prov-resume
+        slot->state = SLOT_PARKED;
+        xSemaphoreGive(slots_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = protocomm_security2.decrypt(slot->inner, slot->inner_id, inbuf, inlen, outbuf, outlen);
+    slot->last_used_us = esp_timer_get_time();
+    if (err == ESP_OK && slot->state == SLOT_HANDSHAKE)
+    {
+        // El primer pedido cifrado marca el fin del handshake
+        slot->state = SLOT_ACTIVE;
+        slot->handshake_ms = (uint32_t)((slot->handshake_end_us - slot->handshake_start_us) / 1000);
+        resume_stats.handshakes++;
+        resume_stats.handshake_ms_total += slot->handshake_ms;
+    }
+    xSemaphoreGive(slots_mutex);
+    return err;
+}
+
+static esp_err_t try_resume(uint32_t session_id, const uint8_t *inbuf, ssize_t inlen, uint8_t **outbuf, ssize_t *outlen)
+{
+    // Un pedido cifrado sin sesion solo puede ser un RESUME cifrado con la clave de una sesion estacionada
+    resume_stats.attempts++;
+    for (int i = 0; i < CONFIG_PROV_RESUME_CACHE_SIZE; i++)
+    {
+        slot_t *slot = &slots[i];
+        if (slot->state != SLOT_PARKED)
+        {
+            continue;
+        }
+        // AES-GCM verifica el tag, con la clave de otra sesion falla sin tocar el estado
+        if (protocomm_security2.decrypt(slot->inner, slot->inner_id, inbuf, inlen, outbuf, outlen) != ESP_OK)
+        {
+            continue;
+        }
+        if (!is_resume_request(*outbuf, *outlen))
+        {
+            free(*outbuf);
+            *outbuf = NULL;
+            resume_stats.rejected++;
+            return ESP_ERR_INVALID_STATE;
+        }
+        slot->state = SLOT_RESUMING;
+        slot->session_id = session_id;
+        slot->last_used_us = esp_timer_get_time();
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "No resumable session for session %" PRIu32 ", the client has to do the handshake", session_id);
+    return ESP_ERR_INVALID_STATE;
+}
+
+static bool is_resume_request(const uint8_t *data, ssize_t len)
+{
+    return (len >= 2 && data[0] == PROV_RESUME_OP_RESUME && data[1] >= 1 && data[1] <= PROV_RESUME_CLIENT_ID_MAX &&
+            (size_t)len == 2u + data[1] + PROV_RESUME_TOKEN_LEN);
+}
+
+static slot_t *find_bound(uint32_t session_id)
+{
+    for (int i = 0; i < CONFIG_PROV_RESUME_CACHE_SIZE; i++)
+    {
+        if (slots[i].state != SLOT_FREE && slots[i].state != SLOT_PARKED && slots[i].session_id == session_id)
+        {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+static slot_t *alloc_slot(void)
+{
+    // Primero un slot libre y despues la sesion estacionada mas vieja. Las sesiones con transporte no se desalojan,
+    // si todas estan en uso el pedido falla
+    slot_t *oldest_parked = NULL;
+    for (int i = 0; i < CONFIG_PROV_RESUME_CACHE_SIZE; i++)
+    {
+        slot_t *slot = &slots[i];
+        if (slot->state == SLOT_FREE)
+        {
+            return slot;
+        }
+        if (slot->state == SLOT_PARKED && (oldest_parked == NULL || slot->last_used_us < oldest_parked->last_used_us))
+        {
+            oldest_parked = slot;
+        }
+    }
+    if (oldest_parked == NULL)
+    {
+        return NULL;
+    }
+    close_slot(oldest_parked);
+    resume_stats.evicted++;
+    return oldest_parked;
+}
+
+static void close_slot(slot_t *slot)
+{
+    if (slot->state != SLOT_FREE)
+    {
+        protocomm_security2.close_transport_session(slot->inner, slot->inner_id);
+    }
+    slot->state = SLOT_FREE;
+    slot->token_issued = false;
+    slot->client_id_len = 0;
+    memset(slot->token, 0, sizeof(slot->token));
+}
+
+static void expire_parked(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    for (int i = 0; i < CONFIG_PROV_RESUME_CACHE_SIZE; i++)
+    {
+        if (slots[i].state == SLOT_PARKED && now_us - slots[i].last_used_us > PROV_RESUME_WINDOW_US)
+        {
+            close_slot(&slots[i]);
+            resume_stats.expired++;
+        }
+    }
+}
+
+static void issue_token(slot_t *slot)
+{
+    esp_fill_random(slot->token, sizeof(slot->token));
+    slot->token_issued = true;
+}
+
+static bool equal_ct(const uint8_t *a, const uint8_t *b, size_t len)
+{
+    // Tiempo constante para no filtrar cuantos bytes del token coinciden
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
@@ -0,0 +1,83 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "prov_sm.h"
+
+//=====[Implementations of public functions]===================================
+
+void prov_sm_init(prov_sm_t *sm)
+{
+    memset(sm, 0, sizeof(*sm));
+}
+
+prov_sm_event_t prov_sm_classify(prov_sm_base_t base, int32_t event_id)
+{
+    switch (base)
+    {
+    case PROV_SM_BASE_WIFI_PROV:
+        switch (event_id)
+        {
+        case PROV_SM_ID_WIFI_PROV_CRED_FAIL:
+            return PROV_SM_EVENT_CRED_FAIL;
+        case PROV_SM_ID_WIFI_PROV_CRED_SUCCESS:
+            return PROV_SM_EVENT_CRED_SUCCESS;
+        case PROV_SM_ID_WIFI_PROV_END:
+            return PROV_SM_EVENT_PROV_END;
+        default:
+            return PROV_SM_EVENT_NONE;
+        }
+    case PROV_SM_BASE_WIFI:
+        switch (event_id)
+        {
+        case PROV_SM_ID_WIFI_STA_START:
+            return PROV_SM_EVENT_STA_START;
+        case PROV_SM_ID_WIFI_STA_DISCONNECTED:
+            return PROV_SM_EVENT_STA_DISCONNECTED;
+        default:
+            return PROV_SM_EVENT_NONE;
+        }
+    case PROV_SM_BASE_IP:
+        return (event_id == PROV_SM_ID_IP_STA_GOT_IP) ? PROV_SM_EVENT_GOT_IP : PROV_SM_EVENT_NONE;
+    default:
+        return PROV_SM_EVENT_NONE;
+    }
+}
+
+uint32_t prov_sm_handle(prov_sm_t *sm, prov_sm_event_t event)
+{
+    switch (event)
+    {
+    case PROV_SM_EVENT_CRED_FAIL:
+        // Despues de varios intentos fallidos se descartan las credenciales y se vuelven a pedir
+        sm->retries++;
+        if (sm->retries >= PROV_SM_MAX_RETRIES)
+        {
+            sm->retries = 0;
+            sm->credential_resets++;
+            return PROV_SM_ACTION_RESET_CREDENTIALS;
+        }
+        return 0;
+    case PROV_SM_EVENT_CRED_SUCCESS:
+        sm->retries = 0;
+        return 0;
+    case PROV_SM_EVENT_PROV_END:
+        return PROV_SM_ACTION_DEINIT;
+    case PROV_SM_EVENT_STA_START:
+    case PROV_SM_EVENT_STA_DISCONNECTED:
+        sm->connect_attempts++;
+        return PROV_SM_ACTION_CONNECT;
+    case PROV_SM_EVENT_GOT_IP:
+        sm->connections++;
+        return PROV_SM_ACTION_SIGNAL_CONNECTED;
+    default:
+        return 0;
+    }
+}
+
+uint32_t prov_sm_reject_credentials(prov_sm_t *sm)
+{
+    sm->retries = 0;
+    sm->credential_resets++;
+    return PROV_SM_ACTION_RESET_CREDENTIALS;
+}
@@ -0,0 +1,768 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "wifi_provisioning/manager.h"
+#if CONFIG_PROV_BLE
+#include "wifi_provisioning/scheme_ble.h"
+#endif
+#if CONFIG_PROV_SOFTAP
+#include "wifi_provisioning/scheme_softap.h"
+#endif
+#if CONFIG_PROV_CREDENTIALS_SRP_RUNTIME
+#include "esp_srp.h"
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "qrcode.h"
+
+#include "provisioning.h"
+#include "prov_sm.h"
+#if CONFIG_PROV_TRANSPORT_DUAL
+#include "prov_dual.h"
+#endif
+#if CONFIG_PROV_PRECHECK
+#include "prov_precheck.h"
+#endif
+#if CONFIG_PROV_RESUME
+#include "prov_resume.h"
+#endif
+
+//=====[Declaration of private defines]========================================
+
+#define PROV_SEC2_NAMESPACE "prov_sec2"
+#define PROV_STATS_NAMESPACE "prov_stats"
+#define PROV_STATS_KEY "last"
+#define PROV_QR_VERSION "v1"
+#define QRCODE_BASE_URL "https://espressif.github.io/esp-jumpstart/qrcode.html"
+
+// Solo se compila el transporte elegido en el menuconfig, en modo dual el transporte se conoce al recibir las credenciales
+#if CONFIG_PROV_TRANSPORT_BLE
+#define PROV_TRANSPORT PROVISIONING_TRANSPORT_BLE
+#define PROV_SCHEME wifi_prov_scheme_ble
+#define PROV_SCHEME_EVENT_HANDLER WIFI_PROV_SCHEME_BLE_EVENT_HANDLER_FREE_BTDM
+#elif CONFIG_PROV_TRANSPORT_SOFTAP
+#define PROV_TRANSPORT PROVISIONING_TRANSPORT_SOFTAP
+#define PROV_SCHEME wifi_prov_scheme_softap
+#define PROV_SCHEME_EVENT_HANDLER WIFI_PROV_EVENT_HANDLER_NONE
+#else
+#define PROV_SCHEME prov_dual_scheme
+#define PROV_SCHEME_EVENT_HANDLER PROV_DUAL_EVENT_HANDLER
+#endif
+
+// Los ids que usa la maquina de estados portable tienen que coincidir con los del ESP-IDF
+_Static_assert(PROV_SM_ID_WIFI_PROV_CRED_FAIL == WIFI_PROV_CRED_FAIL, "WIFI_PROV_CRED_FAIL changed");
+_Static_assert(PROV_SM_ID_WIFI_PROV_CRED_SUCCESS == WIFI_PROV_CRED_SUCCESS, "WIFI_PROV_CRED_SUCCESS changed");
+_Static_assert(PROV_SM_ID_WIFI_PROV_END == WIFI_PROV_END, "WIFI_PROV_END changed");
+_Static_assert(PROV_SM_ID_WIFI_STA_START == WIFI_EVENT_STA_START, "WIFI_EVENT_STA_START changed");
+_Static_assert(PROV_SM_ID_WIFI_STA_DISCONNECTED == WIFI_EVENT_STA_DISCONNECTED, "WIFI_EVENT_STA_DISCONNECTED changed");
+_Static_assert(PROV_SM_ID_IP_STA_GOT_IP == IP_EVENT_STA_GOT_IP, "IP_EVENT_STA_GOT_IP changed");
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "provisioning";
+
+static const EventBits_t WIFI_CONNECTED_EVENT = BIT0;
+
+static const char *transport_names[] = {"ble", "softap"};
+
+#if CONFIG_PROV_SECURITY_2 && !CONFIG_PROV_CREDENTIALS_SRP_RUNTIME
+// Las siguientes constantes estan hardcodeadas pero no deberian estarlo para produccion
+// Corresponden al username y pop por defecto del menuconfig
+static const char sec2_salt[] = {
+    0x03, 0x6e, 0xe0, 0xc7, 0xbc, 0xb9, 0xed, 0xa8, 0x4c, 0x9e, 0xac, 0x97, 0xd9, 0x3d, 0xec, 0xf4};
+
+static const char sec2_verifier[] = {
+    0x7c, 0x7c, 0x85, 0x47, 0x65, 0x08, 0x94, 0x6d, 0xd6, 0x36, 0xaf, 0x37, 0xd7, 0xe8, 0x91, 0x43,
+    0x78, 0xcf, 0xfd, 0x61, 0x6c, 0x59, 0xd2, 0xf8, 0x39, 0x08, 0x12, 0x72, 0x38, 0xde, 0x9e, 0x24,
+    0xa4, 0x70, 0x26, 0x1c, 0xdf, 0xa9, 0x03, 0xc2, 0xb2, 0x70, 0xe7, 0xb1, 0x32, 0x24, 0xda, 0x11,
+    0x1d, 0x97, 0x18, 0xdc, 0x60, 0x72, 0x08, 0xcc, 0x9a, 0xc9, 0x0c, 0x48, 0x27, 0xe2, 0xae, 0x89,
+    0xaa, 0x16, 0x25, 0xb8, 0x04, 0xd2, 0x1a, 0x9b, 0x3a, 0x8f, 0x37, 0xf6, 0xe4, 0x3a, 0x71, 0x2e,
+    0xe1, 0x27, 0x86, 0x6e, 0xad, 0xce, 0x28, 0xff, 0x54, 0x46, 0x60, 0x1f, 0xb9, 0x96, 0x87, 0xdc,
+    0x57, 0x40, 0xa7, 0xd4, 0x6c, 0xc9, 0x77, 0x54, 0xdc, 0x16, 0x82, 0xf0, 0xed, 0x35, 0x6a, 0xc4,
+    0x70, 0xad, 0x3d, 0x90, 0xb5, 0x81, 0x94, 0x70, 0xd7, 0xbc, 0x65, 0xb2, 0xd5, 0x18, 0xe0, 0x2e,
+    0xc3, 0xa5, 0xf9, 0x68, 0xdd, 0x64, 0x7b, 0xb8, 0xb7, 0x3c, 0x9c, 0xfc, 0x00, 0xd8, 0x71, 0x7e,
+    0xb7, 0x9a, 0x7c, 0xb1, 0xb7, 0xc2, 0xc3, 0x18, 0x34, 0x29, 0x32, 0x43, 0x3e, 0x00, 0x99, 0xe9,
+    0x82, 0x94, 0xe3, 0xd8, 0x2a, 0xb0, 0x96, 0x29, 0xb7, 0xdf, 0x0e, 0x5f, 0x08, 0x33, 0x40, 0x76,
+    0x52, 0x91, 0x32, 0x00, 0x9f, 0x97, 0x2c, 0x89, 0x6c, 0x39, 0x1e, 0xc8, 0x28, 0x05, 0x44, 0x17,
+    0x3f, 0x68, 0x02, 0x8a, 0x9f, 0x44, 0x61, 0xd1, 0xf5, 0xa1, 0x7e, 0x5a, 0x70, 0xd2, 0xc7, 0x23,
+    0x81, 0xcb, 0x38, 0x68, 0xe4, 0x2c, 0x20, 0xbc, 0x40, 0x57, 0x76, 0x17, 0xbd, 0x08, 0xb8, 0x96,
+    0xbc, 0x26, 0xeb, 0x32, 0x46, 0x69, 0x35, 0x05, 0x8c, 0x15, 0x70, 0xd9, 0x1b, 0xe9, 0xbe, 0xcc,
+    0xa9, 0x38, 0xa6, 0x67, 0xf0, 0xad, 0x50, 0x13, 0x19, 0x72, 0x64, 0xbf, 0x52, 0xc2, 0x34, 0xe2,
+    0x1b, 0x11, 0x79, 0x74, 0x72, 0xbd, 0x34, 0x5b, 0xb1, 0xe2, 0xfd, 0x66, 0x73, 0xfe, 0x71, 0x64,
+    0x74, 0xd0, 0x4e, 0xbc, 0x51, 0x24, 0x19, 0x40, 0x87, 0x0e, 0x92, 0x40, 0xe6, 0x21, 0xe7, 0x2d,
+    0x4e, 0x37, 0x76, 0x2f, 0x2e, 0xe2, 0x68, 0xc7, 0x89, 0xe8, 0x32, 0x13, 0x42, 0x06, 0x84, 0x84,
+    0x53, 0x4a, 0xb3, 0x0c, 0x1b, 0x4c, 0x8d, 0x1c, 0x51, 0x97, 0x19, 0xab, 0xae, 0x77, 0xff, 0xdb,
+    0xec, 0xf0, 0x10, 0x95, 0x34, 0x33, 0x6b, 0xcb, 0x3e, 0x84, 0x0f, 0xb9, 0xd8, 0x5f, 0xb8, 0xa0,
+    0xb8, 0x55, 0x53, 0x3e, 0x70, 0xf7, 0x18, 0xf5, 0xce, 0x7b, 0x4e, 0xbf, 0x27, 0xce, 0xce, 0xa8,
+    0xb3, 0xbe, 0x40, 0xc5, 0xc5, 0x32, 0x29, 0x3e, 0x71, 0x64, 0x9e, 0xde, 0x8c, 0xf6, 0x75, 0xa1,
+    0xe6, 0xf6, 0x53, 0xc8, 0x31, 0xa8, 0x78, 0xde, 0x50, 0x40, 0xf7, 0x62, 0xde, 0x36, 0xb2, 0xba};
+#endif
+
+//=====[Declaration and initialization of private global variables]============
+
+static EventGroupHandle_t wifi_event_group;
+
+static prov_sm_t state_machine;
+
+// Se escriben en el loop por defecto y se leen al exportar las metricas
+static provisioning_stats_t prov_stats;
+static int64_t prov_start_us = 0;
+static bool credentials_received = false;
+
+#if !CONFIG_PROV_SECURITY_0
+static char *username = NULL;
+static char *pop = NULL;
+#endif
+
+#if CONFIG_PROV_SECURITY_1
+static wifi_prov_security1_params_t *sec1_params = NULL;
+#elif CONFIG_PROV_SECURITY_2
+static wifi_prov_security2_params_t sec2_params;
+#endif
+
+#if CONFIG_PROV_CREDENTIALS_SRP_RUNTIME
+static char *sec2_salt = NULL;
+static int sec2_salt_len = 16;
+
+static char *sec2_verifier = NULL;
+static int sec2_verifier_len = 0;
+#endif
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static esp_err_t start_provisioning(void);
+
+#if !CONFIG_PROV_SECURITY_0
+static esp_err_t load_credentials(void);
+#endif
+
+#if !CONFIG_PROV_SECURITY_0 && !CONFIG_PROV_CREDENTIALS_HARDCODED
+static esp_err_t nvs_read_str(nvs_handle_t handle, const char *key, char **value);
+#endif
+
+static void release_credentials(void);
+
+static void enable_roaming_caps(void);
+
+static void record_stats(esp_event_base_t event_base, int32_t event_id);
+
+static void load_stats(void);
+
+static void save_stats(void);
+
+static void get_device_service_name(char *service_name, size_t max);
+
+static void wifi_prov_print_qr(const char *name, const char *username, const char *pop, provisioning_transport_t transport);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t provisioning_start(void)
+{
+    wifi_event_group = xEventGroupCreate();
+    configASSERT(wifi_event_group != NULL);
+    prov_sm_init(&state_machine);
+    load_stats();
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        WIFI_PROV_EVENT,
+        ESP_EVENT_ANY_ID,
+        &event_handler,
+        NULL));
+#if CONFIG_PROV_BLE
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        PROTOCOMM_TRANSPORT_BLE_EVENT,
+        PROTOCOMM_TRANSPORT_BLE_CONNECTED,
+        &event_handler,
+        NULL));
+#endif
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        WIFI_EVENT,
+        ESP_EVENT_ANY_ID,
+        &event_handler,
+        NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        IP_EVENT,
+        IP_EVENT_STA_GOT_IP,
+        &event_handler,
+        NULL));
+#if CONFIG_PROV_LOG_EVENTS
+    // Los logs van en un handler aparte para que la aplicacion los pueda mover a su propio loop
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        WIFI_PROV_EVENT,
+        ESP_EVENT_ANY_ID,
+        &provisioning_log_event_handler,
+        NULL));
+#if CONFIG_PROV_BLE
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        PROTOCOMM_TRANSPORT_BLE_EVENT,
+        ESP_EVENT_ANY_ID,
+        &provisioning_log_event_handler,
+        NULL));
+#endif
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        PROTOCOMM_SECURITY_SESSION_EVENT,
+        ESP_EVENT_ANY_ID,
+        &provisioning_log_event_handler,
+        NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        WIFI_EVENT,
+        WIFI_EVENT_STA_DISCONNECTED,
+        &provisioning_log_event_handler,
+        NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(
+        IP_EVENT,
+        IP_EVENT_STA_GOT_IP,
+        &provisioning_log_event_handler,
+        NULL));
+#endif
+
+    // Inicializa la interfaz Wi-Fi con la configuracion por defecto
+    esp_netif_create_default_wifi_sta();
+#if CONFIG_PROV_SOFTAP
+    esp_netif_create_default_wifi_ap();
+#endif
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+
+    // Configura el provisioning manager
+    wifi_prov_mgr_config_t config = {
+        .scheme = PROV_SCHEME,
+        .scheme_event_handler = PROV_SCHEME_EVENT_HANDLER,
+    };
+#if CONFIG_PROV_RESUME
+    prov_resume_wrap_scheme(&config.scheme);
+#endif
+
+    // Inicializa el provisioning manager con la configuracion anterior
+    ESP_ERROR_CHECK(wifi_prov_mgr_init(config));
+    bool provisioned = false;
+
+    // Verifica si al dispositivo ya se le habia hecho el provisioning
+    ESP_ERROR_CHECK(wifi_prov_mgr_is_provisioned(&provisioned));
+
+    if (!provisioned)
+    {
+        return start_provisioning();
+    }
+
+    // Arranca la interfaz Wi-Fi en modo station
+    ESP_LOGI(TAG, "Already provisioned, starting Wi-Fi STA");
+    wifi_prov_mgr_deinit();
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    enable_roaming_caps();
+    ESP_ERROR_CHECK(esp_wifi_start());
+    return ESP_OK;
+}
+
+esp_err_t provisioning_wait_connected(TickType_t timeout)
+{
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_EVENT, pdTRUE, pdTRUE, timeout);
+    return (bits & WIFI_CONNECTED_EVENT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void provisioning_log_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // Eventos del provisioning manger
+    if (event_base == WIFI_PROV_EVENT)
+    {
+        switch (event_id)
+        {
+        case WIFI_PROV_START:
+            ESP_LOGI(TAG, "Provisioning started");
+            break;
+        case WIFI_PROV_CRED_RECV:
+        {
+            // La contrasena no se loguea, el log puede quedar en el monitor o en un dump del dispositivo
+            wifi_sta_config_t *wifi_sta_cfg = (wifi_sta_config_t *)event_data;
+            ESP_LOGI(TAG, "Received Wi-Fi credentials"
+                          "\n\tSSID     : %s",
+                     (const char *)wifi_sta_cfg->ssid);
+            break;
+        }
+        case WIFI_PROV_CRED_FAIL:
+        {
+            wifi_prov_sta_fail_reason_t *reason = (wifi_prov_sta_fail_reason_t *)event_data;
+            ESP_LOGE(TAG, "Provisioning failed!\n\tReason : %s"
+                          "\n\tPlease reset to factory and retry provisioning",
+                     (*reason == WIFI_PROV_STA_AUTH_ERROR) ? "Wi-Fi station authentication failed" : "Wi-Fi access-point not found");
+            break;
+        }
+        case WIFI_PROV_CRED_SUCCESS:
+            ESP_LOGI(TAG, "Provisioning successful");
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Eventos del Wi-Fi
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
+    {
+        ESP_LOGI(TAG, "Disconnected. Connecting to the AP again...");
+    }
+
+    // Evento al obtener direccion IP
+    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
+    {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        ESP_LOGI(TAG, "Connected with IP Address:" IPSTR " (%lld ms after boot)",
+                 IP2STR(&event->ip_info.ip), (long long)(esp_timer_get_time() / 1000));
+    }
+
+#if CONFIG_PROV_BLE
+    // Eventos BLE
+    else if (event_base == PROTOCOMM_TRANSPORT_BLE_EVENT)
+    {
+        switch (event_id)
+        {
+        case PROTOCOMM_TRANSPORT_BLE_CONNECTED:
+            ESP_LOGI(TAG, "BLE transport: Connected!");
+            break;
+        case PROTOCOMM_TRANSPORT_BLE_DISCONNECTED:
+            ESP_LOGI(TAG, "BLE transport: Disconnected!");
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+
+    // Eventos de la sesion con el dispositivo que hara el provisioning
+    else if (event_base == PROTOCOMM_SECURITY_SESSION_EVENT)
+    {
+        switch (event_id)
+        {
+        case PROTOCOMM_SECURITY_SESSION_SETUP_OK:
+            ESP_LOGI(TAG, "Secured session established!");
+            break;
+        case PROTOCOMM_SECURITY_SESSION_INVALID_SECURITY_PARAMS:
+            ESP_LOGE(TAG, "Received invalid security parameters for establishing secure session!");
+            break;
+        case PROTOCOMM_SECURITY_SESSION_CREDENTIALS_MISMATCH:
+            ESP_LOGE(TAG, "Received incorrect username and/or PoP for establishing secure session!");
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void provisioning_get_stats(provisioning_stats_t *stats)
+{
+    *stats = prov_stats;
+}
+
+const char *provisioning_transport_to_name(provisioning_transport_t transport)
+{
+    return (transport < PROVISIONING_TRANSPORT_COUNT) ? transport_names[transport] : "unknown";
+}
+
+//=====[Implementations of private functions]==================================
+
+static esp_err_t start_provisioning(void)
+{
+    ESP_LOGI(TAG, "Starting provisioning");
+
+    // Obtiene el device name
+    char service_name[12];
+    get_device_service_name(service_name, sizeof(service_name));
+
+    // El nivel de seguridad (0, 1, o 2) para la sesion que se establece con el dispositivo que hara el provisioning se elige en el menuconfig
+#if CONFIG_PROV_SECURITY_0
+    wifi_prov_security_t security = WIFI_PROV_SECURITY_0;
+    const void *sec_params = NULL;
+#else
+    esp_err_t err = load_credentials();
+    if (err != ESP_OK)
+    {
+        wifi_prov_mgr_deinit();
+        return err;
+    }
+#endif
+
+#if CONFIG_PROV_SECURITY_1
+    wifi_prov_security_t security = WIFI_PROV_SECURITY_1;
+    sec1_params = pop;
+    const void *sec_params = sec1_params;
+#elif CONFIG_PROV_SECURITY_2
+    wifi_prov_security_t security = WIFI_PROV_SECURITY_2;
+#if CONFIG_PROV_CREDENTIALS_SRP_RUNTIME
+    // Genera el salt y el verifier en tiempo de ejecucion a partir del username y el pop
+    ESP_ERROR_CHECK(esp_srp_gen_salt_verifier(
+        (const char *)username,
+        (int)strlen(username),
+        (const char *)pop,
+        (int)strlen(pop),
+        &sec2_salt, sec2_salt_len,
+        &sec2_verifier,
+        &sec2_verifier_len));
+    sec2_params.salt = (const char *)sec2_salt;
+    sec2_params.salt_len = (uint16_t)sec2_salt_len;
+    sec2_params.verifier = (const char *)sec2_verifier;
+    sec2_params.verifier_len = (uint16_t)sec2_verifier_len;
+#else
+    ESP_LOGI(TAG, "Development mode: using hard coded salt and verifier");
+    sec2_params.salt = sec2_salt;
+    sec2_params.salt_len = sizeof(sec2_salt);
+    sec2_params.verifier = sec2_verifier;
+    sec2_params.verifier_len = sizeof(sec2_verifier);
+#endif
+    const void *sec_params = &sec2_params;
+#endif
+
+#if CONFIG_PROV_BLE
+    // Configura el UUID que proveera las caracteristicas en la capa GATT para el provisioning y que se incluira en los paquetes publicitarios BLE del dispositivo
+    uint8_t custom_service_uuid[] = {
+        0xb4, 0xdf, 0x5a, 0x1c, 0x3f, 0x6b, 0xf4, 0xbf, 0xea, 0x4a, 0x82, 0x03, 0x04, 0x90, 0x1a, 0x02};
+    ESP_ERROR_CHECK(wifi_prov_scheme_ble_set_service_uuid(custom_service_uuid));
+#endif
+
+#if CONFIG_PROV_PRECHECK
+    // Los endpoints propios se crean antes de arrancar y se registran despues
+    ESP_ERROR_CHECK(wifi_prov_mgr_endpoint_create(PROV_PRECHECK_ENDPOINT));
+#endif
+#if CONFIG_PROV_RESUME
+    ESP_ERROR_CHECK(wifi_prov_mgr_endpoint_create(PROV_RESUME_ENDPOINT));
+#endif
+
+    // Arranca el provisioning manager, los tiempos de las estadisticas se miden desde aca
+    memset(&prov_stats, 0, sizeof(prov_stats));
+    credentials_received = false;
+    prov_start_us = esp_timer_get_time();
+    ESP_ERROR_CHECK(wifi_prov_mgr_start_provisioning(security, sec_params, service_name, NULL));
+
+#if CONFIG_PROV_PRECHECK
+    ESP_ERROR_CHECK(wifi_prov_mgr_endpoint_register(PROV_PRECHECK_ENDPOINT, prov_precheck_handler, NULL));
+    ESP_ERROR_CHECK(prov_precheck_start());
+#endif
+#if CONFIG_PROV_RESUME
+    // El manager instala la seguridad 2 al arrancar, se reemplaza antes de que llegue el primer cliente
+    ESP_ERROR_CHECK(prov_resume_install(sec_params));
+    ESP_ERROR_CHECK(wifi_prov_mgr_endpoint_register(PROV_RESUME_ENDPOINT, prov_resume_handler, NULL));
+#endif
+
+    // Muestra un QR por cada transporte
+#if CONFIG_PROV_SECURITY_0
+    const char *qr_username = NULL;
+    const char *qr_pop = NULL;
+#elif CONFIG_PROV_SECURITY_1
+    const char *qr_username = NULL;
+    const char *qr_pop = pop;
+#else
+    const char *qr_username = username;
+    const char *qr_pop = pop;
+#endif
+#if CONFIG_PROV_BLE
+    wifi_prov_print_qr(service_name, qr_username, qr_pop, PROVISIONING_TRANSPORT_BLE);
+#endif
+#if CONFIG_PROV_SOFTAP
+    wifi_prov_print_qr(service_name, qr_username, qr_pop, PROVISIONING_TRANSPORT_SOFTAP);
+#endif
+    return ESP_OK;
+}
+
+#if !CONFIG_PROV_SECURITY_0
+static esp_err_t load_credentials(void)
+{
+#if CONFIG_PROV_CREDENTIALS_HARDCODED
+    // username y pop para generar el QR, estan hardcodeados en el menuconfig
+#if CONFIG_PROV_SECURITY_2
+    username = (char *)CONFIG_PROV_USERNAME;
+#endif
+    pop = (char *)CONFIG_PROV_POP;
+    return ESP_OK;
+#else
+    // Recupera username y pop del NVS
+    ESP_LOGI(TAG, "Opening Non-Volatile Storage (NVS) handle");
+    nvs_handle_t my_handle;
+    esp_err_t err = nvs_open(PROV_SEC2_NAMESPACE, NVS_READONLY, &my_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "The NVS handle successfully opened");
+    ESP_LOGI(TAG, "Reading values from NVS");
+
+    err = nvs_read_str(my_handle, "username", &username);
+    if (err == ESP_OK)
+    {
+        err = nvs_read_str(my_handle, "pwd", &pop);
+    }
+    nvs_close(my_handle);
+    if (err != ESP_OK)
+    {
+        release_credentials();
+        return err;
+    }
+    ESP_LOGI(TAG, "Reading values from NVS done - all OK");
+    return ESP_OK;
+#endif
+}
+#endif
+
+#if !CONFIG_PROV_SECURITY_0 && !CONFIG_PROV_CREDENTIALS_HARDCODED
+static esp_err_t nvs_read_str(nvs_handle_t handle, const char *key, char **value)
+{
+    size_t str_len = 0;
+    esp_err_t err = nvs_get_str(handle, key, NULL, &str_len);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) reading %s from NVS", esp_err_to_name(err), key);
+        return err;
+    }
+    *value = (char *)calloc(str_len, 1);
+    if (*value == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate memory for %s", key);
+        return ESP_ERR_NO_MEM;
+    }
+    return nvs_get_str(handle, key, *value, &str_len);
+}
+#endif
+
+static void release_credentials(void)
+{
+#if !CONFIG_PROV_SECURITY_0 && !CONFIG_PROV_CREDENTIALS_HARDCODED
+    free(username);
+    free(pop);
+#endif
+#if !CONFIG_PROV_SECURITY_0
+    username = NULL;
+    pop = NULL;
+#endif
+#if CONFIG_PROV_CREDENTIALS_SRP_RUNTIME
+    free(sec2_salt);
+    free(sec2_verifier);
+    sec2_salt = NULL;
+    sec2_verifier = NULL;
+#endif
+}
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // Se ejecuta en el loop por defecto junto con el Wi-Fi, solo hace el trabajo necesario para conectarse
+    // Los logs estan en provisioning_log_event_handler y la logica en prov_sm.c
+    record_stats(event_base, event_id);
+#if CONFIG_PROV_PRECHECK
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE)
+    {
+        prov_precheck_on_scan_done();
+    }
+    else if (event_base == WIFI_PROV_EVENT && event_id == WIFI_PROV_CRED_RECV)
+    {
+        wifi_sta_config_t *wifi_sta_cfg = (wifi_sta_config_t *)event_data;
+        prov_precheck_on_credentials(wifi_sta_cfg->ssid, wifi_sta_cfg->password);
+    }
+#endif
+#if CONFIG_PROV_RESUME
+    if (event_base == WIFI_PROV_EVENT)
+    {
+        prov_resume_on_prov_event(event_id);
+    }
+#endif
+
+    prov_sm_base_t base = PROV_SM_BASE_OTHER;
+    if (event_base == WIFI_PROV_EVENT)
+    {
+        base = PROV_SM_BASE_WIFI_PROV;
+    }
+    else if (event_base == WIFI_EVENT)
+    {
+        base = PROV_SM_BASE_WIFI;
+    }
+    else if (event_base == IP_EVENT)
+    {
+        base = PROV_SM_BASE_IP;
+    }
+    prov_sm_event_t event = prov_sm_classify(base, event_id);
+    uint32_t actions = 0;
+#if CONFIG_PROV_PRECHECK
+    // El pre-check ya habia rechazado las credenciales y el primer intento lo confirmo, no se esperan los reintentos
+    if (event == PROV_SM_EVENT_CRED_FAIL && prov_precheck_rejected())
+    {
+        ESP_LOGI(TAG, "Credentials rejected by the pre-check");
+        actions = prov_sm_reject_credentials(&state_machine);
+        event = PROV_SM_EVENT_NONE;
+    }
+#endif
+    actions |= prov_sm_handle(&state_machine, event);
+
+    if (actions & PROV_SM_ACTION_RESET_CREDENTIALS)
+    {
+        ESP_LOGI(TAG, "Failed to connect with provisioned AP, reseting provisioned credentials");
+        ESP_ERROR_CHECK(wifi_prov_mgr_reset_sm_state_on_failure());
+    }
+    if (actions & PROV_SM_ACTION_DEINIT)
+    {
+#if CONFIG_PROV_PRECHECK
+        prov_precheck_stop();
+#endif
+        wifi_prov_mgr_deinit();
+        release_credentials();
+    }
+    if (actions & PROV_SM_ACTION_CONNECT)
+    {
+        // No usar la macro ESP_ERROR_CHECK porque reinicia el dispositivo en caso de que aun no se haya hecho el provisioning
+        enable_roaming_caps();
+        esp_wifi_connect();
+    }
+    if (actions & PROV_SM_ACTION_SIGNAL_CONNECTED)
+    {
+        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_EVENT);
+    }
+}
+
+static void enable_roaming_caps(void)
+{
+#if CONFIG_ESP_WIFI_11KV_SUPPORT
+    // 802.11k/v se negocian en la asociacion, tienen que estar en la configuracion antes de cada conexion.
+    // La primera asociacion despues del provisioning la hace el provisioning manager solo con el SSID y la contrasena
+    wifi_config_t wifi_cfg;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_cfg) != ESP_OK || (wifi_cfg.sta.rm_enabled && wifi_cfg.sta.btm_enabled))
+    {
+        return;
+    }
+    wifi_cfg.sta.rm_enabled = 1;
+    wifi_cfg.sta.btm_enabled = 1;
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg);
+#endif
+}
+
+static void record_stats(esp_event_base_t event_base, int32_t event_id)
+{
+    // Solo se mide el provisioning que arranco en este encendido
+    if (prov_start_us == 0)
+    {
+        return;
+    }
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - prov_start_us) / 1000);
+
+#if CONFIG_PROV_BLE
+    if (event_base == PROTOCOMM_TRANSPORT_BLE_EVENT && event_id == PROTOCOMM_TRANSPORT_BLE_CONNECTED &&
+        prov_stats.first_contact_ms[PROVISIONING_TRANSPORT_BLE] == 0)
+    {
+        prov_stats.first_contact_ms[PROVISIONING_TRANSPORT_BLE] = elapsed_ms;
+    }
+#endif
+#if CONFIG_PROV_SOFTAP
+    // El telefono se asocia al AP antes de abrir la sesion por HTTP
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED &&
+        prov_stats.first_contact_ms[PROVISIONING_TRANSPORT_SOFTAP] == 0)
+    {
+        prov_stats.first_contact_ms[PROVISIONING_TRANSPORT_SOFTAP] = elapsed_ms;
+    }
+#endif
+
+    if (event_base == WIFI_PROV_EVENT && event_id == WIFI_PROV_CRED_RECV)
+    {
+#if CONFIG_PROV_TRANSPORT_DUAL
+        prov_stats.transport = prov_dual_resolve();
+#else
+        prov_stats.transport = PROV_TRANSPORT;
+#endif
+        // Si se reintenta con otras credenciales queda el tiempo de las ultimas
+        prov_stats.credentials_ms = elapsed_ms - prov_stats.first_contact_ms[prov_stats.transport];
+        credentials_received = true;
+    }
+    else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP && credentials_received)
+    {
+        prov_stats.connected_ms = elapsed_ms;
+        prov_stats.valid = true;
+        prov_start_us = 0;
+        ESP_LOGI(TAG, "Provisioned over %s: credentials %" PRIu32 " ms after first contact, IP %" PRIu32 " ms after start",
+                 provisioning_transport_to_name(prov_stats.transport), prov_stats.credentials_ms, prov_stats.connected_ms);
+        save_stats();
+    }
+}
+
+static void load_stats(void)
+{
+    // En el primer arranque el namespace no existe y las estadisticas quedan vacias
+    nvs_handle_t handle;
+    if (nvs_open(PROV_STATS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return;
+    }
+    size_t len = sizeof(prov_stats);
+    if (nvs_get_blob(handle, PROV_STATS_KEY, &prov_stats, &len) != ESP_OK || len != sizeof(prov_stats))
+    {
+        memset(&prov_stats, 0, sizeof(prov_stats));
+    }
+    nvs_close(handle);
+}
+
+static void save_stats(void)
+{
+    // Se escribe una sola vez por provisioning
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(PROV_STATS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(handle, PROV_STATS_KEY, &prov_stats, sizeof(prov_stats));
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Error (%s) saving provisioning stats", esp_err_to_name(err));
+    }
+}
+
+static void get_device_service_name(char *service_name, size_t max)
+{
+    // Genera un device name distinto para cada dispositivo porque el resultado depende de la MAC
+    uint8_t eth_mac[6];
+    const char *ssid_prefix = "PROV_";
+    ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, eth_mac));
+    snprintf(service_name, max, "%s%02X%02X%02X",
+             ssid_prefix, eth_mac[3], eth_mac[4], eth_mac[5]);
+}
+
+static void wifi_prov_print_qr(const char *name, const char *username, const char *pop, provisioning_transport_t transport)
+{
+    const char *transport_name = provisioning_transport_to_name(transport);
+    if (!name)
+    {
+        ESP_LOGW(TAG, "Cannot generate QR code payload. Data missing.");
+        return;
+    }
+    char payload[150] = {0};
+    if (username && pop)
+    {
+        snprintf(payload, sizeof(payload), "{\"ver\":\"%s\",\"name\":\"%s\""
+                                           ",\"username\":\"%s\",\"pop\":\"%s\",\"transport\":\"%s\"}",
+                 PROV_QR_VERSION, name, username, pop, transport_name);
+    }
+    else if (pop)
+    {
+        snprintf(payload, sizeof(payload), "{\"ver\":\"%s\",\"name\":\"%s\""
+                                           ",\"pop\":\"%s\",\"transport\":\"%s\"}",
+                 PROV_QR_VERSION, name, pop, transport_name);
+    }
+    else
+    {
+        snprintf(payload, sizeof(payload), "{\"ver\":\"%s\",\"name\":\"%s\""
+                                           ",\"transport\":\"%s\"}",
+                 PROV_QR_VERSION, name, transport_name);
+    }
+    ESP_LOGI(TAG, "Scan this QR code from the provisioning application for Provisioning over %s.", transport_name);
+    esp_qrcode_config_t cfg = ESP_QRCODE_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_qrcode_generate(&cfg, payload));
+    ESP_LOGI(TAG, "If QR code is not visible, copy paste the below URL in a browser.\n%s?data=%s", QRCODE_BASE_URL, payload);
+}
@@ -0,0 +1,68 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ROAM_POLICY_H_
+#define _ROAM_POLICY_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    int8_t rssi_threshold;
+    uint8_t rssi_hysteresis;
+    uint16_t tx_fail_threshold_permille;
+    uint8_t ewma_shift;
+    uint32_t neighbor_timeout_ms;
+    uint32_t cooldown_ms;
+} roam_policy_config_t;
+
+typedef enum
+{
+    ROAM_ACTION_NONE,
+    ROAM_ACTION_REQUEST_NEIGHBORS,
+    ROAM_ACTION_REQUEST_TRANSITION,
+} roam_action_t;
+
+typedef enum
+{
+    ROAM_STATE_MONITOR,
+    ROAM_STATE_WAIT_NEIGHBORS,
+    ROAM_STATE_COOLDOWN,
+} roam_state_t;
+
+// Estado de la decision de roaming, no depende del ESP-IDF para poder probarla con trazas de RSSI grabadas
+typedef struct
+{
+    roam_policy_config_t config;
+    roam_state_t state;
+    uint32_t state_since_ms;
+    bool filter_valid;
+    bool armed;
+    int32_t rssi_q4;
+    int32_t tx_fail_q4;
+} roam_policy_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void roam_policy_init(roam_policy_t *policy, const roam_policy_config_t *config);
+
+// Se llama periodicamente con el RSSI actual y los envios exitosos y fallidos desde la llamada anterior
+roam_action_t roam_policy_update(roam_policy_t *policy, int8_t rssi, uint32_t tx_ok, uint32_t tx_fail, uint32_t now_ms);
+
+// Se llama al recibir el reporte de vecinos con la cantidad de BSS candidatos distintos del actual
+roam_action_t roam_policy_on_neighbor_report(roam_policy_t *policy, uint8_t candidates, uint32_t now_ms);
+
+// Se llama al asociarse a un BSS, ya sea por roaming o por reconexion
+void roam_policy_on_connected(roam_policy_t *policy, uint32_t now_ms);
+
+int8_t roam_policy_rssi(const roam_policy_t *policy);
+
+uint16_t roam_policy_tx_fail_permille(const roam_policy_t *policy);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ROAM_POLICY_H_
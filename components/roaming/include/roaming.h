@@ -0,0 +1,38 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ROAMING_H_
+#define _ROAMING_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    int8_t rssi;
+    uint16_t tx_fail_permille;
+    uint32_t neighbor_requests;
+    uint32_t transition_requests;
+    uint32_t roams;
+} roaming_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Arranca el monitor de calidad, llamar una vez conectado. 802.11k/v se habilitan en la configuracion de la estacion
+// antes de conectarse, en el provisioning y el duty cycle
+esp_err_t roaming_start(void);
+
+// La aplicacion informa el resultado de cada envio para estimar la tasa de fallas de TX, se puede llamar desde
+// cualquier tarea
+void roaming_report_tx(bool ok);
+
+void roaming_get_stats(roaming_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ROAMING_H_
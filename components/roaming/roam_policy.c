@@ -0,0 +1,116 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "roam_policy.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void set_state(roam_policy_t *policy, roam_state_t state, uint32_t now_ms);
+
+static bool quality_is_poor(const roam_policy_t *policy);
+
+//=====[Implementations of public functions]===================================
+
+void roam_policy_init(roam_policy_t *policy, const roam_policy_config_t *config)
+{
+    memset(policy, 0, sizeof(*policy));
+    policy->config = *config;
+    policy->state = ROAM_STATE_MONITOR;
+    policy->armed = true;
+}
+
+roam_action_t roam_policy_update(roam_policy_t *policy, int8_t rssi, uint32_t tx_ok, uint32_t tx_fail, uint32_t now_ms)
+{
+    // Promedio movil exponencial en Q4, alpha = 1 / 2^ewma_shift
+    int32_t rssi_q4 = (int32_t)rssi * 16;
+    uint32_t tx_total = tx_ok + tx_fail;
+    int32_t fail_q4 = (tx_total > 0) ? (int32_t)((tx_fail * 1000u * 16u) / tx_total) : policy->tx_fail_q4;
+    if (!policy->filter_valid)
+    {
+        policy->rssi_q4 = rssi_q4;
+        policy->tx_fail_q4 = (tx_total > 0) ? fail_q4 : 0;
+        policy->filter_valid = true;
+    }
+    else
+    {
+        policy->rssi_q4 += (rssi_q4 - policy->rssi_q4) >> policy->config.ewma_shift;
+        policy->tx_fail_q4 += (fail_q4 - policy->tx_fail_q4) >> policy->config.ewma_shift;
+    }
+
+    // Despues de disparar un roaming la senal tiene que mejorar por encima de la histeresis para volver a dispararlo
+    if (!policy->armed && roam_policy_rssi(policy) > policy->config.rssi_threshold + policy->config.rssi_hysteresis &&
+        roam_policy_tx_fail_permille(policy) < policy->config.tx_fail_threshold_permille)
+    {
+        policy->armed = true;
+    }
+
+    switch (policy->state)
+    {
+    case ROAM_STATE_MONITOR:
+        if (policy->armed && quality_is_poor(policy))
+        {
+            policy->armed = false;
+            set_state(policy, ROAM_STATE_WAIT_NEIGHBORS, now_ms);
+            return ROAM_ACTION_REQUEST_NEIGHBORS;
+        }
+        break;
+    case ROAM_STATE_WAIT_NEIGHBORS:
+        if (now_ms - policy->state_since_ms >= policy->config.neighbor_timeout_ms)
+        {
+            set_state(policy, ROAM_STATE_COOLDOWN, now_ms);
+        }
+        break;
+    case ROAM_STATE_COOLDOWN:
+        if (now_ms - policy->state_since_ms >= policy->config.cooldown_ms)
+        {
+            set_state(policy, ROAM_STATE_MONITOR, now_ms);
+            policy->armed = true;
+        }
+        break;
+    }
+    return ROAM_ACTION_NONE;
+}
+
+roam_action_t roam_policy_on_neighbor_report(roam_policy_t *policy, uint8_t candidates, uint32_t now_ms)
+{
+    if (policy->state != ROAM_STATE_WAIT_NEIGHBORS)
+    {
+        return ROAM_ACTION_NONE;
+    }
+
+    // Sin candidatos en el mismo ESS no hay a donde moverse, se espera el cooldown para volver a intentar
+    set_state(policy, ROAM_STATE_COOLDOWN, now_ms);
+    return (candidates > 0) ? ROAM_ACTION_REQUEST_TRANSITION : ROAM_ACTION_NONE;
+}
+
+void roam_policy_on_connected(roam_policy_t *policy, uint32_t now_ms)
+{
+    policy->filter_valid = false;
+    policy->armed = true;
+    set_state(policy, ROAM_STATE_COOLDOWN, now_ms);
+}
+
+int8_t roam_policy_rssi(const roam_policy_t *policy)
+{
+    return (int8_t)(policy->rssi_q4 / 16);
+}
+
+uint16_t roam_policy_tx_fail_permille(const roam_policy_t *policy)
+{
+    return (uint16_t)(policy->tx_fail_q4 / 16);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void set_state(roam_policy_t *policy, roam_state_t state, uint32_t now_ms)
+{
+    policy->state = state;
+    policy->state_since_ms = now_ms;
+}
+
+static bool quality_is_poor(const roam_policy_t *policy)
+{
+    return roam_policy_rssi(policy) < policy->config.rssi_threshold ||
+           roam_policy_tx_fail_permille(policy) >= policy->config.tx_fail_threshold_permille;
+}
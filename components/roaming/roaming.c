@@ -0,0 +1,230 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_rrm.h"
+#include "esp_wnm.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "roaming.h"
+#include "roam_policy.h"
+
+//=====[Declaration of private defines]========================================
+
+#define WLAN_EID_NEIGHBOR_REPORT 52
+#define NEIGHBOR_REPORT_MIN_LEN 13
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "roaming";
+
+//=====[Declaration and initialization of private global variables]============
+
+// La politica la actualizan la tarea de esp_timer y la del loop de eventos, el mutex protege la politica y las estadisticas
+static SemaphoreHandle_t policy_mutex = NULL;
+static roam_policy_t policy;
+static roaming_stats_t roaming_stats;
+static esp_timer_handle_t monitor_timer = NULL;
+
+static atomic_uint tx_ok_count;
+static atomic_uint tx_fail_count;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void monitor_timer_cb(void *arg);
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+
+static uint8_t count_candidates(const uint8_t *report, uint16_t len);
+
+static uint32_t now_ms(void);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t roaming_start(void)
+{
+    if (monitor_timer != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Radio Measurement (802.11k) y BSS Transition Management (802.11v) se negocian en la asociacion, los habilitan
+    // el provisioning y el duty cycle antes de conectarse
+    if (!esp_rrm_is_rrm_supported_connection() || !esp_wnm_is_btm_supported_connection())
+    {
+        ESP_LOGW(TAG, "Current association does not use 802.11k/v, roaming applies from the next one");
+    }
+
+    policy_mutex = xSemaphoreCreateMutex();
+    if (policy_mutex == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    roam_policy_config_t config = {
+        .rssi_threshold = CONFIG_ROAMING_RSSI_THRESHOLD,
+        .rssi_hysteresis = CONFIG_ROAMING_RSSI_HYSTERESIS,
+        .tx_fail_threshold_permille = CONFIG_ROAMING_TX_FAIL_PERMILLE,
+        .ewma_shift = CONFIG_ROAMING_EWMA_SHIFT,
+        .neighbor_timeout_ms = CONFIG_ROAMING_NEIGHBOR_TIMEOUT_MS,
+        .cooldown_ms = CONFIG_ROAMING_COOLDOWN_MS,
+    };
+    roam_policy_init(&policy, &config);
+    memset(&roaming_stats, 0, sizeof(roaming_stats));
+
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_NEIGHBOR_REP, &event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &event_handler, NULL));
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = monitor_timer_cb,
+        .name = "roaming",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &monitor_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(monitor_timer, CONFIG_ROAMING_MONITOR_PERIOD_MS * 1000));
+    return ESP_OK;
+}
+
+void roaming_report_tx(bool ok)
+{
+    if (ok)
+    {
+        atomic_fetch_add_explicit(&tx_ok_count, 1, memory_order_relaxed);
+    }
+    else
+    {
+        atomic_fetch_add_explicit(&tx_fail_count, 1, memory_order_relaxed);
+    }
+}
+
+void roaming_get_stats(roaming_stats_t *stats)
+{
+    if (policy_mutex == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(policy_mutex, portMAX_DELAY);
+    *stats = roaming_stats;
+    xSemaphoreGive(policy_mutex);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void monitor_timer_cb(void *arg)
+{
+    int rssi = 0;
+    if (esp_wifi_sta_get_rssi(&rssi) != ESP_OK)
+    {
+        return;
+    }
+    uint32_t ok = atomic_exchange_explicit(&tx_ok_count, 0, memory_order_relaxed);
+    uint32_t fail = atomic_exchange_explicit(&tx_fail_count, 0, memory_order_relaxed);
+
+    // Mismo formato que lee tools/roam-policy-test para repetir la traza en la PC
+    ESP_LOGD(TAG, "Sample rssi=%d tx_ok=%" PRIu32 " tx_fail=%" PRIu32, rssi, ok, fail);
+
+    xSemaphoreTake(policy_mutex, portMAX_DELAY);
+    roam_action_t action = roam_policy_update(&policy, (int8_t)rssi, ok, fail, now_ms());
+    int8_t filtered_rssi = roam_policy_rssi(&policy);
+    uint16_t tx_fail_permille = roam_policy_tx_fail_permille(&policy);
+    roaming_stats.rssi = filtered_rssi;
+    roaming_stats.tx_fail_permille = tx_fail_permille;
+    xSemaphoreGive(policy_mutex);
+
+    if (action == ROAM_ACTION_REQUEST_NEIGHBORS)
+    {
+        if (!esp_rrm_is_rrm_supported_connection() || !esp_wnm_is_btm_supported_connection())
+        {
+            ESP_LOGW(TAG, "Link quality is poor but the AP does not support 802.11k/v");
+            return;
+        }
+        ESP_LOGI(TAG, "Link quality is poor (RSSI %d dBm, TX fail %u permille), requesting neighbor report",
+                 filtered_rssi, tx_fail_permille);
+        if (esp_rrm_send_neighbor_report_request() == 0)
+        {
+            xSemaphoreTake(policy_mutex, portMAX_DELAY);
+            roaming_stats.neighbor_requests++;
+            xSemaphoreGive(policy_mutex);
+        }
+    }
+}
+
+static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_id == WIFI_EVENT_STA_NEIGHBOR_REP)
+    {
+        wifi_event_neighbor_report_t *event = (wifi_event_neighbor_report_t *)event_data;
+        uint8_t candidates = count_candidates(event->report, event->report_len);
+        ESP_LOGI(TAG, "Neighbor report received with %u candidates", candidates);
+
+        // El AP elige el mejor candidato y le indica a la estacion que se mueva sin pasar por una desconexion
+        xSemaphoreTake(policy_mutex, portMAX_DELAY);
+        roam_action_t action = roam_policy_on_neighbor_report(&policy, candidates, now_ms());
+        bool frame_loss = (roaming_stats.tx_fail_permille >= CONFIG_ROAMING_TX_FAIL_PERMILLE);
+        xSemaphoreGive(policy_mutex);
+        if (action == ROAM_ACTION_REQUEST_TRANSITION)
+        {
+            enum btm_query_reason reason = frame_loss ? REASON_FRAME_LOSS : REASON_UNSPECIFIED;
+            if (esp_wnm_send_bss_transition_mgmt_query(reason, NULL, 0) == 0)
+            {
+                xSemaphoreTake(policy_mutex, portMAX_DELAY);
+                roaming_stats.transition_requests++;
+                xSemaphoreGive(policy_mutex);
+            }
+        }
+    }
+    else if (event_id == WIFI_EVENT_STA_CONNECTED)
+    {
+        // Cuenta como roaming cuando hubo un pedido de transicion pendiente
+        xSemaphoreTake(policy_mutex, portMAX_DELAY);
+        if (policy.state == ROAM_STATE_COOLDOWN && roaming_stats.transition_requests > roaming_stats.roams)
+        {
+            roaming_stats.roams++;
+        }
+        roam_policy_on_connected(&policy, now_ms());
+        xSemaphoreGive(policy_mutex);
+    }
+}
+
+static uint8_t count_candidates(const uint8_t *report, uint16_t len)
+{
+    uint8_t current_bssid[6] = {0};
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK)
+    {
+        memcpy(current_bssid, ap_info.bssid, sizeof(current_bssid));
+    }
+
+    // Recorre los elementos Neighbor Report: [id][len][bssid(6)][info(4)][op class][canal][phy]...
+    uint8_t candidates = 0;
+    uint16_t pos = 0;
+    while (pos + 2 <= len)
+    {
+        uint8_t id = report[pos];
+        uint8_t elen = report[pos + 1];
+        if (pos + 2 + elen > len)
+        {
+            break;
+        }
+        if (id == WLAN_EID_NEIGHBOR_REPORT && elen >= NEIGHBOR_REPORT_MIN_LEN &&
+            memcmp(&report[pos + 2], current_bssid, sizeof(current_bssid)) != 0)
+        {
+            candidates++;
+        }
+        pos += 2 + elen;
+    }
+    return candidates;
+}
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
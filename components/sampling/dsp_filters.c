@@ -0,0 +1,145 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+#include <limits.h>
+
+#include "dsp_filters.h"
+
+//=====[Declaration and initialization of public global variables]=============
+
+// Pasabajos Hamming de 29 coeficientes en Q15, corte en 0.1 fs, suma 32768 (ganancia unitaria en continua)
+const int16_t fir_lowpass_q15[FIR_LOWPASS_TAPS] = {
+    39, 91, 139, 129, 0, -271, -609, -832, -696, 0, 1297, 3011, 4755, 6059, 6544,
+    6059, 4755, 3011, 1297, 0, -696, -832, -609, -271, 0, 129, 139, 91, 39};
+
+//=====[Implementations of public functions]===================================
+
+int cic_decimator_init(cic_decimator_t *cic, uint8_t order, uint16_t ratio)
+{
+    if (order == 0 || order > CIC_MAX_ORDER || ratio == 0 || (ratio & (ratio - 1)) != 0)
+    {
+        return -1;
+    }
+
+    // La ganancia del CIC es ratio^order, como ratio es potencia de 2 se normaliza con un desplazamiento
+    uint8_t log2_ratio = 0;
+    while ((1u << log2_ratio) < ratio)
+    {
+        log2_ratio++;
+    }
+    if (CIC_INPUT_BITS + log2_ratio * order > 31)
+    {
+        return -1;
+    }
+    memset(cic, 0, sizeof(*cic));
+    cic->order = order;
+    cic->ratio = ratio;
+    cic->shift = (uint8_t)(log2_ratio * order);
+    return 0;
+}
+
+size_t cic_decimator_process(cic_decimator_t *cic, const int32_t *in, size_t n, int32_t *out)
+{
+    size_t produced = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        // Etapas integradoras a la frecuencia de entrada
+        uint32_t acc = (uint32_t)in[i];
+        for (uint8_t s = 0; s < cic->order; s++)
+        {
+            cic->integrator[s] += acc;
+            acc = cic->integrator[s];
+        }
+
+        if (++cic->phase < cic->ratio)
+        {
+            continue;
+        }
+        cic->phase = 0;
+
+        // Etapas comb a la frecuencia de salida
+        for (uint8_t s = 0; s < cic->order; s++)
+        {
+            uint32_t prev = cic->comb[s];
+            cic->comb[s] = acc;
+            acc -= prev;
+        }
+        out[produced++] = (int32_t)acc >> cic->shift;
+    }
+    return produced;
+}
+
+int fir_decimator_init(fir_decimator_t *fir, const int16_t *coeffs, uint16_t taps, uint16_t ratio)
+{
+    if (coeffs == NULL || taps == 0 || taps > FIR_MAX_TAPS || ratio == 0)
+    {
+        return -1;
+    }
+    memset(fir, 0, sizeof(*fir));
+    fir->coeffs = coeffs;
+    fir->taps = taps;
+    fir->ratio = ratio;
+    return 0;
+}
+
+size_t fir_decimator_process(fir_decimator_t *fir, const int32_t *in, size_t n, int32_t *out)
+{
+    size_t produced = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        // La linea de retardo esta duplicada para que la convolucion recorra memoria contigua sin usar modulo
+        fir->head = (fir->head == 0) ? (uint16_t)(fir->taps - 1) : (uint16_t)(fir->head - 1);
+        fir->delay[fir->head] = in[i];
+        fir->delay[fir->head + fir->taps] = in[i];
+
+        // Solo se calcula la salida de las muestras que sobreviven a la decimacion
+        if (++fir->phase < fir->ratio)
+        {
+            continue;
+        }
+        fir->phase = 0;
+
+        const int32_t *x = &fir->delay[fir->head];
+        int64_t acc = 0;
+        for (uint16_t k = 0; k < fir->taps; k++)
+        {
+            acc += (int64_t)fir->coeffs[k] * x[k];
+        }
+        out[produced++] = (int32_t)((acc + (1 << 14)) >> 15);
+    }
+    return produced;
+}
+
+void block_stats_reset(block_stats_t *stats)
+{
+    stats->min = INT32_MAX;
+    stats->max = INT32_MIN;
+    stats->sum = 0;
+    stats->count = 0;
+}
+
+void block_stats_update(block_stats_t *stats, const int32_t *in, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (in[i] < stats->min)
+        {
+            stats->min = in[i];
+        }
+        if (in[i] > stats->max)
+        {
+            stats->max = in[i];
+        }
+        stats->sum += in[i];
+    }
+    stats->count += (uint32_t)n;
+}
+
+int32_t block_stats_mean(const block_stats_t *stats)
+{
+    if (stats->count == 0)
+    {
+        return 0;
+    }
+    return (int32_t)(stats->sum / (int64_t)stats->count);
+}
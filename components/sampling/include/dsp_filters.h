@@ -0,0 +1,82 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _DSP_FILTERS_H_
+#define _DSP_FILTERS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <stddef.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define CIC_MAX_ORDER 5
+#define FIR_MAX_TAPS 64
+
+// Ancho de las muestras del ADC, la salida del CIC sin normalizar ocupa CIC_INPUT_BITS + order * log2(ratio) bits
+#define CIC_INPUT_BITS 12
+
+#define FIR_LOWPASS_TAPS 29
+
+//=====[Declaration of public data types]======================================
+
+// Decimador CIC (Cascaded Integrator-Comb) en punto fijo
+// Los integradores desbordan de forma modular a proposito: el resultado es correcto mientras la salida entre en 32 bits
+// con signo, por eso cic_decimator_init rechaza las configuraciones con CIC_INPUT_BITS + order * log2(ratio) > 31
+typedef struct
+{
+    uint8_t order;
+    uint16_t ratio;
+    uint8_t shift;
+    uint16_t phase;
+    uint32_t integrator[CIC_MAX_ORDER];
+    uint32_t comb[CIC_MAX_ORDER];
+} cic_decimator_t;
+
+// Decimador FIR con coeficientes en Q15
+typedef struct
+{
+    const int16_t *coeffs;
+    uint16_t taps;
+    uint16_t ratio;
+    uint16_t phase;
+    uint16_t head;
+    int32_t delay[2 * FIR_MAX_TAPS];
+} fir_decimator_t;
+
+// Agregado min/max/promedio de un bloque de muestras
+typedef struct
+{
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    uint32_t count;
+} block_stats_t;
+
+//=====[Declaration of public global variables]================================
+
+// Pasabajos de los decimadores FIR del componente, compartido con tools/dsp-bench
+extern const int16_t fir_lowpass_q15[FIR_LOWPASS_TAPS];
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Devuelve 0 si la configuracion es valida (ratio potencia de 2, orden <= CIC_MAX_ORDER y la salida entra en 32 bits)
+int cic_decimator_init(cic_decimator_t *cic, uint8_t order, uint16_t ratio);
+
+// Procesa n muestras de entrada y devuelve la cantidad de muestras escritas en out (como maximo n / ratio + 1)
+size_t cic_decimator_process(cic_decimator_t *cic, const int32_t *in, size_t n, int32_t *out);
+
+// Devuelve 0 si la configuracion es valida (taps <= FIR_MAX_TAPS)
+int fir_decimator_init(fir_decimator_t *fir, const int16_t *coeffs, uint16_t taps, uint16_t ratio);
+
+size_t fir_decimator_process(fir_decimator_t *fir, const int32_t *in, size_t n, int32_t *out);
+
+void block_stats_reset(block_stats_t *stats);
+
+void block_stats_update(block_stats_t *stats, const int32_t *in, size_t n);
+
+int32_t block_stats_mean(const block_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _DSP_FILTERS_H_
@@ -0,0 +1,55 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SAMPLING_H_
+#define _SAMPLING_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "dsp_filters.h"
+
+//=====[Declaration of public data types]======================================
+
+// Bloque de muestras ya decimadas que se entrega a la aplicacion
+typedef struct
+{
+    const int32_t *samples;
+    size_t count;
+    block_stats_t stats;
+    int64_t timestamp_us;
+    uint32_t sequence;
+} sampling_block_t;
+
+// Se ejecuta en la tarea de muestreo, no debe bloquearse
+typedef void (*sampling_block_cb_t)(const sampling_block_t *block, void *ctx);
+
+typedef struct
+{
+    sampling_block_cb_t on_block;
+    void *ctx;
+} sampling_config_t;
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t raw_samples;
+    uint32_t output_samples;
+    uint32_t overruns;
+    uint32_t max_process_us;
+} sampling_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+esp_err_t sampling_start(const sampling_config_t *config);
+
+esp_err_t sampling_stop(void);
+
+void sampling_get_stats(sampling_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _SAMPLING_H_
@@ -0,0 +1,219 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_adc/adc_continuous.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sampling.h"
+
+//=====[Declaration of private defines]========================================
+
+#define SAMPLING_FRAME_BYTES (CONFIG_SAMPLING_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define SAMPLING_CIC_MAX_OUT (CONFIG_SAMPLING_FRAME_SAMPLES / CONFIG_SAMPLING_CIC_RATIO + 1)
+#define SAMPLING_FIR_MAX_OUT (SAMPLING_CIC_MAX_OUT / CONFIG_SAMPLING_FIR_RATIO + 1)
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define SAMPLING_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define SAMPLING_GET_CHANNEL(p) ((p)->type1.channel)
+#define SAMPLING_GET_DATA(p) ((p)->type1.data)
+#else
+#define SAMPLING_OUTPUT_TYPE ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define SAMPLING_GET_CHANNEL(p) ((p)->type2.channel)
+#define SAMPLING_GET_DATA(p) ((p)->type2.data)
+#endif
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "sampling";
+
+
+//=====[Declaration and initialization of private global variables]============
+
+static adc_continuous_handle_t adc_handle = NULL;
+static TaskHandle_t sampling_task_handle = NULL;
+static sampling_config_t sampling_config;
+static sampling_stats_t sampling_stats;
+
+// Todos los buffers son estaticos para no reservar memoria por bloque ni por muestra
+static uint8_t raw_frame[SAMPLING_FRAME_BYTES];
+static int32_t raw_samples[CONFIG_SAMPLING_FRAME_SAMPLES];
+static int32_t cic_out[SAMPLING_CIC_MAX_OUT];
+static int32_t output_blocks[2][SAMPLING_FIR_MAX_OUT];
+
+static cic_decimator_t cic;
+static fir_decimator_t fir;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data);
+
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data);
+
+static void sampling_task(void *arg);
+
+static void process_frame(const uint8_t *frame, uint32_t length, int32_t *block, uint32_t sequence);
+
+//=====[Implementations of public functions]===================================
+
+esp_err_t sampling_start(const sampling_config_t *config)
+{
+    if (adc_handle != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config == NULL || config->on_block == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cic_decimator_init(&cic, CONFIG_SAMPLING_CIC_ORDER, CONFIG_SAMPLING_CIC_RATIO) != 0 ||
+        fir_decimator_init(&fir, fir_lowpass_q15, FIR_LOWPASS_TAPS, CONFIG_SAMPLING_FIR_RATIO) != 0)
+    {
+        ESP_LOGE(TAG, "Invalid decimation settings");
+        return ESP_ERR_INVALID_ARG;
+    }
+    sampling_config = *config;
+    memset(&sampling_stats, 0, sizeof(sampling_stats));
+
+    // El driver guarda hasta 4 tramas en su pool, asi el DMA sigue llenando mientras la tarea procesa
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = 4 * SAMPLING_FRAME_BYTES,
+        .conv_frame_size = SAMPLING_FRAME_BYTES,
+    };
+    ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_cfg, &adc_handle));
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_12,
+        .channel = CONFIG_SAMPLING_ADC_CHANNEL,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = CONFIG_SAMPLING_RATE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = SAMPLING_OUTPUT_TYPE,
+    };
+    ESP_ERROR_CHECK(adc_continuous_config(adc_handle, &dig_cfg));
+
+    // Crea la tarea de procesamiento fijada a un nucleo
+    BaseType_t ret = xTaskCreatePinnedToCore(sampling_task, "sampling", CONFIG_SAMPLING_TASK_STACK_SIZE, NULL,
+                                             CONFIG_SAMPLING_TASK_PRIORITY, &sampling_task_handle, CONFIG_SAMPLING_TASK_CORE);
+    if (ret != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create sampling task");
+        adc_continuous_deinit(adc_handle);
+        adc_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Solo hay una interrupcion por trama de DMA, nunca por muestra
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = on_conv_done,
+        .on_pool_ovf = on_pool_ovf,
+    };
+    ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(adc_handle, &cbs, NULL));
+    ESP_ERROR_CHECK(adc_continuous_start(adc_handle));
+
+    ESP_LOGI(TAG, "Sampling ADC1 channel %d at %d Hz, output rate %d Hz",
+             CONFIG_SAMPLING_ADC_CHANNEL, CONFIG_SAMPLING_RATE_HZ,
+             CONFIG_SAMPLING_RATE_HZ / (CONFIG_SAMPLING_CIC_RATIO * CONFIG_SAMPLING_FIR_RATIO));
+    return ESP_OK;
+}
+
+esp_err_t sampling_stop(void)
+{
+    if (adc_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_ERROR_CHECK(adc_continuous_stop(adc_handle));
+    vTaskDelete(sampling_task_handle);
+    sampling_task_handle = NULL;
+    ESP_ERROR_CHECK(adc_continuous_deinit(adc_handle));
+    adc_handle = NULL;
+    return ESP_OK;
+}
+
+void sampling_get_stats(sampling_stats_t *stats)
+{
+    *stats = sampling_stats;
+}
+
+//=====[Implementations of private functions]==================================
+
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    BaseType_t must_yield = pdFALSE;
+    vTaskNotifyGiveFromISR(sampling_task_handle, &must_yield);
+    return (must_yield == pdTRUE);
+}
+
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    sampling_stats.overruns++;
+    return false;
+}
+
+static void sampling_task(void *arg)
+{
+    uint32_t sequence = 0;
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Vacia todas las tramas disponibles, alternando entre los dos bloques de salida
+        uint32_t length = 0;
+        while (adc_continuous_read(adc_handle, raw_frame, sizeof(raw_frame), &length, 0) == ESP_OK)
+        {
+            process_frame(raw_frame, length, output_blocks[sequence & 1], sequence);
+            sequence++;
+        }
+    }
+}
+
+static void process_frame(const uint8_t *frame, uint32_t length, int32_t *block, uint32_t sequence)
+{
+    int64_t start = esp_timer_get_time();
+
+    size_t n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES)
+    {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&frame[i];
+        if (SAMPLING_GET_CHANNEL(p) == CONFIG_SAMPLING_ADC_CHANNEL)
+        {
+            raw_samples[n++] = SAMPLING_GET_DATA(p);
+        }
+    }
+
+    size_t decimated = cic_decimator_process(&cic, raw_samples, n, cic_out);
+    size_t count = fir_decimator_process(&fir, cic_out, decimated, block);
+
+    sampling_block_t out = {
+        .samples = block,
+        .count = count,
+        .timestamp_us = start,
+        .sequence = sequence,
+    };
+    block_stats_reset(&out.stats);
+    block_stats_update(&out.stats, block, count);
+    if (count > 0)
+    {
+        sampling_config.on_block(&out, sampling_config.ctx);
+    }
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    if (elapsed > sampling_stats.max_process_us)
+    {
+        sampling_stats.max_process_us = elapsed;
+    }
+    sampling_stats.frames++;
+    sampling_stats.raw_samples += n;
+    sampling_stats.output_samples += count;
+}
@@ -0,0 +1,54 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TIME_SYNC_H_
+#define _TIME_SYNC_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    TIME_SOURCE_NONE,
+    TIME_SOURCE_RTC,
+    TIME_SOURCE_SNTP,
+} time_source_t;
+
+typedef struct
+{
+    time_source_t source;
+    uint32_t syncs;
+    uint32_t first_sync_ms;
+    int64_t last_sync_unix_us;
+} time_sync_stats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Recupera la hora guardada en memoria RTC, llamar al inicio antes de tomar timestamps
+void time_sync_init(void);
+
+// Arranca el SNTP, llamar apenas se obtiene la direccion IP
+esp_err_t time_sync_start(void);
+
+// Espera la primera respuesta valida del servidor
+esp_err_t time_sync_wait(TickType_t timeout);
+
+bool time_sync_is_valid(void);
+
+// Hora UNIX en microsegundos a partir del reloj monotonico mas el offset, pensada para el camino de muestreo
+int64_t time_sync_now_us(void);
+
+// Convierte un timestamp de esp_timer_get_time() a hora UNIX en microsegundos
+int64_t time_sync_to_unix_us(int64_t monotonic_us);
+
+void time_sync_get_stats(time_sync_stats_t *stats);
+
+//=====[#include guards - end]=================================================
+
+#endif // _TIME_SYNC_H_
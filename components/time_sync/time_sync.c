@@ -0,0 +1,154 @@
+//=====[Libraries]=============================================================
+
+#include <stdatomic.h>
+#include <sys/time.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_netif_sntp.h"
+
+#include "time_sync.h"
+
+//=====[Declaration of private defines]========================================
+
+#define TIME_SYNC_RTC_MAGIC 0x54494D45
+
+// Cualquier hora anterior al 2024-01-01 se considera invalida
+#define TIME_SYNC_MIN_VALID_UNIX_S 1704067200LL
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    uint32_t magic;
+    int64_t last_sync_unix_us;
+} time_sync_rtc_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TAG = "time-sync";
+
+//=====[Declaration and initialization of private global variables]============
+
+// Sobrevive al deep sleep, el RTC mantiene la hora del sistema mientras el chip duerme
+static RTC_DATA_ATTR time_sync_rtc_t rtc_state;
+
+// El offset se protege con un contador de secuencia porque en el ESP32 la lectura de 64 bits no es atomica
+static atomic_uint offset_seq;
+static int64_t offset_us;
+static volatile bool offset_valid = false;
+
+static time_sync_stats_t sync_stats;
+static int64_t start_us;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void on_time_sync(struct timeval *tv);
+
+static void set_offset(int64_t unix_us);
+
+//=====[Implementations of public functions]===================================
+
+void time_sync_init(void)
+{
+    if (rtc_state.magic != TIME_SYNC_RTC_MAGIC)
+    {
+        return;
+    }
+
+    // Despues de un deep sleep la hora del sistema sigue siendo valida aunque esp_timer haya vuelto a cero
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < TIME_SYNC_MIN_VALID_UNIX_S)
+    {
+        rtc_state.magic = 0;
+        return;
+    }
+    set_offset((int64_t)tv.tv_sec * 1000000LL + tv.tv_usec);
+    sync_stats.source = TIME_SOURCE_RTC;
+    sync_stats.last_sync_unix_us = rtc_state.last_sync_unix_us;
+    ESP_LOGI(TAG, "Restored time from RTC, last SNTP sync %lld s ago",
+             (long long)((time_sync_now_us() - rtc_state.last_sync_unix_us) / 1000000LL));
+}
+
+esp_err_t time_sync_start(void)
+{
+    start_us = esp_timer_get_time();
+
+    // Con SNTP_SYNC_MODE_IMMED la hora se aplica con la primera respuesta valida
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_TIME_SYNC_SERVER);
+    config.sync_cb = on_time_sync;
+    config.smooth_sync = false;
+    esp_err_t err = esp_netif_sntp_init(&config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error (%s) starting SNTP", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "SNTP started with server %s", CONFIG_TIME_SYNC_SERVER);
+    return ESP_OK;
+}
+
+esp_err_t time_sync_wait(TickType_t timeout)
+{
+    return esp_netif_sntp_sync_wait(timeout);
+}
+
+bool time_sync_is_valid(void)
+{
+    return offset_valid;
+}
+
+int64_t time_sync_now_us(void)
+{
+    return time_sync_to_unix_us(esp_timer_get_time());
+}
+
+int64_t time_sync_to_unix_us(int64_t monotonic_us)
+{
+    unsigned seq;
+    int64_t offset;
+    do
+    {
+        seq = atomic_load_explicit(&offset_seq, memory_order_acquire);
+        offset = offset_us;
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) || seq != atomic_load_explicit(&offset_seq, memory_order_relaxed));
+    return monotonic_us + offset;
+}
+
+void time_sync_get_stats(time_sync_stats_t *stats)
+{
+    *stats = sync_stats;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void on_time_sync(struct timeval *tv)
+{
+    int64_t unix_us = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+    set_offset(unix_us);
+
+    if (sync_stats.syncs == 0)
+    {
+        sync_stats.first_sync_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+        ESP_LOGI(TAG, "First valid timestamp %" PRIu32 " ms after SNTP start", sync_stats.first_sync_ms);
+    }
+    sync_stats.syncs++;
+    sync_stats.source = TIME_SOURCE_SNTP;
+    sync_stats.last_sync_unix_us = unix_us;
+
+    rtc_state.last_sync_unix_us = unix_us;
+    rtc_state.magic = TIME_SYNC_RTC_MAGIC;
+}
+
+static void set_offset(int64_t unix_us)
+{
+    int64_t offset = unix_us - esp_timer_get_time();
+    atomic_fetch_add_explicit(&offset_seq, 1, memory_order_acq_rel);
+    offset_us = offset;
+    atomic_fetch_add_explicit(&offset_seq, 1, memory_order_release);
+    offset_valid = true;
+}
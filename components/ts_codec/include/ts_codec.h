@@ -0,0 +1,100 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TS_CODEC_H_
+#define _TS_CODEC_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define TS_CODEC_MAX_CHANNELS 8
+
+// Residuos recientes que se recuerdan por canal cuando el diccionario esta habilitado
+#define TS_CODEC_DICT_SIZE 8
+
+#define TS_CODEC_HEADER_LEN 1
+
+// Peor caso de un registro: timestamp de 10 bytes y 5 bytes por valor
+#define TS_CODEC_RECORD_MAX(channels) (10u + 5u * (channels))
+
+#define TS_CODEC_ERR_FULL -1
+#define TS_CODEC_ERR_INVALID -2
+
+//=====[Declaration of public data types]======================================
+
+typedef enum
+{
+    // Diferencia con el valor anterior en zigzag, para enteros que cambian de a poco
+    TS_CODEC_DELTA,
+    // XOR con el valor anterior, para patrones de bits como floats
+    TS_CODEC_XOR,
+} ts_codec_mode_t;
+
+typedef struct
+{
+    uint8_t channels;
+    ts_codec_mode_t mode;
+    bool dictionary;
+} ts_codec_config_t;
+
+typedef struct
+{
+    uint32_t entries[TS_CODEC_DICT_SIZE];
+    uint8_t next;
+} ts_codec_dict_t;
+
+// Estado compartido por el codificador y el decodificador, se reinicia en cada bloque
+typedef struct
+{
+    ts_codec_config_t config;
+    uint32_t count;
+    int64_t prev_ts;
+    int64_t prev_delta;
+    uint32_t prev[TS_CODEC_MAX_CHANNELS];
+    ts_codec_dict_t dict[TS_CODEC_MAX_CHANNELS];
+} ts_codec_state_t;
+
+typedef struct
+{
+    ts_codec_state_t state;
+    uint8_t *buf;
+    size_t capacity;
+    size_t len;
+} ts_codec_encoder_t;
+
+typedef struct
+{
+    ts_codec_state_t state;
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} ts_codec_decoder_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Empieza un bloque en buf, toda la memoria del codificador es la estructura mas buf
+// Devuelve 0 o TS_CODEC_ERR_INVALID si la configuracion no es valida o buf no alcanza para un registro
+int ts_codec_encoder_init(ts_codec_encoder_t *enc, const ts_codec_config_t *config, uint8_t *buf, size_t capacity);
+
+// Agrega un registro con un valor por canal
+// Devuelve TS_CODEC_ERR_FULL sin modificar el bloque si el registro podria no entrar
+int ts_codec_encoder_append(ts_codec_encoder_t *enc, int64_t timestamp, const int32_t *values);
+
+// Descarta el bloque y empieza otro en el mismo buffer, con la misma configuracion
+void ts_codec_encoder_reset(ts_codec_encoder_t *enc);
+
+// Cada bloque se decodifica solo, sin los anteriores
+// Devuelve 0 o TS_CODEC_ERR_INVALID si el encabezado no es valido
+int ts_codec_decoder_init(ts_codec_decoder_t *dec, const uint8_t *data, size_t len);
+
+// Devuelve 1 si leyo un registro y 0 al final del bloque
+// Un registro cortado al final se ignora, asi se puede decodificar un bloque parcial
+int ts_codec_decoder_next(ts_codec_decoder_t *dec, int64_t *timestamp, int32_t *values);
+
+//=====[#include guards - end]=================================================
+
+#endif // _TS_CODEC_H_
@@ -0,0 +1,310 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "ts_codec.h"
+
+//=====[Declaration of private defines]========================================
+
+#define TS_CODEC_VERSION 1
+
+// Encabezado: bits 0-3 cantidad de canales, bit 4 XOR, bit 5 diccionario, bits 6-7 version
+#define HEADER_CHANNELS_MASK 0x0F
+#define HEADER_XOR 0x10
+#define HEADER_DICT 0x20
+#define HEADER_VERSION_SHIFT 6
+
+// Los residuos chicos ya ocupan un byte, solo los mas grandes entran al diccionario
+#define DICT_MIN_RESIDUAL 64
+
+#define VARINT_MAX_LEN 10
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void state_reset(ts_codec_state_t *state);
+
+static uint32_t value_residual(const ts_codec_state_t *state, uint8_t channel, int32_t value);
+
+static int32_t value_from_residual(const ts_codec_state_t *state, uint8_t channel, uint32_t residual);
+
+static int dict_find(const ts_codec_dict_t *dict, uint32_t residual);
+
+static void dict_insert(ts_codec_dict_t *dict, uint32_t residual);
+
+static uint64_t zigzag_encode(int64_t value);
+
+static int64_t zigzag_decode(uint64_t value);
+
+static size_t varint_len(uint64_t value);
+
+static size_t varint_write(uint8_t *out, uint64_t value);
+
+static int varint_read(ts_codec_decoder_t *dec, uint64_t *value);
+
+//=====[Implementations of public functions]===================================
+
+int ts_codec_encoder_init(ts_codec_encoder_t *enc, const ts_codec_config_t *config, uint8_t *buf, size_t capacity)
+{
+    if (config->channels == 0 || config->channels > TS_CODEC_MAX_CHANNELS ||
+        capacity < TS_CODEC_HEADER_LEN + TS_CODEC_RECORD_MAX(config->channels))
+    {
+        return TS_CODEC_ERR_INVALID;
+    }
+    enc->state.config = *config;
+    enc->buf = buf;
+    enc->capacity = capacity;
+    ts_codec_encoder_reset(enc);
+    return 0;
+}
+
+int ts_codec_encoder_append(ts_codec_encoder_t *enc, int64_t timestamp, const int32_t *values)
+{
+    ts_codec_state_t *state = &enc->state;
+    uint8_t channels = state->config.channels;
+
+    // Primero se calculan los tokens sin tocar el estado, asi un registro que no entra no deja rastros
+    uint64_t ts_token;
+    int64_t delta = 0;
+    if (state->count == 0)
+    {
+        ts_token = zigzag_encode(timestamp);
+    }
+    else
+    {
+        // Con timestamps periodicos la diferencia de las diferencias es 0 y ocupa un byte
+        delta = (int64_t)((uint64_t)timestamp - (uint64_t)state->prev_ts);
+        ts_token = zigzag_encode((int64_t)((uint64_t)delta - (uint64_t)state->prev_delta));
+    }
+    size_t len = varint_len(ts_token);
+
+    uint32_t residuals[TS_CODEC_MAX_CHANNELS];
+    uint64_t tokens[TS_CODEC_MAX_CHANNELS];
+    for (uint8_t i = 0; i < channels; i++)
+    {
+        residuals[i] = value_residual(state, i, values[i]);
+        tokens[i] = residuals[i];
+        if (state->config.dictionary)
+        {
+            // El bit bajo indica si el token es un indice del diccionario o el residuo literal
+            int index = dict_find(&state->dict[i], residuals[i]);
+            tokens[i] = (index >= 0) ? (((uint64_t)index << 1) | 1) : ((uint64_t)residuals[i] << 1);
+        }
+        len += varint_len(tokens[i]);
+    }
+    if (enc->len + len > enc->capacity)
+    {
+        return TS_CODEC_ERR_FULL;
+    }
+
+    enc->len += varint_write(&enc->buf[enc->len], ts_token);
+    for (uint8_t i = 0; i < channels; i++)
+    {
+        enc->len += varint_write(&enc->buf[enc->len], tokens[i]);
+        if (state->config.dictionary && (tokens[i] & 1) == 0 && residuals[i] >= DICT_MIN_RESIDUAL)
+        {
+            dict_insert(&state->dict[i], residuals[i]);
+        }
+        state->prev[i] = (uint32_t)values[i];
+    }
+    state->prev_delta = delta;
+    state->prev_ts = timestamp;
+    state->count++;
+    return 0;
+}
+
+void ts_codec_encoder_reset(ts_codec_encoder_t *enc)
+{
+    const ts_codec_config_t *config = &enc->state.config;
+    state_reset(&enc->state);
+    enc->buf[0] = (uint8_t)(config->channels | ((config->mode == TS_CODEC_XOR) ? HEADER_XOR : 0) |
+                            (config->dictionary ? HEADER_DICT : 0) | (TS_CODEC_VERSION << HEADER_VERSION_SHIFT));
+    enc->len = TS_CODEC_HEADER_LEN;
+}
+
+int ts_codec_decoder_init(ts_codec_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    if (len < TS_CODEC_HEADER_LEN || (data[0] >> HEADER_VERSION_SHIFT) != TS_CODEC_VERSION)
+    {
+        return TS_CODEC_ERR_INVALID;
+    }
+    uint8_t channels = data[0] & HEADER_CHANNELS_MASK;
+    if (channels == 0 || channels > TS_CODEC_MAX_CHANNELS)
+    {
+        return TS_CODEC_ERR_INVALID;
+    }
+    dec->state.config.channels = channels;
+    dec->state.config.mode = (data[0] & HEADER_XOR) ? TS_CODEC_XOR : TS_CODEC_DELTA;
+    dec->state.config.dictionary = (data[0] & HEADER_DICT) != 0;
+    state_reset(&dec->state);
+    dec->data = data;
+    dec->len = len;
+    dec->pos = TS_CODEC_HEADER_LEN;
+    return 0;
+}
+
+int ts_codec_decoder_next(ts_codec_decoder_t *dec, int64_t *timestamp, int32_t *values)
+{
+    ts_codec_state_t *state = &dec->state;
+    uint64_t token;
+    int ret = varint_read(dec, &token);
+    if (ret <= 0)
+    {
+        return ret;
+    }
+    int64_t ts;
+    int64_t delta = 0;
+    if (state->count == 0)
+    {
+        ts = zigzag_decode(token);
+    }
+    else
+    {
+        delta = (int64_t)((uint64_t)state->prev_delta + (uint64_t)zigzag_decode(token));
+        ts = (int64_t)((uint64_t)state->prev_ts + (uint64_t)delta);
+    }
+
+    // Los valores se escriben en values a medida que se leen, si el registro esta cortado se descarta igual
+    for (uint8_t i = 0; i < state->config.channels; i++)
+    {
+        ret = varint_read(dec, &token);
+        if (ret <= 0)
+        {
+            return ret;
+        }
+        uint64_t residual = token;
+        if (state->config.dictionary)
+        {
+            residual = token >> 1;
+            if (token & 1)
+            {
+                if (residual >= TS_CODEC_DICT_SIZE)
+                {
+                    return TS_CODEC_ERR_INVALID;
+                }
+                residual = state->dict[i].entries[residual];
+            }
+            else if (residual >= DICT_MIN_RESIDUAL && residual <= UINT32_MAX)
+            {
+                dict_insert(&state->dict[i], (uint32_t)residual);
+            }
+        }
+        if (residual > UINT32_MAX)
+        {
+            return TS_CODEC_ERR_INVALID;
+        }
+        values[i] = value_from_residual(state, i, (uint32_t)residual);
+        state->prev[i] = (uint32_t)values[i];
+    }
+    state->prev_delta = delta;
+    state->prev_ts = ts;
+    state->count++;
+    *timestamp = ts;
+    return 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void state_reset(ts_codec_state_t *state)
+{
+    state->count = 0;
+    state->prev_ts = 0;
+    state->prev_delta = 0;
+    memset(state->prev, 0, sizeof(state->prev));
+    memset(state->dict, 0, sizeof(state->dict));
+}
+
+static uint32_t value_residual(const ts_codec_state_t *state, uint8_t channel, int32_t value)
+{
+    if (state->config.mode == TS_CODEC_XOR)
+    {
+        return (uint32_t)value ^ state->prev[channel];
+    }
+    // La resta modulo 2^32 siempre entra en 32 bits, aunque la diferencia real no entre en un int32
+    return (uint32_t)zigzag_encode((int32_t)((uint32_t)value - state->prev[channel]));
+}
+
+static int32_t value_from_residual(const ts_codec_state_t *state, uint8_t channel, uint32_t residual)
+{
+    if (state->config.mode == TS_CODEC_XOR)
+    {
+        return (int32_t)(residual ^ state->prev[channel]);
+    }
+    return (int32_t)(state->prev[channel] + (uint32_t)zigzag_decode(residual));
+}
+
+static int dict_find(const ts_codec_dict_t *dict, uint32_t residual)
+{
+    if (residual < DICT_MIN_RESIDUAL)
+    {
+        return -1;
+    }
+    for (int i = 0; i < TS_CODEC_DICT_SIZE; i++)
+    {
+        if (dict->entries[i] == residual)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void dict_insert(ts_codec_dict_t *dict, uint32_t residual)
+{
+    // Reemplaza la entrada mas vieja
+    dict->entries[dict->next] = residual;
+    dict->next = (uint8_t)((dict->next + 1) % TS_CODEC_DICT_SIZE);
+}
+
+static uint64_t zigzag_encode(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_len(uint64_t value)
+{
+    size_t len = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        len++;
+    }
+    return len;
+}
+
+static size_t varint_write(uint8_t *out, uint64_t value)
+{
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+static int varint_read(ts_codec_decoder_t *dec, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (unsigned i = 0; i < VARINT_MAX_LEN; i++)
+    {
+        if (dec->pos >= dec->len)
+        {
+            // Bloque cortado, las llamadas siguientes tambien devuelven 0
+            return 0;
+        }
+        uint8_t byte = dec->data[dec->pos++];
+        result |= (uint64_t)(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return 1;
+        }
+    }
+    return TS_CODEC_ERR_INVALID;
+}
@@ -0,0 +1,399 @@
+//=====[Libraries]=============================================================
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "actuator_packet.h"
+#include "actuator_rx.h"
+#include "spsc_queue.h"
+
+//=====[Declaration of private defines]========================================
+
+#define QUEUE_MAX 64
+#define RX_POLL_MS 100
+#define DRAIN_TIMEOUT_NS 2000000000ULL
+#define NOT_EXECUTED UINT64_MAX
+
+//=====[Declaration of private data types]=====================================
+
+// Hace de dispositivo: la tarea de recepcion y la del actuador, con la misma funcion de recepcion y la misma cola
+typedef struct
+{
+    int sock;
+    uint8_t key[ACTUATOR_CMD_KEY_LEN];
+    uint32_t count;
+    actuator_rx_t rx;
+    uint32_t seq_stores;
+    spsc_queue_t queue;
+    actuator_cmd_t storage[QUEUE_MAX];
+    sem_t wake;
+    atomic_bool stop;
+    atomic_uint executed;
+    atomic_uint busy;
+    atomic_uint rejected;
+    uint64_t *send_ns;
+    uint64_t *received_ns;
+    uint64_t *packet_latency_ns;
+    uint64_t *send_latency_ns;
+} bench_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void *rx_thread(void *arg);
+
+static void *actuator_thread(void *arg);
+
+static void on_command(bench_t *bench, const actuator_cmd_t *cmd);
+
+static int store_seq(uint32_t reserved, void *ctx);
+
+static int send_commands(bench_t *bench, int sock, unsigned rate, uint8_t first_packet[ACTUATOR_CMD_PACKET_LEN]);
+
+static int check_replay(bench_t *bench, int sock, const uint8_t packet[ACTUATOR_CMD_PACKET_LEN]);
+
+static void print_percentiles(const char *name, const uint64_t *latencies, uint32_t count);
+
+static int compare_u64(const void *a, const void *b);
+
+static uint64_t now_ns(void);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    uint32_t count = 100000;
+    unsigned rate = 10000;
+    uint32_t queue_len = 8;
+    uint32_t seq_reserve = 1024;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:q:b:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            count = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rate = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'q':
+            queue_len = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            seq_reserve = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            count = 0;
+            break;
+        }
+    }
+    if (count == 0 || queue_len > QUEUE_MAX || seq_reserve == 0 || optind != argc)
+    {
+        fprintf(stderr, "usage: %s [-n commands] [-r commands/s, 0 sin limite] [-q queue length (power of 2, max %d)]"
+                        " [-b sequence numbers reserved per store]\n",
+                argv[0], QUEUE_MAX);
+        return 1;
+    }
+
+    static bench_t bench;
+    bench.count = count;
+    for (size_t i = 0; i < sizeof(bench.key); i++)
+    {
+        bench.key[i] = (uint8_t)rand();
+    }
+    if (spsc_queue_init(&bench.queue, bench.storage, sizeof(actuator_cmd_t), queue_len) != 0)
+    {
+        fprintf(stderr, "queue length must be a power of 2\n");
+        return 1;
+    }
+    bench.rx = (actuator_rx_t){
+        .key = bench.key,
+        .queue = &bench.queue,
+        .seq_reserve = seq_reserve,
+        .store_seq = store_seq,
+        .store_ctx = &bench,
+    };
+    bench.send_ns = calloc(count, sizeof(uint64_t));
+    bench.received_ns = calloc(count, sizeof(uint64_t));
+    bench.packet_latency_ns = malloc(count * sizeof(uint64_t));
+    bench.send_latency_ns = malloc(count * sizeof(uint64_t));
+    if (bench.send_ns == NULL || bench.received_ns == NULL || bench.packet_latency_ns == NULL ||
+        bench.send_latency_ns == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bench.packet_latency_ns[i] = NOT_EXECUTED;
+        bench.send_latency_ns[i] = NOT_EXECUTED;
+    }
+    sem_init(&bench.wake, 0, 0);
+
+    // El endpoint escucha en localhost, el emisor es un socket conectado a ese puerto
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addr_len = sizeof(addr);
+    bench.sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+    struct timeval poll = {.tv_sec = 0, .tv_usec = RX_POLL_MS * 1000};
+    if (bench.sock < 0 || sender < 0 || bind(bench.sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        getsockname(bench.sock, (struct sockaddr *)&addr, &addr_len) != 0 ||
+        setsockopt(bench.sock, SOL_SOCKET, SO_RCVTIMEO, &poll, sizeof(poll)) != 0 ||
+        connect(sender, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    pthread_t rx_id;
+    pthread_t actuator_id;
+    pthread_create(&actuator_id, NULL, actuator_thread, &bench);
+    pthread_create(&rx_id, NULL, rx_thread, &bench);
+
+    if (rate > 0)
+    {
+        printf("%" PRIu32 " commands at %u/s, queue %" PRIu32 "\n", count, rate, queue_len);
+    }
+    else
+    {
+        printf("%" PRIu32 " commands unpaced, queue %" PRIu32 "\n", count, queue_len);
+    }
+    uint8_t first_packet[ACTUATOR_CMD_PACKET_LEN];
+    int ret = send_commands(&bench, sender, rate, first_packet);
+
+    // Espera a que cada comando se ejecute o se rechace
+    uint64_t deadline_ns = now_ns() + DRAIN_TIMEOUT_NS;
+    while (atomic_load(&bench.executed) + atomic_load(&bench.busy) + atomic_load(&bench.rejected) < count &&
+           now_ns() < deadline_ns)
+    {
+        usleep(1000);
+    }
+    // Los que faltan se perdieron en el socket UDP, sin llegar al parser
+    unsigned handled = atomic_load(&bench.executed) + atomic_load(&bench.busy) + atomic_load(&bench.rejected);
+    printf("executed %u, busy %u, rejected %u, lost %u, sequence stores %" PRIu32 "\n\n", atomic_load(&bench.executed),
+           atomic_load(&bench.busy), atomic_load(&bench.rejected), count - handled, bench.seq_stores);
+
+    printf("%-18s %9s %9s %9s %9s %9s\n", "latency (us)", "p50", "p90", "p99", "p99.9", "max");
+    print_percentiles("packet->callback", bench.packet_latency_ns, count);
+    print_percentiles("send->callback", bench.send_latency_ns, count);
+
+    if (ret == 0)
+    {
+        ret = check_replay(&bench, sender, first_packet);
+    }
+
+    atomic_store(&bench.stop, true);
+    sem_post(&bench.wake);
+    pthread_join(rx_id, NULL);
+    pthread_join(actuator_id, NULL);
+    close(sender);
+    close(bench.sock);
+    return ret;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void *rx_thread(void *arg)
+{
+    // Mismo camino que rx_task: actuator_rx_handle valida, reserva el numero y encola, despues el aviso y el ACK
+    bench_t *bench = (bench_t *)arg;
+    uint8_t packet[ACTUATOR_CMD_PACKET_LEN + 1];
+    uint8_t ack[ACTUATOR_CMD_ACK_LEN];
+    while (!atomic_load(&bench->stop))
+    {
+        struct sockaddr_storage source_addr;
+        socklen_t addr_len = sizeof(source_addr);
+        ssize_t len = recvfrom(bench->sock, packet, sizeof(packet), 0, (struct sockaddr *)&source_addr, &addr_len);
+        if (len < 0)
+        {
+            continue;
+        }
+        uint64_t received_ns = now_ns();
+
+        // El emisor es el benchmark, el numero sin verificar alcanza para guardar cuando llego el paquete
+        uint32_t seq = actuator_packet_seq(packet, (size_t)len);
+        if (seq >= 1 && seq <= bench->count && bench->received_ns[seq - 1] == 0)
+        {
+            bench->received_ns[seq - 1] = received_ns;
+        }
+
+        actuator_status_t status = actuator_rx_handle(&bench->rx, packet, (size_t)len, (int64_t)(received_ns / 1000), ack);
+        if (status == ACTUATOR_STATUS_OK)
+        {
+            sem_post(&bench->wake);
+        }
+        else if (status == ACTUATOR_STATUS_BUSY)
+        {
+            atomic_fetch_add(&bench->busy, 1);
+        }
+        else
+        {
+            atomic_fetch_add(&bench->rejected, 1);
+        }
+
+        sendto(bench->sock, ack, sizeof(ack), 0, (struct sockaddr *)&source_addr, addr_len);
+    }
+    return NULL;
+}
+
+static void *actuator_thread(void *arg)
+{
+    bench_t *bench = (bench_t *)arg;
+    actuator_cmd_t cmd;
+    while (1)
+    {
+        sem_wait(&bench->wake);
+        if (atomic_load(&bench->stop))
+        {
+            return NULL;
+        }
+        while (spsc_queue_pop(&bench->queue, &cmd))
+        {
+            on_command(bench, &cmd);
+            atomic_fetch_add(&bench->executed, 1);
+        }
+    }
+}
+
+static void on_command(bench_t *bench, const actuator_cmd_t *cmd)
+{
+    // Hace de callback del actuador, solo registra cuando se ejecuto
+    uint64_t executed_ns = now_ns();
+    if (cmd->seq >= 1 && cmd->seq <= bench->count)
+    {
+        bench->packet_latency_ns[cmd->seq - 1] = executed_ns - bench->received_ns[cmd->seq - 1];
+        bench->send_latency_ns[cmd->seq - 1] = executed_ns - bench->send_ns[cmd->seq - 1];
+    }
+}
+
+static int store_seq(uint32_t reserved, void *ctx)
+{
+    // Hace de NVS, el numero queda en memoria y la escritura de la flash no entra en la medicion
+    bench_t *bench = (bench_t *)ctx;
+    (void)reserved;
+    bench->seq_stores++;
+    return 0;
+}
+
+static int send_commands(bench_t *bench, int sock, unsigned rate, uint8_t first_packet[ACTUATOR_CMD_PACKET_LEN])
+{
+    // Los comandos salen a intervalos fijos, sin esperar el ACK, como un emisor que controla el actuador
+    uint64_t start_ns = now_ns();
+    for (uint32_t seq = 1; seq <= bench->count; seq++)
+    {
+        actuator_cmd_t cmd = {
+            .actuator = 0,
+            .op = ACTUATOR_OP_SET,
+            .seq = seq,
+            .value = (int32_t)(seq & 1),
+            .duration_ms = 0,
+        };
+        uint8_t packet[ACTUATOR_CMD_PACKET_LEN];
+        if (actuator_packet_encode(bench->key, &cmd, packet) != 0)
+        {
+            fprintf(stderr, "cannot sign command %" PRIu32 "\n", seq);
+            return 1;
+        }
+        if (seq == 1)
+        {
+            memcpy(first_packet, packet, sizeof(packet));
+        }
+
+        if (rate > 0)
+        {
+            uint64_t due_ns = start_ns + (uint64_t)(seq - 1) * 1000000000ULL / rate;
+            while (now_ns() < due_ns)
+            {
+            }
+        }
+        bench->send_ns[seq - 1] = now_ns();
+        if (send(sock, packet, sizeof(packet), 0) != (ssize_t)sizeof(packet))
+        {
+            perror("send");
+            return 1;
+        }
+
+        // Descarta los ACK a medida que llegan para que no se llene el buffer del socket
+        uint8_t ack[ACTUATOR_CMD_ACK_LEN];
+        while (recv(sock, ack, sizeof(ack), MSG_DONTWAIT) > 0)
+        {
+        }
+    }
+    return 0;
+}
+
+static int check_replay(bench_t *bench, int sock, const uint8_t packet[ACTUATOR_CMD_PACKET_LEN])
+{
+    // El primer paquete repetido tiene que rechazarse y el ACK tiene que traer el ultimo numero aceptado
+    uint8_t ack[ACTUATOR_CMD_ACK_LEN];
+    while (recv(sock, ack, sizeof(ack), MSG_DONTWAIT) > 0)
+    {
+    }
+    struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (send(sock, packet, ACTUATOR_CMD_PACKET_LEN, 0) != ACTUATOR_CMD_PACKET_LEN ||
+        recv(sock, ack, sizeof(ack), 0) != (ssize_t)sizeof(ack))
+    {
+        printf("\nreplay check: no ACK\n");
+        return 1;
+    }
+    uint32_t ack_seq = actuator_packet_seq(ack, sizeof(ack));
+    bool ok = (ack[2] == ACTUATOR_STATUS_REPLAYED && ack_seq == bench->rx.last_seq);
+    printf("\nreplay check: %s, status %u, ACK seq %" PRIu32 "\n", ok ? "ok" : "FAILED", ack[2], ack_seq);
+    return ok ? 0 : 1;
+}
+
+static void print_percentiles(const char *name, const uint64_t *latencies, uint32_t count)
+{
+    uint64_t *sorted = malloc(count * sizeof(uint64_t));
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (latencies[i] != NOT_EXECUTED)
+        {
+            sorted[n++] = latencies[i];
+        }
+    }
+    if (n == 0)
+    {
+        printf("%-18s no commands executed\n", name);
+        free(sorted);
+        return;
+    }
+    qsort(sorted, n, sizeof(uint64_t), compare_u64);
+    static const double percentiles[] = {0.50, 0.90, 0.99, 0.999};
+    printf("%-18s", name);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+    {
+        printf(" %9.2f", sorted[(size_t)(percentiles[i] * (n - 1))] / 1000.0);
+    }
+    printf(" %9.2f\n", sorted[n - 1] / 1000.0);
+    free(sorted);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
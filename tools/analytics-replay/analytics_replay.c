@@ -0,0 +1,368 @@
+//=====[Libraries]=============================================================
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "analytics_engine.h"
+#include "cloud_frame.h"
+#include "ts_codec.h"
+
+//=====[Declaration of private defines]========================================
+
+#define LINE_MAX_LEN 512
+
+// Mismo formato de envio que main.c: tipo, muestra, EWMA, promedio, desvio, minimo y maximo de la ventana
+#define OUTPUT_CHANNELS 7
+
+// Lo que ocuparia cada muestra con su timestamp sin analizar ni comprimir, como samples_raw_bytes_total
+#define RAW_SAMPLE_LEN (sizeof(int64_t) + sizeof(int32_t))
+
+// Periodo de las muestras decimadas con la configuracion por defecto del componente sampling (20 kHz / 32)
+#define GENERATE_PERIOD_US 1600
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    int64_t *timestamps_us;
+    int32_t *values;
+    size_t count;
+} trace_t;
+
+// Envios por la conexion con el servidor, contando el encabezado de cada trama
+typedef struct
+{
+    ts_codec_encoder_t enc;
+    uint8_t block[CLOUD_FRAME_MAX_PAYLOAD];
+    size_t bytes;
+    size_t frames;
+} uplink_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int load_trace(const char *path, trace_t *trace);
+
+static void generate_trace(size_t seconds, trace_t *trace);
+
+static int trace_push(trace_t *trace, size_t *capacity, int64_t timestamp_us, int32_t value);
+
+static void print_rules(const analytics_rules_t *rules);
+
+static void uplink_init(uplink_t *uplink, uint8_t channels, size_t block_size);
+
+static void uplink_append(uplink_t *uplink, int64_t timestamp_ms, const int32_t *values);
+
+static void uplink_flush(uplink_t *uplink);
+
+static uint64_t now_ns(void);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    analytics_rules_t rules;
+    analytics_rules_default(&rules);
+    size_t block_size = 64;
+    size_t generate = 0;
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:B:g:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            if (analytics_rules_parse(&rules, optarg, strlen(optarg)) != 0)
+            {
+                fprintf(stderr, "invalid rules: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'B':
+            block_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            generate = strtoul(optarg, NULL, 10);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind > argc || (optind == argc) == (generate == 0))
+    {
+        fprintf(stderr, "usage: %s [-r \"key=value ...\"] [-B block_size] [-v] <trace.csv | monitor.log> | -g seconds\n",
+                argv[0]);
+        return 1;
+    }
+    if (analytics_rules_validate(&rules) != 0)
+    {
+        fprintf(stderr, "invalid rules, the window must be 1 to %u samples and low <= high\n", ANALYTICS_WINDOW_MAX);
+        return 1;
+    }
+    if (block_size < TS_CODEC_HEADER_LEN + TS_CODEC_RECORD_MAX(OUTPUT_CHANNELS) || block_size > CLOUD_FRAME_MAX_PAYLOAD)
+    {
+        fprintf(stderr, "block size must be %u to %u bytes\n", TS_CODEC_HEADER_LEN + TS_CODEC_RECORD_MAX(OUTPUT_CHANNELS),
+                CLOUD_FRAME_MAX_PAYLOAD);
+        return 1;
+    }
+
+    trace_t trace;
+    if (generate > 0)
+    {
+        generate_trace(generate, &trace);
+    }
+    else if (load_trace(argv[optind], &trace) != 0)
+    {
+        fprintf(stderr, "%s: no samples found\n", argv[optind]);
+        return 1;
+    }
+    double duration_s = (double)(trace.timestamps_us[trace.count - 1] - trace.timestamps_us[0]) / 1e6;
+    printf("%zu samples over %.1f s, %zu byte blocks\n", trace.count, duration_s, block_size);
+    print_rules(&rules);
+
+    // Cada muestra sin analizar, comprimida con el mismo codec, es la referencia del ahorro
+    uplink_t samples;
+    uplink_init(&samples, 1, block_size);
+    uplink_t outputs;
+    uplink_init(&outputs, OUTPUT_CHANNELS, block_size);
+
+    // Primero se mide solo el motor, sin los envios ni leer el reloj en cada muestra
+    analytics_engine_t engine;
+    analytics_engine_init(&engine, &rules);
+    uint64_t start_ns = now_ns();
+    for (size_t i = 0; i < trace.count; i++)
+    {
+        analytics_output_t out[ANALYTICS_MAX_OUTPUTS];
+        analytics_engine_update(&engine, trace.timestamps_us[i] / 1000, trace.values[i], out);
+    }
+    uint64_t engine_ns = now_ns() - start_ns;
+
+    analytics_engine_init(&engine, &rules);
+    size_t counts[ANALYTICS_OUTPUT_COUNT] = {0};
+    for (size_t i = 0; i < trace.count; i++)
+    {
+        int64_t timestamp_ms = trace.timestamps_us[i] / 1000;
+        uplink_append(&samples, timestamp_ms, &trace.values[i]);
+
+        analytics_output_t out[ANALYTICS_MAX_OUTPUTS];
+        size_t n = analytics_engine_update(&engine, timestamp_ms, trace.values[i], out);
+
+        for (size_t j = 0; j < n; j++)
+        {
+            counts[out[j].kind]++;
+            if (verbose)
+            {
+                printf("%" PRId64 " ms: %-7s value=%" PRId32 " ewma=%" PRId32 " mean=%" PRId32 " stddev=%" PRIu32
+                       " window=[%" PRId32 ", %" PRId32 "] n=%" PRIu32 "\n",
+                       out[j].timestamp_ms, analytics_output_to_name(out[j].kind), out[j].value, out[j].ewma,
+                       out[j].mean, out[j].stddev, out[j].window_min, out[j].window_max, out[j].count);
+            }
+            int32_t values[OUTPUT_CHANNELS] = {
+                (int32_t)out[j].kind,
+                out[j].value,
+                out[j].ewma,
+                out[j].mean,
+                (int32_t)out[j].stddev,
+                out[j].window_min,
+                out[j].window_max,
+            };
+            uplink_append(&outputs, out[j].timestamp_ms, values);
+
+            // Igual que en el dispositivo, los eventos salen enseguida y los resumenes esperan a llenar el bloque
+            if (out[j].kind != ANALYTICS_OUTPUT_SUMMARY)
+            {
+                uplink_flush(&outputs);
+            }
+        }
+    }
+    uplink_flush(&samples);
+    uplink_flush(&outputs);
+
+    printf("\noutputs:");
+    for (int i = 0; i < ANALYTICS_OUTPUT_COUNT; i++)
+    {
+        printf(" %s=%zu", analytics_output_to_name(i), counts[i]);
+    }
+    size_t raw_len = trace.count * RAW_SAMPLE_LEN;
+    printf("\n\n%-20s %12s %9s %10s\n", "uplink", "bytes", "frames", "B/sample");
+    printf("%-20s %12zu %9s %10.3f\n", "raw samples", raw_len, "-", (double)raw_len / (double)trace.count);
+    printf("%-20s %12zu %9zu %10.3f\n", "compressed samples", samples.bytes, samples.frames,
+           (double)samples.bytes / (double)trace.count);
+    printf("%-20s %12zu %9zu %10.3f\n", "analytics outputs", outputs.bytes, outputs.frames,
+           (double)outputs.bytes / (double)trace.count);
+    printf("\nsuppressed: %.3f%% of the raw bytes, %.3f%% of the compressed samples\n",
+           100.0 * (1.0 - (double)outputs.bytes / (double)raw_len),
+           100.0 * (1.0 - (double)outputs.bytes / (double)samples.bytes));
+    printf("engine: %.1f ns/sample, %zu bytes of state\n", (double)engine_ns / (double)trace.count, sizeof(engine));
+
+    free(trace.timestamps_us);
+    free(trace.values);
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int load_trace(const char *path, trace_t *trace)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    memset(trace, 0, sizeof(*trace));
+    size_t capacity = 0;
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        long long timestamp;
+        unsigned sequence;
+        unsigned count;
+        int32_t min;
+        int32_t max;
+        int32_t mean;
+
+        // Log del monitor: solo trae el promedio de uno de cada 64 bloques, que se toma como la muestra
+        const char *block = strstr(line, "Block ");
+        if (block != NULL && sscanf(block, "Block %u at %lld ms: n=%u min=%" SCNd32 " max=%" SCNd32 " mean=%" SCNd32,
+                                    &sequence, &timestamp, &count, &min, &max, &mean) == 6)
+        {
+            if (trace_push(trace, &capacity, timestamp * 1000, mean) != 0)
+            {
+                break;
+            }
+            continue;
+        }
+
+        // CSV con el timestamp en ms y el valor, las lineas que no empiezan con un numero se saltean
+        char *end;
+        timestamp = strtoll(line, &end, 10);
+        if (end == line || *end != ',')
+        {
+            continue;
+        }
+        char *cursor = end + 1;
+        long value = strtol(cursor, &end, 10);
+        if (end != cursor && trace_push(trace, &capacity, timestamp * 1000, (int32_t)value) != 0)
+        {
+            break;
+        }
+    }
+    fclose(file);
+    return (trace->count > 0) ? 0 : -1;
+}
+
+static void generate_trace(size_t seconds, trace_t *trace)
+{
+    // Deriva lenta del ADC de 12 bits con ruido, y cada 5 minutos una excursion de 20 s que cruza los 3000
+    memset(trace, 0, sizeof(*trace));
+    size_t capacity = 0;
+    uint32_t seed = 12345;
+    int64_t timestamp_us = 1735689600000000LL;
+    size_t count = seconds * 1000000 / GENERATE_PERIOD_US;
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int noise = (int)(seed >> 27) - 16;
+        double t = (double)i * GENERATE_PERIOD_US / 1e6;
+        double value = 2048 + 300 * sin(t / 100.0) + noise;
+        if (fmod(t, 300.0) >= 200.0 && fmod(t, 300.0) < 220.0)
+        {
+            value += 1200;
+        }
+        trace_push(trace, &capacity, timestamp_us, (int32_t)value);
+        timestamp_us += GENERATE_PERIOD_US;
+    }
+}
+
+static int trace_push(trace_t *trace, size_t *capacity, int64_t timestamp_us, int32_t value)
+{
+    if (trace->count == *capacity)
+    {
+        *capacity = (*capacity == 0) ? 4096 : *capacity * 2;
+        int64_t *timestamps = realloc(trace->timestamps_us, *capacity * sizeof(int64_t));
+        int32_t *values = realloc(trace->values, *capacity * sizeof(int32_t));
+        if (timestamps == NULL || values == NULL)
+        {
+            return -1;
+        }
+        trace->timestamps_us = timestamps;
+        trace->values = values;
+    }
+    trace->timestamps_us[trace->count] = timestamp_us;
+    trace->values[trace->count] = value;
+    trace->count++;
+    return 0;
+}
+
+static void print_rules(const analytics_rules_t *rules)
+{
+    printf("rules:");
+    for (size_t i = 0; i < analytics_rule_field_count; i++)
+    {
+        const analytics_rule_field_t *field = &analytics_rule_fields[i];
+        const uint8_t *value = (const uint8_t *)rules + field->offset;
+        switch (field->type)
+        {
+        case ANALYTICS_RULE_U8:
+            printf(" %s=%u", field->key, *value);
+            break;
+        case ANALYTICS_RULE_U16:
+            printf(" %s=%u", field->key, *(const uint16_t *)value);
+            break;
+        case ANALYTICS_RULE_U32:
+            printf(" %s=%" PRIu32, field->key, *(const uint32_t *)value);
+            break;
+        case ANALYTICS_RULE_I32:
+            printf(" %s=%" PRId32, field->key, *(const int32_t *)value);
+            break;
+        }
+    }
+    printf("\n");
+}
+
+static void uplink_init(uplink_t *uplink, uint8_t channels, size_t block_size)
+{
+    ts_codec_config_t config = {
+        .channels = channels,
+        .mode = TS_CODEC_DELTA,
+        .dictionary = true,
+    };
+    ts_codec_encoder_init(&uplink->enc, &config, uplink->block, block_size);
+    uplink->bytes = 0;
+    uplink->frames = 0;
+}
+
+static void uplink_append(uplink_t *uplink, int64_t timestamp_ms, const int32_t *values)
+{
+    if (ts_codec_encoder_append(&uplink->enc, timestamp_ms, values) == TS_CODEC_ERR_FULL)
+    {
+        uplink_flush(uplink);
+        ts_codec_encoder_append(&uplink->enc, timestamp_ms, values);
+    }
+}
+
+static void uplink_flush(uplink_t *uplink)
+{
+    if (uplink->enc.state.count == 0)
+    {
+        return;
+    }
+    uplink->bytes += CLOUD_FRAME_HEADER_LEN + uplink->enc.len;
+    uplink->frames++;
+    ts_codec_encoder_reset(&uplink->enc);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,201 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cloud_link.h"
+#include "cloud_frame.h"
+
+//=====[Declaration of private defines]========================================
+
+#define SESSION_MAX 1024
+#define ACK_TIMEOUT_MS 2000
+#define IO_TIMEOUT_MS 5000
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    int acked;
+    int commands;
+} client_state_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static char *read_file(const char *path);
+
+static double now_ms(void);
+
+static int exchange(cloud_link_t *link);
+
+static void on_frame(const cloud_frame_t *frame, void *ctx);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "usage: %s <host> <port> <ca.pem> [connections] [session file]\n", argv[0]);
+        return 1;
+    }
+    int connections = (argc > 4) ? atoi(argv[4]) : 5;
+    const char *session_path = (argc > 5) ? argv[5] : NULL;
+
+    char *ca_pem = read_file(argv[3]);
+    if (ca_pem == NULL)
+    {
+        fprintf(stderr, "cannot read %s\n", argv[3]);
+        return 1;
+    }
+
+    cloud_link_t link;
+    cloud_link_config_t config = {
+        .host = argv[1],
+        .port = argv[2],
+        .ca_pem = ca_pem,
+        .timeout_ms = IO_TIMEOUT_MS,
+    };
+    int ret = cloud_link_init(&link, &config);
+    if (ret != 0)
+    {
+        fprintf(stderr, "error -0x%04x initializing TLS\n", -ret);
+        return 1;
+    }
+
+    // El archivo hace de NVS, la sesion sobrevive entre ejecuciones igual que en el dispositivo
+    static uint8_t session[SESSION_MAX];
+    size_t session_len = 0;
+    if (session_path != NULL)
+    {
+        FILE *f = fopen(session_path, "rb");
+        if (f != NULL)
+        {
+            session_len = fread(session, 1, sizeof(session), f);
+            fclose(f);
+        }
+    }
+
+    unsigned counts[CLOUD_LINK_HANDSHAKE_COUNT] = {0};
+    double totals_ms[CLOUD_LINK_HANDSHAKE_COUNT] = {0};
+    for (int i = 0; i < connections; i++)
+    {
+        cloud_link_handshake_t handshake;
+        double start_ms = now_ms();
+        ret = cloud_link_connect(&link, session_len ? session : NULL, session_len, &handshake);
+        double elapsed_ms = now_ms() - start_ms;
+        if (ret != 0)
+        {
+            fprintf(stderr, "connection %d: error -0x%04x\n", i, -ret);
+            session_len = 0;
+            continue;
+        }
+        counts[handshake]++;
+        totals_ms[handshake] += elapsed_ms;
+        printf("connection %d: %s handshake in %.1f ms\n", i, cloud_link_handshake_to_name(handshake), elapsed_ms);
+
+        if (cloud_link_save_session(&link, session, sizeof(session), &session_len) != 0)
+        {
+            session_len = 0;
+        }
+        if (exchange(&link) != 0)
+        {
+            fprintf(stderr, "connection %d: no ACK from server\n", i);
+        }
+        cloud_link_close(&link);
+    }
+
+    if (session_path != NULL && session_len > 0)
+    {
+        FILE *f = fopen(session_path, "wb");
+        if (f != NULL)
+        {
+            fwrite(session, 1, session_len, f);
+            fclose(f);
+        }
+    }
+
+    printf("\n%-8s %6s %10s\n", "kind", "count", "mean ms");
+    for (int i = 0; i < CLOUD_LINK_HANDSHAKE_COUNT; i++)
+    {
+        if (counts[i] > 0)
+        {
+            printf("%-8s %6u %10.1f\n", cloud_link_handshake_to_name(i), counts[i], totals_ms[i] / counts[i]);
+        }
+    }
+
+    cloud_link_free(&link);
+    free(ca_pem);
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    if (data != NULL)
+    {
+        size_t len = fread(data, 1, (size_t)size, f);
+        data[len] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int exchange(cloud_link_t *link)
+{
+    // Un UPLINK y un PING por la misma conexion, como hace el dispositivo
+    static const uint8_t sample[] = {0x01, 0x02, 0x03, 0x04};
+    uint8_t frame[CLOUD_FRAME_HEADER_LEN + sizeof(sample)];
+    size_t len = cloud_frame_encode(CLOUD_FRAME_UPLINK, 0, sample, sizeof(sample), frame, sizeof(frame));
+    if (cloud_link_write(link, frame, len) != 0)
+    {
+        return -1;
+    }
+
+    client_state_t state = {0};
+    cloud_frame_parser_t parser;
+    cloud_frame_parser_init(&parser, on_frame, &state);
+    uint8_t buf[256];
+    double deadline_ms = now_ms() + ACK_TIMEOUT_MS;
+    while (!state.acked && now_ms() < deadline_ms)
+    {
+        int ret = cloud_link_read(link, buf, sizeof(buf), 100);
+        if (ret < 0 || (ret > 0 && cloud_frame_parser_feed(&parser, buf, (size_t)ret) != 0))
+        {
+            return -1;
+        }
+    }
+    return state.acked ? 0 : -1;
+}
+
+static void on_frame(const cloud_frame_t *frame, void *ctx)
+{
+    client_state_t *state = (client_state_t *)ctx;
+    if (frame->type == CLOUD_FRAME_ACK)
+    {
+        state->acked = 1;
+    }
+    else if (frame->type == CLOUD_FRAME_COMMAND)
+    {
+        state->commands++;
+    }
+}
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Genera una CA y un certificado de servidor ECDSA P-256 para el servidor local
+# uso: gen_certs.sh <host o IP del servidor> [directorio del proyecto]
+set -e
+
+HOST=${1:?uso: gen_certs.sh <host o IP del servidor> [directorio del proyecto]}
+PROJECT=${2:-../../4-sensor-node}
+OUT=certs
+
+mkdir -p "$OUT"
+openssl ecparam -name prime256v1 -genkey -noout -out "$OUT/ca.key"
+openssl req -new -x509 -key "$OUT/ca.key" -subj "/CN=Sensor node test CA" -days 3650 -out "$OUT/ca.pem"
+
+openssl ecparam -name prime256v1 -genkey -noout -out "$OUT/server.key"
+openssl req -new -key "$OUT/server.key" -subj "/CN=$HOST" -out "$OUT/server.csr"
+
+# mbedTLS compara el nombre con el SAN, las versiones anteriores a la 3.6 solo miran las entradas DNS
+if echo "$HOST" | grep -Eq '^[0-9.]+$'; then
+    SAN="IP:$HOST,DNS:$HOST"
+else
+    SAN="DNS:$HOST"
+fi
+printf "subjectAltName=%s\n" "$SAN" > "$OUT/server.ext"
+openssl x509 -req -in "$OUT/server.csr" -CA "$OUT/ca.pem" -CAkey "$OUT/ca.key" -CAcreateserial \
+    -days 825 -extfile "$OUT/server.ext" -out "$OUT/server.pem"
+rm "$OUT/server.csr" "$OUT/server.ext"
+
+# El componente cloud_conn embebe la CA del directorio del proyecto
+cp "$OUT/ca.pem" "$PROJECT/cloud_ca.pem"
+echo "CA copied to $PROJECT/cloud_ca.pem"
@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""Servidor TLS local que reemplaza al backend para probar el componente cloud_conn.
+
+    server.py --cert certs/server.pem --key certs/server.key --port 8443
+
+Atiende las tramas de cloud_frame.h: responde ACK a cada UPLINK, PONG a cada PING y
+manda un COMMAND al actuador por el canal 2 cada --command-interval segundos. Los UPLINK del canal 0 se decodifican
+con el formato de ts_codec.c y se muestran los eventos y resumenes del analisis. Con --rules
+manda las reglas del analisis por el canal 1 al conectarse el cliente. Los paquetes del modo duty cycle
+llegan por el canal 3. Emite tickets de sesion
+TLS 1.2, por lo que las reconexiones del cliente usan el handshake abreviado.
+"""
+
+import argparse
+import socketserver
+import ssl
+import struct
+import threading
+import time
+
+FRAME_UPLINK = 1
+FRAME_COMMAND = 2
+FRAME_ACK = 3
+FRAME_PING = 4
+FRAME_PONG = 5
+
+FRAME_HEADER_LEN = 4
+FRAME_MAX_PAYLOAD = 512
+
+CHANNEL_SAMPLES = 0
+CHANNEL_RULES = 1
+CHANNEL_ACTUATOR = 2
+CHANNEL_DUTY_CYCLE = 3
+
+# Mismo orden que analytics_output_kind_t
+ANALYTICS_OUTPUTS = ['summary', 'high', 'low', 'normal', 'change']
+
+TS_CODEC_VERSION = 1
+TS_CODEC_DICT_SIZE = 8
+TS_CODEC_DICT_MIN_RESIDUAL = 64
+
+
+def encode_frame(frame_type, channel, payload=b''):
+    return struct.pack('<BBH', frame_type, channel, len(payload)) + payload
+
+
+def read_varint(data, pos):
+    value = 0
+    for i in range(10):
+        if pos >= len(data):
+            return None, pos
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << (7 * i)
+        if not byte & 0x80:
+            return value, pos
+    raise ValueError('varint too long')
+
+
+def zigzag_decode(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_samples(block):
+    """Devuelve los registros (timestamp, valores) completos de un bloque de ts_codec.c."""
+    if not block or block[0] >> 6 != TS_CODEC_VERSION:
+        raise ValueError('invalid header')
+    channels = block[0] & 0x0F
+    xor = bool(block[0] & 0x10)
+    dictionary = bool(block[0] & 0x20)
+    prev = [0] * channels
+    dicts = [[0] * TS_CODEC_DICT_SIZE for _ in range(channels)]
+    dict_next = [0] * channels
+    prev_ts = prev_delta = 0
+    records = []
+    pos = 1
+    while True:
+        token, pos = read_varint(block, pos)
+        if token is None:
+            return records
+        if records:
+            delta = prev_delta + zigzag_decode(token)
+            ts = prev_ts + delta
+        else:
+            delta = 0
+            ts = zigzag_decode(token)
+        values = []
+        for i in range(channels):
+            token, pos = read_varint(block, pos)
+            # Un registro cortado al final del bloque se descarta
+            if token is None:
+                return records
+            residual = token
+            if dictionary:
+                residual = token >> 1
+                if token & 1:
+                    residual = dicts[i][residual]
+                elif residual >= TS_CODEC_DICT_MIN_RESIDUAL:
+                    dicts[i][dict_next[i]] = residual
+                    dict_next[i] = (dict_next[i] + 1) % TS_CODEC_DICT_SIZE
+            value = (residual ^ prev[i]) if xor else (prev[i] + zigzag_decode(residual))
+            value &= 0xFFFFFFFF
+            prev[i] = value
+            values.append(value - (1 << 32) if value & 0x80000000 else value)
+        records.append((ts, values))
+        prev_ts, prev_delta = ts, delta
+
+
+def read_exact(sock, n):
+    data = b''
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+class FrameHandler(socketserver.BaseRequestHandler):
+    context = None
+    command_interval = 0.0
+    rules = None
+
+    def handle(self):
+        start = time.monotonic()
+        try:
+            sock = self.context.wrap_socket(self.request, server_side=True)
+        except (ssl.SSLError, OSError) as e:
+            print(f'{self.client_address[0]}: handshake failed: {e}')
+            return
+        elapsed_ms = (time.monotonic() - start) * 1000
+        kind = 'resumed' if sock.session_reused else 'full'
+        print(f'{self.client_address[0]}: {kind} handshake in {elapsed_ms:.1f} ms, {sock.version()} {sock.cipher()[0]}')
+
+        lock = threading.Lock()
+        stop = threading.Event()
+        if self.rules:
+            sock.sendall(encode_frame(FRAME_COMMAND, CHANNEL_RULES, self.rules.encode()))
+        if self.command_interval > 0:
+            threading.Thread(target=self.send_commands, args=(sock, lock, stop), daemon=True).start()
+        try:
+            self.serve_frames(sock, lock)
+        except (ssl.SSLError, OSError) as e:
+            print(f'{self.client_address[0]}: {e}')
+        finally:
+            stop.set()
+            sock.close()
+        print(f'{self.client_address[0]}: closed')
+
+    def serve_frames(self, sock, lock):
+        while True:
+            header = read_exact(sock, FRAME_HEADER_LEN)
+            if header is None:
+                return
+            frame_type, channel, length = struct.unpack('<BBH', header)
+            if length > FRAME_MAX_PAYLOAD:
+                print(f'{self.client_address[0]}: invalid frame length {length}')
+                return
+            payload = read_exact(sock, length) if length else b''
+            if payload is None:
+                return
+
+            if frame_type == FRAME_UPLINK:
+                print(f'{self.client_address[0]}: uplink channel {channel}, {length} bytes')
+                if channel == CHANNEL_SAMPLES:
+                    self.print_samples(payload)
+                elif channel == CHANNEL_DUTY_CYCLE and len(payload) >= 8:
+                    # Mismo paquete que el modo duty cycle manda por UDP, ver duty_cycle.h
+                    records, wake = payload[2], struct.unpack_from('<I', payload, 4)[0]
+                    print(f'  duty-cycle report of wake {wake}, {records} records')
+                reply = encode_frame(FRAME_ACK, channel)
+            elif frame_type == FRAME_PING:
+                reply = encode_frame(FRAME_PONG, channel)
+            elif frame_type == FRAME_ACK:
+                print(f'{self.client_address[0]}: command on channel {channel} acknowledged')
+                continue
+            else:
+                continue
+            with lock:
+                sock.sendall(reply)
+
+    def print_samples(self, payload):
+        try:
+            records = decode_samples(payload)
+        except (ValueError, IndexError) as e:
+            print(f'{self.client_address[0]}: invalid samples block: {e}')
+            return
+        raw = len(records) * (8 + 4 * len(records[0][1])) if records else 0
+        print(f'  {len(records)} outputs, {raw} bytes uncompressed')
+        for ts, values in records:
+            # kind, value, ewma, mean, stddev, window_min, window_max
+            kind = ANALYTICS_OUTPUTS[values[0]] if 0 <= values[0] < len(ANALYTICS_OUTPUTS) else str(values[0])
+            print(f'  {ts} ms: {kind} ' + ' '.join(str(v) for v in values[1:]))
+
+    def send_commands(self, sock, lock, stop):
+        # Los comandos comparten la conexion con los datos salientes
+        value = 0
+        while not stop.wait(self.command_interval):
+            value ^= 1
+            try:
+                with lock:
+                    sock.sendall(encode_frame(FRAME_COMMAND, CHANNEL_ACTUATOR, bytes([value])))
+            except (ssl.SSLError, OSError):
+                return
+
+
+class Server(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def make_context(args):
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    # El cliente solo retoma sesiones con TLS 1.2
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(args.cert, args.key)
+    if args.psk:
+        if not hasattr(context, 'set_psk_server_callback'):
+            raise SystemExit('PSK requiere Python 3.13 o posterior')
+        key = bytes.fromhex(args.psk)
+        context.set_ciphers('PSK:ECDHE-PSK:' + context.get_ciphers()[0]['name'])
+        context.set_psk_server_callback(lambda identity: key if identity == args.psk_identity else b'')
+    return context
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--cert', default='certs/server.pem')
+    parser.add_argument('--key', default='certs/server.key')
+    parser.add_argument('--port', type=int, default=8443)
+    parser.add_argument('--command-interval', type=float, default=10.0, help='segundos entre comandos, 0 los desactiva')
+    parser.add_argument('--psk', help='clave en hexadecimal para aceptar tambien handshakes con PSK')
+    parser.add_argument('--psk-identity', default='sensor-node')
+    parser.add_argument('--rules', help='reglas del analisis, por ejemplo "high=3000 hysteresis=50"')
+    args = parser.parse_args()
+
+    FrameHandler.context = make_context(args)
+    FrameHandler.command_interval = args.command_interval
+    FrameHandler.rules = args.rules
+    server = Server(('', args.port), FrameHandler)
+    print(f'Listening on port {args.port}')
+    server.serve_forever()
+
+
+if __name__ == '__main__':
+    main()
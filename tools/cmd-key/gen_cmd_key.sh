@@ -0,0 +1,37 @@
+#!/bin/sh
+# Genera la clave de los comandos del actuador para un dispositivo y graba su particion NVS
+# Cada dispositivo tiene su propia clave, la lista de claves queda en keys/keys.csv para quien envia los comandos
+# uso: gen_cmd_key.sh <puerto serie> <id del dispositivo> [directorio del proyecto]
+set -e
+
+PORT=${1:?uso: gen_cmd_key.sh <puerto serie> <id del dispositivo> [directorio del proyecto]}
+DEVICE=${2:?uso: gen_cmd_key.sh <puerto serie> <id del dispositivo> [directorio del proyecto]}
+PROJECT=${3:-../../4-sensor-node}
+OUT=keys
+# Igual que la particion nvs de partitions.csv
+NVS_SIZE=0x6000
+
+: "${IDF_PATH:?exportar el entorno del ESP-IDF antes de ejecutar el script}"
+
+mkdir -p "$OUT"
+chmod 700 "$OUT"
+if [ -f "$OUT/keys.csv" ] && grep -q "^$DEVICE," "$OUT/keys.csv"; then
+    echo "Device $DEVICE already has a key in $OUT/keys.csv" >&2
+    exit 1
+fi
+
+KEY=$(openssl rand -hex 32)
+
+# La imagen es la del proyecto mas la clave de este dispositivo, el archivo con la clave se borra al terminar
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cp "$PROJECT/nvs_data.csv" "$WORK/nvs.csv"
+printf "cmd_auth,namespace,,\nkey,data,hex2bin,%s\n" "$KEY" >> "$WORK/nvs.csv"
+python "$IDF_PATH/components/nvs_flash/nvs_partition_generator/nvs_partition_gen.py" generate \
+    "$WORK/nvs.csv" "$WORK/nvs.bin" "$NVS_SIZE"
+python "$IDF_PATH/components/partition_table/parttool.py" --port "$PORT" \
+    --partition-table-file "$PROJECT/partitions.csv" write_partition --partition-name nvs --input "$WORK/nvs.bin"
+
+printf "%s,%s\n" "$DEVICE" "$KEY" >> "$OUT/keys.csv"
+chmod 600 "$OUT/keys.csv"
+echo "Key for $DEVICE written to the device and added to $OUT/keys.csv"
@@ -0,0 +1,320 @@
+//=====[Libraries]=============================================================
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dsp_filters.h"
+
+//=====[Declaration of private defines]========================================
+
+#define MAX_THREADS 16
+
+// Largo de la senal de prueba, se repite hasta juntar al menos MEASURE_MIN_NS
+#define SIGNAL_LEN 65536
+#define MEASURE_MIN_NS 200000000ULL
+
+#define ADC_MAX ((1 << CIC_INPUT_BITS) - 1)
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum
+{
+    STAGE_CIC,
+    STAGE_FIR,
+    STAGE_STATS,
+    STAGE_CHAIN,
+    STAGE_COUNT,
+} stage_t;
+
+typedef struct
+{
+    stage_t stage;
+    uint8_t order;
+    uint16_t cic_ratio;
+    uint16_t fir_ratio;
+    size_t frame;
+    const int32_t *signal;
+    double samples_s;
+    int32_t sink;
+} job_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *STAGE_NAMES[STAGE_COUNT] = {"cic", "fir", "stats", "chain"};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int check_cic(void);
+
+static int check_fir(void);
+
+static void *bench_job(void *arg);
+
+static void make_signal(int32_t *signal, size_t len);
+
+static uint64_t now_ns(void);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    unsigned threads = 1;
+    unsigned order = CONFIG_SAMPLING_CIC_ORDER;
+    unsigned cic_ratio = CONFIG_SAMPLING_CIC_RATIO;
+    unsigned fir_ratio = CONFIG_SAMPLING_FIR_RATIO;
+    unsigned frame = CONFIG_SAMPLING_FRAME_SAMPLES;
+    unsigned rate = CONFIG_SAMPLING_RATE_HZ;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:o:r:f:F:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            threads = (unsigned)atoi(optarg);
+            break;
+        case 'o':
+            order = (unsigned)atoi(optarg);
+            break;
+        case 'r':
+            cic_ratio = (unsigned)atoi(optarg);
+            break;
+        case 'f':
+            fir_ratio = (unsigned)atoi(optarg);
+            break;
+        case 'F':
+            frame = (unsigned)atoi(optarg);
+            break;
+        case 's':
+            rate = (unsigned)atoi(optarg);
+            break;
+        default:
+            threads = 0;
+            break;
+        }
+    }
+    if (threads == 0 || threads > MAX_THREADS || frame == 0 || frame > SIGNAL_LEN || optind != argc)
+    {
+        fprintf(stderr, "usage: %s [-t threads] [-o cic order] [-r cic ratio] [-f fir ratio] [-F frame samples] "
+                        "[-s sample rate Hz]\n", argv[0]);
+        return 1;
+    }
+
+    // Primero verifica los filtros, un resultado incorrecto invalida las mediciones
+    if (check_cic() != 0 || check_fir() != 0)
+    {
+        return 1;
+    }
+    cic_decimator_t cic;
+    fir_decimator_t fir;
+    if (cic_decimator_init(&cic, (uint8_t)order, (uint16_t)cic_ratio) != 0 ||
+        fir_decimator_init(&fir, fir_lowpass_q15, FIR_LOWPASS_TAPS, (uint16_t)fir_ratio) != 0)
+    {
+        fprintf(stderr, "invalid settings: order %u, CIC ratio %u, FIR ratio %u\n", order, cic_ratio, fir_ratio);
+        return 1;
+    }
+
+    int32_t *signal = malloc(SIGNAL_LEN * sizeof(int32_t));
+    if (signal == NULL)
+    {
+        return 1;
+    }
+    make_signal(signal, SIGNAL_LEN);
+
+    printf("\nCIC order %u ratio %u, FIR %u taps ratio %u, %u sample frames, %u threads\n\n", order, cic_ratio,
+           FIR_LOWPASS_TAPS, fir_ratio, frame, threads);
+    printf("%-6s %14s %16s %11s\n", "stage", "Msamples/s", "Msamples/s/core", "ns/sample");
+    double chain_per_core = 0;
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        // Cada hilo procesa la senal con sus propios filtros, como un nucleo por canal
+        job_t jobs[MAX_THREADS];
+        pthread_t ids[MAX_THREADS];
+        for (unsigned i = 0; i < threads; i++)
+        {
+            jobs[i] = (job_t){
+                .stage = (stage_t)s,
+                .order = (uint8_t)order,
+                .cic_ratio = (uint16_t)cic_ratio,
+                .fir_ratio = (uint16_t)fir_ratio,
+                .frame = frame,
+                .signal = signal,
+            };
+            pthread_create(&ids[i], NULL, bench_job, &jobs[i]);
+        }
+        double total = 0;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            pthread_join(ids[i], NULL);
+            total += jobs[i].samples_s;
+        }
+        double per_core = total / threads;
+        printf("%-6s %14.1f %16.1f %11.2f\n", STAGE_NAMES[s], total / 1e6, per_core / 1e6, 1e9 / per_core);
+        if (s == STAGE_CHAIN)
+        {
+            chain_per_core = per_core;
+        }
+    }
+
+    // Las muestras por segundo se cuentan a la entrada de cada etapa: la cadena y el CIC a la frecuencia del ADC
+    printf("\nchain at %u Hz uses %.3f%% of a core\n", rate, 100.0 * rate / chain_per_core);
+    free(signal);
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int check_cic(void)
+{
+    // Cada configuracion valida tiene que devolver la continua de entrada y las que no entran en 32 bits se rechazan
+    unsigned valid = 0;
+    unsigned rejected = 0;
+    for (unsigned order = 1; order <= CIC_MAX_ORDER; order++)
+    {
+        for (unsigned log2_ratio = 1; log2_ratio <= 6; log2_ratio++)
+        {
+            uint16_t ratio = (uint16_t)(1u << log2_ratio);
+            cic_decimator_t cic;
+            int ret = cic_decimator_init(&cic, (uint8_t)order, ratio);
+            if ((ret == 0) != (CIC_INPUT_BITS + order * log2_ratio <= 31))
+            {
+                printf("CIC order %u ratio %u: init returned %d\n", order, ratio, ret);
+                return -1;
+            }
+            if (ret != 0)
+            {
+                rejected++;
+                continue;
+            }
+            valid++;
+
+            int32_t in[64];
+            int32_t out[2];
+            for (size_t i = 0; i < 64; i++)
+            {
+                in[i] = ADC_MAX;
+            }
+            // El transitorio dura order muestras de salida, despues la salida es la entrada
+            for (unsigned block = 0; block < order + 2; block++)
+            {
+                size_t n = cic_decimator_process(&cic, in, ratio, out);
+                if (n != 1 || (block >= order && out[0] != ADC_MAX))
+                {
+                    printf("CIC order %u ratio %u: DC %d gives %d\n", order, ratio, ADC_MAX, out[0]);
+                    return -1;
+                }
+            }
+        }
+    }
+    printf("CIC: DC gain ok for %u configurations, %u rejected because they overflow 32 bits\n", valid, rejected);
+    return 0;
+}
+
+static int check_fir(void)
+{
+    // La respuesta al impulso sin decimar son los coeficientes y la continua pasa con ganancia unitaria
+    fir_decimator_t fir;
+    fir_decimator_init(&fir, fir_lowpass_q15, FIR_LOWPASS_TAPS, 1);
+    int32_t in[FIR_LOWPASS_TAPS] = {1 << 15};
+    int32_t out[FIR_LOWPASS_TAPS];
+    fir_decimator_process(&fir, in, FIR_LOWPASS_TAPS, out);
+    for (size_t i = 0; i < FIR_LOWPASS_TAPS; i++)
+    {
+        if (out[i] != fir_lowpass_q15[i])
+        {
+            printf("FIR: impulse response %zu is %d, expected %d\n", i, out[i], fir_lowpass_q15[i]);
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < FIR_LOWPASS_TAPS; i++)
+    {
+        in[i] = ADC_MAX;
+    }
+    fir_decimator_process(&fir, in, FIR_LOWPASS_TAPS, out);
+    if (out[FIR_LOWPASS_TAPS - 1] != ADC_MAX)
+    {
+        printf("FIR: DC %d gives %d\n", ADC_MAX, out[FIR_LOWPASS_TAPS - 1]);
+        return -1;
+    }
+    printf("FIR: impulse response and DC gain ok\n");
+    return 0;
+}
+
+static void *bench_job(void *arg)
+{
+    job_t *job = (job_t *)arg;
+    cic_decimator_t cic;
+    fir_decimator_t fir;
+    block_stats_t stats;
+    cic_decimator_init(&cic, job->order, job->cic_ratio);
+    fir_decimator_init(&fir, fir_lowpass_q15, FIR_LOWPASS_TAPS, job->fir_ratio);
+    int32_t *cic_out = malloc((job->frame / job->cic_ratio + 1) * sizeof(int32_t));
+    int32_t *fir_out = malloc((job->frame + 1) * sizeof(int32_t));
+
+    // Procesa la senal en tramas como la tarea de muestreo
+    uint64_t samples = 0;
+    uint64_t start_ns = now_ns();
+    uint64_t elapsed_ns = 0;
+    while (elapsed_ns < MEASURE_MIN_NS)
+    {
+        for (size_t pos = 0; pos + job->frame <= SIGNAL_LEN; pos += job->frame)
+        {
+            const int32_t *in = &job->signal[pos];
+            switch (job->stage)
+            {
+            case STAGE_CIC:
+                job->sink += (int32_t)cic_decimator_process(&cic, in, job->frame, cic_out);
+                break;
+            case STAGE_FIR:
+                job->sink += (int32_t)fir_decimator_process(&fir, in, job->frame, fir_out);
+                break;
+            case STAGE_STATS:
+                block_stats_reset(&stats);
+                block_stats_update(&stats, in, job->frame);
+                job->sink += block_stats_mean(&stats);
+                break;
+            case STAGE_CHAIN:
+            {
+                size_t decimated = cic_decimator_process(&cic, in, job->frame, cic_out);
+                size_t count = fir_decimator_process(&fir, cic_out, decimated, fir_out);
+                block_stats_reset(&stats);
+                block_stats_update(&stats, fir_out, count);
+                job->sink += block_stats_mean(&stats);
+                break;
+            }
+            default:
+                break;
+            }
+            samples += job->frame;
+        }
+        elapsed_ns = now_ns() - start_ns;
+    }
+    job->samples_s = (double)samples * 1e9 / (double)elapsed_ns;
+    free(cic_out);
+    free(fir_out);
+    return NULL;
+}
+
+static void make_signal(int32_t *signal, size_t len)
+{
+    // Senoidal de 50 Hz a 20 kHz de media escala con ruido, dentro del rango del ADC
+    unsigned seed = 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        double value = ADC_MAX / 2.0 + ADC_MAX / 4.0 * sin(2.0 * M_PI * 50.0 * (double)i / 20000.0) +
+                       (double)((seed >> 16) % 64) - 32.0;
+        signal[i] = (int32_t)value;
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,10 @@
+# Ejecuta event_replay con una grabacion y compara la salida con la esperada
+# cmake -DREPLAY=<event_replay> -DTRACE=<grabacion> -DEXPECTED=<salida esperada> -P check_replay.cmake
+execute_process(COMMAND ${REPLAY} ${TRACE} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "event_replay failed with ${result}")
+endif()
+file(READ ${EXPECTED} expected)
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Output differs from ${EXPECTED}:\n${output}")
+endif()
@@ -0,0 +1,436 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "evrec_format.h"
+#include "prov_sm.h"
+
+//=====[Declaration of private defines]========================================
+
+// Ventana para buscar tormentas de reconexion
+#define STORM_WINDOW_US 10000000ULL
+
+// Offsets de los payloads del ESP-IDF 5 en el ESP32 (punteros de 4 bytes)
+// wifi_event_sta_disconnected_t: ssid[32], ssid_len, bssid[6], reason, rssi
+#define DISCONNECTED_REASON_OFFSET 39
+#define DISCONNECTED_RSSI_OFFSET 40
+// ip_event_got_ip_t: esp_netif, ip_info (ip, netmask, gw), ip_changed. El if_index del ESP-IDF 4 ya no esta
+#define GOT_IP_ADDRESS_OFFSET 4
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    uint64_t time_us;
+    uint16_t event_id;
+    uint8_t base;
+    uint8_t len;
+    const uint8_t *payload;
+} event_t;
+
+typedef struct
+{
+    char names[EVREC_MAX_BASES][EVREC_BASE_NAME_LEN];
+    prov_sm_base_t sm_bases[EVREC_MAX_BASES];
+    uint8_t base_count;
+    uint32_t lost;
+    event_t *events;
+    size_t event_count;
+} recording_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *prov_event_names[] = {"INIT", "START", "CRED_RECV", "CRED_FAIL", "CRED_SUCCESS", "END", "DEINIT"};
+
+static const char *wifi_event_names[] = {"WIFI_READY", "SCAN_DONE", "STA_START", "STA_STOP", "STA_CONNECTED", "STA_DISCONNECTED"};
+
+static const char *ip_event_names[] = {"STA_GOT_IP", "STA_LOST_IP"};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static uint8_t *load_file(const char *path, size_t *len);
+
+static uint8_t *decode_uart_log(const uint8_t *text, size_t text_len, size_t *len);
+
+static int parse_recording(const uint8_t *data, size_t len, recording_t *rec);
+
+static const char *event_name(const recording_t *rec, const event_t *event, char *buf, size_t max);
+
+static void print_details(const recording_t *rec, const event_t *event);
+
+static void print_actions(uint32_t actions);
+
+static void replay(const recording_t *rec, uint64_t until_us, int quiet);
+
+static void benchmark(const recording_t *rec, unsigned iterations);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    uint64_t until_us = UINT64_MAX;
+    unsigned iterations = 0;
+    int quiet = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "u:b:q")) != -1)
+    {
+        switch (opt)
+        {
+        case 'u':
+            until_us = strtoull(optarg, NULL, 10) * 1000ULL;
+            break;
+        case 'b':
+            iterations = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'q':
+            quiet = 1;
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-q] [-u until_ms] [-b iterations] <recording.bin | monitor.log>\n", argv[0]);
+        return 1;
+    }
+
+    size_t len;
+    uint8_t *data = load_file(argv[optind], &len);
+    if (data == NULL)
+    {
+        fprintf(stderr, "cannot read %s\n", argv[optind]);
+        return 1;
+    }
+
+    // Acepta la particion leida con parttool.py o el log de la consola con las lineas EVREC:
+    if (len < sizeof(uint32_t) || *(const uint32_t *)data != EVREC_MAGIC)
+    {
+        uint8_t *decoded = decode_uart_log(data, len, &len);
+        free(data);
+        data = decoded;
+    }
+
+    recording_t rec;
+    if (data == NULL || parse_recording(data, len, &rec) != 0)
+    {
+        fprintf(stderr, "%s: not a valid recording\n", argv[optind]);
+        return 1;
+    }
+    printf("%zu events, %u lost before the recording\n\n", rec.event_count, (unsigned)rec.lost);
+
+    replay(&rec, until_us, quiet);
+    if (iterations > 0)
+    {
+        benchmark(&rec, iterations);
+    }
+
+    free(rec.events);
+    free(data);
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static uint8_t *load_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc((size_t)size + 1);
+    if (data != NULL)
+    {
+        *len = fread(data, 1, (size_t)size, f);
+        data[*len] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+static uint8_t *decode_uart_log(const uint8_t *text, size_t text_len, size_t *len)
+{
+    // Si el log tiene varios volcados se usa el ultimo
+    uint8_t *out = malloc(text_len / 2 + 1);
+    if (out == NULL)
+    {
+        return NULL;
+    }
+    size_t prefix_len = strlen(EVREC_UART_PREFIX);
+    *len = 0;
+    const char *line = (const char *)text;
+    while (line != NULL && *line != '\0')
+    {
+        const char *next = strchr(line, '\n');
+        const char *start = strstr(line, EVREC_UART_PREFIX);
+        if (start != NULL && (next == NULL || start < next))
+        {
+            start += prefix_len;
+            if (strncmp(start, "BEGIN", 5) == 0)
+            {
+                *len = 0;
+            }
+            else
+            {
+                unsigned byte;
+                while (sscanf(start, "%2x", &byte) == 1 && (next == NULL || start + 1 < next))
+                {
+                    out[(*len)++] = (uint8_t)byte;
+                    start += 2;
+                }
+            }
+        }
+        line = (next != NULL) ? next + 1 : NULL;
+    }
+    return out;
+}
+
+static int parse_recording(const uint8_t *data, size_t len, recording_t *rec)
+{
+    evrec_header_t header;
+    if (len < sizeof(header))
+    {
+        return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != EVREC_MAGIC || header.version != EVREC_VERSION || header.base_count > EVREC_MAX_BASES)
+    {
+        return -1;
+    }
+    size_t offset = sizeof(header);
+    if (len < offset + header.base_count * EVREC_BASE_NAME_LEN)
+    {
+        return -1;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    rec->base_count = header.base_count;
+    rec->lost = header.lost;
+    for (uint8_t i = 0; i < header.base_count; i++)
+    {
+        memcpy(rec->names[i], data + offset, EVREC_BASE_NAME_LEN);
+        rec->names[i][EVREC_BASE_NAME_LEN - 1] = '\0';
+        offset += EVREC_BASE_NAME_LEN;
+
+        // En la PC las bases se reconocen por el nombre, en el dispositivo por el puntero
+        if (strcmp(rec->names[i], "WIFI_PROV_EVENT") == 0)
+        {
+            rec->sm_bases[i] = PROV_SM_BASE_WIFI_PROV;
+        }
+        else if (strcmp(rec->names[i], "WIFI_EVENT") == 0)
+        {
+            rec->sm_bases[i] = PROV_SM_BASE_WIFI;
+        }
+        else if (strcmp(rec->names[i], "IP_EVENT") == 0)
+        {
+            rec->sm_bases[i] = PROV_SM_BASE_IP;
+        }
+        else
+        {
+            rec->sm_bases[i] = PROV_SM_BASE_OTHER;
+        }
+    }
+
+    rec->events = calloc(header.record_count ? header.record_count : 1, sizeof(event_t));
+    if (rec->events == NULL)
+    {
+        return -1;
+    }
+
+    // La hora se reconstruye con las diferencias entre registros, asi un reloj de 32 bits que da la vuelta no afecta
+    uint64_t virtual_us = 0;
+    uint32_t previous_us = 0;
+    for (uint32_t i = 0; i < header.record_count; i++)
+    {
+        evrec_record_t record;
+        if (len < offset + sizeof(record))
+        {
+            break;
+        }
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+        if (len < offset + record.len)
+        {
+            break;
+        }
+        if (i > 0)
+        {
+            virtual_us += (uint32_t)(record.time_us - previous_us);
+        }
+        previous_us = record.time_us;
+
+        event_t *event = &rec->events[rec->event_count++];
+        event->time_us = virtual_us;
+        event->event_id = record.event_id;
+        event->base = record.base;
+        event->len = record.len;
+        event->payload = data + offset;
+        offset += record.len;
+    }
+    if (rec->event_count != header.record_count)
+    {
+        fprintf(stderr, "recording truncated after %zu of %u events\n", rec->event_count, (unsigned)header.record_count);
+    }
+    return 0;
+}
+
+static const char *event_name(const recording_t *rec, const event_t *event, char *buf, size_t max)
+{
+    const char *base = (event->base < rec->base_count) ? rec->names[event->base] : "?";
+    const char *name = NULL;
+    prov_sm_base_t sm_base = (event->base < rec->base_count) ? rec->sm_bases[event->base] : PROV_SM_BASE_OTHER;
+    if (sm_base == PROV_SM_BASE_WIFI_PROV && event->event_id < sizeof(prov_event_names) / sizeof(prov_event_names[0]))
+    {
+        name = prov_event_names[event->event_id];
+    }
+    else if (sm_base == PROV_SM_BASE_WIFI && event->event_id < sizeof(wifi_event_names) / sizeof(wifi_event_names[0]))
+    {
+        name = wifi_event_names[event->event_id];
+    }
+    else if (sm_base == PROV_SM_BASE_IP && event->event_id < sizeof(ip_event_names) / sizeof(ip_event_names[0]))
+    {
+        name = ip_event_names[event->event_id];
+    }
+
+    if (name != NULL)
+    {
+        snprintf(buf, max, "%s/%s", base, name);
+    }
+    else
+    {
+        snprintf(buf, max, "%s/%u", base, (unsigned)event->event_id);
+    }
+    return buf;
+}
+
+static void print_details(const recording_t *rec, const event_t *event)
+{
+    prov_sm_base_t sm_base = (event->base < rec->base_count) ? rec->sm_bases[event->base] : PROV_SM_BASE_OTHER;
+    prov_sm_event_t sm_event = prov_sm_classify(sm_base, event->event_id);
+    if (sm_event == PROV_SM_EVENT_CRED_FAIL && event->len >= 1)
+    {
+        printf(" reason=%s", event->payload[0] == 0 ? "auth-error" : "ap-not-found");
+    }
+    else if (sm_event == PROV_SM_EVENT_STA_DISCONNECTED && event->len > DISCONNECTED_RSSI_OFFSET)
+    {
+        printf(" reason=%u rssi=%d", event->payload[DISCONNECTED_REASON_OFFSET], (int8_t)event->payload[DISCONNECTED_RSSI_OFFSET]);
+    }
+    else if (sm_event == PROV_SM_EVENT_GOT_IP && event->len >= GOT_IP_ADDRESS_OFFSET + 4)
+    {
+        const uint8_t *ip = &event->payload[GOT_IP_ADDRESS_OFFSET];
+        printf(" ip=%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    }
+}
+
+static void print_actions(uint32_t actions)
+{
+    if (actions & PROV_SM_ACTION_CONNECT)
+    {
+        printf(" connect");
+    }
+    if (actions & PROV_SM_ACTION_RESET_CREDENTIALS)
+    {
+        printf(" reset-credentials");
+    }
+    if (actions & PROV_SM_ACTION_DEINIT)
+    {
+        printf(" deinit");
+    }
+    if (actions & PROV_SM_ACTION_SIGNAL_CONNECTED)
+    {
+        printf(" signal-connected");
+    }
+}
+
+static void replay(const recording_t *rec, uint64_t until_us, int quiet)
+{
+    prov_sm_t sm;
+    prov_sm_init(&sm);
+
+    // Tiempos de los intentos de conexion, para encontrar la ventana con mas reintentos
+    uint64_t *connects = malloc((rec->event_count ? rec->event_count : 1) * sizeof(uint64_t));
+    size_t connect_count = 0;
+    size_t storm_peak = 0;
+    uint64_t storm_start_us = 0;
+    uint64_t now_us = 0;
+
+    for (size_t i = 0; i < rec->event_count; i++)
+    {
+        const event_t *event = &rec->events[i];
+        if (event->time_us > until_us)
+        {
+            break;
+        }
+        now_us = event->time_us;
+        prov_sm_base_t sm_base = (event->base < rec->base_count) ? rec->sm_bases[event->base] : PROV_SM_BASE_OTHER;
+        uint32_t actions = prov_sm_handle(&sm, prov_sm_classify(sm_base, event->event_id));
+
+        if (actions & PROV_SM_ACTION_CONNECT && connects != NULL)
+        {
+            connects[connect_count++] = now_us;
+            size_t first = 0;
+            while (now_us - connects[first] > STORM_WINDOW_US)
+            {
+                first++;
+            }
+            if (connect_count - first > storm_peak)
+            {
+                storm_peak = connect_count - first;
+                storm_start_us = connects[first];
+            }
+        }
+
+        if (!quiet)
+        {
+            char name[64];
+            printf("%12.3f ms  %-34s retries=%d", now_us / 1000.0, event_name(rec, event, name, sizeof(name)), sm.retries);
+            print_details(rec, event);
+            if (actions != 0)
+            {
+                printf("  ->");
+                print_actions(actions);
+            }
+            printf("\n");
+        }
+    }
+
+    printf("\nState at %.3f ms\n", now_us / 1000.0);
+    printf("  retries            %d\n", sm.retries);
+    printf("  connect attempts   %u\n", (unsigned)sm.connect_attempts);
+    printf("  credential resets  %u\n", (unsigned)sm.credential_resets);
+    printf("  connections        %u\n", (unsigned)sm.connections);
+    printf("  peak attempts/10 s %zu (from %.3f ms)\n", storm_peak, storm_start_us / 1000.0);
+    free(connects);
+}
+
+static void benchmark(const recording_t *rec, unsigned iterations)
+{
+    // Mide solo la maquina de estados, sin la salida por consola
+    struct timespec start, end;
+    volatile uint32_t sink = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned n = 0; n < iterations; n++)
+    {
+        prov_sm_t sm;
+        prov_sm_init(&sm);
+        for (size_t i = 0; i < rec->event_count; i++)
+        {
+            const event_t *event = &rec->events[i];
+            prov_sm_base_t sm_base = (event->base < rec->base_count) ? rec->sm_bases[event->base] : PROV_SM_BASE_OTHER;
+            sink += prov_sm_handle(&sm, prov_sm_classify(sm_base, event->event_id));
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    double events = (double)iterations * rec->event_count;
+    printf("\n%u iterations, %.0f events, %.1f ns/event\n", iterations, events, events > 0 ? elapsed_ns / events : 0.0);
+}
@@ -0,0 +1,447 @@
+//=====[Libraries]=============================================================
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mem_pool.h"
+
+//=====[Declaration of private defines]========================================
+
+#define MAX_THREADS 8
+#define LATENCY_BUCKETS 32
+
+// Cada tantos registros se reserva y libera un buffer de tamano variable, como hacen los stacks de red
+#define CHURN_PERIOD 8
+#define CHURN_MIN 32
+#define CHURN_MAX 1600
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum
+{
+    ALLOCATOR_POOL,
+    ALLOCATOR_MALLOC,
+} allocator_t;
+
+typedef enum
+{
+    SCENARIO_LOCAL,
+    SCENARIO_HANDOFF,
+} scenario_t;
+
+// Cola de un productor y un consumidor para pasar registros entre hilos, como la cola de envio
+typedef struct
+{
+    void **slots;
+    unsigned size;
+    atomic_uint head;
+    atomic_uint tail;
+} handoff_t;
+
+typedef struct
+{
+    allocator_t allocator;
+    mem_pool_t *pool;
+    size_t block_size;
+    unsigned window;
+    unsigned iterations;
+    uint32_t seed;
+    handoff_t *handoff;
+    uint64_t latency[LATENCY_BUCKETS];
+    uint64_t latency_total_ns;
+    uint64_t latency_max_ns;
+    uint64_t allocs;
+    uint64_t failures;
+} worker_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *ALLOCATOR_NAMES[] = {"pool", "malloc"};
+
+static const char *SCENARIO_NAMES[] = {"local", "handoff"};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void run_case(scenario_t scenario, allocator_t allocator, unsigned threads, size_t block_size, unsigned window,
+                     unsigned iterations);
+
+static void *local_worker(void *arg);
+
+static void *producer_worker(void *arg);
+
+static void *consumer_worker(void *arg);
+
+static void *record_alloc(worker_t *worker);
+
+static void record_free(worker_t *worker, void *record);
+
+static void churn(worker_t *worker);
+
+static uint32_t next_random(uint32_t *state);
+
+static uint64_t now_ns(void);
+
+static uint64_t latency_percentile(const worker_t *workers, unsigned count, double percentile);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    unsigned max_threads = 4;
+    size_t block_size = 72;
+    unsigned window = 16;
+    unsigned iterations = 2000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:w:n:")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            max_threads = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            block_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            window = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            iterations = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind != argc || max_threads == 0 || max_threads > MAX_THREADS || block_size == 0 || window == 0)
+    {
+        fprintf(stderr, "usage: %s [-t threads (1-%d)] [-b block_size] [-w live_records] [-n iterations]\n", argv[0],
+                MAX_THREADS);
+        return 1;
+    }
+
+    printf("%-8s %-7s %7s %9s %9s %9s %10s %8s\n", "scenario", "alloc", "threads", "Mops/s", "mean_ns", "p99_ns",
+           "max_ns", "failures");
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        for (allocator_t allocator = ALLOCATOR_POOL; allocator <= ALLOCATOR_MALLOC; allocator++)
+        {
+            run_case(SCENARIO_LOCAL, allocator, threads, block_size, window, iterations);
+        }
+    }
+    // Cada par es un productor que reserva y un consumidor que libera en otro hilo
+    for (unsigned pairs = 1; pairs * 2 <= max_threads || pairs == 1; pairs *= 2)
+    {
+        for (allocator_t allocator = ALLOCATOR_POOL; allocator <= ALLOCATOR_MALLOC; allocator++)
+        {
+            run_case(SCENARIO_HANDOFF, allocator, pairs * 2, block_size, window, iterations);
+        }
+    }
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void run_case(scenario_t scenario, allocator_t allocator, unsigned threads, size_t block_size, unsigned window,
+                     unsigned iterations)
+{
+    // Cada caso corre en un proceso nuevo, asi los hilos estrenan las caches del pool y el heap arranca limpio
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if (pid > 0)
+    {
+        waitpid(pid, NULL, 0);
+        return;
+    }
+
+    mem_pool_t *pool = NULL;
+    if (allocator == ALLOCATOR_POOL)
+    {
+        // Los registros vivos de cada hilo mas lo que puede quedar en las caches
+        uint32_t block_count = threads * (window + CONFIG_MEM_POOL_CACHE_SIZE) + window;
+        mem_pool_config_t config = {
+            .name = "bench",
+            .block_size = block_size,
+            .block_count = block_count,
+            .region = MEM_POOL_INTERNAL,
+        };
+        pool = mem_pool_create(&config);
+        if (pool == NULL)
+        {
+            fprintf(stderr, "cannot create a pool of %u blocks\n", (unsigned)block_count);
+            exit(1);
+        }
+    }
+
+    worker_t workers[MAX_THREADS];
+    handoff_t handoffs[MAX_THREADS / 2];
+    pthread_t ids[MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    for (unsigned i = 0; i < threads; i++)
+    {
+        workers[i].allocator = allocator;
+        workers[i].pool = pool;
+        workers[i].block_size = block_size;
+        workers[i].window = window;
+        workers[i].iterations = iterations;
+        workers[i].seed = 0x9E3779B9u * (i + 1);
+        if (scenario == SCENARIO_HANDOFF)
+        {
+            handoff_t *handoff = &handoffs[i / 2];
+            if (i % 2 == 0)
+            {
+                handoff->size = window;
+                handoff->slots = calloc(window, sizeof(void *));
+                atomic_init(&handoff->head, 0);
+                atomic_init(&handoff->tail, 0);
+            }
+            workers[i].handoff = handoff;
+        }
+    }
+
+    uint64_t start_ns = now_ns();
+    for (unsigned i = 0; i < threads; i++)
+    {
+        void *(*fn)(void *) = local_worker;
+        if (scenario == SCENARIO_HANDOFF)
+        {
+            fn = (i % 2 == 0) ? producer_worker : consumer_worker;
+        }
+        pthread_create(&ids[i], NULL, fn, &workers[i]);
+    }
+    for (unsigned i = 0; i < threads; i++)
+    {
+        pthread_join(ids[i], NULL);
+    }
+    uint64_t elapsed_ns = now_ns() - start_ns;
+
+    uint64_t allocs = 0;
+    uint64_t failures = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    for (unsigned i = 0; i < threads; i++)
+    {
+        allocs += workers[i].allocs;
+        failures += workers[i].failures;
+        total_ns += workers[i].latency_total_ns;
+        max_ns = (workers[i].latency_max_ns > max_ns) ? workers[i].latency_max_ns : max_ns;
+    }
+    printf("%-8s %-7s %7u %9.2f %9.1f %9llu %10llu %8llu\n", SCENARIO_NAMES[scenario], ALLOCATOR_NAMES[allocator],
+           threads, (double)allocs * 1000.0 / (double)elapsed_ns, allocs ? (double)total_ns / (double)allocs : 0.0,
+           (unsigned long long)latency_percentile(workers, threads, 0.99), (unsigned long long)max_ns,
+           (unsigned long long)failures);
+
+    if (pool != NULL)
+    {
+        mem_pool_stats_t stats;
+        mem_pool_get_stats(pool, &stats);
+        if (stats.in_use != 0)
+        {
+            printf("  pool leak: %u blocks still in use\n", (unsigned)stats.in_use);
+        }
+    }
+    fflush(stdout);
+    _exit(0);
+}
+
+static void *local_worker(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    void **live = calloc(worker->window, sizeof(void *));
+
+    // Se reemplaza un registro al azar, asi los tiempos de vida varian como en una cola con reintentos
+    for (unsigned i = 0; i < worker->iterations; i++)
+    {
+        unsigned slot = next_random(&worker->seed) % worker->window;
+        record_free(worker, live[slot]);
+        live[slot] = record_alloc(worker);
+        if (i % CHURN_PERIOD == 0)
+        {
+            churn(worker);
+        }
+    }
+    for (unsigned i = 0; i < worker->window; i++)
+    {
+        record_free(worker, live[i]);
+    }
+    if (worker->pool != NULL)
+    {
+        mem_pool_flush_cache(worker->pool);
+    }
+    free(live);
+    return NULL;
+}
+
+static void *producer_worker(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    handoff_t *handoff = worker->handoff;
+    for (unsigned i = 0; i < worker->iterations; i++)
+    {
+        void *record = record_alloc(worker);
+        if (record == NULL)
+        {
+            continue;
+        }
+        unsigned head = atomic_load_explicit(&handoff->head, memory_order_relaxed);
+        while (head - atomic_load_explicit(&handoff->tail, memory_order_acquire) == handoff->size)
+        {
+            sched_yield();
+        }
+        handoff->slots[head % handoff->size] = record;
+        atomic_store_explicit(&handoff->head, head + 1, memory_order_release);
+        if (i % CHURN_PERIOD == 0)
+        {
+            churn(worker);
+        }
+    }
+    // Un NULL marca el final para el consumidor
+    unsigned head = atomic_load_explicit(&handoff->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&handoff->tail, memory_order_acquire) == handoff->size)
+    {
+        sched_yield();
+    }
+    handoff->slots[head % handoff->size] = NULL;
+    atomic_store_explicit(&handoff->head, head + 1, memory_order_release);
+    if (worker->pool != NULL)
+    {
+        mem_pool_flush_cache(worker->pool);
+    }
+    return NULL;
+}
+
+static void *consumer_worker(void *arg)
+{
+    worker_t *worker = (worker_t *)arg;
+    handoff_t *handoff = worker->handoff;
+    while (1)
+    {
+        unsigned tail = atomic_load_explicit(&handoff->tail, memory_order_relaxed);
+        while (atomic_load_explicit(&handoff->head, memory_order_acquire) == tail)
+        {
+            sched_yield();
+        }
+        void *record = handoff->slots[tail % handoff->size];
+        atomic_store_explicit(&handoff->tail, tail + 1, memory_order_release);
+        if (record == NULL)
+        {
+            break;
+        }
+        record_free(worker, record);
+    }
+    if (worker->pool != NULL)
+    {
+        mem_pool_flush_cache(worker->pool);
+    }
+    return NULL;
+}
+
+static void *record_alloc(worker_t *worker)
+{
+    uint64_t start_ns = now_ns();
+    void *record = (worker->allocator == ALLOCATOR_POOL) ? mem_pool_alloc(worker->pool) : malloc(worker->block_size);
+    uint64_t elapsed_ns = now_ns() - start_ns;
+
+    worker->allocs++;
+    if (record == NULL)
+    {
+        worker->failures++;
+        return NULL;
+    }
+    // Se escribe el registro completo como lo haria el camino de muestreo
+    memset(record, (int)worker->allocs, worker->block_size);
+
+    worker->latency_total_ns += elapsed_ns;
+    if (elapsed_ns > worker->latency_max_ns)
+    {
+        worker->latency_max_ns = elapsed_ns;
+    }
+    unsigned bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (1ULL << (bucket + 1)) <= elapsed_ns)
+    {
+        bucket++;
+    }
+    worker->latency[bucket]++;
+    return record;
+}
+
+static void record_free(worker_t *worker, void *record)
+{
+    if (worker->allocator == ALLOCATOR_POOL)
+    {
+        mem_pool_free(worker->pool, record);
+    }
+    else
+    {
+        free(record);
+    }
+}
+
+static void churn(worker_t *worker)
+{
+    size_t len = CHURN_MIN + next_random(&worker->seed) % (CHURN_MAX - CHURN_MIN);
+    volatile uint8_t *buf = malloc(len);
+    if (buf != NULL)
+    {
+        buf[0] = 1;
+        buf[len - 1] = 1;
+    }
+    free((void *)buf);
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t latency_percentile(const worker_t *workers, unsigned count, double percentile)
+{
+    // Devuelve el limite superior del bucket donde cae el percentil
+    uint64_t buckets[LATENCY_BUCKETS] = {0};
+    uint64_t total = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+        {
+            buckets[b] += workers[i].latency[b];
+            total += workers[i].latency[b];
+        }
+    }
+    uint64_t target = (uint64_t)((double)total * percentile);
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+    {
+        seen += buckets[b];
+        if (seen > target)
+        {
+            return 1ULL << (b + 1);
+        }
+    }
+    return 1ULL << LATENCY_BUCKETS;
+}
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""Servidor NTP local para probar el componente time_sync sin salir a internet.
+
+    ntp_server.py serve --port 123 [--delay-ms 0] [--drop 0] [--offset-s 0]
+    ntp_server.py query --host 127.0.0.1 --port 123 [--timeout-ms 15000] [--retry-ms 1000]
+    ntp_server.py test
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+NTP_PACKET_LEN = 48
+NTP_UNIX_OFFSET_S = 2208988800
+NTP_MODE_CLIENT = 3
+NTP_MODE_SERVER = 4
+NTP_STRATUM = 1
+NTP_PRECISION = -20
+
+# Igual que TIME_SYNC_MIN_VALID_UNIX_S del componente time_sync
+MIN_VALID_UNIX_S = 1704067200
+
+
+def to_ntp(unix_s):
+    seconds = int(unix_s)
+    fraction = int((unix_s - seconds) * (1 << 32)) & 0xFFFFFFFF
+    return struct.pack('>II', seconds + NTP_UNIX_OFFSET_S, fraction)
+
+
+def from_ntp(data):
+    seconds, fraction = struct.unpack('>II', data)
+    return seconds - NTP_UNIX_OFFSET_S + fraction / (1 << 32)
+
+
+def make_response(request, receive_s, transmit_s):
+    # Copia la version y el transmit timestamp del pedido, lwIP verifica que el originate timestamp coincida
+    version = (request[0] >> 3) & 0x07
+    header = struct.pack('>BBbbII4s', (version << 3) | NTP_MODE_SERVER, NTP_STRATUM, request[2], NTP_PRECISION,
+                         0, 0, b'LOCL')
+    return header + to_ntp(receive_s) + request[40:48] + to_ntp(receive_s) + to_ntp(transmit_s)
+
+
+class Responder:
+    def __init__(self, sock, delay_ms, drop, offset_s, log):
+        self.sock = sock
+        self.delay_ms = delay_ms
+        self.drop = drop
+        self.offset_s = offset_s
+        self.log = log
+        self.clients = {}
+        self.stop = threading.Event()
+
+    def run(self):
+        self.sock.settimeout(0.2)
+        while not self.stop.is_set():
+            try:
+                request, addr = self.sock.recvfrom(512)
+            except socket.timeout:
+                continue
+            received = time.monotonic()
+            if len(request) < NTP_PACKET_LEN or (request[0] & 0x07) != NTP_MODE_CLIENT:
+                continue
+
+            # Cada cliente cuenta sus pedidos desde el primero, asi se ve cuanto tardo en recibir una respuesta
+            first, count = self.clients.get(addr[0], (received, 0))
+            count += 1
+            self.clients[addr[0]] = (first, count)
+            elapsed_ms = (received - first) * 1000.0
+            if count <= self.drop:
+                self.log(f'{addr[0]}: request {count} at {elapsed_ms:.0f} ms dropped')
+                continue
+
+            if self.delay_ms > 0:
+                time.sleep(self.delay_ms / 1000.0)
+            receive_s = time.time() + self.offset_s
+            self.sock.sendto(make_response(request, receive_s, time.time() + self.offset_s), addr)
+            self.log(f'{addr[0]}: request {count} at {elapsed_ms:.0f} ms answered')
+
+
+def query(host, port, timeout_ms, retry_ms):
+    # Repite el pedido como el cliente SNTP hasta recibir una respuesta valida, devuelve los ms hasta esa respuesta
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    start = time.monotonic()
+    deadline = start + timeout_ms / 1000.0
+    try:
+        while time.monotonic() < deadline:
+            request = bytearray(NTP_PACKET_LEN)
+            request[0] = (4 << 3) | NTP_MODE_CLIENT
+            request[40:48] = to_ntp(time.time())
+            sock.sendto(bytes(request), (host, port))
+            sock.settimeout(min(retry_ms / 1000.0, max(deadline - time.monotonic(), 0.001)))
+            try:
+                response = sock.recv(512)
+            except socket.timeout:
+                continue
+            if len(response) < NTP_PACKET_LEN or (response[0] & 0x07) != NTP_MODE_SERVER or response[1] == 0:
+                continue
+            if response[24:32] != bytes(request[40:48]):
+                continue
+            unix_s = from_ntp(response[40:48])
+            if unix_s < MIN_VALID_UNIX_S:
+                continue
+            return (time.monotonic() - start) * 1000.0, unix_s
+    finally:
+        sock.close()
+    return None, None
+
+
+def start_responder(port, delay_ms, drop, offset_s, log):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('0.0.0.0', port))
+    responder = Responder(sock, delay_ms, drop, offset_s, log)
+    thread = threading.Thread(target=responder.run, daemon=True)
+    thread.start()
+    return responder, thread
+
+
+def cmd_serve(args):
+    responder, thread = start_responder(args.port, args.delay_ms, args.drop, args.offset_s,
+                                        lambda line: print(line, flush=True))
+    print(f'NTP stand-in listening on UDP port {args.port}', flush=True)
+    try:
+        thread.join()
+    except KeyboardInterrupt:
+        responder.stop.set()
+
+
+def cmd_query(args):
+    elapsed_ms, unix_s = query(args.host, args.port, args.timeout_ms, args.retry_ms)
+    if elapsed_ms is None:
+        sys.exit(f'no valid answer in {args.timeout_ms} ms')
+    print(f'first valid timestamp after {elapsed_ms:.1f} ms: {time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(unix_s))} UTC')
+
+
+def cmd_test(args):
+    # Cada caso: pedidos descartados, demora de la respuesta, intervalo entre pedidos y el rango esperado del tiempo
+    # hasta la hora valida. El intervalo tiene que ser mayor que la demora: lwIP descarta la respuesta a un pedido anterior
+    cases = [
+        ('immediate', 0, 0, 200, 0, 200),
+        ('delayed', 0, 300, 1000, 300, 600),
+        ('two dropped', 2, 0, 200, 2 * 200, 2 * 200 + 250),
+    ]
+    failed = 0
+    for name, drop, delay_ms, retry_ms, low_ms, high_ms in cases:
+        responder, thread = start_responder(0, delay_ms, drop, 0, lambda line: None)
+        port = responder.sock.getsockname()[1]
+        elapsed_ms, unix_s = query('127.0.0.1', port, 3000, retry_ms)
+        responder.stop.set()
+        thread.join()
+        responder.sock.close()
+        ok = elapsed_ms is not None and low_ms <= elapsed_ms <= high_ms and abs(unix_s - time.time()) < 1.0
+        failed += 0 if ok else 1
+        measured = 'no answer' if elapsed_ms is None else f'{elapsed_ms:.1f} ms'
+        print(f'{name:12s} {measured:>10s}  expected {low_ms}..{high_ms} ms  {"ok" if ok else "FAILED"}')
+    sys.exit(1 if failed else 0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    serve = sub.add_parser('serve', help='responde los pedidos NTP con la hora de la PC')
+    serve.add_argument('--port', type=int, default=123)
+    serve.add_argument('--delay-ms', type=int, default=0, help='demora de cada respuesta')
+    serve.add_argument('--drop', type=int, default=0, help='pedidos descartados por cliente antes de responder')
+    serve.add_argument('--offset-s', type=float, default=0.0, help='corrimiento de la hora entregada')
+    serve.set_defaults(func=cmd_serve)
+
+    query_parser = sub.add_parser('query', help='mide el tiempo hasta la primera hora valida, como el dispositivo')
+    query_parser.add_argument('--host', default='127.0.0.1')
+    query_parser.add_argument('--port', type=int, default=123)
+    query_parser.add_argument('--timeout-ms', type=int, default=15000)
+    query_parser.add_argument('--retry-ms', type=int, default=1000)
+    query_parser.set_defaults(func=cmd_query)
+
+    test = sub.add_parser('test', help='prueba el servidor y la medicion en localhost')
+    test.set_defaults(func=cmd_test)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
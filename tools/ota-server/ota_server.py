@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Generacion de parches delta y servidor de actualizaciones local para el componente ota.
+
+    ota_server.py patch --base old.bin --new new.bin --out patches/
+    ota_server.py apply --base old.bin --patch patches/<sha>.patch --out new.bin
+    ota_server.py serve --dir patches/ --port 8070 --cert server.pem --key server.key
+"""
+
+import argparse
+import hashlib
+import http.server
+import io
+import os
+import re
+import ssl
+import struct
+import sys
+
+import detools
+
+PATCH_MAGIC = 0x4154444F
+PATCH_HEADER_LEN = 64
+DIGEST_LEN = 32
+
+
+def image_digest(image):
+    # El ESP-IDF agrega al final de la imagen el SHA-256 del resto, es el que devuelve esp_partition_get_sha256
+    digest = hashlib.sha256(image[:-DIGEST_LEN]).digest()
+    if digest != image[-DIGEST_LEN:]:
+        sys.exit('la imagen no tiene el SHA-256 agregado al final')
+    return digest
+
+
+def make_header(base_digest, image_size):
+    header = struct.pack('<I32sI', PATCH_MAGIC, base_digest, image_size)
+    return header.ljust(PATCH_HEADER_LEN, b'\0')
+
+
+def parse_header(patch):
+    magic, base_digest, image_size = struct.unpack_from('<I32sI', patch)
+    if magic != PATCH_MAGIC:
+        sys.exit('el archivo no es un parche')
+    return base_digest, image_size
+
+
+def cmd_patch(args):
+    base = open(args.base, 'rb').read()
+    new = open(args.new, 'rb').read()
+    base_digest = image_digest(base)
+    image_digest(new)
+
+    # El dispositivo aplica el parche en orden, por eso se usa el tipo sequential
+    body = io.BytesIO()
+    detools.create_patch(io.BytesIO(base), io.BytesIO(new), body,
+                         compression='heatshrink', patch_type='sequential')
+
+    os.makedirs(args.out, exist_ok=True)
+    path = os.path.join(args.out, base_digest.hex() + '.patch')
+    with open(path, 'wb') as f:
+        f.write(make_header(base_digest, len(new)))
+        f.write(body.getvalue())
+    size = os.path.getsize(path)
+    print(f'{path}: {size} bytes, {100.0 * size / len(new):.1f}% of the {len(new)} bytes image')
+
+
+def cmd_apply(args):
+    base = open(args.base, 'rb').read()
+    patch = open(args.patch, 'rb').read()
+    base_digest, image_size = parse_header(patch)
+    if base_digest != image_digest(base):
+        sys.exit('el parche no corresponde a la imagen base')
+
+    new = io.BytesIO()
+    detools.apply_patch(io.BytesIO(base), io.BytesIO(patch[PATCH_HEADER_LEN:]), new)
+    if len(new.getvalue()) != image_size:
+        sys.exit(f'la imagen resultante tiene {len(new.getvalue())} bytes, se esperaban {image_size}')
+    image_digest(new.getvalue())
+    with open(args.out, 'wb') as f:
+        f.write(new.getvalue())
+    print(f'{args.out}: {image_size} bytes, SHA-256 ok')
+
+
+class PatchHandler(http.server.BaseHTTPRequestHandler):
+    patch_dir = '.'
+
+    def do_GET(self):
+        match = re.fullmatch(r'/patch\?base=([0-9a-f]{64})', self.path)
+        if match is None:
+            self.send_error(400)
+            return
+        path = os.path.join(self.patch_dir, match.group(1) + '.patch')
+        if not os.path.exists(path):
+            # No hay actualizacion para esta imagen
+            self.send_response(204)
+            self.end_headers()
+            return
+        data = open(path, 'rb').read()
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/octet-stream')
+        self.send_header('Content-Length', str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def cmd_serve(args):
+    PatchHandler.patch_dir = args.dir
+    server = http.server.ThreadingHTTPServer(('', args.port), PatchHandler)
+    # El dispositivo solo descarga parches por HTTPS, de un servidor firmado por la CA de ota_ca.pem
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(args.cert, args.key)
+    server.socket = context.wrap_socket(server.socket, server_side=True)
+    print(f'Serving patches from {args.dir} on port {args.port} over HTTPS')
+    server.serve_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    p = sub.add_parser('patch', help='genera el parche entre dos imagenes')
+    p.add_argument('--base', required=True, help='imagen que esta en el dispositivo')
+    p.add_argument('--new', required=True, help='imagen nueva')
+    p.add_argument('--out', default='patches', help='directorio de salida')
+    p.set_defaults(func=cmd_patch)
+
+    p = sub.add_parser('apply', help='aplica un parche igual que el dispositivo')
+    p.add_argument('--base', required=True)
+    p.add_argument('--patch', required=True)
+    p.add_argument('--out', required=True)
+    p.set_defaults(func=cmd_apply)
+
+    p = sub.add_parser('serve', help='sirve los parches por HTTPS')
+    p.add_argument('--dir', default='patches')
+    p.add_argument('--port', type=int, default=8070)
+    p.add_argument('--cert', required=True, help='certificado del servidor firmado por la CA de ota_ca.pem')
+    p.add_argument('--key', required=True, help='clave privada del certificado')
+    p.set_defaults(func=cmd_serve)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,163 @@
+//=====[Libraries]=============================================================
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prov_dual_sel.h"
+
+//=====[Declaration of private defines]========================================
+
+#define LINE_MAX_LEN 256
+
+//=====[Declaration of private data types]=====================================
+
+// Una linea de la traza. expect apunta a un texto vacio si la linea no trae el resultado esperado
+typedef struct
+{
+    uint32_t ms;
+    int transport;
+    const char *request;
+    const char *expect;
+} trace_event_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *TRANSPORT_NAMES[] = {"ble", "softap"};
+
+//=====[Declaration and initialization of private global variables]============
+
+// Cada transporte atiende sus pedidos en su propia tarea, solo importa que sean distintas
+static int task_of[2];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int parse_line(char *line, trace_event_t *event);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s trace\n", argv[0]);
+        return 2;
+    }
+    FILE *file = fopen(argv[1], "r");
+    if (file == NULL)
+    {
+        perror(argv[1]);
+        return 2;
+    }
+
+    prov_dual_sel_t sel;
+    prov_dual_sel_init(&sel);
+    bool running[2] = {true, true};
+    unsigned checked = 0;
+    unsigned mismatches = 0;
+    unsigned line_number = 0;
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        trace_event_t event;
+        int ret = parse_line(line, &event);
+        if (ret < 0)
+        {
+            fprintf(stderr, "%s:%u: invalid line\n", argv[1], line_number);
+            fclose(file);
+            return 2;
+        }
+        if (ret == 0)
+        {
+            continue;
+        }
+
+        // Mismas llamadas que prov_dual.c: match_uri en cada pedido HTTP, el callback del esquema en la tarea que
+        // ejecuta apply-config y prov_dual_resolve en el loop por defecto, que cierra el transporte que perdio
+        const char *result = "";
+        if (!running[event.transport])
+        {
+            result = "closed";
+        }
+        else
+        {
+            if (event.transport == PROV_DUAL_SEL_SOFTAP)
+            {
+                prov_dual_sel_http_request(&sel, &task_of[PROV_DUAL_SEL_SOFTAP]);
+            }
+            if (strcmp(event.request, "apply-config") == 0)
+            {
+                prov_dual_sel_credentials(&sel, &task_of[event.transport]);
+                int winner = prov_dual_sel_winner(&sel, running[PROV_DUAL_SEL_BLE], running[PROV_DUAL_SEL_SOFTAP]);
+                result = (winner < 0) ? "unknown" : TRANSPORT_NAMES[winner];
+                if (winner >= 0)
+                {
+                    running[1 - winner] = false;
+                }
+            }
+        }
+
+        if (result[0] != '\0')
+        {
+            printf("%8" PRIu32 " ms  %-6s %-12s %s\n", event.ms, TRANSPORT_NAMES[event.transport], event.request,
+                   result);
+        }
+        if (event.expect[0] != '\0')
+        {
+            checked++;
+            if (strcmp(event.expect, result) != 0)
+            {
+                printf("%s:%u: expected %s, got %s\n", argv[1], line_number, event.expect,
+                       (result[0] != '\0') ? result : "delivered");
+                mismatches++;
+            }
+        }
+    }
+    fclose(file);
+
+    printf("%u of %u expected results matched\n", checked - mismatches, checked);
+    return (mismatches == 0) ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int parse_line(char *line, trace_event_t *event)
+{
+    // Devuelve 1 si la linea es un pedido, 0 si se ignora y -1 si es invalida
+    // ms,transporte,pedido,esperado con esperado vacio, ble, softap o closed si el transporte ya se cerro
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#')
+    {
+        return 0;
+    }
+    char *fields[4] = {NULL};
+    size_t count = 0;
+    char *rest = line;
+    while (rest != NULL && count < 4)
+    {
+        fields[count++] = strsep(&rest, ",");
+    }
+    if (count < 3)
+    {
+        return -1;
+    }
+    event->ms = (uint32_t)strtoul(fields[0], NULL, 10);
+    if (strcmp(fields[1], "ble") == 0)
+    {
+        event->transport = PROV_DUAL_SEL_BLE;
+    }
+    else if (strcmp(fields[1], "softap") == 0)
+    {
+        event->transport = PROV_DUAL_SEL_SOFTAP;
+    }
+    else
+    {
+        return -1;
+    }
+    event->request = fields[2];
+    event->expect = (count == 4) ? fields[3] : "";
+    return 1;
+}
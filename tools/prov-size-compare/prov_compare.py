@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Compara las partes 1, 2 y 3 antes del componente provisioning y con el componente.
+
+Compila cada proyecto en los dos arboles, toma los tamanos de idf.py size y, con --port, mide el tiempo desde el
+reset hasta el log "Connected with IP Address" grabando solo la aplicacion. Imprime una tabla en Markdown.
+
+    prov_compare.py [--base <commit>] [--port /dev/ttyUSB0] [--boots 5] [--work build-prov-compare]
+
+Ejecutar desde el ESP-IDF Terminal, en la raiz del repositorio.
+"""
+
+import argparse
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+PROJECTS = ['1-wifi-provisioning-ble', '2-nvs-gen', '3-salt-verifier']
+
+# Lineas del sdkconfig.defaults que solo existen con el componente, el arbol anterior se configura sin ellas
+COMPONENT_ONLY = re.compile(r'^#? ?CONFIG_(PROV_|ESP_PROTOCOMM_)')
+
+# El prefijo del log del ESP-IDF trae los ms desde el arranque, asi sirve tambien para las imagenes anteriores
+GOT_IP_LOG = re.compile(r'I \((\d+)\) [^:]+: Connected with IP Address')
+BOOT_TIMEOUT_S = 30
+
+
+def run(args, cwd):
+    result = subprocess.run(args, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0:
+        sys.exit(f'{" ".join(args)} failed in {cwd}:\n{result.stdout[-2000:]}')
+    return result.stdout
+
+
+def first_component_commit():
+    # El arbol anterior es el padre del primer commit que agrega components/provisioning
+    out = run(['git', 'rev-list', '--reverse', 'HEAD', '--', 'components/provisioning'], '.')
+    return out.split()[0] + '^'
+
+
+def prepare_base(base, work):
+    tree = os.path.join(work, 'base')
+    if not os.path.isdir(tree):
+        run(['git', 'worktree', 'add', '--detach', tree, base], '.')
+    for project in PROJECTS:
+        with open(os.path.join(project, 'sdkconfig.defaults')) as f:
+            lines = [line for line in f if not COMPONENT_ONLY.match(line)]
+        with open(os.path.join(tree, project, 'sdkconfig.defaults'), 'w') as f:
+            f.writelines(lines)
+    return tree
+
+
+def build_and_size(project_dir, build_dir):
+    run(['idf.py', '-B', build_dir, 'build'], project_dir)
+    out = run(['idf.py', '-B', build_dir, 'size', '--format', 'json'], project_dir)
+    size = json.loads(out[out.index('{'):])
+    return {
+        'total': size['total_size'],
+        'flash': size['flash_code'] + size['flash_rodata'],
+        'dram': size['dram_data'] + size['dram_bss'],
+    }
+
+
+def measure_boot(project_dir, build_dir, port, boots):
+    import serial
+
+    # Solo se graba la aplicacion, asi el NVS conserva las credenciales del provisioning hecho antes
+    run(['idf.py', '-B', build_dir, '-p', port, 'app-flash'], project_dir)
+    times = []
+    with serial.Serial(port, 115200, timeout=0.5) as ser:
+        for _ in range(boots):
+            # Reset por EN con RTS, con DTR alto para arrancar la aplicacion y no el bootloader
+            ser.dtr = False
+            ser.rts = True
+            time.sleep(0.1)
+            ser.reset_input_buffer()
+            ser.rts = False
+            deadline = time.monotonic() + BOOT_TIMEOUT_S
+            while time.monotonic() < deadline:
+                match = GOT_IP_LOG.search(ser.readline().decode(errors='replace'))
+                if match:
+                    times.append(int(match.group(1)))
+                    break
+            else:
+                sys.exit(f'{project_dir}: no IP address in {BOOT_TIMEOUT_S} s, provision the device first')
+    return statistics.median(times)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--base', help='commit anterior al componente, por defecto el padre del primero que lo agrega')
+    parser.add_argument('--port', help='puerto serie del dispositivo ya provisionado, sin el no se mide el arranque')
+    parser.add_argument('--boots', type=int, default=5, help='arranques por imagen, se informa la mediana')
+    parser.add_argument('--work', default='build-prov-compare')
+    args = parser.parse_args()
+
+    base = prepare_base(args.base or first_component_commit(), args.work)
+    rows = []
+    for project in PROJECTS:
+        results = {}
+        for name, tree in (('base', base), ('component', '.')):
+            project_dir = os.path.join(tree, project)
+            build_dir = os.path.abspath(os.path.join(args.work, f'{name}-{project}'))
+            results[name] = build_and_size(project_dir, build_dir)
+            if args.port:
+                results[name]['got_ip_ms'] = measure_boot(project_dir, build_dir, args.port, args.boots)
+        rows.append((project, results['base'], results['component']))
+
+    print('| Proyecto | Imagen antes | Imagen con el componente | Flash | DRAM | IP antes (ms) | IP con el componente (ms) |')
+    print('| -------- | ------------ | ------------------------ | ----- | ---- | ------------- | ------------------------- |')
+    for project, old, new in rows:
+        old_ip = old.get('got_ip_ms', '-')
+        new_ip = new.get('got_ip_ms', '-')
+        print(f'| {project} | {old["total"]} | {new["total"]} | {new["flash"] - old["flash"]:+d} | '
+              f'{new["dram"] - old["dram"]:+d} | {old_ip} | {new_ip} |')
+
+
+if __name__ == '__main__':
+    main()
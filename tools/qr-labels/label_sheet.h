@@ -0,0 +1,79 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _LABEL_SHEET_H_
+#define _LABEL_SHEET_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "qrcodegen.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Mismo tamano de buffer que wifi_prov_print_qr
+#define LABEL_PAYLOAD_MAX 150
+#define LABEL_NAME_MAX 16
+
+// Margen sin modulos alrededor del QR, en modulos
+#define LABEL_QUIET_ZONE 4
+
+// A4 en puntos PostScript y en milimetros
+#define SHEET_WIDTH_PT 595.28
+#define SHEET_HEIGHT_PT 841.89
+#define SHEET_WIDTH_MM 210.0
+#define SHEET_HEIGHT_MM 297.0
+#define SHEET_MARGIN_MM 10.0
+
+//=====[Declaration of public data types]======================================
+
+typedef struct
+{
+    char name[LABEL_NAME_MAX];
+    char payload[LABEL_PAYLOAD_MAX];
+} label_t;
+
+typedef struct
+{
+    int cols;
+    int rows;
+    int dpi;
+} sheet_layout_t;
+
+// Buffers de trabajo de cada hilo, qrcodegen no reserva memoria
+typedef struct
+{
+    uint8_t qr[qrcodegen_BUFFER_LEN_MAX];
+    uint8_t temp[qrcodegen_BUFFER_LEN_MAX];
+} label_encoder_t;
+
+typedef struct
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} buffer_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Codifica el payload con los mismos parametros que esp_qrcode_generate, devuelve el tamano en modulos o 0
+int label_encode(const label_t *label, label_encoder_t *encoder);
+
+// Genera los objetos de una pagina del PDF a partir de first_obj, guarda el offset de cada uno relativo al buffer
+int sheet_pdf_render(const label_t *labels, int count, const sheet_layout_t *layout, int first_obj, int font_obj,
+                     label_encoder_t *encoder, buffer_t *out, size_t *offsets);
+
+// Genera una hoja en PNG de 1 bit a la resolucion del layout
+int sheet_png_write(const label_t *labels, int count, const sheet_layout_t *layout, label_encoder_t *encoder,
+                    const char *path);
+
+int buffer_append(buffer_t *buf, const void *data, size_t len);
+
+int buffer_printf(buffer_t *buf, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void buffer_free(buffer_t *buf);
+
+//=====[#include guards - end]=================================================
+
+#endif // _LABEL_SHEET_H_
@@ -0,0 +1,523 @@
+//=====[Libraries]=============================================================
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "label_sheet.h"
+
+//=====[Declaration of private defines]========================================
+
+// Igual que en el componente provisioning
+#define PROV_QR_VERSION "v1"
+#define PROV_NAME_PREFIX "PROV_"
+
+#define MANIFEST_LINE_MAX 256
+#define PDF_FIXED_OBJECTS 3
+#define PDF_CATALOG_OBJ 1
+#define PDF_PAGES_OBJ 2
+#define PDF_FONT_OBJ 3
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum
+{
+    OUTPUT_PDF,
+    OUTPUT_PNG,
+} output_format_t;
+
+typedef struct
+{
+    output_format_t format;
+    const char *output;
+    const char *transport;
+    sheet_layout_t layout;
+    int threads;
+} options_t;
+
+typedef struct
+{
+    const options_t *options;
+    const label_t *labels;
+    int label_count;
+    int per_sheet;
+    int sheet_count;
+    buffer_t *pages;
+    size_t *offsets;
+    atomic_int next_sheet;
+    atomic_bool failed;
+} job_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void usage(const char *prog);
+
+static label_t *load_manifest(const char *path, const char *transport, int *count);
+
+static int parse_mac(const char *text, uint8_t mac[6]);
+
+static bool json_safe(const char *text);
+
+static char *trim(char *text);
+
+static void *render_worker(void *arg);
+
+static int write_pdf(const job_t *job);
+
+static int pdf_first_obj(const job_t *job, int sheet);
+
+static double elapsed_s(const struct timespec *start);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    options_t options = {
+        .format = OUTPUT_PDF,
+        .output = NULL,
+        .transport = "ble",
+        .layout = {.cols = 5, .rows = 8, .dpi = 300},
+        .threads = (int)sysconf(_SC_NPROCESSORS_ONLN),
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:f:t:j:c:r:d:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'o':
+            options.output = optarg;
+            break;
+        case 'f':
+            if (strcmp(optarg, "pdf") == 0)
+            {
+                options.format = OUTPUT_PDF;
+            }
+            else if (strcmp(optarg, "png") == 0)
+            {
+                options.format = OUTPUT_PNG;
+            }
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 't':
+            if (strcmp(optarg, "ble") != 0 && strcmp(optarg, "softap") != 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            options.transport = optarg;
+            break;
+        case 'j':
+            options.threads = atoi(optarg);
+            break;
+        case 'c':
+            options.layout.cols = atoi(optarg);
+            break;
+        case 'r':
+            options.layout.rows = atoi(optarg);
+            break;
+        case 'd':
+            options.layout.dpi = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || options.layout.cols < 1 || options.layout.rows < 1 || options.layout.dpi < 72)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (options.threads < 1)
+    {
+        options.threads = 1;
+    }
+    if (options.output == NULL)
+    {
+        options.output = (options.format == OUTPUT_PDF) ? "labels.pdf" : "labels";
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int label_count = 0;
+    label_t *labels = load_manifest(argv[optind], options.transport, &label_count);
+    if (labels == NULL)
+    {
+        return 1;
+    }
+
+    job_t job = {
+        .options = &options,
+        .labels = labels,
+        .label_count = label_count,
+        .per_sheet = options.layout.cols * options.layout.rows,
+    };
+    job.sheet_count = (label_count + job.per_sheet - 1) / job.per_sheet;
+    atomic_init(&job.next_sheet, 0);
+    atomic_init(&job.failed, false);
+    if (options.format == OUTPUT_PDF)
+    {
+        // Cada hoja se arma en su propio buffer y despues se escriben en orden
+        job.pages = calloc(job.sheet_count, sizeof(buffer_t));
+        job.offsets = calloc((size_t)job.sheet_count * (2 + job.per_sheet), sizeof(size_t));
+        if (job.pages == NULL || job.offsets == NULL)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    // Los hilos toman la siguiente hoja libre, asi se reparten la carga aunque la ultima hoja quede incompleta
+    int threads = (options.threads < job.sheet_count) ? options.threads : job.sheet_count;
+    pthread_t *workers = calloc(threads, sizeof(pthread_t));
+    int started = 0;
+    for (; workers != NULL && started < threads; started++)
+    {
+        if (pthread_create(&workers[started], NULL, render_worker, &job) != 0)
+        {
+            break;
+        }
+    }
+    if (started == 0)
+    {
+        render_worker(&job);
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    int ret = atomic_load(&job.failed) ? 1 : 0;
+    if (ret == 0 && options.format == OUTPUT_PDF)
+    {
+        ret = (write_pdf(&job) == 0) ? 0 : 1;
+    }
+
+    if (ret == 0)
+    {
+        double seconds = elapsed_s(&start);
+        printf("%d labels on %d sheets with %d threads in %.2f s (%.0f labels/s)\n",
+               label_count, job.sheet_count, (started > 0) ? started : 1, seconds, label_count / seconds);
+    }
+
+    for (int i = 0; job.pages != NULL && i < job.sheet_count; i++)
+    {
+        buffer_free(&job.pages[i]);
+    }
+    free(job.pages);
+    free(job.offsets);
+    free(labels);
+    return ret;
+}
+
+int label_encode(const label_t *label, label_encoder_t *encoder)
+{
+    // Mismos parametros que ESP_QRCODE_CONFIG_DEFAULT del componente espressif/qrcode
+    if (!qrcodegen_encodeText(label->payload, encoder->temp, encoder->qr, qrcodegen_Ecc_LOW,
+                              qrcodegen_VERSION_MIN, 10, qrcodegen_Mask_AUTO, true))
+    {
+        return 0;
+    }
+    return qrcodegen_getSize(encoder->qr);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-o output] [-f pdf|png] [-t ble|softap] [-j threads] [-c cols] [-r rows] [-d dpi] manifest.csv\n", prog);
+    fprintf(stderr, "  manifest.csv  one device per line: mac,username,pop (username and pop can be empty)\n");
+    fprintf(stderr, "  -o            PDF file, or file prefix for PNG sheets (prefix_0001.png, ...)\n");
+}
+
+static label_t *load_manifest(const char *path, const char *transport, int *count)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    label_t *labels = NULL;
+    int cap = 0;
+    int line_number = 0;
+    char line[MANIFEST_LINE_MAX];
+    *count = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        char *fields[3] = {line, NULL, NULL};
+        for (int i = 1; i < 3; i++)
+        {
+            char *comma = (fields[i - 1] != NULL) ? strchr(fields[i - 1], ',') : NULL;
+            if (comma != NULL)
+            {
+                *comma = '\0';
+                fields[i] = comma + 1;
+            }
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            fields[i] = (fields[i] != NULL) ? trim(fields[i]) : NULL;
+            if (fields[i] != NULL && *fields[i] == '\0')
+            {
+                fields[i] = NULL;
+            }
+        }
+
+        // Se saltean las lineas vacias, los comentarios y la cabecera
+        if (fields[0] == NULL || fields[0][0] == '#' || strcmp(fields[0], "mac") == 0)
+        {
+            continue;
+        }
+
+        uint8_t mac[6];
+        if (parse_mac(fields[0], mac) != 0)
+        {
+            fprintf(stderr, "%s:%d: invalid MAC '%s'\n", path, line_number, fields[0]);
+            goto fail;
+        }
+        const char *username = fields[1];
+        const char *pop = fields[2];
+        if ((username && !json_safe(username)) || (pop && !json_safe(pop)))
+        {
+            fprintf(stderr, "%s:%d: username and pop cannot contain quotes or backslashes\n", path, line_number);
+            goto fail;
+        }
+
+        if (*count == cap)
+        {
+            cap = cap ? cap * 2 : 1024;
+            label_t *grown = realloc(labels, (size_t)cap * sizeof(label_t));
+            if (grown == NULL)
+            {
+                fprintf(stderr, "Out of memory\n");
+                goto fail;
+            }
+            labels = grown;
+        }
+        label_t *label = &labels[*count];
+
+        // Mismo nombre que get_device_service_name, toma los ultimos tres bytes de la MAC de la estacion
+        snprintf(label->name, sizeof(label->name), "%s%02X%02X%02X", PROV_NAME_PREFIX, mac[3], mac[4], mac[5]);
+
+        // Mismas variantes que wifi_prov_print_qr, pero un payload que no entra es un error y no se trunca
+        int len;
+        if (username && pop)
+        {
+            len = snprintf(label->payload, sizeof(label->payload), "{\"ver\":\"%s\",\"name\":\"%s\""
+                                                                   ",\"username\":\"%s\",\"pop\":\"%s\",\"transport\":\"%s\"}",
+                           PROV_QR_VERSION, label->name, username, pop, transport);
+        }
+        else if (pop)
+        {
+            len = snprintf(label->payload, sizeof(label->payload), "{\"ver\":\"%s\",\"name\":\"%s\""
+                                                                   ",\"pop\":\"%s\",\"transport\":\"%s\"}",
+                           PROV_QR_VERSION, label->name, pop, transport);
+        }
+        else
+        {
+            len = snprintf(label->payload, sizeof(label->payload), "{\"ver\":\"%s\",\"name\":\"%s\""
+                                                                   ",\"transport\":\"%s\"}",
+                           PROV_QR_VERSION, label->name, transport);
+        }
+        if (len >= (int)sizeof(label->payload))
+        {
+            fprintf(stderr, "%s:%d: payload longer than %d bytes\n", path, line_number, LABEL_PAYLOAD_MAX - 1);
+            goto fail;
+        }
+        (*count)++;
+    }
+    fclose(file);
+
+    if (*count == 0)
+    {
+        fprintf(stderr, "%s: no devices\n", path);
+        free(labels);
+        return NULL;
+    }
+    return labels;
+
+fail:
+    fclose(file);
+    free(labels);
+    return NULL;
+}
+
+static int parse_mac(const char *text, uint8_t mac[6])
+{
+    // Acepta 240AC4123456, 24:0A:C4:12:34:56 y 24-0A-C4-12-34-56
+    int digits = 0;
+    memset(mac, 0, 6);
+    for (; *text; text++)
+    {
+        if (*text == ':' || *text == '-')
+        {
+            continue;
+        }
+        if (!isxdigit((unsigned char)*text) || digits == 12)
+        {
+            return -1;
+        }
+        int value = isdigit((unsigned char)*text) ? *text - '0' : toupper((unsigned char)*text) - 'A' + 10;
+        mac[digits / 2] |= (uint8_t)(value << ((digits % 2) ? 0 : 4));
+        digits++;
+    }
+    return (digits == 12) ? 0 : -1;
+}
+
+static bool json_safe(const char *text)
+{
+    // El dispositivo no escapa el payload, asi que la herramienta tampoco
+    return strpbrk(text, "\"\\") == NULL;
+}
+
+static char *trim(char *text)
+{
+    while (isspace((unsigned char)*text))
+    {
+        text++;
+    }
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1]))
+    {
+        *--end = '\0';
+    }
+    return text;
+}
+
+static void *render_worker(void *arg)
+{
+    job_t *job = (job_t *)arg;
+    label_encoder_t *encoder = malloc(sizeof(label_encoder_t));
+    if (encoder == NULL)
+    {
+        atomic_store(&job->failed, true);
+        return NULL;
+    }
+
+    int sheet;
+    while (!atomic_load_explicit(&job->failed, memory_order_relaxed) &&
+           (sheet = atomic_fetch_add(&job->next_sheet, 1)) < job->sheet_count)
+    {
+        const label_t *labels = &job->labels[sheet * job->per_sheet];
+        int count = job->label_count - sheet * job->per_sheet;
+        count = (count < job->per_sheet) ? count : job->per_sheet;
+
+        int ret;
+        if (job->options->format == OUTPUT_PDF)
+        {
+            ret = sheet_pdf_render(labels, count, &job->options->layout, pdf_first_obj(job, sheet), PDF_FONT_OBJ,
+                                   encoder, &job->pages[sheet], &job->offsets[(size_t)sheet * (2 + job->per_sheet)]);
+        }
+        else
+        {
+            char path[512];
+            snprintf(path, sizeof(path), "%s_%04d.png", job->options->output, sheet + 1);
+            ret = sheet_png_write(labels, count, &job->options->layout, encoder, path);
+        }
+        if (ret != 0)
+        {
+            fprintf(stderr, "Error rendering sheet %d (%s ...)\n", sheet + 1, labels[0].name);
+            atomic_store(&job->failed, true);
+        }
+    }
+
+    free(encoder);
+    return NULL;
+}
+
+static int write_pdf(const job_t *job)
+{
+    FILE *file = fopen(job->options->output, "wb");
+    if (file == NULL)
+    {
+        perror(job->options->output);
+        return -1;
+    }
+
+    int last_count = job->label_count - (job->sheet_count - 1) * job->per_sheet;
+    int obj_count = pdf_first_obj(job, job->sheet_count - 1) + 2 + last_count;
+    size_t *xref = calloc(obj_count, sizeof(size_t));
+    buffer_t head = {0};
+    if (xref == NULL)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    // El comentario binario de la segunda linea avisa que el archivo no es texto
+    int ret = buffer_printf(&head, "%%PDF-1.4\n%%\xE2\xE3\xCF\xD3\n");
+    xref[PDF_CATALOG_OBJ] = head.len;
+    ret |= buffer_printf(&head, "%d 0 obj\n<< /Type /Catalog /Pages %d 0 R >>\nendobj\n", PDF_CATALOG_OBJ, PDF_PAGES_OBJ);
+    xref[PDF_PAGES_OBJ] = head.len;
+    ret |= buffer_printf(&head, "%d 0 obj\n<< /Type /Pages /Count %d /Kids [", PDF_PAGES_OBJ, job->sheet_count);
+    for (int s = 0; s < job->sheet_count; s++)
+    {
+        ret |= buffer_printf(&head, "%s%d 0 R", s ? " " : "", pdf_first_obj(job, s));
+    }
+    ret |= buffer_printf(&head, "] >>\nendobj\n");
+    xref[PDF_FONT_OBJ] = head.len;
+    ret |= buffer_printf(&head, "%d 0 obj\n<< /Type /Font /Subtype /Type1 /BaseFont /Courier >>\nendobj\n", PDF_FONT_OBJ);
+    ret |= (fwrite(head.data, head.len, 1, file) == 1) ? 0 : -1;
+
+    size_t offset = head.len;
+    for (int s = 0; s < job->sheet_count && ret == 0; s++)
+    {
+        int count = (s == job->sheet_count - 1) ? last_count : job->per_sheet;
+        const size_t *offsets = &job->offsets[(size_t)s * (2 + job->per_sheet)];
+        for (int i = 0; i < 2 + count; i++)
+        {
+            xref[pdf_first_obj(job, s) + i] = offset + offsets[i];
+        }
+        ret |= (fwrite(job->pages[s].data, job->pages[s].len, 1, file) == 1) ? 0 : -1;
+        offset += job->pages[s].len;
+    }
+
+    // Cada entrada de la tabla xref ocupa exactamente 20 bytes
+    head.len = 0;
+    ret |= buffer_printf(&head, "xref\n0 %d\n0000000000 65535 f \n", obj_count);
+    for (int i = 1; i < obj_count; i++)
+    {
+        ret |= buffer_printf(&head, "%010zu 00000 n \n", xref[i]);
+    }
+    ret |= buffer_printf(&head, "trailer\n<< /Size %d /Root %d 0 R >>\nstartxref\n%zu\n%%%%EOF\n",
+                         obj_count, PDF_CATALOG_OBJ, offset);
+    ret |= (fwrite(head.data, head.len, 1, file) == 1) ? 0 : -1;
+    ret |= (fclose(file) == 0) ? 0 : -1;
+
+    buffer_free(&head);
+    free(xref);
+    if (ret != 0)
+    {
+        fprintf(stderr, "Error writing %s\n", job->options->output);
+    }
+    return ret;
+}
+
+static int pdf_first_obj(const job_t *job, int sheet)
+{
+    // Cada hoja ocupa la pagina, el contenido y una imagen por etiqueta
+    return PDF_FIXED_OBJECTS + 1 + sheet * (2 + job->per_sheet);
+}
+
+static double elapsed_s(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
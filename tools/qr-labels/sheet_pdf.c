@@ -0,0 +1,186 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "label_sheet.h"
+
+//=====[Declaration of private defines]========================================
+
+#define PT_PER_MM (72.0 / 25.4)
+
+// Courier es monoespaciada, cada caracter ocupa 0.6 veces el tamano de la fuente
+#define COURIER_ADVANCE 0.6
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int buffer_reserve(buffer_t *buf, size_t extra);
+
+//=====[Implementations of public functions]===================================
+
+int sheet_pdf_render(const label_t *labels, int count, const sheet_layout_t *layout, int first_obj, int font_obj,
+                     label_encoder_t *encoder, buffer_t *out, size_t *offsets)
+{
+    double margin = SHEET_MARGIN_MM * PT_PER_MM;
+    double cell_w = (SHEET_WIDTH_PT - 2 * margin) / layout->cols;
+    double cell_h = (SHEET_HEIGHT_PT - 2 * margin) / layout->rows;
+    double font_size = cell_h * 0.07;
+    font_size = (font_size < 5.0) ? 5.0 : (font_size > 10.0) ? 10.0 : font_size;
+    double side = cell_h - 1.5 * font_size;
+    side = (cell_w < side) ? cell_w : side;
+
+    int content_obj = first_obj + 1;
+    int image_obj = first_obj + 2;
+    buffer_t content = {0};
+    buffer_t images = {0};
+    int ret = 0;
+
+    for (int i = 0; i < count && ret == 0; i++)
+    {
+        int size = label_encode(&labels[i], encoder);
+        if (size == 0)
+        {
+            ret = -1;
+            break;
+        }
+
+        // El QR va como mascara de imagen de 1 bit por modulo, el visor la escala sin suavizar
+        int row_bytes = (size + 7) / 8;
+        offsets[2 + i] = images.len;
+        ret |= buffer_printf(&images, "%d 0 obj\n<< /Type /XObject /Subtype /Image /Width %d /Height %d /ImageMask true "
+                                      "/BitsPerComponent 1 /Length %d >>\nstream\n",
+                             image_obj + i, size, size, row_bytes * size);
+        ret |= buffer_reserve(&images, (size_t)row_bytes * size);
+        if (ret != 0)
+        {
+            break;
+        }
+        for (int y = 0; y < size; y++)
+        {
+            // Con ImageMask los bits en 0 se pintan, los modulos claros quedan en 1
+            uint8_t *row = (uint8_t *)images.data + images.len;
+            memset(row, 0xFF, row_bytes);
+            for (int x = 0; x < size; x++)
+            {
+                if (qrcodegen_getModule(encoder->qr, x, y))
+                {
+                    row[x / 8] &= (uint8_t)~(0x80 >> (x % 8));
+                }
+            }
+            images.len += row_bytes;
+        }
+        ret |= buffer_printf(&images, "\nendstream\nendobj\n");
+
+        // Las etiquetas se ubican de izquierda a derecha y de arriba hacia abajo
+        int col = i % layout->cols;
+        int row = i / layout->cols;
+        double cell_x = margin + col * cell_w;
+        double cell_top = SHEET_HEIGHT_PT - margin - row * cell_h;
+        double quiet = side * LABEL_QUIET_ZONE / (size + 2 * LABEL_QUIET_ZONE);
+        double qr_side = side - 2 * quiet;
+        double qr_x = cell_x + (cell_w - side) / 2 + quiet;
+        double qr_y = cell_top - side + quiet;
+        double text_x = cell_x + (cell_w - strlen(labels[i].name) * COURIER_ADVANCE * font_size) / 2;
+        double text_y = cell_top - side - font_size * 0.8;
+        ret |= buffer_printf(&content, "q %.3f 0 0 %.3f %.3f %.3f cm /Q%d Do Q\n", qr_side, qr_side, qr_x, qr_y, i);
+        ret |= buffer_printf(&content, "BT /F1 %.2f Tf %.3f %.3f Td (%s) Tj ET\n", font_size, text_x, text_y, labels[i].name);
+    }
+
+    if (ret == 0)
+    {
+        offsets[0] = out->len;
+        ret |= buffer_printf(out, "%d 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 %.2f %.2f] "
+                                  "/Resources << /Font << /F1 %d 0 R >> /XObject <<",
+                             first_obj, SHEET_WIDTH_PT, SHEET_HEIGHT_PT, font_obj);
+        for (int i = 0; i < count; i++)
+        {
+            ret |= buffer_printf(out, " /Q%d %d 0 R", i, image_obj + i);
+        }
+        ret |= buffer_printf(out, " >> >> /Contents %d 0 R >>\nendobj\n", content_obj);
+
+        offsets[1] = out->len;
+        ret |= buffer_printf(out, "%d 0 obj\n<< /Length %zu >>\nstream\n", content_obj, content.len);
+        ret |= buffer_append(out, content.data, content.len);
+        ret |= buffer_printf(out, "endstream\nendobj\n");
+
+        size_t images_start = out->len;
+        ret |= buffer_append(out, images.data, images.len);
+        for (int i = 0; i < count; i++)
+        {
+            offsets[2 + i] += images_start;
+        }
+    }
+
+    buffer_free(&content);
+    buffer_free(&images);
+    return ret;
+}
+
+int buffer_append(buffer_t *buf, const void *data, size_t len)
+{
+    if (buffer_reserve(buf, len) != 0)
+    {
+        return -1;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+int buffer_printf(buffer_t *buf, const char *fmt, ...)
+{
+    for (;;)
+    {
+        size_t room = buf->cap - buf->len;
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(buf->data ? buf->data + buf->len : NULL, room, fmt, args);
+        va_end(args);
+        if (len < 0)
+        {
+            return -1;
+        }
+        if ((size_t)len < room)
+        {
+            buf->len += (size_t)len;
+            return 0;
+        }
+        if (buffer_reserve(buf, (size_t)len + 1) != 0)
+        {
+            return -1;
+        }
+    }
+}
+
+void buffer_free(buffer_t *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int buffer_reserve(buffer_t *buf, size_t extra)
+{
+    if (buf->len + extra <= buf->cap)
+    {
+        return 0;
+    }
+    size_t cap = buf->cap ? buf->cap : 4096;
+    while (cap < buf->len + extra)
+    {
+        cap *= 2;
+    }
+    char *data = realloc(buf->data, cap);
+    if (data == NULL)
+    {
+        return -1;
+    }
+    buf->data = data;
+    buf->cap = cap;
+    return 0;
+}
@@ -0,0 +1,261 @@
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "label_sheet.h"
+
+//=====[Declaration of private defines]========================================
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+
+// Una columna de separacion entre caracteres
+#define GLYPH_ADVANCE (GLYPH_WIDTH + 1)
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    uint8_t *pixels;
+    int width;
+    int height;
+    int stride;
+} bitmap_t;
+
+typedef struct
+{
+    char c;
+    uint8_t rows[GLYPH_HEIGHT];
+} glyph_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+// Solo hacen falta los caracteres de los nombres PROV_XXXXXX, el bit 4 es la columna izquierda
+static const glyph_t glyphs[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'_', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}},
+};
+
+static const uint8_t png_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void fill_rect(bitmap_t *bitmap, int x, int y, int w, int h);
+
+static void draw_text(bitmap_t *bitmap, const char *text, int x, int y, int scale);
+
+static int write_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t len);
+
+static void put_u32(uint8_t *p, uint32_t value);
+
+//=====[Implementations of public functions]===================================
+
+int sheet_png_write(const label_t *labels, int count, const sheet_layout_t *layout, label_encoder_t *encoder,
+                    const char *path)
+{
+    double px_per_mm = layout->dpi / 25.4;
+    bitmap_t bitmap = {
+        .width = (int)(SHEET_WIDTH_MM * px_per_mm + 0.5),
+        .height = (int)(SHEET_HEIGHT_MM * px_per_mm + 0.5),
+    };
+
+    // Cada fila lleva adelante el byte de filtro de PNG (0, sin filtro)
+    bitmap.stride = 1 + (bitmap.width + 7) / 8;
+    size_t raw_len = (size_t)bitmap.stride * bitmap.height;
+    bitmap.pixels = malloc(raw_len);
+    if (bitmap.pixels == NULL)
+    {
+        return -1;
+    }
+    memset(bitmap.pixels, 0xFF, raw_len);
+    for (int y = 0; y < bitmap.height; y++)
+    {
+        bitmap.pixels[(size_t)y * bitmap.stride] = 0;
+    }
+
+    int margin = (int)(SHEET_MARGIN_MM * px_per_mm + 0.5);
+    int cell_w = (bitmap.width - 2 * margin) / layout->cols;
+    int cell_h = (bitmap.height - 2 * margin) / layout->rows;
+    int scale = cell_h * 7 / 100 / GLYPH_HEIGHT;
+    scale = (scale < 1) ? 1 : scale;
+    int text_h = (GLYPH_HEIGHT + 2) * scale;
+    int side = (cell_w < cell_h - text_h) ? cell_w : cell_h - text_h;
+
+    int ret = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int size = label_encode(&labels[i], encoder);
+        if (size == 0)
+        {
+            ret = -1;
+            break;
+        }
+
+        // Modulos de un numero entero de pixeles para que la impresora no los deforme
+        int module = side / (size + 2 * LABEL_QUIET_ZONE);
+        if (module < 1)
+        {
+            ret = -1;
+            break;
+        }
+        int qr_px = module * size;
+        int cell_x = margin + (i % layout->cols) * cell_w;
+        int cell_y = margin + (i / layout->cols) * cell_h;
+        int qr_x = cell_x + (cell_w - qr_px) / 2;
+        int qr_y = cell_y + (side - qr_px) / 2;
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                if (qrcodegen_getModule(encoder->qr, x, y))
+                {
+                    fill_rect(&bitmap, qr_x + x * module, qr_y + y * module, module, module);
+                }
+            }
+        }
+
+        int text_w = (int)strlen(labels[i].name) * GLYPH_ADVANCE * scale - scale;
+        draw_text(&bitmap, labels[i].name, cell_x + (cell_w - text_w) / 2, cell_y + side, scale);
+    }
+
+    // Las hojas son casi todas blancas, el nivel mas rapido de zlib comprime igual de bien
+    uLongf idat_len = compressBound(raw_len);
+    uint8_t *idat = (ret == 0) ? malloc(idat_len) : NULL;
+    if (idat == NULL || compress2(idat, &idat_len, bitmap.pixels, raw_len, Z_BEST_SPEED) != Z_OK)
+    {
+        free(idat);
+        free(bitmap.pixels);
+        return -1;
+    }
+    free(bitmap.pixels);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        free(idat);
+        return -1;
+    }
+
+    // Escala de grises de 1 bit, sin entrelazado
+    uint8_t ihdr[13];
+    put_u32(&ihdr[0], (uint32_t)bitmap.width);
+    put_u32(&ihdr[4], (uint32_t)bitmap.height);
+    ihdr[8] = 1;
+    ihdr[9] = 0;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+
+    // La resolucion va en pixeles por metro para que el visor imprima a tamano real
+    uint8_t phys[9];
+    uint32_t px_per_m = (uint32_t)(layout->dpi / 0.0254 + 0.5);
+    put_u32(&phys[0], px_per_m);
+    put_u32(&phys[4], px_per_m);
+    phys[8] = 1;
+
+    ret = (fwrite(png_signature, sizeof(png_signature), 1, file) == 1) ? 0 : -1;
+    ret |= write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+    ret |= write_chunk(file, "pHYs", phys, sizeof(phys));
+    ret |= write_chunk(file, "IDAT", idat, (uint32_t)idat_len);
+    ret |= write_chunk(file, "IEND", NULL, 0);
+    ret |= (fclose(file) == 0) ? 0 : -1;
+    free(idat);
+    return ret;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void fill_rect(bitmap_t *bitmap, int x, int y, int w, int h)
+{
+    for (int row = y; row < y + h && row < bitmap->height; row++)
+    {
+        uint8_t *line = bitmap->pixels + (size_t)row * bitmap->stride + 1;
+        for (int col = x; col < x + w && col < bitmap->width; col++)
+        {
+            line[col / 8] &= (uint8_t)~(0x80 >> (col % 8));
+        }
+    }
+}
+
+static void draw_text(bitmap_t *bitmap, const char *text, int x, int y, int scale)
+{
+    for (; *text; text++, x += GLYPH_ADVANCE * scale)
+    {
+        const glyph_t *glyph = NULL;
+        for (size_t i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); i++)
+        {
+            if (glyphs[i].c == *text)
+            {
+                glyph = &glyphs[i];
+                break;
+            }
+        }
+        if (glyph == NULL)
+        {
+            continue;
+        }
+        for (int row = 0; row < GLYPH_HEIGHT; row++)
+        {
+            for (int col = 0; col < GLYPH_WIDTH; col++)
+            {
+                if (glyph->rows[row] & (0x10 >> col))
+                {
+                    fill_rect(bitmap, x + col * scale, y + row * scale, scale, scale);
+                }
+            }
+        }
+    }
+}
+
+static int write_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t len)
+{
+    uint8_t header[8];
+    put_u32(&header[0], len);
+    memcpy(&header[4], type, 4);
+
+    uint8_t trailer[4];
+    uLong crc = crc32(0, &header[4], 4);
+    if (len > 0)
+    {
+        crc = crc32(crc, data, len);
+    }
+    put_u32(trailer, (uint32_t)crc);
+
+    if (fwrite(header, sizeof(header), 1, file) != 1 || (len > 0 && fwrite(data, len, 1, file) != 1) ||
+        fwrite(trailer, sizeof(trailer), 1, file) != 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
@@ -0,0 +1,279 @@
+//=====[Libraries]=============================================================
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "roam_policy.h"
+
+//=====[Declaration of private defines]========================================
+
+#define LINE_MAX_LEN 256
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum
+{
+    EVENT_SAMPLE,
+    EVENT_NEIGHBORS,
+    EVENT_CONNECTED,
+} event_kind_t;
+
+// Una linea de la traza. expect < 0 si la linea no trae la accion esperada
+typedef struct
+{
+    uint32_t ms;
+    event_kind_t kind;
+    int32_t value;
+    uint32_t tx_ok;
+    uint32_t tx_fail;
+    int expect;
+} trace_event_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const char *ACTION_NAMES[] = {"none", "neighbors", "transition"};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int parse_line(char *line, trace_event_t *event);
+
+static int parse_csv(char *line, trace_event_t *event);
+
+static int parse_log(const char *line, trace_event_t *event);
+
+static int parse_action(const char *name);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    roam_policy_config_t config = {
+        .rssi_threshold = CONFIG_ROAMING_RSSI_THRESHOLD,
+        .rssi_hysteresis = CONFIG_ROAMING_RSSI_HYSTERESIS,
+        .tx_fail_threshold_permille = CONFIG_ROAMING_TX_FAIL_PERMILLE,
+        .ewma_shift = CONFIG_ROAMING_EWMA_SHIFT,
+        .neighbor_timeout_ms = CONFIG_ROAMING_NEIGHBOR_TIMEOUT_MS,
+        .cooldown_ms = CONFIG_ROAMING_COOLDOWN_MS,
+    };
+    int verbose = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:y:f:s:n:c:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            config.rssi_threshold = (int8_t)atoi(optarg);
+            break;
+        case 'y':
+            config.rssi_hysteresis = (uint8_t)atoi(optarg);
+            break;
+        case 'f':
+            config.tx_fail_threshold_permille = (uint16_t)atoi(optarg);
+            break;
+        case 's':
+            config.ewma_shift = (uint8_t)atoi(optarg);
+            break;
+        case 'n':
+            config.neighbor_timeout_ms = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            config.cooldown_ms = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-t rssi threshold] [-y hysteresis] [-f tx fail permille] [-s ewma shift] "
+                        "[-n neighbor timeout ms] [-c cooldown ms] [-v] trace\n", argv[0]);
+        return 2;
+    }
+    FILE *file = fopen(argv[optind], "r");
+    if (file == NULL)
+    {
+        perror(argv[optind]);
+        return 2;
+    }
+
+    roam_policy_t policy;
+    roam_policy_init(&policy, &config);
+    unsigned counts[3] = {0};
+    unsigned checked = 0;
+    unsigned mismatches = 0;
+    unsigned line_number = 0;
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        trace_event_t event;
+        int ret = parse_line(line, &event);
+        if (ret < 0)
+        {
+            fprintf(stderr, "%s:%u: invalid line\n", argv[optind], line_number);
+            fclose(file);
+            return 2;
+        }
+        if (ret == 0)
+        {
+            continue;
+        }
+
+        // Mismas llamadas que roaming.c: el timer del monitor, el reporte de vecinos y la asociacion
+        roam_action_t action = ROAM_ACTION_NONE;
+        switch (event.kind)
+        {
+        case EVENT_SAMPLE:
+            action = roam_policy_update(&policy, (int8_t)event.value, event.tx_ok, event.tx_fail, event.ms);
+            break;
+        case EVENT_NEIGHBORS:
+            action = roam_policy_on_neighbor_report(&policy, (uint8_t)event.value, event.ms);
+            break;
+        case EVENT_CONNECTED:
+            roam_policy_on_connected(&policy, event.ms);
+            break;
+        }
+        counts[action]++;
+
+        if (verbose || action != ROAM_ACTION_NONE)
+        {
+            printf("%8" PRIu32 " ms  rssi %4d dBm  tx fail %4u permille  %s\n", event.ms, roam_policy_rssi(&policy),
+                   roam_policy_tx_fail_permille(&policy), ACTION_NAMES[action]);
+        }
+        if (event.expect >= 0)
+        {
+            checked++;
+            if (event.expect != (int)action)
+            {
+                printf("%s:%u: expected %s, got %s\n", argv[optind], line_number, ACTION_NAMES[event.expect],
+                       ACTION_NAMES[action]);
+                mismatches++;
+            }
+        }
+    }
+    fclose(file);
+
+    printf("neighbor requests %u, transition requests %u, %u of %u expected actions matched\n",
+           counts[ROAM_ACTION_REQUEST_NEIGHBORS], counts[ROAM_ACTION_REQUEST_TRANSITION], checked - mismatches, checked);
+    return (mismatches == 0) ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int parse_line(char *line, trace_event_t *event)
+{
+    // Devuelve 1 si la linea es un evento, 0 si se ignora y -1 si es invalida
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#')
+    {
+        return 0;
+    }
+    // Las lineas del monitor tienen el tiempo entre parentesis, las del CSV no
+    if (strchr(line, '(') != NULL)
+    {
+        return parse_log(line, event);
+    }
+    return parse_csv(line, event);
+}
+
+static int parse_csv(char *line, trace_event_t *event)
+{
+    // ms,tipo,valor,tx_ok,tx_fail,esperado con tipo sample (valor = RSSI), neighbors (valor = candidatos) o connected
+    char *fields[6] = {NULL};
+    size_t count = 0;
+    // strsep mantiene los campos vacios, las lineas de neighbors y connected no tienen tx_ok ni tx_fail
+    char *rest = line;
+    while (rest != NULL && count < 6)
+    {
+        fields[count++] = strsep(&rest, ",");
+    }
+    if (count < 2)
+    {
+        return -1;
+    }
+    memset(event, 0, sizeof(*event));
+    event->ms = (uint32_t)strtoul(fields[0], NULL, 10);
+    event->expect = -1;
+    if (strcmp(fields[1], "sample") == 0 && count >= 5)
+    {
+        event->kind = EVENT_SAMPLE;
+        event->value = atoi(fields[2]);
+        event->tx_ok = (uint32_t)strtoul(fields[3], NULL, 10);
+        event->tx_fail = (uint32_t)strtoul(fields[4], NULL, 10);
+    }
+    else if (strcmp(fields[1], "neighbors") == 0 && count >= 3)
+    {
+        event->kind = EVENT_NEIGHBORS;
+        event->value = atoi(fields[2]);
+    }
+    else if (strcmp(fields[1], "connected") == 0)
+    {
+        event->kind = EVENT_CONNECTED;
+    }
+    else
+    {
+        return -1;
+    }
+    if (count == 6)
+    {
+        event->expect = parse_action(fields[5]);
+        if (event->expect < 0)
+        {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static int parse_log(const char *line, trace_event_t *event)
+{
+    // Lineas del monitor con el log del componente en nivel debug: "D (12345) roaming: Sample rssi=... tx_ok=... tx_fail=..."
+    const char *time = strchr(line, '(');
+    const char *text = strstr(line, "roaming:");
+    if (text == NULL)
+    {
+        return 0;
+    }
+    memset(event, 0, sizeof(*event));
+    event->ms = (uint32_t)strtoul(time + 1, NULL, 10);
+    event->expect = -1;
+    text += strlen("roaming:");
+    int rssi;
+    unsigned ok;
+    unsigned fail;
+    unsigned candidates;
+    if (sscanf(text, " Sample rssi=%d tx_ok=%u tx_fail=%u", &rssi, &ok, &fail) == 3)
+    {
+        event->kind = EVENT_SAMPLE;
+        event->value = rssi;
+        event->tx_ok = ok;
+        event->tx_fail = fail;
+        return 1;
+    }
+    if (sscanf(text, " Neighbor report received with %u candidates", &candidates) == 1)
+    {
+        event->kind = EVENT_NEIGHBORS;
+        event->value = (int32_t)candidates;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_action(const char *name)
+{
+    for (size_t i = 0; i < sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]); i++)
+    {
+        if (strcmp(name, ACTION_NAMES[i]) == 0)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
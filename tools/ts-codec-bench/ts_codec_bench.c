@@ -0,0 +1,447 @@
+//=====[Libraries]=============================================================
+
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ts_codec.h"
+
+//=====[Declaration of private defines]========================================
+
+#define MAX_THREADS 16
+#define LINE_MAX_LEN 512
+
+// Cada medicion repite la traza hasta juntar al menos este tiempo
+#define MEASURE_MIN_NS 200000000ULL
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct
+{
+    int64_t *timestamps;
+    int32_t *values;
+    uint8_t channels;
+    size_t count;
+} trace_t;
+
+typedef struct
+{
+    const trace_t *trace;
+    ts_codec_config_t config;
+    size_t block_size;
+    uint8_t *out;
+    size_t out_len;
+    size_t blocks;
+    double encode_mb_s;
+} job_t;
+
+//=====[Declaration and initialization of private global constants]============
+
+static const struct
+{
+    const char *name;
+    ts_codec_mode_t mode;
+    bool dictionary;
+} MODES[] = {
+    {"delta", TS_CODEC_DELTA, false},
+    {"delta+dict", TS_CODEC_DELTA, true},
+    {"xor", TS_CODEC_XOR, false},
+    {"xor+dict", TS_CODEC_XOR, true},
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int load_trace(const char *path, trace_t *trace);
+
+static void generate_trace(size_t count, trace_t *trace);
+
+static int trace_push(trace_t *trace, size_t *capacity, int64_t timestamp, const int32_t *values, uint8_t channels);
+
+static size_t encode_trace(const trace_t *trace, const ts_codec_config_t *config, size_t block_size, uint8_t *out,
+                           size_t *blocks);
+
+static void *encode_job(void *arg);
+
+static double decode_mb_s(const trace_t *trace, const uint8_t *data, size_t len, size_t block_size);
+
+static int verify(const trace_t *trace, const uint8_t *data, size_t len, size_t block_size);
+
+static int verify_partial(const uint8_t *block, size_t len, const trace_t *trace, size_t first);
+
+static size_t block_len(const uint8_t *data, size_t block_size, size_t remaining);
+
+static uint64_t now_ns(void);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char **argv)
+{
+    size_t block_size = 64;
+    unsigned threads = 1;
+    size_t generate = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "B:j:g:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'B':
+            block_size = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            threads = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            generate = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind > argc || (optind == argc) == (generate == 0) || threads == 0 || threads > MAX_THREADS)
+    {
+        fprintf(stderr, "usage: %s [-B block_size] [-j threads] <trace.csv | monitor.log> | -g records\n", argv[0]);
+        return 1;
+    }
+
+    trace_t trace;
+    if (generate > 0)
+    {
+        generate_trace(generate, &trace);
+    }
+    else if (load_trace(argv[optind], &trace) != 0)
+    {
+        fprintf(stderr, "%s: no records found\n", argv[optind]);
+        return 1;
+    }
+    if (block_size < TS_CODEC_HEADER_LEN + TS_CODEC_RECORD_MAX(trace.channels))
+    {
+        fprintf(stderr, "block size must be at least %u bytes\n", TS_CODEC_HEADER_LEN + TS_CODEC_RECORD_MAX(trace.channels));
+        return 1;
+    }
+
+    size_t raw_len = trace.count * (sizeof(int64_t) + trace.channels * sizeof(int32_t));
+    printf("%zu records, %u channels, %zu raw bytes, %zu byte blocks, %u threads\n\n", trace.count,
+           (unsigned)trace.channels, raw_len, block_size, threads);
+    printf("%-11s %10s %7s %7s %9s %12s %12s %12s\n", "mode", "bytes", "blocks", "ratio", "B/record", "enc_MB/s",
+           "enc_MB/s/core", "dec_MB/s");
+
+    for (size_t m = 0; m < sizeof(MODES) / sizeof(MODES[0]); m++)
+    {
+        // Cada hilo codifica la traza completa por su cuenta, como un nucleo por flujo
+        job_t jobs[MAX_THREADS];
+        pthread_t ids[MAX_THREADS];
+        for (unsigned i = 0; i < threads; i++)
+        {
+            jobs[i].trace = &trace;
+            jobs[i].config.channels = trace.channels;
+            jobs[i].config.mode = MODES[m].mode;
+            jobs[i].config.dictionary = MODES[m].dictionary;
+            jobs[i].block_size = block_size;
+            // En el peor caso un registro codificado ocupa menos del doble que el original
+            jobs[i].out = malloc(raw_len * 3 + block_size * 2);
+            pthread_create(&ids[i], NULL, encode_job, &jobs[i]);
+        }
+        double total_mb_s = 0;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            pthread_join(ids[i], NULL);
+            total_mb_s += jobs[i].encode_mb_s;
+        }
+
+        if (verify(&trace, jobs[0].out, jobs[0].out_len, block_size) != 0)
+        {
+            fprintf(stderr, "%s: decoded records do not match the trace\n", MODES[m].name);
+            return 1;
+        }
+        // El largo de cada bloque no cuenta, en la conexion lo lleva el encabezado de la trama
+        size_t encoded_len = jobs[0].out_len - 2 * jobs[0].blocks;
+        printf("%-11s %10zu %7zu %6.2fx %9.2f %12.1f %12.1f %12.1f\n", MODES[m].name, encoded_len, jobs[0].blocks,
+               (double)raw_len / (double)encoded_len, (double)encoded_len / (double)trace.count, total_mb_s,
+               total_mb_s / threads, decode_mb_s(&trace, jobs[0].out, jobs[0].out_len, block_size));
+        for (unsigned i = 0; i < threads; i++)
+        {
+            free(jobs[i].out);
+        }
+    }
+
+    free(trace.timestamps);
+    free(trace.values);
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static int load_trace(const char *path, trace_t *trace)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    memset(trace, 0, sizeof(*trace));
+    size_t capacity = 0;
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        int32_t values[TS_CODEC_MAX_CHANNELS];
+        long long timestamp;
+        unsigned sequence;
+        unsigned count;
+
+        // Log del monitor con los resumenes de bloque de la aplicacion
+        const char *block = strstr(line, "Block ");
+        if (block != NULL && sscanf(block, "Block %u at %lld ms: n=%u min=%" SCNd32 " max=%" SCNd32 " mean=%" SCNd32,
+                                    &sequence, &timestamp, &count, &values[1], &values[2], &values[3]) == 6)
+        {
+            values[0] = (int32_t)sequence;
+            if (trace_push(trace, &capacity, timestamp, values, 4) != 0)
+            {
+                break;
+            }
+            continue;
+        }
+
+        // CSV con el timestamp y un valor por canal, las lineas que no empiezan con un numero se saltean
+        char *cursor = line;
+        char *end;
+        timestamp = strtoll(cursor, &end, 10);
+        if (end == cursor)
+        {
+            continue;
+        }
+        uint8_t channels = 0;
+        while (*end == ',' && channels < TS_CODEC_MAX_CHANNELS)
+        {
+            cursor = end + 1;
+            values[channels] = (int32_t)strtol(cursor, &end, 10);
+            if (end == cursor)
+            {
+                break;
+            }
+            channels++;
+        }
+        if (channels > 0 && trace_push(trace, &capacity, timestamp, values, channels) != 0)
+        {
+            break;
+        }
+    }
+    fclose(file);
+    return (trace->count > 0) ? 0 : -1;
+}
+
+static void generate_trace(size_t count, trace_t *trace)
+{
+    // Senal lenta del ADC de 12 bits con ruido, muestreada cada 10 ms con un poco de jitter
+    memset(trace, 0, sizeof(*trace));
+    size_t capacity = 0;
+    uint32_t seed = 12345;
+    int64_t timestamp = 1735689600000LL;
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        int noise = (int)(seed >> 28) - 8;
+        int32_t value = (int32_t)(2048 + 900 * sin((double)i / 500.0) + noise);
+        timestamp += 10 + (((seed >> 20) & 0x7) == 0 ? 1 : 0);
+        trace_push(trace, &capacity, timestamp, &value, 1);
+    }
+}
+
+static int trace_push(trace_t *trace, size_t *capacity, int64_t timestamp, const int32_t *values, uint8_t channels)
+{
+    // Todos los registros tienen que tener la misma cantidad de canales que el primero
+    if (trace->count == 0)
+    {
+        trace->channels = channels;
+    }
+    else if (channels != trace->channels)
+    {
+        return 0;
+    }
+    if (trace->count == *capacity)
+    {
+        *capacity = (*capacity == 0) ? 1024 : *capacity * 2;
+        int64_t *timestamps = realloc(trace->timestamps, *capacity * sizeof(int64_t));
+        int32_t *all_values = realloc(trace->values, *capacity * trace->channels * sizeof(int32_t));
+        if (timestamps == NULL || all_values == NULL)
+        {
+            return -1;
+        }
+        trace->timestamps = timestamps;
+        trace->values = all_values;
+    }
+    trace->timestamps[trace->count] = timestamp;
+    memcpy(&trace->values[trace->count * trace->channels], values, trace->channels * sizeof(int32_t));
+    trace->count++;
+    return 0;
+}
+
+static size_t encode_trace(const trace_t *trace, const ts_codec_config_t *config, size_t block_size, uint8_t *out,
+                           size_t *blocks)
+{
+    // Los bloques se guardan uno detras de otro, cada uno precedido por su largo en 2 bytes, y devuelve el total
+    size_t len = 0;
+    *blocks = 0;
+    ts_codec_encoder_t enc;
+    ts_codec_encoder_init(&enc, config, &out[len + 2], block_size);
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        const int32_t *values = &trace->values[i * trace->channels];
+        if (ts_codec_encoder_append(&enc, trace->timestamps[i], values) == TS_CODEC_ERR_FULL)
+        {
+            out[len] = (uint8_t)enc.len;
+            out[len + 1] = (uint8_t)(enc.len >> 8);
+            len += 2 + enc.len;
+            (*blocks)++;
+            ts_codec_encoder_init(&enc, config, &out[len + 2], block_size);
+            ts_codec_encoder_append(&enc, trace->timestamps[i], values);
+        }
+    }
+    out[len] = (uint8_t)enc.len;
+    out[len + 1] = (uint8_t)(enc.len >> 8);
+    len += 2 + enc.len;
+    (*blocks)++;
+    return len;
+}
+
+static void *encode_job(void *arg)
+{
+    job_t *job = (job_t *)arg;
+    size_t raw_len = job->trace->count * (sizeof(int64_t) + job->trace->channels * sizeof(int32_t));
+    uint64_t start_ns = now_ns();
+    uint64_t elapsed_ns;
+    unsigned rounds = 0;
+    do
+    {
+        job->out_len = encode_trace(job->trace, &job->config, job->block_size, job->out, &job->blocks);
+        rounds++;
+        elapsed_ns = now_ns() - start_ns;
+    } while (elapsed_ns < MEASURE_MIN_NS);
+    job->encode_mb_s = (double)raw_len * rounds * 1000.0 / (double)elapsed_ns;
+    return NULL;
+}
+
+static double decode_mb_s(const trace_t *trace, const uint8_t *data, size_t len, size_t block_size)
+{
+    size_t raw_len = trace->count * (sizeof(int64_t) + trace->channels * sizeof(int32_t));
+    int64_t timestamp;
+    int32_t values[TS_CODEC_MAX_CHANNELS];
+    volatile int64_t sink = 0;
+    uint64_t start_ns = now_ns();
+    uint64_t elapsed_ns;
+    unsigned rounds = 0;
+    do
+    {
+        size_t pos = 0;
+        while (pos + 2 <= len)
+        {
+            size_t block = block_len(&data[pos], block_size, len - pos);
+            if (block == 0)
+            {
+                break;
+            }
+            ts_codec_decoder_t dec;
+            ts_codec_decoder_init(&dec, &data[pos + 2], block);
+            while (ts_codec_decoder_next(&dec, &timestamp, values) == 1)
+            {
+                sink += timestamp + values[0];
+            }
+            pos += 2 + block;
+        }
+        rounds++;
+        elapsed_ns = now_ns() - start_ns;
+    } while (elapsed_ns < MEASURE_MIN_NS);
+    (void)sink;
+    return (double)raw_len * rounds * 1000.0 / (double)elapsed_ns;
+}
+
+static int verify(const trace_t *trace, const uint8_t *data, size_t len, size_t block_size)
+{
+    size_t pos = 0;
+    size_t record = 0;
+    while (record < trace->count && pos + 2 <= len)
+    {
+        size_t block = block_len(&data[pos], block_size, len - pos);
+        if (block == 0)
+        {
+            return -1;
+        }
+        ts_codec_decoder_t dec;
+        if (ts_codec_decoder_init(&dec, &data[pos + 2], block) != 0)
+        {
+            return -1;
+        }
+        // Cada bloque cortado en cualquier byte tiene que devolver un prefijo de sus registros
+        if (verify_partial(&data[pos + 2], block, trace, record) != 0)
+        {
+            return -1;
+        }
+        int64_t timestamp;
+        int32_t values[TS_CODEC_MAX_CHANNELS];
+        int ret;
+        while ((ret = ts_codec_decoder_next(&dec, &timestamp, values)) == 1)
+        {
+            if (record >= trace->count || timestamp != trace->timestamps[record] ||
+                memcmp(values, &trace->values[record * trace->channels], trace->channels * sizeof(int32_t)) != 0)
+            {
+                return -1;
+            }
+            record++;
+        }
+        if (ret != 0)
+        {
+            return -1;
+        }
+        pos += 2 + block;
+    }
+    return (record == trace->count) ? 0 : -1;
+}
+
+static int verify_partial(const uint8_t *block, size_t len, const trace_t *trace, size_t first)
+{
+    for (size_t cut = TS_CODEC_HEADER_LEN; cut < len; cut++)
+    {
+        ts_codec_decoder_t dec;
+        ts_codec_decoder_init(&dec, block, cut);
+        int64_t timestamp;
+        int32_t values[TS_CODEC_MAX_CHANNELS];
+        size_t record = first;
+        int ret;
+        while ((ret = ts_codec_decoder_next(&dec, &timestamp, values)) == 1)
+        {
+            if (timestamp != trace->timestamps[record] ||
+                memcmp(values, &trace->values[record * trace->channels], trace->channels * sizeof(int32_t)) != 0)
+            {
+                return -1;
+            }
+            record++;
+        }
+        if (ret != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static size_t block_len(const uint8_t *data, size_t block_size, size_t remaining)
+{
+    size_t len = data[0] | ((size_t)data[1] << 8);
+    if (len == 0 || len > block_size || len + 2 > remaining)
+    {
+        return 0;
+    }
+    return len;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}